@@ -0,0 +1,385 @@
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "host_sim.h"
+#include "adc_config.h"
+#include "voltage_filter.h"
+#include "data_collector.h"
+#include "flash_storage.h"
+#include "filter_benchmark.h"
+#include "crc32.h"
+#include "sample_codec.h"
+#include "stage_profiler.h"
+#include "triple_buffer.h"
+#include "spsc_ring.h"
+
+// ==================================================
+// Host Benchmarks
+// Usage: airsoft-bench [name ...]   (no arguments runs everything)
+// Host timings are for relative comparison between implementations; the
+// virtual-clock figures (flash busy time) model the RP2040 directly.
+// ==================================================
+
+namespace {
+
+using BenchClock = std::chrono::steady_clock;
+
+double elapsed_ns(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::nano>(BenchClock::now() - start).count();
+}
+
+// Deterministic synthetic battery signal: ~10V baseline (ADC ~2000) with
+// broadband noise and occasional single-sample commutation spikes
+void make_synthetic_samples(uint16_t* out, uint32_t count) {
+    uint32_t lcg = 12345;
+    for (uint32_t i = 0; i < count; ++i) {
+        lcg = lcg * 1664525u + 1013904223u;
+        int32_t noise = static_cast<int32_t>((lcg >> 24) & 0x1F) - 16;
+        int32_t value = 2000 + noise;
+        if ((lcg & 0x3FF) == 0) {
+            value += 400;
+        }
+        out[i] = static_cast<uint16_t>(value);
+    }
+}
+
+// Keeps results observable so the optimiser cannot drop the work
+volatile float g_sink_f = 0.0f;
+volatile uint32_t g_sink_u = 0;
+
+// --------------------------------------------------
+// filter: VoltageFilter::process over a 10 s capture
+// --------------------------------------------------
+void bench_filter() {
+    constexpr uint32_t SAMPLES = ADCConfig::SAMPLE_RATE_HZ * 10;
+    constexpr int ROUNDS = 20;
+    static uint16_t samples[SAMPLES];
+    make_synthetic_samples(samples, SAMPLES);
+
+    VoltageFilter filter;
+    float acc = 0.0f;
+    auto start = BenchClock::now();
+    for (int r = 0; r < ROUNDS; ++r) {
+        filter.reset();
+        for (uint32_t i = 0; i < SAMPLES; ++i) {
+            acc += filter.process(samples[i]);
+        }
+    }
+    double ns = elapsed_ns(start);
+    g_sink_f = acc;
+
+    double per_sample = ns / (static_cast<double>(SAMPLES) * ROUNDS);
+    printf("filter   VoltageFilter::process        %8.2f ns/sample  (%.1f us per %lu-sample buffer)\n",
+           per_sample, per_sample * ADCConfig::BUFFER_SIZE / 1000.0,
+           static_cast<unsigned long>(ADCConfig::BUFFER_SIZE));
+
+    // Block API over DMA-sized buffers, with filtered output and statistics
+    static uint16_t filtered[ADCConfig::BUFFER_SIZE];
+    VoltageFilter::BlockStats stats;
+    uint64_t sum = 0;
+    start = BenchClock::now();
+    for (int r = 0; r < ROUNDS; ++r) {
+        filter.reset();
+        for (uint32_t offset = 0; offset + ADCConfig::BUFFER_SIZE <= SAMPLES; offset += ADCConfig::BUFFER_SIZE) {
+            filter.process_block(samples + offset, filtered, ADCConfig::BUFFER_SIZE, &stats);
+            sum += stats.last_filtered_q4;
+        }
+    }
+    ns = elapsed_ns(start);
+    g_sink_u = static_cast<uint32_t>(sum);
+
+    uint32_t blocked = (SAMPLES / ADCConfig::BUFFER_SIZE) * ADCConfig::BUFFER_SIZE;
+    per_sample = ns / (static_cast<double>(blocked) * ROUNDS);
+    printf("filter   VoltageFilter::process_block  %8.2f ns/sample  (%.1f us per %lu-sample buffer)\n",
+           per_sample, per_sample * ADCConfig::BUFFER_SIZE / 1000.0,
+           static_cast<unsigned long>(ADCConfig::BUFFER_SIZE));
+}
+
+// --------------------------------------------------
+// fixed: float vs fixed-point filter chain, time per sample and error
+// --------------------------------------------------
+void bench_fixed() {
+    StageProfiler::init_counter();
+    FilterBenchmark::print(FilterBenchmark::run(ADCConfig::SAMPLE_RATE_HZ * 10 / ADCConfig::BUFFER_SIZE));
+}
+
+// --------------------------------------------------
+// median: running median implementations across window sizes
+// --------------------------------------------------
+void bench_median() {
+    StageProfiler::init_counter();
+    FilterBenchmark::run_median_sweep(ADCConfig::SAMPLE_RATE_HZ * 10 / ADCConfig::BUFFER_SIZE);
+}
+
+// --------------------------------------------------
+// collector: DataCollector capture of 10 s in DMA-sized buffers
+// --------------------------------------------------
+void bench_collector() {
+    constexpr uint32_t DURATION_MS = 10000;
+    constexpr uint32_t SAMPLES = ADCConfig::SAMPLE_RATE_HZ * DURATION_MS / 1000;
+    static uint16_t raw[SAMPLES];
+    static uint16_t filtered[SAMPLES];
+    make_synthetic_samples(raw, SAMPLES);
+    memcpy(filtered, raw, sizeof(raw));
+
+    HostSim::reset();
+    DataCollector collector;
+    if (!collector.start_collection(DURATION_MS, true)) {
+        printf("collector: start_collection failed\n");
+        return;
+    }
+
+    double copy_ns = 0.0;
+    uint32_t buffers = 0;
+    for (uint32_t offset = 0; offset < SAMPLES && collector.is_collecting(); offset += ADCConfig::BUFFER_SIZE) {
+        uint32_t count = SAMPLES - offset;
+        if (count > ADCConfig::BUFFER_SIZE) count = ADCConfig::BUFFER_SIZE;
+        bool last = offset + count >= SAMPLES;
+        auto start = BenchClock::now();
+        collector.process_buffer(raw + offset, filtered + offset, count);
+        if (!last) {
+            copy_ns += elapsed_ns(start);
+            buffers++;
+        }
+    }
+    while (collector.service_write()) {
+    }
+
+    printf("collect  DataCollector::process_buffer %8.2f us/buffer  (final flush: %llu ms virtual flash time)\n",
+           buffers ? copy_ns / buffers / 1000.0 : 0.0,
+           static_cast<unsigned long long>(HostSim::get_flash_busy_us() / 1000));
+}
+
+// --------------------------------------------------
+// flash: write + verify a 10 s raw+filtered capture
+// --------------------------------------------------
+void bench_flash() {
+    constexpr uint32_t SAMPLES = ADCConfig::SAMPLE_RATE_HZ * 10;
+    static uint16_t raw[SAMPLES];
+    static uint16_t filtered[SAMPLES];
+    make_synthetic_samples(raw, SAMPLES);
+    memcpy(filtered, raw, sizeof(raw));
+
+    HostSim::reset();
+    FlashStorage::init();
+
+    auto start = BenchClock::now();
+    int id = FlashStorage::write_capture_dual(raw, filtered, SAMPLES, 0);
+    double write_ns = elapsed_ns(start);
+    uint64_t busy_us = HostSim::get_flash_busy_us();
+
+    start = BenchClock::now();
+    bool ok = id >= 0 && FlashStorage::verify_capture(id);
+    double verify_ns = elapsed_ns(start);
+    g_sink_u = ok;
+
+    printf("flash    write_capture_dual            %8.2f ms host, %llu ms virtual flash (%lu erases, %lu pages)\n",
+           write_ns / 1e6, static_cast<unsigned long long>(busy_us / 1000),
+           static_cast<unsigned long>(HostSim::get_flash_sector_erase_count()),
+           static_cast<unsigned long>(HostSim::get_flash_page_program_count()));
+    printf("flash    verify_capture                %8.2f ms host (%s)\n",
+           verify_ns / 1e6, ok ? "ok" : "FAILED");
+}
+
+// --------------------------------------------------
+// crc: bitwise vs slice-by-8 vs DMA sniffer over a RAM capture's worth
+// (the sniffer is emulated bit by bit here, so its host time is not
+// representative; the firmware BENCH CRC command times the hardware)
+// --------------------------------------------------
+void bench_crc() {
+    HostSim::reset();
+    StageProfiler::init_counter();
+    Crc32::run_benchmark(CollectConfig::RAM_CAPTURE_MAX_BYTES);
+}
+
+// --------------------------------------------------
+// codec: capture sample codec, time per sample, ratio and round trip
+// --------------------------------------------------
+void bench_codec() {
+    StageProfiler::init_counter();
+    SampleCodec::run_benchmark(ADCConfig::SAMPLE_RATE_HZ * 10);
+}
+
+// --------------------------------------------------
+// handoff: TripleBuffer under two threads (Core 1 publishing every loop,
+// Core 0 reading flat out), then the SpscRing behind EventQueue. Every word of a snapshot derives from its
+// sequence number, so a copy mixing two publishes is detected. An
+// unguarded copy of the same struct runs first to show the check works
+// --------------------------------------------------
+struct HandoffSnapshot {
+    uint32_t sequence;
+    uint32_t words[31];
+};
+
+void fill_snapshot(HandoffSnapshot* s, uint32_t sequence) {
+    s->sequence = sequence;
+    for (uint32_t i = 0; i < 31; ++i) {
+        s->words[i] = sequence * (2 * i + 1);
+    }
+}
+
+bool snapshot_torn(const HandoffSnapshot& s) {
+    for (uint32_t i = 0; i < 31; ++i) {
+        if (s.words[i] != s.sequence * (2 * i + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct HandoffResult {
+    uint32_t published;
+    uint32_t reads;
+    uint32_t fresh;
+    uint32_t torn;
+    uint32_t backwards;  // Older than a snapshot already seen
+};
+
+template <typename Publish, typename Read>
+HandoffResult run_handoff(Publish publish, Read read, double seconds) {
+    HandoffResult result = {0, 0, 0, 0, 0};
+    std::atomic<bool> stop(false);
+    std::thread producer([&]() {
+        uint32_t sequence = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            publish(++sequence);
+        }
+        result.published = sequence;
+    });
+
+    auto start = BenchClock::now();
+    uint32_t last = 0;
+    HandoffSnapshot copy;
+    while (std::chrono::duration<double>(BenchClock::now() - start).count() < seconds) {
+        read(&copy);
+        result.reads++;
+        if (snapshot_torn(copy)) {
+            result.torn++;
+        } else if (copy.sequence < last) {
+            result.backwards++;
+        } else if (copy.sequence > last) {
+            result.fresh++;
+            last = copy.sequence;
+        }
+    }
+    stop = true;
+    producer.join();
+    return result;
+}
+
+void print_handoff(const char* name, const HandoffResult& r) {
+    printf("handoff  %-22s %9lu published, %9lu reads (%lu fresh), %lu torn, %lu out of order\n", name,
+           static_cast<unsigned long>(r.published), static_cast<unsigned long>(r.reads),
+           static_cast<unsigned long>(r.fresh), static_cast<unsigned long>(r.torn),
+           static_cast<unsigned long>(r.backwards));
+}
+
+void bench_handoff() {
+    constexpr double SECONDS = 1.0;
+
+    static volatile HandoffSnapshot unguarded;
+    HandoffResult control = run_handoff(
+        [](uint32_t sequence) {
+            HandoffSnapshot s;
+            fill_snapshot(&s, sequence);
+            for (uint32_t i = 0; i < 31; ++i) unguarded.words[i] = s.words[i];
+            unguarded.sequence = sequence;
+        },
+        [](HandoffSnapshot* out) {
+            out->sequence = unguarded.sequence;
+            for (uint32_t i = 0; i < 31; ++i) out->words[i] = unguarded.words[i];
+        },
+        SECONDS);
+    print_handoff("unguarded copy", control);
+
+    static TripleBuffer<HandoffSnapshot> buffer;
+    HandoffResult triple = run_handoff(
+        [](uint32_t sequence) { fill_snapshot(&buffer.begin_write(), sequence); buffer.publish(); },
+        [](HandoffSnapshot* out) { *out = buffer.acquire(); },
+        SECONDS);
+    print_handoff("TripleBuffer", triple);
+    printf("handoff  TripleBuffer: %s\n", (triple.torn == 0 && triple.backwards == 0) ? "PASS" : "FAIL");
+
+    // Event ring: every item must arrive once, in order, intact. The
+    // producer retries while the ring is full (EventQueue drops instead)
+    struct RingItem {
+        uint32_t sequence;
+        uint32_t check;
+    };
+    constexpr uint32_t RING_ITEMS = 2000000;
+    static SpscRing<RingItem, EventConfig::RING_SIZE> ring;
+    uint32_t full = 0;
+    std::thread producer([&]() {
+        for (uint32_t sequence = 1; sequence <= RING_ITEMS; ++sequence) {
+            RingItem item = {sequence, sequence * 2654435761u};
+            while (!ring.push(item)) {
+                full++;
+                std::this_thread::yield();
+            }
+        }
+    });
+    uint32_t received = 0;
+    uint32_t bad = 0;
+    RingItem item;
+    while (received < RING_ITEMS) {
+        if (!ring.pop(&item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        received++;
+        if (item.sequence != received || item.check != item.sequence * 2654435761u) {
+            bad++;
+        }
+    }
+    producer.join();
+    printf("handoff  %-22s %9lu pushed, %9lu popped, %lu ring full, %lu lost/torn/out of order\n", "SpscRing",
+           static_cast<unsigned long>(RING_ITEMS), static_cast<unsigned long>(received),
+           static_cast<unsigned long>(full), static_cast<unsigned long>(bad));
+    printf("handoff  SpscRing: %s\n", (bad == 0 && ring.empty()) ? "PASS" : "FAIL");
+}
+
+struct Benchmark {
+    const char* name;
+    void (*run)();
+};
+
+const Benchmark BENCHMARKS[] = {
+    {"filter", bench_filter},
+    {"fixed", bench_fixed},
+    {"median", bench_median},
+    {"collector", bench_collector},
+    {"flash", bench_flash},
+    {"crc", bench_crc},
+    {"codec", bench_codec},
+    {"handoff", bench_handoff},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool ran_any = false;
+    for (const Benchmark& bench : BENCHMARKS) {
+        bool selected = (argc < 2);
+        for (int i = 1; i < argc; ++i) {
+            if (strcmp(argv[i], bench.name) == 0) {
+                selected = true;
+            }
+        }
+        if (selected) {
+            bench.run();
+            ran_any = true;
+        }
+    }
+
+    if (!ran_any) {
+        printf("Usage: %s [", argv[0]);
+        for (size_t i = 0; i < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); ++i) {
+            printf("%s%s", i ? "|" : "", BENCHMARKS[i].name);
+        }
+        printf("] ...\n");
+        return 1;
+    }
+    return 0;
+}
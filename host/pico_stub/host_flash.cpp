@@ -0,0 +1,136 @@
+#include "host_sim.h"
+#include "host_sim_internal.h"
+#include "hardware/flash.h"
+#include <stdio.h>
+#include <string.h>
+
+// ==================================================
+// RAM-backed Flash Image
+// ==================================================
+
+uint8_t host_xip_flash[PICO_FLASH_SIZE_BYTES];
+
+namespace {
+
+// Typical W25Q16JV timings (datasheet tPP, tSE, tBE2)
+constexpr uint64_t PAGE_PROGRAM_US = 400;
+constexpr uint64_t SECTOR_ERASE_US = 45000;
+constexpr uint64_t BLOCK_ERASE_US = 150000;
+
+bool g_flash_timing_enabled = true;
+uint32_t g_sector_erase_count = 0;
+uint32_t g_page_program_count = 0;
+uint64_t g_flash_busy_us = 0;
+
+// Flash powers up erased
+struct FlashImageInit {
+    FlashImageInit() { memset(host_xip_flash, 0xFF, sizeof(host_xip_flash)); }
+} g_flash_image_init;
+
+void flash_busy(uint64_t duration_us) {
+    g_flash_busy_us += duration_us;
+    if (g_flash_timing_enabled) {
+        HostSim::advance_us(duration_us);
+    }
+}
+
+} // namespace
+
+void host_flash_reset() {
+    memset(host_xip_flash, 0xFF, sizeof(host_xip_flash));
+    g_sector_erase_count = 0;
+    g_page_program_count = 0;
+    g_flash_busy_us = 0;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    if ((flash_offs % FLASH_SECTOR_SIZE) != 0 || (count % FLASH_SECTOR_SIZE) != 0 ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        host_sim_panic("flash_range_erase: bad range 0x%08x + %zu", flash_offs, count);
+    }
+
+    // Like the SDK's flash_range_erase: 64K block erases where aligned, sectors otherwise
+    uint64_t busy_us = 0;
+    uint32_t offset = flash_offs;
+    uint32_t end = flash_offs + static_cast<uint32_t>(count);
+    while (offset < end) {
+        if ((offset % FLASH_BLOCK_SIZE) == 0 && end - offset >= FLASH_BLOCK_SIZE) {
+            busy_us += BLOCK_ERASE_US;
+            offset += FLASH_BLOCK_SIZE;
+        } else {
+            busy_us += SECTOR_ERASE_US;
+            offset += FLASH_SECTOR_SIZE;
+        }
+    }
+
+    memset(host_xip_flash + flash_offs, 0xFF, count);
+    g_sector_erase_count += static_cast<uint32_t>(count / FLASH_SECTOR_SIZE);
+    flash_busy(busy_us);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count) {
+    if ((flash_offs % FLASH_PAGE_SIZE) != 0 || (count % FLASH_PAGE_SIZE) != 0 ||
+        flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        host_sim_panic("flash_range_program: bad range 0x%08x + %zu", flash_offs, count);
+    }
+
+    // NOR semantics: programming can only clear bits
+    for (size_t i = 0; i < count; ++i) {
+        host_xip_flash[flash_offs + i] &= data[i];
+    }
+    g_page_program_count += static_cast<uint32_t>(count / FLASH_PAGE_SIZE);
+    flash_busy(PAGE_PROGRAM_US * (count / FLASH_PAGE_SIZE));
+}
+
+// ==================================================
+// HostSim Flash Control
+// ==================================================
+
+namespace HostSim {
+
+uint8_t* flash_image() {
+    return host_xip_flash;
+}
+
+size_t flash_size() {
+    return sizeof(host_xip_flash);
+}
+
+bool flash_load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        return false;
+    }
+    memset(host_xip_flash, 0xFF, sizeof(host_xip_flash));
+    size_t read = fread(host_xip_flash, 1, sizeof(host_xip_flash), f);
+    fclose(f);
+    return read > 0;
+}
+
+bool flash_save(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (f == nullptr) {
+        return false;
+    }
+    size_t written = fwrite(host_xip_flash, 1, sizeof(host_xip_flash), f);
+    fclose(f);
+    return written == sizeof(host_xip_flash);
+}
+
+void set_flash_timing_enabled(bool enabled) {
+    g_flash_timing_enabled = enabled;
+}
+
+uint32_t get_flash_sector_erase_count() {
+    return g_sector_erase_count;
+}
+
+uint32_t get_flash_page_program_count() {
+    return g_page_program_count;
+}
+
+uint64_t get_flash_busy_us() {
+    return g_flash_busy_us;
+}
+
+} // namespace HostSim
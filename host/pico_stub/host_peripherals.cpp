@@ -0,0 +1,590 @@
+#include "host_sim.h"
+#include "host_sim_internal.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "pico/time.h"
+#include <string.h>
+
+// ==================================================
+// ADC Emulation
+// ==================================================
+
+adc_hw_t host_adc_regs = {};
+
+namespace {
+
+constexpr uint32_t ADC_FIFO_DEPTH = 4;
+
+uint16_t g_adc_fifo[ADC_FIFO_DEPTH];
+uint32_t g_adc_fifo_head = 0;
+uint32_t g_adc_fifo_level = 0;
+HostSim::AdcSource g_adc_source = nullptr;
+void* g_adc_source_context = nullptr;
+uint32_t g_adc_conversions = 0;
+uint32_t g_adc_fifo_overflows = 0;
+uint32_t g_adc_fcs_sticky = 0;  // OVER/UNDER, write-1-to-clear
+
+constexpr uint32_t ADC_FCS_STICKY_BITS = ADC_FCS_OVER_BITS | ADC_FCS_UNDER_BITS;
+
+// START_MANY pacing, kept in 1/256 ADC clock cycles to match DIV's fraction
+constexpr uint64_t ADC_CLOCK_HZ = 48000000;
+constexpr uint64_t ADC_CONVERSION_CYCLES = 96;
+constexpr uint64_t ADC_Q8_PER_US = ADC_CLOCK_HZ / 1000000 * 256;
+bool g_adc_free_running = false;
+uint64_t g_adc_next_q8 = 0;
+
+uint64_t adc_period_q8() {
+    uint64_t period = 256 + (adc_hw->div & (ADC_DIV_INT_BITS | ADC_DIV_FRAC_BITS));
+    return (period < ADC_CONVERSION_CYCLES * 256) ? ADC_CONVERSION_CYCLES * 256 : period;
+}
+
+inline void adc_write_ro(io_ro_32& reg, uint32_t value) {
+    *const_cast<volatile uint32_t*>(&reg) = value;
+}
+
+void adc_update_fcs_level() {
+    uint32_t fcs = adc_hw->fcs & ~(ADC_FCS_LEVEL_BITS | ADC_FCS_EMPTY_BITS | ADC_FCS_FULL_BITS);
+    fcs |= (g_adc_fifo_level << ADC_FCS_LEVEL_LSB) & ADC_FCS_LEVEL_BITS;
+    if (g_adc_fifo_level == 0) fcs |= ADC_FCS_EMPTY_BITS;
+    if (g_adc_fifo_level == ADC_FIFO_DEPTH) fcs |= ADC_FCS_FULL_BITS;
+    adc_hw->fcs = fcs;
+    adc_write_ro(adc_hw->fifo, g_adc_fifo_level > 0 ? g_adc_fifo[g_adc_fifo_head] : 0);
+}
+
+uint16_t adc_convert() {
+    uint16_t value = 0;
+    if (g_adc_source != nullptr) {
+        value = g_adc_source(g_adc_source_context) & 0x0FFF;
+    }
+    g_adc_conversions++;
+    adc_write_ro(adc_hw->result, value);
+    return value;
+}
+
+void adc_fifo_push(uint16_t value) {
+    if (!(adc_hw->fcs & ADC_FCS_EN_BITS)) {
+        return;
+    }
+    if (adc_hw->fcs & ADC_FCS_SHIFT_BITS) {
+        value >>= 4;
+    }
+    if (g_adc_fifo_level == ADC_FIFO_DEPTH) {
+        // Result discarded, as on hardware
+        g_adc_fcs_sticky |= ADC_FCS_OVER_BITS;
+        adc_hw->fcs |= ADC_FCS_OVER_BITS;
+        g_adc_fifo_overflows++;
+        return;
+    }
+    g_adc_fifo[(g_adc_fifo_head + g_adc_fifo_level) % ADC_FIFO_DEPTH] = value;
+    g_adc_fifo_level++;
+    adc_update_fcs_level();
+}
+
+uint16_t adc_fifo_pop() {
+    if (g_adc_fifo_level == 0) {
+        g_adc_fcs_sticky |= ADC_FCS_UNDER_BITS;
+        adc_hw->fcs |= ADC_FCS_UNDER_BITS;
+        return 0;
+    }
+    uint16_t value = g_adc_fifo[g_adc_fifo_head];
+    g_adc_fifo_head = (g_adc_fifo_head + 1) % ADC_FIFO_DEPTH;
+    g_adc_fifo_level--;
+    adc_update_fcs_level();
+    return value;
+}
+
+bool adc_dreq_asserted() {
+    if (!(adc_hw->fcs & ADC_FCS_DREQ_EN_BITS)) {
+        return false;
+    }
+    uint32_t thresh = (adc_hw->fcs & ADC_FCS_THRESH_BITS) >> ADC_FCS_THRESH_LSB;
+    if (thresh == 0) thresh = 1;
+    return g_adc_fifo_level >= thresh;
+}
+
+void adc_reset_registers() {
+    memset(static_cast<void*>(&host_adc_regs), 0, sizeof(host_adc_regs));
+    g_adc_fifo_head = 0;
+    g_adc_fifo_level = 0;
+    g_adc_fcs_sticky = 0;
+    g_adc_free_running = false;
+    adc_update_fcs_level();
+}
+
+} // namespace
+
+void host_adc_reset() {
+    adc_reset_registers();
+    g_adc_source = nullptr;
+    g_adc_source_context = nullptr;
+    g_adc_conversions = 0;
+    g_adc_fifo_overflows = 0;
+}
+
+void host_adc_register_written(volatile void* addr, uint32_t bits_written) {
+    if (addr == &adc_hw->fcs) {
+        // Alias writes leave OVER/UNDER as they were unless a 1 was written
+        g_adc_fcs_sticky &= ~bits_written;
+        adc_hw->fcs = (adc_hw->fcs & ~ADC_FCS_STICKY_BITS) | g_adc_fcs_sticky;
+        return;
+    }
+    if (addr != &adc_hw->cs) {
+        return;
+    }
+    if (adc_hw->cs & ADC_CS_EN_BITS) {
+        adc_hw->cs |= ADC_CS_READY_BITS;
+    } else {
+        adc_hw->cs &= ~ADC_CS_READY_BITS;
+        g_adc_free_running = false;
+        return;
+    }
+    if (!(adc_hw->cs & ADC_CS_START_MANY_BITS)) {
+        g_adc_free_running = false;
+    } else if (!g_adc_free_running) {
+        // First result one period after START_MANY is set
+        g_adc_free_running = true;
+        g_adc_next_q8 = time_us_64() * ADC_Q8_PER_US + adc_period_q8();
+    }
+    if (adc_hw->cs & ADC_CS_START_ONCE_BITS) {
+        // START_ONCE is self-clearing; the 2 µs conversion is treated as instantaneous
+        adc_hw->cs &= ~ADC_CS_START_ONCE_BITS;
+        adc_fifo_push(adc_convert());
+        host_sim_dispatch();
+    }
+}
+
+bool host_adc_next_conversion_us(uint64_t* when_us) {
+    if (!g_adc_free_running) {
+        return false;
+    }
+    *when_us = (g_adc_next_q8 + ADC_Q8_PER_US - 1) / ADC_Q8_PER_US;
+    return true;
+}
+
+void host_adc_free_running_conversion() {
+    g_adc_next_q8 += adc_period_q8();
+    adc_fifo_push(adc_convert());
+    host_sim_dispatch();
+}
+
+void adc_init(void) {
+    // Peripheral reset: registers and FIFO only, the harness's sample source stays
+    adc_reset_registers();
+    adc_hw->cs = ADC_CS_EN_BITS | ADC_CS_READY_BITS;
+}
+
+void adc_gpio_init(uint gpio) {
+    (void)gpio;
+}
+
+void adc_select_input(uint input) {
+    hw_write_masked(&adc_hw->cs, input << ADC_CS_AINSEL_LSB, ADC_CS_AINSEL_BITS);
+}
+
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift) {
+    hw_write_masked(&adc_hw->fcs,
+                    (en ? ADC_FCS_EN_BITS : 0) |
+                    (dreq_en ? ADC_FCS_DREQ_EN_BITS : 0) |
+                    (static_cast<uint32_t>(dreq_thresh) << ADC_FCS_THRESH_LSB) |
+                    (err_in_fifo ? ADC_FCS_ERR_BITS : 0) |
+                    (byte_shift ? ADC_FCS_SHIFT_BITS : 0),
+                    ADC_FCS_EN_BITS | ADC_FCS_DREQ_EN_BITS | ADC_FCS_THRESH_BITS |
+                    ADC_FCS_ERR_BITS | ADC_FCS_SHIFT_BITS);
+}
+
+bool adc_fifo_is_empty(void) {
+    return g_adc_fifo_level == 0;
+}
+
+uint8_t adc_fifo_get_level(void) {
+    return static_cast<uint8_t>(g_adc_fifo_level);
+}
+
+uint16_t adc_fifo_get(void) {
+    return adc_fifo_pop();
+}
+
+uint16_t adc_fifo_get_blocking(void) {
+    return adc_fifo_pop();
+}
+
+void adc_fifo_drain(void) {
+    g_adc_fifo_head = 0;
+    g_adc_fifo_level = 0;
+    adc_update_fcs_level();
+}
+
+uint16_t adc_read(void) {
+    return adc_convert();
+}
+
+// ==================================================
+// DMA Emulation
+// ==================================================
+
+dma_hw_t host_dma_regs = {};
+
+namespace {
+
+bool g_dma_claimed[NUM_DMA_CHANNELS] = {};
+uint32_t g_dma_reload_count[NUM_DMA_CHANNELS] = {};
+uint32_t g_sniff_accumulator = 0;  // Internal state; SNIFF_DATA shows it through OUT_REV/OUT_INV
+
+inline uint32_t dma_ctrl_field(uint32_t ctrl, uint32_t bits, uint32_t lsb) {
+    return (ctrl & bits) >> lsb;
+}
+
+bool dma_dreq_ready(uint32_t treq) {
+    switch (treq) {
+        case DREQ_FORCE:
+            return true;
+        case DREQ_ADC:
+            return adc_dreq_asserted();
+        default:
+            return false;
+    }
+}
+
+uintptr_t dma_next_addr(uintptr_t addr, uint32_t size, uint32_t ring_bits) {
+    if (ring_bits == 0) {
+        return addr + size;
+    }
+    uintptr_t mask = (static_cast<uintptr_t>(1) << ring_bits) - 1;
+    return (addr & ~mask) | ((addr + size) & mask);
+}
+
+uint32_t sniff_reverse(uint32_t value) {
+    uint32_t result = 0;
+    for (int i = 0; i < 32; ++i) {
+        result = (result << 1) | ((value >> i) & 1);
+    }
+    return result;
+}
+
+void sniff_publish() {
+    uint32_t value = g_sniff_accumulator;
+    if (dma_hw->sniff_ctrl & DMA_SNIFF_CTRL_OUT_REV_BITS) value = sniff_reverse(value);
+    if (dma_hw->sniff_ctrl & DMA_SNIFF_CTRL_OUT_INV_BITS) value = ~value;
+    dma_hw->sniff_data = value;
+}
+
+// CRC-32 (poly 0x04C11DB7) fed MSB-first with the transfer's data, bit
+// reversed across the transfer width in CRC32R mode
+void sniff_transfer(uint channel, uint32_t ctrl, uint32_t value, uint32_t size) {
+    uint32_t sniff = dma_hw->sniff_ctrl;
+    if (!(sniff & DMA_SNIFF_CTRL_EN_BITS) || !(ctrl & DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS) ||
+        dma_ctrl_field(sniff, DMA_SNIFF_CTRL_DMACH_BITS, DMA_SNIFF_CTRL_DMACH_LSB) != channel) {
+        return;
+    }
+
+    uint32_t bits = size * 8;
+    uint32_t calc = dma_ctrl_field(sniff, DMA_SNIFF_CTRL_CALC_BITS, DMA_SNIFF_CTRL_CALC_LSB);
+    if (calc == DMA_SNIFF_CTRL_CALC_VALUE_CRC32R) {
+        value = sniff_reverse(value) >> (32 - bits);
+    } else if (calc != DMA_SNIFF_CTRL_CALC_VALUE_CRC32) {
+        host_sim_panic("DMA sniffer mode %lu is not emulated", static_cast<unsigned long>(calc));
+    }
+    for (int i = static_cast<int>(bits) - 1; i >= 0; --i) {
+        uint32_t feedback = (g_sniff_accumulator >> 31) ^ ((value >> i) & 1);
+        g_sniff_accumulator = (g_sniff_accumulator << 1) ^ (feedback ? 0x04C11DB7u : 0);
+    }
+    sniff_publish();
+}
+
+void dma_complete(uint channel) {
+    dma_channel_hw_t& ch = dma_hw->ch[channel];
+    uint32_t bit = 1u << channel;
+    ch.ctrl_trig &= ~DMA_CH0_CTRL_TRIG_BUSY_BITS;
+
+    if (!(ch.ctrl_trig & DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS)) {
+        dma_hw->intr |= bit;
+        dma_hw->ints0 = dma_hw->intr & dma_hw->inte0;
+        dma_hw->ints1 = dma_hw->intr & dma_hw->inte1;
+    }
+
+    uint chain_to = dma_ctrl_field(ch.ctrl_trig, DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS, DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+    if (chain_to != channel) {
+        dma_channel_start(chain_to);
+    }
+
+    if (dma_hw->ints0 & bit) host_irq_raise(DMA_IRQ_0);
+    if (dma_hw->ints1 & bit) host_irq_raise(DMA_IRQ_1);
+}
+
+// A DMA write that lands in the channel register block (control-channel
+// idiom, e.g. rewriting another channel's count and triggering it)
+bool dma_register_write(uintptr_t addr, uint32_t value) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(&dma_hw->ch[0]);
+    uintptr_t end = reinterpret_cast<uintptr_t>(&dma_hw->ch[NUM_DMA_CHANNELS]);
+    if (addr < base || addr >= end) {
+        return false;
+    }
+
+    uint channel = static_cast<uint>((addr - base) / sizeof(dma_channel_hw_t));
+    dma_channel_hw_t& ch = dma_hw->ch[channel];
+    volatile void* reg = reinterpret_cast<volatile void*>(addr);
+    dma_channel_config config = {value};
+
+    if (reg == &ch.transfer_count || reg == &ch.al2_transfer_count || reg == &ch.al3_transfer_count) {
+        dma_channel_set_trans_count(channel, value, false);
+    } else if (reg == &ch.al1_transfer_count_trig) {
+        dma_channel_set_trans_count(channel, value, true);
+    } else if (reg == &ch.al1_ctrl || reg == &ch.al2_ctrl || reg == &ch.al3_ctrl) {
+        dma_channel_set_config(channel, &config, false);
+    } else if (reg == &ch.ctrl_trig) {
+        dma_channel_set_config(channel, &config, true);
+    } else {
+        host_sim_panic("DMA write to channel %u address register is not emulated", channel);
+    }
+    return true;
+}
+
+void dma_transfer_one(uint channel) {
+    dma_channel_hw_t& ch = dma_hw->ch[channel];
+    uint32_t ctrl = ch.ctrl_trig;
+    uint32_t size = 1u << dma_ctrl_field(ctrl, DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS, DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+    uint32_t ring_bits = dma_ctrl_field(ctrl, DMA_CH0_CTRL_TRIG_RING_SIZE_BITS, DMA_CH0_CTRL_TRIG_RING_SIZE_LSB);
+    bool ring_on_write = (ctrl & DMA_CH0_CTRL_TRIG_RING_SEL_BITS) != 0;
+
+    uint32_t value = 0;
+    if (ch.read_addr == reinterpret_cast<uintptr_t>(&adc_hw->fifo)) {
+        value = adc_fifo_pop();
+    } else {
+        memcpy(&value, reinterpret_cast<const void*>(ch.read_addr), size);
+    }
+    sniff_transfer(channel, ctrl, value, size);
+    if (!dma_register_write(ch.write_addr, value)) {
+        memcpy(reinterpret_cast<void*>(ch.write_addr), &value, size);
+    }
+
+    if (ctrl & DMA_CH0_CTRL_TRIG_INCR_READ_BITS) {
+        ch.read_addr = dma_next_addr(ch.read_addr, size, ring_on_write ? 0 : ring_bits);
+    }
+    if (ctrl & DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS) {
+        ch.write_addr = dma_next_addr(ch.write_addr, size, ring_on_write ? ring_bits : 0);
+    }
+
+    ch.transfer_count = ch.transfer_count - 1;
+    if (ch.transfer_count == 0) {
+        dma_complete(channel);
+    }
+}
+
+} // namespace
+
+void host_dma_reset() {
+    memset(static_cast<void*>(&host_dma_regs), 0, sizeof(host_dma_regs));
+    for (uint i = 0; i < NUM_DMA_CHANNELS; ++i) {
+        g_dma_claimed[i] = false;
+        g_dma_reload_count[i] = 0;
+    }
+    g_sniff_accumulator = 0;
+}
+
+void host_dma_service() {
+    bool moved = true;
+    while (moved) {
+        moved = false;
+        for (uint channel = 0; channel < NUM_DMA_CHANNELS; ++channel) {
+            dma_channel_hw_t& ch = dma_hw->ch[channel];
+            uint32_t treq = dma_ctrl_field(ch.ctrl_trig, DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS, DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+            while ((ch.ctrl_trig & DMA_CH0_CTRL_TRIG_BUSY_BITS) && dma_dreq_ready(treq)) {
+                dma_transfer_one(channel);
+                moved = true;
+            }
+        }
+    }
+}
+
+int dma_claim_unused_channel(bool required) {
+    for (uint i = 0; i < NUM_DMA_CHANNELS; ++i) {
+        if (!g_dma_claimed[i]) {
+            g_dma_claimed[i] = true;
+            return static_cast<int>(i);
+        }
+    }
+    if (required) {
+        host_sim_panic("No DMA channels are available");
+    }
+    return -1;
+}
+
+void dma_channel_claim(uint channel) {
+    if (channel >= NUM_DMA_CHANNELS || g_dma_claimed[channel]) {
+        host_sim_panic("DMA channel %u is already claimed", channel);
+    }
+    g_dma_claimed[channel] = true;
+}
+
+void dma_channel_unclaim(uint channel) {
+    if (channel < NUM_DMA_CHANNELS) {
+        g_dma_claimed[channel] = false;
+    }
+}
+
+bool dma_channel_is_claimed(uint channel) {
+    return channel < NUM_DMA_CHANNELS && g_dma_claimed[channel];
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    dma_channel_config c = {0};
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, DREQ_FORCE);
+    channel_config_set_chain_to(&c, channel);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_enable(&c, true);
+    return c;
+}
+
+void dma_channel_set_config(uint channel, const dma_channel_config* config, bool trigger) {
+    dma_channel_hw_t& ch = dma_hw->ch[channel];
+    ch.ctrl_trig = (config->ctrl & ~DMA_CH0_CTRL_TRIG_BUSY_BITS) | (ch.ctrl_trig & DMA_CH0_CTRL_TRIG_BUSY_BITS);
+    if (trigger) {
+        dma_channel_start(channel);
+    }
+}
+
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger) {
+    dma_hw->ch[channel].read_addr = reinterpret_cast<uintptr_t>(read_addr);
+    if (trigger) {
+        dma_channel_start(channel);
+    }
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void* write_addr, bool trigger) {
+    dma_hw->ch[channel].write_addr = reinterpret_cast<uintptr_t>(write_addr);
+    if (trigger) {
+        dma_channel_start(channel);
+    }
+}
+
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    g_dma_reload_count[channel] = trans_count;
+    if (!(dma_hw->ch[channel].ctrl_trig & DMA_CH0_CTRL_TRIG_BUSY_BITS)) {
+        dma_hw->ch[channel].transfer_count = trans_count;
+    }
+    if (trigger) {
+        dma_channel_start(channel);
+    }
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger) {
+    dma_channel_set_read_addr(channel, read_addr, false);
+    dma_channel_set_write_addr(channel, write_addr, false);
+    dma_channel_set_trans_count(channel, transfer_count, false);
+    dma_channel_set_config(channel, config, trigger);
+}
+
+void dma_channel_start(uint channel) {
+    dma_channel_hw_t& ch = dma_hw->ch[channel];
+    if (!(ch.ctrl_trig & DMA_CH0_CTRL_TRIG_EN_BITS)) {
+        return;
+    }
+    ch.transfer_count = g_dma_reload_count[channel];
+    if (ch.transfer_count == 0) {
+        dma_complete(channel);
+    } else {
+        ch.ctrl_trig |= DMA_CH0_CTRL_TRIG_BUSY_BITS;
+    }
+    host_sim_dispatch();
+}
+
+void dma_start_channel_mask(uint32_t chan_mask) {
+    for (uint i = 0; i < NUM_DMA_CHANNELS; ++i) {
+        if (chan_mask & (1u << i)) {
+            dma_channel_start(i);
+        }
+    }
+}
+
+void dma_channel_abort(uint channel) {
+    dma_hw->ch[channel].ctrl_trig &= ~DMA_CH0_CTRL_TRIG_BUSY_BITS;
+}
+
+bool dma_channel_is_busy(uint channel) {
+    return (dma_hw->ch[channel].ctrl_trig & DMA_CH0_CTRL_TRIG_BUSY_BITS) != 0;
+}
+
+void dma_channel_wait_for_finish_blocking(uint channel) {
+    while (dma_channel_is_busy(channel)) {
+        host_sim_dispatch();
+    }
+}
+
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable) {
+    uint32_t keep = dma_hw->sniff_ctrl & (DMA_SNIFF_CTRL_OUT_REV_BITS | DMA_SNIFF_CTRL_OUT_INV_BITS);
+    dma_hw->sniff_ctrl = keep | DMA_SNIFF_CTRL_EN_BITS | (channel << DMA_SNIFF_CTRL_DMACH_LSB) |
+                         (mode << DMA_SNIFF_CTRL_CALC_LSB);
+    if (force_channel_enable) {
+        dma_hw->ch[channel].ctrl_trig |= DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS;
+    }
+    sniff_publish();
+}
+
+void dma_sniffer_disable(void) {
+    dma_hw->sniff_ctrl = 0;
+}
+
+void dma_sniffer_set_output_reverse_enabled(bool enable) {
+    dma_hw->sniff_ctrl = enable ? (dma_hw->sniff_ctrl | DMA_SNIFF_CTRL_OUT_REV_BITS)
+                                : (dma_hw->sniff_ctrl & ~DMA_SNIFF_CTRL_OUT_REV_BITS);
+    sniff_publish();
+}
+
+void dma_sniffer_set_output_invert_enabled(bool enable) {
+    dma_hw->sniff_ctrl = enable ? (dma_hw->sniff_ctrl | DMA_SNIFF_CTRL_OUT_INV_BITS)
+                                : (dma_hw->sniff_ctrl & ~DMA_SNIFF_CTRL_OUT_INV_BITS);
+    sniff_publish();
+}
+
+void dma_sniffer_set_data_accumulator(uint32_t seed_value) {
+    g_sniff_accumulator = seed_value;
+    sniff_publish();
+}
+
+uint32_t dma_sniffer_get_data_accumulator(void) {
+    return dma_hw->sniff_data;
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled) {
+    if (enabled) {
+        dma_hw->inte0 |= 1u << channel;
+    } else {
+        dma_hw->inte0 &= ~(1u << channel);
+    }
+    dma_hw->ints0 = dma_hw->intr & dma_hw->inte0;
+}
+
+bool dma_channel_get_irq0_status(uint channel) {
+    return (dma_hw->ints0 & (1u << channel)) != 0;
+}
+
+void dma_channel_acknowledge_irq0(uint channel) {
+    dma_hw->intr &= ~(1u << channel);
+    dma_hw->ints0 = dma_hw->intr & dma_hw->inte0;
+    dma_hw->ints1 = dma_hw->intr & dma_hw->inte1;
+}
+
+// ==================================================
+// HostSim ADC Control
+// ==================================================
+
+namespace HostSim {
+
+void set_adc_source(AdcSource source, void* context) {
+    g_adc_source = source;
+    g_adc_source_context = context;
+}
+
+uint32_t get_adc_conversion_count() {
+    return g_adc_conversions;
+}
+
+uint32_t get_adc_fifo_overflow_count() {
+    return g_adc_fifo_overflows;
+}
+
+} // namespace HostSim
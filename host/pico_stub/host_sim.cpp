@@ -0,0 +1,407 @@
+#include "host_sim.h"
+#include "host_sim_internal.h"
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+#include "hardware/watchdog.h"
+#include "hardware/structs/systick.h"
+#include "hardware/regs/m0plus.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <deque>
+
+// ==================================================
+// Emulator State
+// ==================================================
+
+namespace {
+
+struct AlarmState {
+    bool claimed;
+    bool armed;
+    uint64_t target_us;
+    hardware_alarm_callback_t callback;
+};
+
+uint64_t g_now_us = 0;
+AlarmState g_alarms[NUM_TIMERS] = {};
+
+irq_handler_t g_irq_handlers[NUM_IRQS] = {};
+bool g_irq_enabled[NUM_IRQS] = {};
+bool g_irq_pending[NUM_IRQS] = {};
+bool g_interrupts_enabled = true;
+
+bool g_dispatching = false;
+bool g_dispatch_again = false;
+
+std::deque<char> g_serial_input;
+
+using SysTickClock = std::chrono::steady_clock;
+systick_hw_t g_systick_regs = {};
+uint32_t g_systick_last_cvr = 0;
+bool g_systick_running = false;
+SysTickClock::time_point g_systick_epoch;
+
+void fire_alarm(uint alarm_num) {
+    hardware_alarm_callback_t callback = g_alarms[alarm_num].callback;
+    if (callback != nullptr) {
+        callback(alarm_num);
+    }
+}
+
+void timer_irq_0() { fire_alarm(0); }
+void timer_irq_1() { fire_alarm(1); }
+void timer_irq_2() { fire_alarm(2); }
+void timer_irq_3() { fire_alarm(3); }
+
+constexpr irq_handler_t TIMER_IRQ_HANDLERS[NUM_TIMERS] = {
+    timer_irq_0, timer_irq_1, timer_irq_2, timer_irq_3
+};
+
+// Earliest armed alarm due at or before limit_us
+bool next_alarm(uint64_t limit_us, int* index, uint64_t* when_us) {
+    int best = -1;
+    uint64_t best_us = 0;
+    for (int i = 0; i < NUM_TIMERS; ++i) {
+        if (!g_alarms[i].armed || g_alarms[i].target_us > limit_us) {
+            continue;
+        }
+        if (best < 0 || g_alarms[i].target_us < best_us) {
+            best = i;
+            best_us = g_alarms[i].target_us;
+        }
+    }
+    if (best < 0) {
+        return false;
+    }
+    *index = best;
+    *when_us = best_us;
+    return true;
+}
+
+void deliver_irqs() {
+    if (!g_interrupts_enabled) {
+        return;
+    }
+    for (uint num = 0; num < NUM_IRQS; ++num) {
+        if (!g_irq_pending[num] || !g_irq_enabled[num] || g_irq_handlers[num] == nullptr) {
+            continue;
+        }
+        g_irq_pending[num] = false;
+        g_irq_handlers[num]();
+        if (!g_interrupts_enabled) {
+            return;
+        }
+    }
+}
+
+} // namespace
+
+watchdog_hw_t host_watchdog_regs = {};
+
+// ==================================================
+// Dispatch & IRQ Delivery
+// ==================================================
+
+void host_sim_dispatch() {
+    if (g_dispatching) {
+        g_dispatch_again = true;
+        return;
+    }
+    g_dispatching = true;
+    do {
+        g_dispatch_again = false;
+        host_dma_service();
+        deliver_irqs();
+    } while (g_dispatch_again);
+    g_dispatching = false;
+}
+
+void host_irq_raise(uint num) {
+    if (num >= NUM_IRQS) {
+        return;
+    }
+    g_irq_pending[num] = true;
+    host_sim_dispatch();
+}
+
+void host_sim_panic(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "*** HOST PANIC *** ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    abort();
+}
+
+void host_sim_register_written(volatile void* addr, uint32_t bits_written) {
+    host_adc_register_written(addr, bits_written);
+}
+
+// ==================================================
+// hardware/irq.h & hardware/sync.h
+// ==================================================
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) {
+    if (num >= NUM_IRQS) {
+        host_sim_panic("irq_set_exclusive_handler: bad IRQ %u", num);
+    }
+    if (g_irq_handlers[num] != nullptr && g_irq_handlers[num] != handler) {
+        host_sim_panic("irq_set_exclusive_handler: IRQ %u already has a handler", num);
+    }
+    g_irq_handlers[num] = handler;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (num >= NUM_IRQS) {
+        return;
+    }
+    g_irq_enabled[num] = enabled;
+    if (enabled) {
+        host_sim_dispatch();
+    }
+}
+
+void irq_set_mask_enabled(uint32_t mask, bool enabled) {
+    for (uint num = 0; num < NUM_IRQS; ++num) {
+        if (mask & (1u << num)) {
+            g_irq_enabled[num] = enabled;
+        }
+    }
+    if (enabled) {
+        host_sim_dispatch();
+    }
+}
+
+bool irq_is_enabled(uint num) {
+    return num < NUM_IRQS && g_irq_enabled[num];
+}
+
+void irq_set_pending(uint num) {
+    host_irq_raise(num);
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    uint32_t status = g_interrupts_enabled ? 0 : 1;  // PRIMASK semantics
+    g_interrupts_enabled = false;
+    return status;
+}
+
+void restore_interrupts(uint32_t status) {
+    g_interrupts_enabled = (status == 0);
+    if (g_interrupts_enabled) {
+        host_sim_dispatch();
+    }
+}
+
+// ==================================================
+// pico/time.h & hardware/timer.h
+// ==================================================
+
+uint64_t time_us_64(void) {
+    return g_now_us;
+}
+
+void sleep_us(uint64_t us) {
+    HostSim::advance_us(us);
+}
+
+void hardware_alarm_claim(uint alarm_num) {
+    if (alarm_num >= NUM_TIMERS || g_alarms[alarm_num].claimed) {
+        host_sim_panic("hardware_alarm_claim: alarm %u unavailable", alarm_num);
+    }
+    g_alarms[alarm_num].claimed = true;
+}
+
+int hardware_alarm_claim_unused(bool required) {
+    for (uint i = 0; i < NUM_TIMERS; ++i) {
+        if (!g_alarms[i].claimed) {
+            g_alarms[i].claimed = true;
+            return static_cast<int>(i);
+        }
+    }
+    if (required) {
+        host_sim_panic("No alarms available");
+    }
+    return -1;
+}
+
+void hardware_alarm_unclaim(uint alarm_num) {
+    if (alarm_num < NUM_TIMERS) {
+        g_alarms[alarm_num] = AlarmState{};
+    }
+}
+
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback) {
+    if (alarm_num >= NUM_TIMERS) {
+        return;
+    }
+    g_alarms[alarm_num].callback = callback;
+    uint irq_num = TIMER_IRQ_0 + alarm_num;
+    if (callback != nullptr) {
+        g_irq_handlers[irq_num] = TIMER_IRQ_HANDLERS[alarm_num];
+        g_irq_enabled[irq_num] = true;
+    } else {
+        g_irq_enabled[irq_num] = false;
+        g_irq_handlers[irq_num] = nullptr;
+    }
+}
+
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t) {
+    if (alarm_num >= NUM_TIMERS) {
+        return true;
+    }
+    if (t <= g_now_us) {
+        g_alarms[alarm_num].armed = false;
+        return true;  // Missed, same as the SDK
+    }
+    g_alarms[alarm_num].armed = true;
+    g_alarms[alarm_num].target_us = t;
+    return false;
+}
+
+void hardware_alarm_cancel(uint alarm_num) {
+    if (alarm_num < NUM_TIMERS) {
+        g_alarms[alarm_num].armed = false;
+        g_irq_pending[TIMER_IRQ_0 + alarm_num] = false;
+    }
+}
+
+// ==================================================
+// pico/stdlib.h & hardware/watchdog.h
+// ==================================================
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void)timeout_us;
+    if (g_serial_input.empty()) {
+        return PICO_ERROR_TIMEOUT;
+    }
+    char c = g_serial_input.front();
+    g_serial_input.pop_front();
+    return static_cast<unsigned char>(c);
+}
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug) {
+    (void)pause_on_debug;
+    host_watchdog_regs.load = delay_ms * 1000;
+    host_watchdog_regs.ctrl |= WATCHDOG_CTRL_ENABLE_BITS;
+}
+
+void watchdog_update(void) {
+}
+
+// ==================================================
+// hardware/structs/systick.h
+// ==================================================
+
+systick_hw_t* host_systick_hw(void) {
+    if (!(g_systick_regs.csr & M0PLUS_SYST_CSR_ENABLE_BITS)) {
+        g_systick_running = false;
+        return &g_systick_regs;
+    }
+
+    // Enabling the counter or writing cvr restarts the count from rvr
+    if (!g_systick_running || g_systick_regs.cvr != g_systick_last_cvr) {
+        g_systick_epoch = SysTickClock::now();
+        g_systick_running = true;
+    }
+
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        SysTickClock::now() - g_systick_epoch).count();
+    uint64_t ticks = ns * 125 / 1000;
+    uint64_t period = static_cast<uint64_t>(g_systick_regs.rvr & 0x00FFFFFFu) + 1;
+    g_systick_regs.cvr = static_cast<uint32_t>(period - 1 - ticks % period);
+    g_systick_last_cvr = g_systick_regs.cvr;
+    return &g_systick_regs;
+}
+
+// ==================================================
+// HostSim Control API
+// ==================================================
+
+namespace HostSim {
+
+void reset() {
+    g_now_us = 0;
+    for (auto& alarm : g_alarms) {
+        alarm = AlarmState{};
+    }
+    for (uint i = 0; i < NUM_IRQS; ++i) {
+        g_irq_handlers[i] = nullptr;
+        g_irq_enabled[i] = false;
+        g_irq_pending[i] = false;
+    }
+    g_interrupts_enabled = true;
+    g_dispatching = false;
+    g_dispatch_again = false;
+    g_serial_input.clear();
+    memset(static_cast<void*>(&host_watchdog_regs), 0, sizeof(host_watchdog_regs));
+    memset(static_cast<void*>(&g_systick_regs), 0, sizeof(g_systick_regs));
+    g_systick_last_cvr = 0;
+    g_systick_running = false;
+    host_adc_reset();
+    host_dma_reset();
+    host_flash_reset();
+}
+
+uint64_t now_us() {
+    return g_now_us;
+}
+
+void advance_us(uint64_t delta_us) {
+    advance_to_us(g_now_us + delta_us);
+}
+
+void advance_to_us(uint64_t target_us) {
+    int index = 0;
+    uint64_t when_us = 0;
+    uint64_t adc_us = 0;
+    while (true) {
+        bool alarm_due = next_alarm(target_us, &index, &when_us);
+        bool adc_due = host_adc_next_conversion_us(&adc_us) && adc_us <= target_us;
+        if (!alarm_due && !adc_due) {
+            break;
+        }
+        if (adc_due && (!alarm_due || adc_us < when_us)) {
+            if (adc_us > g_now_us) {
+                g_now_us = adc_us;
+            }
+            host_adc_free_running_conversion();
+            continue;
+        }
+        if (when_us > g_now_us) {
+            g_now_us = when_us;
+        }
+        g_alarms[index].armed = false;
+        host_irq_raise(TIMER_IRQ_0 + index);
+    }
+    if (target_us > g_now_us) {
+        g_now_us = target_us;
+    }
+}
+
+bool next_event_us(uint64_t* when_us) {
+    int index = 0;
+    uint64_t alarm_us = 0;
+    uint64_t adc_us = 0;
+    bool alarm = next_alarm(UINT64_MAX, &index, &alarm_us);
+    bool adc = host_adc_next_conversion_us(&adc_us);
+    if (!alarm && !adc) {
+        return false;
+    }
+    *when_us = (alarm && (!adc || alarm_us <= adc_us)) ? alarm_us : adc_us;
+    return true;
+}
+
+void push_serial_input(const char* text) {
+    while (text != nullptr && *text != '\0') {
+        g_serial_input.push_back(*text++);
+    }
+}
+
+} // namespace HostSim
@@ -0,0 +1,32 @@
+#ifndef HOST_SIM_INTERNAL_H
+#define HOST_SIM_INTERNAL_H
+
+#include "pico.h"
+
+// ==================================================
+// Hooks shared between the emulator translation units
+// ==================================================
+
+// Mark an IRQ pending and deliver it if interrupts allow
+void host_irq_raise(uint num);
+
+// Run peripheral side effects (DMA transfers) and deliver pending IRQs.
+// Re-entrant calls are folded into the outermost dispatch loop.
+void host_sim_dispatch();
+
+// Abort with a message, like the SDK's panic()
+[[noreturn]] void host_sim_panic(const char* fmt, ...);
+
+// Peripheral hooks
+void host_adc_register_written(volatile void* addr, uint32_t bits_written);
+void host_adc_reset();
+
+// START_MANY conversions are timed events like alarms: the next one is due
+// at *when_us; the clock loop calls the conversion hook once it is reached
+bool host_adc_next_conversion_us(uint64_t* when_us);
+void host_adc_free_running_conversion();
+void host_dma_service();
+void host_dma_reset();
+void host_flash_reset();
+
+#endif // HOST_SIM_INTERNAL_H
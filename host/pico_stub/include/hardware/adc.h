@@ -0,0 +1,54 @@
+#ifndef HOST_HARDWARE_ADC_H
+#define HOST_HARDWARE_ADC_H
+
+#include "pico.h"
+#include "hardware/address_mapped.h"
+#include "hardware/regs/adc.h"
+
+// ==================================================
+// Emulated ADC
+// Conversions pull 12-bit values from the sample source installed with
+// HostSim::set_adc_source() and land in a 4-deep FIFO, as on the RP2040.
+// START_MANY free-runs on the virtual clock: one conversion every
+// max(96, 1 + DIV) cycles of the 48 MHz ADC clock (DIV is 16.8 fixed point).
+// ==================================================
+
+typedef struct {
+    io_rw_32 cs;
+    io_ro_32 result;
+    io_rw_32 fcs;
+    io_ro_32 fifo;
+    io_rw_32 div;
+    io_ro_32 intr;
+    io_rw_32 inte;
+    io_rw_32 intf;
+    io_ro_32 ints;
+} adc_hw_t;
+
+extern adc_hw_t host_adc_regs;
+#define adc_hw (&host_adc_regs)
+
+void adc_init(void);
+void adc_gpio_init(uint gpio);
+void adc_select_input(uint input);
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift);
+bool adc_fifo_is_empty(void);
+uint8_t adc_fifo_get_level(void);
+uint16_t adc_fifo_get(void);
+uint16_t adc_fifo_get_blocking(void);
+void adc_fifo_drain(void);
+uint16_t adc_read(void);
+
+static inline void adc_run(bool run) {
+    if (run) {
+        hw_set_bits(&adc_hw->cs, ADC_CS_START_MANY_BITS);
+    } else {
+        hw_clear_bits(&adc_hw->cs, ADC_CS_START_MANY_BITS);
+    }
+}
+
+static inline void adc_set_clkdiv(float clkdiv) {
+    adc_hw->div = static_cast<uint32_t>(clkdiv * static_cast<float>(1 << ADC_DIV_INT_LSB));
+}
+
+#endif // HOST_HARDWARE_ADC_H
@@ -0,0 +1,33 @@
+#ifndef HOST_HARDWARE_ADDRESS_MAPPED_H
+#define HOST_HARDWARE_ADDRESS_MAPPED_H
+
+#include "pico.h"
+
+// Register writes made through the SDK helpers are reported to the
+// emulator so peripherals can react (e.g. ADC START_ONCE triggers a conversion).
+// bits_written is the data the atomic alias write carried on the bus, so
+// write-1-to-clear status bits can be modelled.
+void host_sim_register_written(volatile void* addr, uint32_t bits_written);
+
+static inline void hw_set_bits(io_rw_32* addr, uint32_t mask) {
+    *addr |= mask;
+    host_sim_register_written(addr, mask);
+}
+
+static inline void hw_clear_bits(io_rw_32* addr, uint32_t mask) {
+    *addr &= ~mask;
+    host_sim_register_written(addr, mask);
+}
+
+static inline void hw_xor_bits(io_rw_32* addr, uint32_t mask) {
+    *addr ^= mask;
+    host_sim_register_written(addr, mask);
+}
+
+static inline void hw_write_masked(io_rw_32* addr, uint32_t values, uint32_t write_mask) {
+    uint32_t bits_written = (*addr ^ values) & write_mask;  // XOR alias write, as on hardware
+    *addr = (*addr & ~write_mask) | (values & write_mask);
+    host_sim_register_written(addr, bits_written);
+}
+
+#endif // HOST_HARDWARE_ADDRESS_MAPPED_H
@@ -0,0 +1,172 @@
+#ifndef HOST_HARDWARE_DMA_H
+#define HOST_HARDWARE_DMA_H
+
+#include "pico.h"
+
+// ==================================================
+// Emulated DMA controller
+// Channel control words use the RP2040 CTRL bit layout. Transfers paced by
+// DREQ_ADC move one element per FIFO entry; DREQ_FORCE transfers complete
+// immediately. Completion raises INTR/INTS0, chains, and fires DMA_IRQ_0.
+// Address registers are pointer-width so they can hold host addresses.
+// The alias registers are modelled for DMA-to-DMA writes (control
+// channels): count and CTRL aliases behave as on the RP2040, *_TRIG
+// aliases start the channel. DMA writes into address registers are not
+// supported since host pointers do not fit a 32-bit transfer.
+// The sniffer models the CRC-32 modes (plain and bit-reversed data) with
+// OUT_REV/OUT_INV; use the dma_sniffer_* calls rather than writing
+// SNIFF_DATA directly.
+// ==================================================
+
+#define NUM_DMA_CHANNELS 12
+
+#define DREQ_ADC 36
+#define DREQ_FORCE 0x3f
+
+#define DMA_CH0_CTRL_TRIG_EN_BITS            0x00000001u
+#define DMA_CH0_CTRL_TRIG_HIGH_PRIORITY_BITS 0x00000002u
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB      2
+#define DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS     0x0000000cu
+#define DMA_CH0_CTRL_TRIG_INCR_READ_BITS     0x00000010u
+#define DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS    0x00000020u
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_LSB      6
+#define DMA_CH0_CTRL_TRIG_RING_SIZE_BITS     0x000003c0u
+#define DMA_CH0_CTRL_TRIG_RING_SEL_BITS      0x00000400u
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB       11
+#define DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS      0x00007800u
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB       15
+#define DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS      0x001f8000u
+#define DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS     0x00200000u
+#define DMA_CH0_CTRL_TRIG_BSWAP_BITS         0x00400000u
+#define DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS      0x00800000u
+#define DMA_CH0_CTRL_TRIG_BUSY_BITS          0x01000000u
+
+#define DMA_SNIFF_CTRL_EN_BITS               0x00000001u
+#define DMA_SNIFF_CTRL_DMACH_LSB             1
+#define DMA_SNIFF_CTRL_DMACH_BITS            0x0000001eu
+#define DMA_SNIFF_CTRL_CALC_LSB              5
+#define DMA_SNIFF_CTRL_CALC_BITS             0x000001e0u
+#define DMA_SNIFF_CTRL_OUT_REV_BITS          0x00000400u
+#define DMA_SNIFF_CTRL_OUT_INV_BITS          0x00000800u
+#define DMA_SNIFF_CTRL_CALC_VALUE_CRC32      0x0u
+#define DMA_SNIFF_CTRL_CALC_VALUE_CRC32R     0x1u
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+typedef struct {
+    uint32_t ctrl;
+} dma_channel_config;
+
+typedef struct {
+    volatile uintptr_t read_addr;
+    volatile uintptr_t write_addr;
+    io_rw_32 transfer_count;
+    io_rw_32 ctrl_trig;
+    io_rw_32 al1_ctrl;
+    volatile uintptr_t al1_read_addr;
+    volatile uintptr_t al1_write_addr;
+    io_rw_32 al1_transfer_count_trig;
+    io_rw_32 al2_ctrl;
+    io_rw_32 al2_transfer_count;
+    volatile uintptr_t al2_read_addr;
+    volatile uintptr_t al2_write_addr_trig;
+    io_rw_32 al3_ctrl;
+    volatile uintptr_t al3_write_addr;
+    io_rw_32 al3_transfer_count;
+    volatile uintptr_t al3_read_addr_trig;
+} dma_channel_hw_t;
+
+typedef struct {
+    dma_channel_hw_t ch[NUM_DMA_CHANNELS];
+    io_rw_32 intr;
+    io_rw_32 inte0;
+    io_rw_32 intf0;
+    io_rw_32 ints0;
+    io_rw_32 inte1;
+    io_rw_32 intf1;
+    io_rw_32 ints1;
+    io_rw_32 sniff_ctrl;
+    io_rw_32 sniff_data;
+} dma_hw_t;
+
+extern dma_hw_t host_dma_regs;
+#define dma_hw (&host_dma_regs)
+
+// Channel claiming
+int dma_claim_unused_channel(bool required);
+void dma_channel_claim(uint channel);
+void dma_channel_unclaim(uint channel);
+bool dma_channel_is_claimed(uint channel);
+
+// Configuration (mirrors hardware_dma inline helpers)
+static inline void channel_config_set_read_increment(dma_channel_config* c, bool incr) {
+    c->ctrl = incr ? (c->ctrl | DMA_CH0_CTRL_TRIG_INCR_READ_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_READ_BITS);
+}
+
+static inline void channel_config_set_write_increment(dma_channel_config* c, bool incr) {
+    c->ctrl = incr ? (c->ctrl | DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_INCR_WRITE_BITS);
+}
+
+static inline void channel_config_set_dreq(dma_channel_config* c, uint dreq) {
+    c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_TREQ_SEL_BITS) | (dreq << DMA_CH0_CTRL_TRIG_TREQ_SEL_LSB);
+}
+
+static inline void channel_config_set_chain_to(dma_channel_config* c, uint chain_to) {
+    c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_CHAIN_TO_BITS) | (chain_to << DMA_CH0_CTRL_TRIG_CHAIN_TO_LSB);
+}
+
+static inline void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size) {
+    c->ctrl = (c->ctrl & ~DMA_CH0_CTRL_TRIG_DATA_SIZE_BITS) | (static_cast<uint32_t>(size) << DMA_CH0_CTRL_TRIG_DATA_SIZE_LSB);
+}
+
+static inline void channel_config_set_ring(dma_channel_config* c, bool write, uint size_bits) {
+    c->ctrl = (c->ctrl & ~(DMA_CH0_CTRL_TRIG_RING_SIZE_BITS | DMA_CH0_CTRL_TRIG_RING_SEL_BITS)) |
+              (size_bits << DMA_CH0_CTRL_TRIG_RING_SIZE_LSB) |
+              (write ? DMA_CH0_CTRL_TRIG_RING_SEL_BITS : 0);
+}
+
+static inline void channel_config_set_irq_quiet(dma_channel_config* c, bool irq_quiet) {
+    c->ctrl = irq_quiet ? (c->ctrl | DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_IRQ_QUIET_BITS);
+}
+
+static inline void channel_config_set_enable(dma_channel_config* c, bool enable) {
+    c->ctrl = enable ? (c->ctrl | DMA_CH0_CTRL_TRIG_EN_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_EN_BITS);
+}
+
+static inline void channel_config_set_sniff_enable(dma_channel_config* c, bool sniff_enable) {
+    c->ctrl = sniff_enable ? (c->ctrl | DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS) : (c->ctrl & ~DMA_CH0_CTRL_TRIG_SNIFF_EN_BITS);
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+
+// Channel control
+void dma_channel_set_config(uint channel, const dma_channel_config* config, bool trigger);
+void dma_channel_set_read_addr(uint channel, const volatile void* read_addr, bool trigger);
+void dma_channel_set_write_addr(uint channel, volatile void* write_addr, bool trigger);
+void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger);
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr,
+                           const volatile void* read_addr, uint transfer_count, bool trigger);
+void dma_channel_start(uint channel);
+void dma_start_channel_mask(uint32_t chan_mask);
+void dma_channel_abort(uint channel);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+
+// Sniffer
+void dma_sniffer_enable(uint channel, uint mode, bool force_channel_enable);
+void dma_sniffer_disable(void);
+void dma_sniffer_set_output_reverse_enabled(bool enable);
+void dma_sniffer_set_output_invert_enabled(bool enable);
+void dma_sniffer_set_data_accumulator(uint32_t seed_value);
+uint32_t dma_sniffer_get_data_accumulator(void);
+
+// Interrupts
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+bool dma_channel_get_irq0_status(uint channel);
+void dma_channel_acknowledge_irq0(uint channel);
+
+#endif // HOST_HARDWARE_DMA_H
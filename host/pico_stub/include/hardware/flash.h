@@ -0,0 +1,20 @@
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+
+#include "pico.h"
+
+// ==================================================
+// RAM-backed flash
+// Offsets are relative to the start of flash (as in the SDK) and land in
+// host_xip_flash[]. Erase sets bytes to 0xFF, program can only clear bits,
+// and both advance the virtual clock by typical W25Q16 timings.
+// ==================================================
+
+#define FLASH_PAGE_SIZE (1u << 8)
+#define FLASH_SECTOR_SIZE (1u << 12)
+#define FLASH_BLOCK_SIZE (1u << 16)
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count);
+
+#endif // HOST_HARDWARE_FLASH_H
@@ -0,0 +1,24 @@
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+#include "pico.h"
+
+// GPIO is not modelled on the host; calls are accepted and ignored
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+enum gpio_function {
+    GPIO_FUNC_SPI = 1,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_NULL = 0x1f,
+};
+
+static inline void gpio_init(uint gpio) { (void)gpio; }
+static inline void gpio_set_dir(uint gpio, bool out) { (void)gpio; (void)out; }
+static inline void gpio_put(uint gpio, bool value) { (void)gpio; (void)value; }
+static inline bool gpio_get(uint gpio) { (void)gpio; return false; }
+static inline void gpio_pull_up(uint gpio) { (void)gpio; }
+static inline void gpio_disable_pulls(uint gpio) { (void)gpio; }
+static inline void gpio_set_function(uint gpio, enum gpio_function fn) { (void)gpio; (void)fn; }
+
+#endif // HOST_HARDWARE_GPIO_H
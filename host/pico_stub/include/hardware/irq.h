@@ -0,0 +1,26 @@
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+#include "pico.h"
+
+// RP2040 IRQ numbers used by the emulated peripherals
+#define TIMER_IRQ_0 0
+#define TIMER_IRQ_1 1
+#define TIMER_IRQ_2 2
+#define TIMER_IRQ_3 3
+#define DMA_IRQ_0 11
+#define DMA_IRQ_1 12
+#define SIO_IRQ_PROC0 15
+#define SIO_IRQ_PROC1 16
+#define ADC_IRQ_FIFO 22
+#define NUM_IRQS 32
+
+typedef void (*irq_handler_t)(void);
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+void irq_set_enabled(uint num, bool enabled);
+void irq_set_mask_enabled(uint32_t mask, bool enabled);
+bool irq_is_enabled(uint num);
+void irq_set_pending(uint num);
+
+#endif // HOST_HARDWARE_IRQ_H
@@ -0,0 +1,33 @@
+#ifndef HOST_HARDWARE_REGS_ADC_H
+#define HOST_HARDWARE_REGS_ADC_H
+
+// ADC register bit definitions (values match the RP2040 datasheet)
+#define ADC_CS_EN_BITS          0x00000001u
+#define ADC_CS_TS_EN_BITS       0x00000002u
+#define ADC_CS_START_ONCE_BITS  0x00000004u
+#define ADC_CS_START_MANY_BITS  0x00000008u
+#define ADC_CS_READY_BITS       0x00000100u
+#define ADC_CS_ERR_BITS         0x00000200u
+#define ADC_CS_ERR_STICKY_BITS  0x00000400u
+#define ADC_CS_AINSEL_BITS      0x00007000u
+#define ADC_CS_AINSEL_LSB       12
+#define ADC_CS_RROBIN_BITS      0x001f0000u
+
+#define ADC_DIV_INT_BITS        0x00ffff00u
+#define ADC_DIV_INT_LSB         8
+#define ADC_DIV_INT_MSB         23
+#define ADC_DIV_FRAC_BITS       0x000000ffu
+#define ADC_FCS_EN_BITS         0x00000001u
+#define ADC_FCS_SHIFT_BITS      0x00000002u
+#define ADC_FCS_ERR_BITS        0x00000004u
+#define ADC_FCS_DREQ_EN_BITS    0x00000008u
+#define ADC_FCS_EMPTY_BITS      0x00000100u
+#define ADC_FCS_FULL_BITS       0x00000200u
+#define ADC_FCS_UNDER_BITS      0x00000400u
+#define ADC_FCS_OVER_BITS       0x00000800u
+#define ADC_FCS_LEVEL_BITS      0x000f0000u
+#define ADC_FCS_LEVEL_LSB       16
+#define ADC_FCS_THRESH_BITS     0x0f000000u
+#define ADC_FCS_THRESH_LSB      24
+
+#endif // HOST_HARDWARE_REGS_ADC_H
@@ -0,0 +1,18 @@
+#ifndef HOST_HARDWARE_REGS_ADDRESSMAP_H
+#define HOST_HARDWARE_REGS_ADDRESSMAP_H
+
+#include <stdint.h>
+
+// ==================================================
+// Host flash image stands in for the XIP window
+// XIP_BASE + offset yields a readable pointer into a RAM-backed 2MB image,
+// so memory-mapped reads in FlashStorage work exactly as on the RP2040.
+// ==================================================
+
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+extern uint8_t host_xip_flash[PICO_FLASH_SIZE_BYTES];
+
+#define XIP_BASE (reinterpret_cast<uintptr_t>(host_xip_flash))
+
+#endif // HOST_HARDWARE_REGS_ADDRESSMAP_H
@@ -0,0 +1,9 @@
+#ifndef HOST_HARDWARE_REGS_M0PLUS_H
+#define HOST_HARDWARE_REGS_M0PLUS_H
+
+#define M0PLUS_SYST_CSR_ENABLE_BITS    0x00000001u
+#define M0PLUS_SYST_CSR_TICKINT_BITS   0x00000002u
+#define M0PLUS_SYST_CSR_CLKSOURCE_BITS 0x00000004u
+#define M0PLUS_SYST_CSR_COUNTFLAG_BITS 0x00010000u
+
+#endif // HOST_HARDWARE_REGS_M0PLUS_H
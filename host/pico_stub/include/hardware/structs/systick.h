@@ -0,0 +1,20 @@
+#ifndef HOST_HARDWARE_STRUCTS_SYSTICK_H
+#define HOST_HARDWARE_STRUCTS_SYSTICK_H
+
+#include "pico.h"
+
+// SysTick on the host counts host wall-clock time scaled to a 125 MHz
+// processor clock, so cycle figures measure host compute, not RP2040 time.
+// Each systick_hw access refreshes cvr from the host clock.
+
+typedef struct {
+    io_rw_32 csr;
+    io_rw_32 rvr;
+    io_rw_32 cvr;
+    io_ro_32 calib;
+} systick_hw_t;
+
+systick_hw_t* host_systick_hw(void);
+#define systick_hw (host_systick_hw())
+
+#endif // HOST_HARDWARE_STRUCTS_SYSTICK_H
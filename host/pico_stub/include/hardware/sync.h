@@ -0,0 +1,21 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include "pico.h"
+#include "hardware/address_mapped.h"
+
+// Interrupts are emulated: while disabled, IRQs raised by the virtual
+// peripherals are held pending and delivered on restore_interrupts()
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+// Real fences: the cross-core handoffs (TripleBuffer, SpectrumAnalyzer)
+// run on two host threads in airsoft-bench
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __dsb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __isb(void) {}
+static inline void __sev(void) {}
+static inline void __wfe(void) {}
+static inline void __wfi(void) {}
+
+#endif // HOST_HARDWARE_SYNC_H
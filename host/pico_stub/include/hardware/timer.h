@@ -0,0 +1,26 @@
+#ifndef HOST_HARDWARE_TIMER_H
+#define HOST_HARDWARE_TIMER_H
+
+#include "pico.h"
+#include "pico/time.h"
+
+// ==================================================
+// Hardware alarms on the virtual clock
+// Same one-shot semantics as the RP2040 timer: an alarm fires once when the
+// clock reaches its target, via TIMER_IRQ_n, and must be re-armed.
+// ==================================================
+
+#define NUM_TIMERS 4
+
+typedef void (*hardware_alarm_callback_t)(uint alarm_num);
+
+void hardware_alarm_claim(uint alarm_num);
+int hardware_alarm_claim_unused(bool required);
+void hardware_alarm_unclaim(uint alarm_num);
+void hardware_alarm_set_callback(uint alarm_num, hardware_alarm_callback_t callback);
+
+// Returns true if the target was already in the past (alarm not armed)
+bool hardware_alarm_set_target(uint alarm_num, absolute_time_t t);
+void hardware_alarm_cancel(uint alarm_num);
+
+#endif // HOST_HARDWARE_TIMER_H
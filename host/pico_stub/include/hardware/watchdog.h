@@ -0,0 +1,23 @@
+#ifndef HOST_HARDWARE_WATCHDOG_H
+#define HOST_HARDWARE_WATCHDOG_H
+
+#include "pico.h"
+#include "hardware/address_mapped.h"
+
+#define WATCHDOG_CTRL_ENABLE_BITS 0x40000000u
+
+typedef struct {
+    io_rw_32 ctrl;
+    io_wo_32 load;
+    io_ro_32 reason;
+} watchdog_hw_t;
+
+extern watchdog_hw_t host_watchdog_regs;
+#define watchdog_hw (&host_watchdog_regs)
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug);
+void watchdog_update(void);
+
+static inline bool watchdog_caused_reboot(void) { return false; }
+
+#endif // HOST_HARDWARE_WATCHDOG_H
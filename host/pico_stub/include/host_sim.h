@@ -0,0 +1,63 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ==================================================
+// Host Simulation Control
+// Harness-side API for the Pico SDK stand-in: drives the virtual clock,
+// feeds the emulated ADC, and inspects the RAM-backed flash image.
+// Firmware code never includes this header.
+// ==================================================
+
+namespace HostSim {
+    // Restore power-on state: clock at zero, peripherals idle, flash erased
+    void reset();
+
+    // --------------------------------------------------
+    // Virtual clock
+    // --------------------------------------------------
+    uint64_t now_us();
+
+    // Advance the clock, firing alarms (and the conversions/DMA/IRQs they
+    // cause) in timestamp order. Events due while interrupts are disabled
+    // stay pending until restore_interrupts().
+    void advance_us(uint64_t delta_us);
+    void advance_to_us(uint64_t target_us);
+
+    // Earliest timed event (alarm or free-running ADC conversion); false if
+    // nothing is scheduled
+    bool next_event_us(uint64_t* when_us);
+
+    // --------------------------------------------------
+    // ADC input
+    // --------------------------------------------------
+    // Called once per conversion; the low 12 bits are used
+    typedef uint16_t (*AdcSource)(void* context);
+    void set_adc_source(AdcSource source, void* context);
+    uint32_t get_adc_conversion_count();
+    uint32_t get_adc_fifo_overflow_count();
+
+    // --------------------------------------------------
+    // Flash image
+    // --------------------------------------------------
+    uint8_t* flash_image();
+    size_t flash_size();
+    bool flash_load(const char* path);
+    bool flash_save(const char* path);
+
+    // When enabled (default), erase/program advance the virtual clock by
+    // typical W25Q16 timings so flash stalls show up in sampling
+    void set_flash_timing_enabled(bool enabled);
+    uint32_t get_flash_sector_erase_count();
+    uint32_t get_flash_page_program_count();
+    uint64_t get_flash_busy_us();
+
+    // --------------------------------------------------
+    // Serial input (consumed by getchar_timeout_us)
+    // --------------------------------------------------
+    void push_serial_input(const char* text);
+}
+
+#endif // HOST_SIM_H
@@ -0,0 +1,31 @@
+#ifndef HOST_PICO_H
+#define HOST_PICO_H
+
+// ==================================================
+// Host Pico SDK stand-in: base types
+// Mirrors the subset of pico.h / pico/types.h that the DSP and storage
+// core depends on, so lib/ builds unchanged on x86 Linux.
+// ==================================================
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "hardware/regs/addressmap.h"
+
+typedef unsigned int uint;
+
+typedef volatile uint32_t io_rw_32;
+typedef const volatile uint32_t io_ro_32;
+typedef volatile uint32_t io_wo_32;
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT (-1)
+#define PICO_ERROR_GENERIC (-2)
+
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) func_name
+
+static inline void tight_loop_contents(void) {}
+
+#endif // HOST_PICO_H
@@ -0,0 +1,16 @@
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include "pico.h"
+
+// The host build runs a single core; lockout is a no-op but the call sites
+// stay identical to the firmware build
+static inline void multicore_lockout_victim_init(void) {}
+static inline void multicore_lockout_start_blocking(void) {}
+static inline void multicore_lockout_end_blocking(void) {}
+
+// Nothing reads the FIFO: always room, pushes are dropped
+static inline bool multicore_fifo_wready(void) { return true; }
+static inline void multicore_fifo_push_blocking(uint32_t data) { (void)data; }
+
+#endif // HOST_PICO_MULTICORE_H
@@ -0,0 +1,14 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+// stdio goes straight to the host's stdout; serial input is injected by the
+// harness through HostSim::push_serial_input()
+static inline bool stdio_init_all(void) { return true; }
+
+int getchar_timeout_us(uint32_t timeout_us);
+
+#endif // HOST_PICO_STDLIB_H
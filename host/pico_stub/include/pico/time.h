@@ -0,0 +1,62 @@
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+
+#include "pico.h"
+
+// ==================================================
+// Virtual clock
+// Time only moves when the host harness advances it (HostSim::advance_us)
+// or when code sleeps; sleeping fires any alarms that fall due.
+// ==================================================
+
+typedef uint64_t absolute_time_t;
+
+uint64_t time_us_64(void);
+
+static inline uint32_t time_us_32(void) {
+    return static_cast<uint32_t>(time_us_64());
+}
+
+static inline absolute_time_t get_absolute_time(void) {
+    return time_us_64();
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t) {
+    return static_cast<uint32_t>(t / 1000);
+}
+
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) {
+    return t + us;
+}
+
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) {
+    return t + static_cast<uint64_t>(ms) * 1000;
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us) {
+    return delayed_by_us(get_absolute_time(), us);
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms) {
+    return delayed_by_ms(get_absolute_time(), ms);
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) {
+    return static_cast<int64_t>(to - from);
+}
+
+void sleep_us(uint64_t us);
+
+static inline void sleep_ms(uint32_t ms) {
+    sleep_us(static_cast<uint64_t>(ms) * 1000);
+}
+
+static inline void busy_wait_us(uint64_t us) {
+    sleep_us(us);
+}
+
+#endif // HOST_PICO_TIME_H
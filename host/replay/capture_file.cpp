@@ -0,0 +1,149 @@
+#include "capture_file.h"
+#include <stdio.h>
+#include <string.h>
+#include "flash_storage.h"
+#include "sample_codec.h"
+
+namespace CaptureFile {
+
+namespace {
+
+uint32_t read_u32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) |
+           (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void read_samples(const std::vector<uint8_t>& data, size_t offset, uint32_t count, std::vector<uint16_t>* out) {
+    out->resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint8_t* p = data.data() + offset + i * 2;
+        (*out)[i] = static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+}
+
+// Append a chunk's samples; false if its stream is damaged
+bool decode_chunk(const FlashStorage::ChunkHeader& chunk, const uint8_t* coded, bool has_filtered, Capture* capture) {
+    size_t offset = capture->raw.size();
+    capture->raw.resize(offset + chunk.sample_count);
+    capture->filtered.resize(has_filtered ? offset + chunk.sample_count : 0);
+    SampleCodec::Decoder decoder(coded, chunk.coded_size, chunk.sample_count, has_filtered);
+    uint32_t decoded = 0;
+    uint32_t n;
+    while ((n = decoder.next_block(capture->raw.data() + offset + decoded,
+                                   has_filtered ? capture->filtered.data() + offset + decoded : nullptr)) > 0) {
+        decoded += n;
+    }
+    if (decoded < chunk.sample_count) {
+        capture->raw.resize(offset);
+        capture->filtered.resize(has_filtered ? offset : 0);
+        return false;
+    }
+    return true;
+}
+
+// Version 3: decode the chunks through the index, skipping damaged ones
+// (so the samples after a bad chunk move up by its length)
+bool read_coded(const std::vector<uint8_t>& data, uint32_t sample_count, bool has_filtered, Capture* capture) {
+    const uint8_t* payload = data.data() + 32;
+    uint32_t size = static_cast<uint32_t>(data.size() - 32);
+    uint32_t chunk_count = FlashStorage::get_chunk_count(payload, size);
+    if (chunk_count == 0) {
+        printf("CaptureFile: Chunk index missing or damaged\n");
+        return false;
+    }
+
+    capture->raw.clear();
+    capture->filtered.clear();
+    capture->raw.reserve(sample_count);
+    capture->filtered.reserve(has_filtered ? sample_count : 0);
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+        FlashStorage::ChunkHeader chunk;
+        const uint8_t* coded;
+        if (!FlashStorage::read_chunk(payload, size, i, &chunk, &coded) ||
+            !decode_chunk(chunk, coded, has_filtered, capture)) {
+            printf("CaptureFile: WARNING - chunk %lu is damaged, skipped\n", static_cast<unsigned long>(i));
+            continue;
+        }
+        if (i == 0) {
+            capture->first_sample = chunk.first_sample;
+        }
+    }
+    if (capture->raw.size() < sample_count) {
+        printf("CaptureFile: WARNING - chunks hold %zu of %lu samples\n",
+               capture->raw.size(), static_cast<unsigned long>(sample_count));
+    }
+    return true;
+}
+
+} // namespace
+
+bool load(const char* path, Capture* capture) {
+    FILE* f = fopen(path, "rb");
+    if (f == nullptr) {
+        printf("CaptureFile: Cannot open %s\n", path);
+        return false;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(f);
+
+    if (data.size() < 24 || read_u32(data.data()) != MAGIC) {
+        printf("CaptureFile: %s is not an ADCS capture\n", path);
+        return false;
+    }
+
+    capture->version = read_u32(data.data() + 4);
+    capture->sample_rate = read_u32(data.data() + 8);
+    uint32_t sample_count = read_u32(data.data() + 12);
+    capture->timestamp = read_u32(data.data() + 16);
+    capture->checksum = read_u32(data.data() + 20);
+    capture->checksum_filt = 0;
+    capture->first_sample = 0;
+
+    size_t header_size = 24;
+    bool has_filtered = false;
+    if (capture->version == 2 || capture->version == 3) {
+        if (data.size() < 32) {
+            printf("CaptureFile: %s is too small for a version %lu header\n",
+                   path, static_cast<unsigned long>(capture->version));
+            return false;
+        }
+        header_size = 32;
+        has_filtered = read_u32(data.data() + 24) == 1;
+        capture->checksum_filt = read_u32(data.data() + 28);
+        if (capture->version == 3) {
+            return read_coded(data, sample_count, has_filtered, capture);
+        }
+    } else if (capture->version != 1) {
+        printf("CaptureFile: Unsupported version %lu\n", static_cast<unsigned long>(capture->version));
+        return false;
+    }
+
+    size_t available = (data.size() - header_size) / sizeof(uint16_t);
+    uint32_t raw_count = sample_count;
+    if (available < raw_count) {
+        printf("CaptureFile: WARNING - %s truncated (%zu of %lu samples)\n",
+               path, available, static_cast<unsigned long>(sample_count));
+        raw_count = static_cast<uint32_t>(available);
+        has_filtered = false;
+    }
+    read_samples(data, header_size, raw_count, &capture->raw);
+
+    capture->filtered.clear();
+    if (has_filtered) {
+        size_t filt_offset = header_size + static_cast<size_t>(sample_count) * sizeof(uint16_t);
+        size_t filt_available = (data.size() - filt_offset) / sizeof(uint16_t);
+        uint32_t filt_count = (filt_available < sample_count) ? static_cast<uint32_t>(filt_available) : sample_count;
+        read_samples(data, filt_offset, filt_count, &capture->filtered);
+    }
+
+    return true;
+}
+
+} // namespace CaptureFile
@@ -0,0 +1,34 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <stdint.h>
+#include <vector>
+
+// ==================================================
+// Capture File Reader
+// Loads ADCS capture files as written by DOWNLOAD / tools/download_data.py
+// (version 1: 24-byte header, raw only; version 2: 32-byte header, raw +
+// optional filtered; version 3: 32-byte header, coded chunks and their
+// index, see FlashStorage::ChunkHeader)
+// ==================================================
+
+namespace CaptureFile {
+    constexpr uint32_t MAGIC = 0x41444353;  // "ADCS"
+
+    struct Capture {
+        uint32_t version;
+        uint32_t sample_rate;
+        uint32_t timestamp;
+        uint32_t checksum;
+        uint32_t checksum_filt;
+        uint32_t first_sample;           // Position of raw[0] in the capture (ranged downloads)
+        std::vector<uint16_t> raw;
+        std::vector<uint16_t> filtered;  // Empty if not present
+    };
+
+    // Returns false (and prints the reason) if the file is missing or malformed.
+    // A truncated sample section is accepted with a warning, like parse_capture.py.
+    bool load(const char* path, Capture* capture);
+}
+
+#endif // CAPTURE_FILE_H
@@ -0,0 +1,219 @@
+#include "capture_replay.h"
+#include "host_sim.h"
+#include "adc_config.h"
+#include "dma_adc_sampler.h"
+#include "data_collector.h"
+#include "flash_storage.h"
+#include "sample_pipeline.h"
+#include "serial_commands.h"
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+using ReplayClock = std::chrono::steady_clock;
+
+} // namespace
+
+// ==================================================
+// Constructor & Options
+// ==================================================
+
+CaptureReplay::Options CaptureReplay::default_options() {
+    Options options;
+    options.speed = 0.0;
+    options.loops = 1;
+    options.buffer_cost_us = 0;
+    options.loop_cost_us = 0;
+    options.collect_ms = 0;
+    options.arm_sag_mv = 0;
+    options.pacing = ADCConfig::HARDWARE_PACING ? DMAADCSampler::Pacing::ADC_CLKDIV
+                                                : DMAADCSampler::Pacing::TIMER;
+    return options;
+}
+
+CaptureReplay::CaptureReplay(const uint16_t* samples, uint32_t count, uint32_t sample_rate_hz)
+    : samples(samples),
+      sample_count(count),
+      sample_rate_hz(sample_rate_hz ? sample_rate_hz : ADCConfig::SAMPLE_RATE_HZ),
+      total_to_feed(0),
+      fed(0),
+      held(0),
+      skipped(0),
+      start_us(0) {
+}
+
+uint16_t CaptureReplay::adc_source(void* context) {
+    CaptureReplay* self = static_cast<CaptureReplay*>(context);
+    if (self->sample_count == 0) {
+        return 0;
+    }
+
+    // The recorded signal keeps running in virtual time: a conversion reads
+    // whatever sample is current, so stalls skip samples instead of pausing
+    // the recording. The first conversion lands one period after start().
+    uint64_t elapsed_us = HostSim::now_us() - self->start_us;
+    uint64_t position = (elapsed_us * self->sample_rate_hz + 500000) / 1000000;
+    uint64_t index = (position > 0) ? position - 1 : 0;
+
+    if (index >= self->total_to_feed) {
+        // Hold the last value until the loop notices the end of the capture
+        self->fed = self->total_to_feed;
+        self->held++;
+        return self->samples[self->sample_count - 1];
+    }
+    if (index > self->fed) {
+        self->skipped += static_cast<uint32_t>(index - self->fed);
+    }
+    self->fed = static_cast<uint32_t>(index) + 1;
+    return self->samples[index % self->sample_count];
+}
+
+// Step the virtual clock event by event until a buffer completes, the
+// capture runs out, or nothing is scheduled
+void CaptureReplay::advance_until_buffer_ready(DMAADCSampler& sampler) {
+    while (!sampler.is_buffer_ready() && !exhausted()) {
+        uint64_t when_us = 0;
+        if (!HostSim::next_event_us(&when_us)) {
+            return;
+        }
+        HostSim::advance_to_us(when_us);
+    }
+}
+
+// ==================================================
+// Replay Loop
+// ==================================================
+
+bool CaptureReplay::run(const Options& options, Stats* stats) {
+    *stats = Stats{};
+    fed = 0;
+    held = 0;
+    skipped = 0;
+    total_to_feed = sample_count * (options.loops ? options.loops : 1);
+
+    HostSim::reset();
+    HostSim::set_adc_source(adc_source, this);
+    FlashStorage::init();
+
+    StageProfiler::init_counter();
+    profiler.reset();
+
+    // Sampler outlives the collector, which may hold it for zero-copy capture
+    DMAADCSampler sampler;
+
+    if (!sampler.configure(sample_rate_hz, options.pacing)) {
+        return false;
+    }
+
+    DataCollector collector;
+    collector.set_sample_rate(sample_rate_hz);
+    SamplePipeline pipeline;
+    pipeline.set_profiler(&profiler);
+    spectrum.request_reset();
+    pipeline.set_spectrum(&spectrum);
+    pipeline.get_shot_detector().set_sample_rate(sample_rate_hz);
+    SerialCommands::init(&collector, &profiler, &sampler, &pipeline.get_shot_detector(), &spectrum);
+    if (options.collect_ms > 0) {
+        collector.start_collection(options.collect_ms);
+    } else if (options.arm_sag_mv > 0) {
+        collector.arm(CollectConfig::ARM_PRE_MS, CollectConfig::ARM_POST_MS, options.arm_sag_mv);
+    }
+
+    if (!sampler.init()) {
+        return false;
+    }
+    start_us = HostSim::now_us();
+    sampler.start();
+
+    double process_ns_total = 0.0;
+    auto wall_start = ReplayClock::now();
+    uint64_t virtual_start_us = HostSim::now_us();
+
+    // Mirrors the Core 1 loop in src/main.cpp
+    while (true) {
+        uint32_t fetch_start = StageProfiler::now();
+        if (sampler.is_buffer_ready()) {
+            uint32_t buffer_size = 0;
+            const uint16_t* buffer = sampler.get_ready_buffer(&buffer_size);
+
+            if (buffer != nullptr && buffer_size > 0) {
+                profiler.record_since(StageProfiler::STAGE_FETCH, fetch_start);
+                auto start = ReplayClock::now();
+                pipeline.process_buffer(buffer, buffer_size, &collector);
+                double ns = std::chrono::duration<double, std::nano>(ReplayClock::now() - start).count();
+
+                process_ns_total += ns;
+                if (stats->buffers_processed == 0 || ns < stats->process_ns_min) stats->process_ns_min = ns;
+                if (ns > stats->process_ns_max) stats->process_ns_max = ns;
+                stats->buffers_processed++;
+
+                // Charge modelled Core 1 time before the buffer goes back to DMA
+                HostSim::advance_us(options.buffer_cost_us);
+                sampler.release_buffer();
+                profiler.record_since(StageProfiler::STAGE_BUFFER, fetch_start);
+
+                // Core 0 transforms the buffer long before the next one
+                spectrum.update();
+            }
+        }
+
+        uint32_t serial_start = StageProfiler::now();
+        SerialCommands::check_input();
+        profiler.record_since(StageProfiler::STAGE_SERIAL, serial_start);
+        collector.attach_dma(&sampler);
+        HostSim::advance_us(options.loop_cost_us);
+
+        if (exhausted()) {
+            // Stop sampling, then drain whatever buffers are already complete
+            sampler.stop();
+            if (!sampler.is_buffer_ready()) {
+                break;
+            }
+            continue;
+        }
+
+        if (options.speed <= 0.0) {
+            advance_until_buffer_ready(sampler);
+        } else {
+            // Keep virtual time at wall time x speed; sleep while idle
+            double wall_us = std::chrono::duration<double, std::micro>(ReplayClock::now() - wall_start).count();
+            uint64_t target_us = virtual_start_us + static_cast<uint64_t>(wall_us * options.speed);
+            if (target_us > HostSim::now_us()) {
+                HostSim::advance_to_us(target_us);
+            } else if (!sampler.is_buffer_ready()) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+
+        if (!sampler.is_buffer_ready()) {
+            uint64_t when_us = 0;
+            if (!HostSim::next_event_us(&when_us)) {
+                break;  // Sampler stalled; nothing will ever complete
+            }
+        }
+    }
+
+    sampler.stop();
+    printf("\n");
+    sampler.print_pacing_report();
+
+    stats->samples_fed = fed;
+    stats->samples_held = held;
+    stats->samples_skipped = skipped;
+    stats->samples_processed = pipeline.get_total_samples_processed();
+    stats->buffer_count = sampler.get_buffer_count();
+    stats->overflow_count = sampler.get_overflow_count();
+    stats->irq_count = sampler.get_irq_count();
+    stats->timer_trigger_count = sampler.get_timer_trigger_count();
+    stats->samples_delivered = sampler.get_samples_delivered();
+    stats->continuity_errors = sampler.get_continuity_error_count();
+    stats->adc_fifo_overflows = HostSim::get_adc_fifo_overflow_count();
+    stats->dropped_samples = sampler.get_dropped_sample_count();
+    stats->virtual_us = HostSim::now_us() - virtual_start_us;
+    stats->process_ns_avg = stats->buffers_processed ? process_ns_total / stats->buffers_processed : 0.0;
+    stats->final_voltage_mv = pipeline.get_voltage_mv() + ADCConfig::DIODE_DROP_MV;
+    stats->shot_count = pipeline.get_shot_detector().get_shot_count();
+    return true;
+}
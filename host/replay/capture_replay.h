@@ -0,0 +1,86 @@
+#ifndef CAPTURE_REPLAY_H
+#define CAPTURE_REPLAY_H
+
+#include <stdint.h>
+#include "stage_profiler.h"
+#include "dma_adc_sampler.h"
+#include "spectrum_analyzer.h"
+
+// ==================================================
+// CaptureReplay Class
+// Plays recorded samples into the emulated ADC and runs the firmware's
+// Core 1 loop against the real DMAADCSampler: is_buffer_ready() ->
+// get_ready_buffer() -> SamplePipeline::process_buffer() -> release_buffer().
+// Sampling is paced by the sampler's own hardware alarm or free-running
+// ADC on the virtual clock, so buffer overflows reproduce deterministically.
+// Core 0's share, the spectrum transform, runs after each buffer.
+// ==================================================
+
+class CaptureReplay {
+public:
+    struct Options {
+        double speed;             // Virtual seconds per wall second; 0 = as fast as possible
+        uint32_t loops;           // Times to play the capture back to back
+        uint32_t buffer_cost_us;  // Virtual Core 1 time charged per processed buffer
+        uint32_t loop_cost_us;    // Virtual time charged per loop iteration
+        uint32_t collect_ms;      // Start a DataCollector capture at t=0 (0 = off)
+        uint32_t arm_sag_mv;      // Arm a pre-trigger capture at t=0 (0 = off)
+        DMAADCSampler::Pacing pacing;  // Sampler pacing at the capture's sample rate
+    };
+
+    struct Stats {
+        uint32_t samples_fed;         // Capture samples covered by the replay
+        uint32_t samples_skipped;     // Capture samples no conversion landed on
+        uint32_t samples_held;        // Conversions after the end (last value held)
+        uint32_t samples_processed;   // Samples seen by the pipeline
+        uint32_t buffers_processed;
+        uint32_t buffer_count;        // DMAADCSampler counters
+        uint32_t overflow_count;
+        uint32_t irq_count;
+        uint32_t timer_trigger_count;
+        uint32_t samples_delivered;   // Samples DMA completed into buffers
+        uint32_t continuity_errors;   // Buffer boundaries with a dropped conversion
+        uint32_t adc_fifo_overflows;
+        uint32_t dropped_samples;     // Sampler's total of samples lost for any reason
+        uint64_t virtual_us;          // Virtual time elapsed
+        double process_ns_min;        // Host time in SamplePipeline per buffer
+        double process_ns_avg;
+        double process_ns_max;
+        float final_voltage_mv;       // Last 10 Hz voltage (with diode drop)
+        uint32_t shot_count;          // ShotDetector count at the end
+    };
+
+    static Options default_options();
+
+    // sample_rate_hz is the capture's rate; samples are indexed by virtual time
+    CaptureReplay(const uint16_t* samples, uint32_t count, uint32_t sample_rate_hz);
+
+    // Returns false if the sampler could not be started
+    bool run(const Options& options, Stats* stats);
+
+    // Per-stage timing from the last run (host cycles at 125 MHz)
+    const StageProfiler& get_profiler() const { return profiler; }
+
+    uint32_t get_sample_rate_hz() const { return sample_rate_hz; }
+
+    // Buffer spectrum averaged over the last run
+    const SpectrumAnalyzer& get_spectrum() const { return spectrum; }
+
+private:
+    const uint16_t* samples;
+    uint32_t sample_count;
+    uint32_t sample_rate_hz;
+    uint32_t total_to_feed;
+    uint32_t fed;
+    uint32_t held;
+    uint32_t skipped;
+    uint64_t start_us;
+    StageProfiler profiler;
+    SpectrumAnalyzer spectrum;
+
+    static uint16_t adc_source(void* context);
+    void advance_until_buffer_ready(DMAADCSampler& sampler);
+    bool exhausted() const { return fed >= total_to_feed; }
+};
+
+#endif // CAPTURE_REPLAY_H
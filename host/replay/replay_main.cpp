@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "adc_config.h"
+#include "capture_file.h"
+#include "capture_replay.h"
+#include "dma_adc_sampler.h"
+
+// ==================================================
+// airsoft-replay
+// Usage: airsoft-replay <capture.bin> [options]
+//   --speed <x|max>       Playback speed (1 = real time, default max)
+//   --loops <n>           Play the capture n times back to back
+//   --buffer-cost-us <n>  Virtual Core 1 time charged per buffer
+//   --loop-cost-us <n>    Virtual time charged per loop iteration
+//   --collect <seconds>   Run a DataCollector capture during replay
+//   --arm <sag_mv>        Arm a pre-trigger capture (CollectConfig windows)
+//   --pacing <timer|adc>  Sampler pacing mode (default from ADCConfig)
+//   --filtered            Replay the stored filtered channel instead of raw
+//   --spectrum            Print the averaged spectrum peaks (SPECTRUM)
+// ==================================================
+
+namespace {
+
+void print_usage(const char* argv0) {
+    printf("Usage: %s <capture.bin> [--speed <x|max>] [--loops <n>] [--buffer-cost-us <n>]\n"
+           "       [--loop-cost-us <n>] [--collect <seconds>] [--arm <sag_mv>] [--pacing <timer|adc>]\n"
+           "       [--filtered] [--spectrum]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    CaptureReplay::Options options = CaptureReplay::default_options();
+    bool use_filtered = false;
+    bool print_spectrum = false;
+    for (int i = 2; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--filtered") == 0) {
+            use_filtered = true;
+            continue;
+        }
+        if (strcmp(arg, "--spectrum") == 0) {
+            print_spectrum = true;
+            continue;
+        }
+        if (value == nullptr) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (strcmp(arg, "--speed") == 0) {
+            options.speed = (strcmp(value, "max") == 0) ? 0.0 : atof(value);
+        } else if (strcmp(arg, "--loops") == 0) {
+            options.loops = static_cast<uint32_t>(atoi(value));
+        } else if (strcmp(arg, "--buffer-cost-us") == 0) {
+            options.buffer_cost_us = static_cast<uint32_t>(atoi(value));
+        } else if (strcmp(arg, "--loop-cost-us") == 0) {
+            options.loop_cost_us = static_cast<uint32_t>(atoi(value));
+        } else if (strcmp(arg, "--collect") == 0) {
+            options.collect_ms = static_cast<uint32_t>(atoi(value)) * 1000;
+        } else if (strcmp(arg, "--arm") == 0) {
+            options.arm_sag_mv = static_cast<uint32_t>(atoi(value));
+        } else if (strcmp(arg, "--pacing") == 0 && (strcmp(value, "timer") == 0 || strcmp(value, "adc") == 0)) {
+            options.pacing = (strcmp(value, "adc") == 0) ? DMAADCSampler::Pacing::ADC_CLKDIV
+                                                         : DMAADCSampler::Pacing::TIMER;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+        ++i;
+    }
+
+    CaptureFile::Capture capture;
+    if (!CaptureFile::load(argv[1], &capture)) {
+        return 1;
+    }
+    const std::vector<uint16_t>& samples = use_filtered ? capture.filtered : capture.raw;
+    if (samples.empty()) {
+        printf("Capture has no %s samples\n", use_filtered ? "filtered" : "raw");
+        return 1;
+    }
+
+    printf("Replaying %s: v%lu, %zu %s samples @ %lu Hz, speed %s, loops %lu\n",
+           argv[1], static_cast<unsigned long>(capture.version), samples.size(),
+           use_filtered ? "filtered" : "raw", static_cast<unsigned long>(capture.sample_rate),
+           options.speed > 0.0 ? "paced" : "max", static_cast<unsigned long>(options.loops));
+
+    CaptureReplay replay(samples.data(), static_cast<uint32_t>(samples.size()), capture.sample_rate);
+    CaptureReplay::Stats stats;
+    if (!replay.run(options, &stats)) {
+        printf("Replay failed to start the sampler\n");
+        return 1;
+    }
+
+    const double BUFFER_BUDGET_US = ADCConfig::BUFFER_SIZE * 1e6 / replay.get_sample_rate_hz();
+    uint32_t converted = stats.samples_fed - stats.samples_skipped + stats.samples_held;
+    uint32_t lost = (converted > stats.samples_processed) ? converted - stats.samples_processed : 0;
+
+    printf("\n==================================================\n");
+    printf("Replay results\n");
+    printf("==================================================\n");
+    printf("Virtual time:      %.3f s\n", stats.virtual_us / 1e6);
+    printf("Samples fed:       %lu (%lu skipped by stalls, +%lu held after end of capture)\n",
+           static_cast<unsigned long>(stats.samples_fed), static_cast<unsigned long>(stats.samples_skipped),
+           static_cast<unsigned long>(stats.samples_held));
+    printf("Samples processed: %lu (%lu converted but not delivered)\n",
+           static_cast<unsigned long>(stats.samples_processed), static_cast<unsigned long>(lost));
+    printf("Buffers:           %lu processed, %lu filled, %lu overflows\n",
+           static_cast<unsigned long>(stats.buffers_processed),
+           static_cast<unsigned long>(stats.buffer_count),
+           static_cast<unsigned long>(stats.overflow_count));
+    printf("DMA IRQs:          %lu, timer triggers: %lu, ADC FIFO overflows: %lu\n",
+           static_cast<unsigned long>(stats.irq_count),
+           static_cast<unsigned long>(stats.timer_trigger_count),
+           static_cast<unsigned long>(stats.adc_fifo_overflows));
+    printf("Continuity:        %lu samples delivered, %lu boundaries with gaps, %lu samples dropped\n",
+           static_cast<unsigned long>(stats.samples_delivered),
+           static_cast<unsigned long>(stats.continuity_errors),
+           static_cast<unsigned long>(stats.dropped_samples));
+    printf("Processing (host): min %.1f us, avg %.1f us, max %.1f us per buffer\n",
+           stats.process_ns_min / 1000.0, stats.process_ns_avg / 1000.0, stats.process_ns_max / 1000.0);
+    printf("Headroom (host):   %.2f%% of the %.1f ms buffer budget used at max\n",
+           100.0 * stats.process_ns_max / 1000.0 / BUFFER_BUDGET_US, BUFFER_BUDGET_US / 1000.0);
+    if (options.buffer_cost_us > 0) {
+        printf("Modelled Core 1:   %lu us per buffer = %.1f%% of budget\n",
+               static_cast<unsigned long>(options.buffer_cost_us),
+               100.0 * options.buffer_cost_us / BUFFER_BUDGET_US);
+    }
+    printf("Final voltage:     %.2f V\n", stats.final_voltage_mv / 1000.0f);
+    printf("Shots detected:    %lu\n", static_cast<unsigned long>(stats.shot_count));
+    printf("\n");
+    replay.get_profiler().print_report(replay.get_sample_rate_hz());
+    if (print_spectrum) {
+        printf("\n");
+        replay.get_spectrum().print_report(false);
+    }
+    return 0;
+}
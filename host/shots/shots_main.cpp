@@ -0,0 +1,341 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "adc_config.h"
+#include "capture_file.h"
+#include "shot_detector.h"
+#include "voltage_filter.h"
+
+// ==================================================
+// airsoft-shots
+// Usage: airsoft-shots [--depth <mv>[,<mv>...]] [--seed <n>] <capture.bin> ...
+// Scores ShotDetector (fed by VoltageFilter's baseline deviation in
+// DMA-sized blocks, as SamplePipeline does) on recorded captures:
+//   - As recorded. With a label file <capture>.shots (one shot start in
+//     ms per line) the detections are scored against it; without one
+//     they are listed as unlabelled.
+//   - With synthetic shots added to the raw samples at known times:
+//     singles and 5-shot bursts at 15 shots/s, for each sag depth.
+//     Detections the recording produces on its own are not counted as
+//     false positives.
+// Precision, recall and latency (true start to the sample the shot is
+// counted at) per capture and over all of them.
+// ==================================================
+
+namespace {
+
+// A detection matches a shot that started up to MATCH_BEFORE_MS after or
+// MATCH_AFTER_MS before it
+constexpr uint32_t MATCH_BEFORE_MS = 5;
+constexpr uint32_t MATCH_AFTER_MS = 30;
+
+// Synthetic shot (battery mV): 1 ms fall, 15 ms at depth while the motor
+// spins up, exponential recovery with a 10 ms time constant
+constexpr float SHOT_FALL_MS = 1.0f;
+constexpr float SHOT_HOLD_MS = 15.0f;
+constexpr float SHOT_RECOVERY_TAU_MS = 10.0f;
+constexpr float SHOT_LENGTH_MS = 80.0f;
+
+// Schedule: a group per second from 1 s (after the baseline warm-up),
+// alternating single shots and bursts; +/-100 ms jitter per group
+constexpr uint32_t FIRST_GROUP_MS = 1000;
+constexpr uint32_t GROUP_PERIOD_MS = 1000;
+constexpr uint32_t GROUP_JITTER_MS = 100;
+constexpr uint32_t BURST_SHOTS = 5;
+constexpr uint32_t BURST_PERIOD_MS = 66;
+
+const uint32_t DEFAULT_DEPTHS_MV[] = {150, 200, 300, 500, 1000};
+
+struct Score {
+    uint32_t shots = 0;
+    uint32_t hits = 0;
+    uint32_t false_positives = 0;
+    uint32_t background = 0;      // Detections the recording makes without injected shots
+    double latency_sum_ms = 0.0;
+    double latency_max_ms = 0.0;
+
+    void add(const Score& other) {
+        shots += other.shots;
+        hits += other.hits;
+        false_positives += other.false_positives;
+        background += other.background;
+        latency_sum_ms += other.latency_sum_ms;
+        if (other.latency_max_ms > latency_max_ms) latency_max_ms = other.latency_max_ms;
+    }
+};
+
+// Filter and detect in DMA-sized blocks; returns every finished shot
+std::vector<ShotDetector::Event> detect(const std::vector<uint16_t>& raw, uint32_t sample_rate) {
+    VoltageFilter filter;
+    ShotDetector detector;
+    detector.set_sample_rate(sample_rate);
+
+    std::vector<ShotDetector::Event> events;
+    int16_t deviation[ADCConfig::BUFFER_SIZE];
+    uint32_t seen = 0;
+    for (uint32_t offset = 0; offset < raw.size(); offset += ADCConfig::BUFFER_SIZE) {
+        uint32_t n = static_cast<uint32_t>(raw.size()) - offset;
+        if (n > ADCConfig::BUFFER_SIZE) n = ADCConfig::BUFFER_SIZE;
+        filter.process_block(raw.data() + offset, nullptr, n, nullptr, deviation);
+        uint32_t end_ms = static_cast<uint32_t>(static_cast<uint64_t>(offset + n - 1) * 1000 / sample_rate);
+        detector.process_block(deviation, n, end_ms);
+
+        uint32_t total = detector.get_event_count();
+        if (total - seen > ShotConfig::EVENT_LOG_SIZE) {
+            printf("WARNING: %lu events lost between blocks\n",
+                   static_cast<unsigned long>(total - seen - ShotConfig::EVENT_LOG_SIZE));
+            seen = total - ShotConfig::EVENT_LOG_SIZE;
+        }
+        for (uint32_t age = total - seen; age-- > 0;) {
+            ShotDetector::Event event;
+            detector.get_event(age, &event);
+            events.push_back(event);
+        }
+        seen = total;
+    }
+    return events;
+}
+
+bool near(uint32_t detection, uint32_t shot, uint32_t sample_rate) {
+    uint32_t before = MATCH_BEFORE_MS * sample_rate / 1000;
+    uint32_t after = MATCH_AFTER_MS * sample_rate / 1000;
+    return detection + before >= shot && detection <= shot + after;
+}
+
+// Greedy in time order; each shot matches at most one detection
+Score score(const std::vector<ShotDetector::Event>& events, const std::vector<uint32_t>& shots,
+            const std::vector<ShotDetector::Event>& background, uint32_t sample_rate) {
+    Score result;
+    result.shots = static_cast<uint32_t>(shots.size());
+    std::vector<bool> used(shots.size(), false);
+    for (const ShotDetector::Event& event : events) {
+        bool matched = false;
+        for (size_t i = 0; i < shots.size() && !matched; ++i) {
+            if (!used[i] && near(event.start_sample, shots[i], sample_rate)) {
+                used[i] = true;
+                matched = true;
+                double latency_ms = (static_cast<double>(event.detect_sample) - shots[i]) * 1000.0 / sample_rate;
+                result.hits++;
+                result.latency_sum_ms += latency_ms;
+                if (latency_ms > result.latency_max_ms) result.latency_max_ms = latency_ms;
+            }
+        }
+        if (matched) {
+            continue;
+        }
+        bool recorded = false;
+        for (const ShotDetector::Event& other : background) {
+            if (near(event.start_sample, other.start_sample, sample_rate) ||
+                near(other.start_sample, event.start_sample, sample_rate)) {
+                recorded = true;
+                break;
+            }
+        }
+        if (recorded) {
+            result.background++;
+        } else {
+            result.false_positives++;
+        }
+    }
+    return result;
+}
+
+// Shot start samples for a capture of count samples
+std::vector<uint32_t> make_schedule(uint32_t count, uint32_t sample_rate, uint32_t seed) {
+    std::vector<uint32_t> shots;
+    uint32_t lcg = seed;
+    uint32_t length = static_cast<uint32_t>(SHOT_LENGTH_MS * sample_rate / 1000);
+    for (uint32_t group = 0;; ++group) {
+        lcg = lcg * 1664525u + 1013904223u;
+        uint32_t jitter = (lcg >> 8) % (2 * GROUP_JITTER_MS + 1);
+        uint32_t start_ms = FIRST_GROUP_MS + group * GROUP_PERIOD_MS + jitter - GROUP_JITTER_MS;
+        uint32_t shots_in_group = (group & 1) ? BURST_SHOTS : 1;
+        uint32_t last = (start_ms + (shots_in_group - 1) * BURST_PERIOD_MS) * (sample_rate / 1000) + length;
+        if (last > count) {
+            return shots;
+        }
+        for (uint32_t s = 0; s < shots_in_group; ++s) {
+            shots.push_back((start_ms + s * BURST_PERIOD_MS) * (sample_rate / 1000));
+        }
+    }
+}
+
+// Subtract the shot shape (in ADC counts) from a copy of raw
+std::vector<uint16_t> inject(const std::vector<uint16_t>& raw, const std::vector<uint32_t>& shots,
+                             uint32_t depth_mv, uint32_t sample_rate) {
+    std::vector<uint16_t> out(raw);
+    float depth = depth_mv / ADCConfig::MV_PER_COUNT;
+    uint32_t length = static_cast<uint32_t>(SHOT_LENGTH_MS * sample_rate / 1000);
+    for (uint32_t start : shots) {
+        for (uint32_t i = 0; i < length && start + i < out.size(); ++i) {
+            float t_ms = i * 1000.0f / sample_rate;
+            float sag;
+            if (t_ms < SHOT_FALL_MS) {
+                sag = depth * t_ms / SHOT_FALL_MS;
+            } else if (t_ms < SHOT_FALL_MS + SHOT_HOLD_MS) {
+                sag = depth;
+            } else {
+                sag = depth * expf(-(t_ms - SHOT_FALL_MS - SHOT_HOLD_MS) / SHOT_RECOVERY_TAU_MS);
+            }
+            int32_t value = static_cast<int32_t>(out[start + i]) - static_cast<int32_t>(sag + 0.5f);
+            out[start + i] = static_cast<uint16_t>(value < 0 ? 0 : value);
+        }
+    }
+    return out;
+}
+
+// Label file next to the capture: shot start times in ms, one per line
+bool load_labels(const char* capture_path, uint32_t sample_rate, std::vector<uint32_t>* shots) {
+    std::string path = std::string(capture_path) + ".shots";
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == nullptr) {
+        return false;
+    }
+    char line[64];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        char* end;
+        double ms = strtod(line, &end);
+        if (end != line) {
+            shots->push_back(static_cast<uint32_t>(ms * sample_rate / 1000.0 + 0.5));
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+void print_score_header() {
+    printf("  %-10s %6s %6s %6s %6s %8s %10s %13s\n",
+           "shots", "count", "hits", "false", "rec.", "recall", "precision", "latency ms");
+}
+
+void print_score(const char* label, const Score& s) {
+    char recall[16] = "-";
+    char precision[16] = "-";
+    char latency[32] = "-";
+    if (s.shots > 0) {
+        snprintf(recall, sizeof(recall), "%.1f%%", 100.0 * s.hits / s.shots);
+    }
+    if (s.hits + s.false_positives > 0) {
+        snprintf(precision, sizeof(precision), "%.1f%%", 100.0 * s.hits / (s.hits + s.false_positives));
+    }
+    if (s.hits > 0) {
+        snprintf(latency, sizeof(latency), "%.1f / %.1f", s.latency_sum_ms / s.hits, s.latency_max_ms);
+    }
+    printf("  %-10s %6lu %6lu %6lu %6lu %8s %10s %13s\n", label,
+           static_cast<unsigned long>(s.shots), static_cast<unsigned long>(s.hits),
+           static_cast<unsigned long>(s.false_positives), static_cast<unsigned long>(s.background),
+           recall, precision, latency);
+}
+
+void print_usage(const char* argv0) {
+    printf("Usage: %s [--depth <mv>[,<mv>...]] [--seed <n>] <capture.bin> ...\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<uint32_t> depths(DEFAULT_DEPTHS_MV, DEFAULT_DEPTHS_MV + sizeof(DEFAULT_DEPTHS_MV) / sizeof(DEFAULT_DEPTHS_MV[0]));
+    uint32_t seed = 1;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            depths.clear();
+            for (char* p = argv[++i]; *p != '\0';) {
+                char* end;
+                unsigned long mv = strtoul(p, &end, 10);
+                if (end == p || mv == 0) {
+                    print_usage(argv[0]);
+                    return 1;
+                }
+                depths.push_back(static_cast<uint32_t>(mv));
+                p = (*end == ',') ? end + 1 : end;
+            }
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (argv[i][0] == '-') {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty() || depths.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    printf("ShotDetector: enter %lu mV, exit %lu mV, %lu-%lu ms; baseline up 1/%lu, down 1/%lu per sample, gate %lu mV\n",
+           static_cast<unsigned long>(ShotConfig::ENTER_MV), static_cast<unsigned long>(ShotConfig::EXIT_MV),
+           static_cast<unsigned long>(ShotConfig::MIN_SAG_MS), static_cast<unsigned long>(ShotConfig::MAX_SAG_MS),
+           static_cast<unsigned long>(1u << FilterConfig::BASELINE_UP_SHIFT),
+           static_cast<unsigned long>(1u << FilterConfig::BASELINE_DOWN_SHIFT),
+           static_cast<unsigned long>(FilterConfig::BASELINE_GATE_MV));
+    printf("Synthetic shots: %.0f ms fall, %.0f ms hold, %.0f ms recovery; singles and %lu-shot bursts every %lu ms\n\n",
+           SHOT_FALL_MS, SHOT_HOLD_MS, SHOT_RECOVERY_TAU_MS, static_cast<unsigned long>(BURST_SHOTS),
+           static_cast<unsigned long>(BURST_PERIOD_MS));
+
+    Score labelled_total;
+    std::vector<Score> depth_totals(depths.size());
+    uint32_t unlabelled_total = 0;
+    double unlabelled_seconds = 0.0;
+    for (const char* path : paths) {
+        CaptureFile::Capture capture;
+        if (!CaptureFile::load(path, &capture) || capture.raw.empty() || capture.sample_rate == 0) {
+            printf("%s: skipped\n\n", path);
+            continue;
+        }
+        uint32_t rate = capture.sample_rate;
+        double seconds = static_cast<double>(capture.raw.size()) / rate;
+        std::vector<ShotDetector::Event> recorded = detect(capture.raw, rate);
+
+        printf("%s: %.1f s @ %lu Hz\n", path, seconds, static_cast<unsigned long>(rate));
+        std::vector<uint32_t> labels;
+        if (load_labels(path, rate, &labels)) {
+            Score s = score(recorded, labels, {}, rate);
+            print_score_header();
+            print_score("labelled", s);
+            labelled_total.add(s);
+        } else {
+            printf("  As recorded: %zu unlabelled detections\n", recorded.size());
+            for (const ShotDetector::Event& event : recorded) {
+                printf("    %8.1f ms  depth %4u mV  %5.1f ms long  recovery %u ms\n",
+                       event.start_sample * 1000.0 / rate, event.depth_mv,
+                       (event.end_sample - event.start_sample) * 1000.0 / rate, event.recovery_ms);
+            }
+            unlabelled_total += static_cast<uint32_t>(recorded.size());
+            unlabelled_seconds += seconds;
+        }
+
+        std::vector<uint32_t> shots = make_schedule(static_cast<uint32_t>(capture.raw.size()), rate, seed);
+        print_score_header();
+        for (size_t d = 0; d < depths.size(); ++d) {
+            std::vector<uint16_t> injected = inject(capture.raw, shots, depths[d], rate);
+            Score s = score(detect(injected, rate), shots, recorded, rate);
+            char label[16];
+            snprintf(label, sizeof(label), "%lu mV", static_cast<unsigned long>(depths[d]));
+            print_score(label, s);
+            depth_totals[d].add(s);
+        }
+        printf("\n");
+    }
+
+    printf("All captures (rec. = detections the recording makes on its own)\n");
+    print_score_header();
+    if (labelled_total.shots > 0) {
+        print_score("labelled", labelled_total);
+    }
+    for (size_t d = 0; d < depths.size(); ++d) {
+        char label[16];
+        snprintf(label, sizeof(label), "%lu mV", static_cast<unsigned long>(depths[d]));
+        print_score(label, depth_totals[d]);
+    }
+    if (unlabelled_seconds > 0.0) {
+        printf("Unlabelled detections: %lu in %.1f s (%.1f per minute)\n",
+               static_cast<unsigned long>(unlabelled_total), unlabelled_seconds,
+               unlabelled_total * 60.0 / unlabelled_seconds);
+    }
+    return 0;
+}
@@ -2,6 +2,7 @@
 #define ADC_CONFIG_H
 
 #include <stdint.h>
+#include "filter_design.h"
 
 // ==================================================
 // ADC Configuration Constants
@@ -10,8 +11,17 @@
 
 namespace ADCConfig {
     // Sampling
+    // Default rate; DMAADCSampler::configure() changes it at runtime. The
+    // filter coefficients below are designed for this rate at compile time.
     constexpr uint32_t SAMPLE_RATE_HZ = 5000;
     constexpr uint32_t SAMPLE_PERIOD_US = 1'000'000 / SAMPLE_RATE_HZ;  // 200µs
+    constexpr uint32_t MIN_SAMPLE_RATE_HZ = 1000;    // ADC divider range ends at ~733 Hz
+    constexpr uint32_t MAX_SAMPLE_RATE_HZ = 50000;   // Keeps a buffer >= 10ms for Core 1
+
+    // Pacing: true = ADC free-running (START_MANY) paced by its clock
+    // divider, exact and CPU-free; false = hardware alarm + START_ONCE
+    constexpr bool HARDWARE_PACING = true;
+    constexpr uint32_t ADC_CLOCK_HZ = 48000000;      // clk_adc (USB PLL)
     
     // Buffers (ping-pong)
     constexpr uint32_t BUFFER_SIZE = 512;  // Must be power of 2
@@ -43,6 +53,10 @@ namespace ADCConfig {
     // Diode voltage drop compensation (to display pre-diode battery voltage)
     // Measured: 11.2V battery → 10.1V after diode = 1.1V drop
     constexpr float DIODE_DROP_MV = 1100.0f;  // Add back to show true battery voltage
+
+    // Battery mV (after the diode) per ADC count; every count <-> mV
+    // conversion goes through this
+    constexpr float MV_PER_COUNT = (ADC_VREF * 1000.0f * VDIV_RATIO * ADC_CALIBRATION) / (1 << ADC_BITS);
 }
 
 // ==================================================
@@ -51,18 +65,223 @@ namespace ADCConfig {
 
 namespace FilterConfig {
     // Median filter (spike rejection)
+    // Odd; up to 9 taps use a sorting network, larger windows (e.g. 9-31)
+    // a double-heap running median, see lib/running_median.h
     constexpr uint32_t MEDIAN_WINDOW = 5;  // 1ms @ 5kHz
     
     // Low-pass filter (noise smoothing)
     constexpr float LPF_CUTOFF_HZ = 100.0f;
     constexpr float LPF_SAMPLE_RATE = static_cast<float>(ADCConfig::SAMPLE_RATE_HZ);
     
-    // IIR coefficients (100 Hz @ 5 kHz)
-    // Calculated using Butterworth 1st order low-pass filter design
-    // http://www.micromodeler.com/dsp/
-    constexpr float LPF_A0 = 0.06745527f;
-    constexpr float LPF_A1 = 0.06745527f;
-    constexpr float LPF_B1 = -0.86508946f;
+    // Butterworth design from the cutoff and rate (lib/filter_design.h),
+    // run as a BiquadCascade on the float reference path and as a
+    // BiquadCascadeQ on the fixed-point chain. First order at 100 Hz /
+    // 5 kHz is b0 = b1 = 0.0591907, a1 = -0.8816186; before it was
+    // designed here, pasted coefficients gave a 115 Hz corner.
+    constexpr uint32_t LPF_ORDER = 1;
+    constexpr auto LPF_DESIGN = FilterDesign::butterworth_lowpass<LPF_ORDER>(LPF_CUTOFF_HZ, LPF_SAMPLE_RATE);
+    
+    // Fixed-point filter chain (no soft-float per sample on the M0+)
+    // true:  integer median + Q16 IIR cascade, output in Q4 ADC counts
+    // false: float reference path (MedianFilter + LowPassFilter)
+    constexpr bool FIXED_POINT = true;
+    
+    // Q16 coefficients, each section's a1 adjusted for unity DC gain.
+    // With the state in Q4 ADC counts a first-order section has no
+    // negative terms and its worst case, 65536 * (4095 << 4) plus
+    // rounding, just fits an unsigned 32-bit accumulator; second-order
+    // sections (negative a2 term) fall back to 64 bits.
+    constexpr uint32_t LPF_COEF_BITS = 16;
+    constexpr uint32_t LPF_STATE_BITS = 4;
+    constexpr uint32_t LPF_STATE_MAX = ADCConfig::ADC_MAX << LPF_STATE_BITS;
+    inline constexpr auto LPF_DESIGN_Q = FilterDesign::quantize(LPF_DESIGN, LPF_COEF_BITS);
+    static_assert(FilterDesign::accumulator_range(LPF_DESIGN_Q, LPF_STATE_MAX).fits_signed64(),
+                  "Fixed-point IIR accumulator would overflow");
+    static_assert(LPF_ORDER > 1 || FilterDesign::accumulator_range(LPF_DESIGN_Q, LPF_STATE_MAX).fits_unsigned32(),
+                  "First-order fixed-point IIR must keep its 32-bit accumulator");
+
+    // Notch for the ~106 Hz interference (2025-11-21 analysis: 73% of the
+    // noise power, right at the low-pass corner), between the median and
+    // the low-pass. -3 dB width NOTCH_CENTER_HZ / NOTCH_Q
+    constexpr bool NOTCH_ENABLE = true;
+    constexpr float NOTCH_CENTER_HZ = 106.0f;
+    constexpr float NOTCH_Q = 4.0f;
+    constexpr auto NOTCH_DESIGN = FilterDesign::Cascade<1>{{FilterDesign::notch(NOTCH_CENTER_HZ, LPF_SAMPLE_RATE, NOTCH_Q)}};
+    
+    // Fixed-point notch: Q28 coefficients, 64-bit accumulator (three
+    // 32x32 multiplies per sample)
+    constexpr uint32_t NOTCH_COEF_BITS = 28;
+    
+    // Tracking (fixed-point chain, once per process_block): Goertzel power
+    // at the notch frequency and NOTCH_PROBE_STEPS steps either side; the
+    // notch moves one NOTCH_STEP_HZ step per buffer toward the peak,
+    // within NOTCH_MIN_HZ..NOTCH_MAX_HZ. Left alone while the tone is
+    // below NOTCH_TRACK_MIN_MV (battery side) amplitude
+    constexpr bool NOTCH_TRACK = true;
+    constexpr float NOTCH_MIN_HZ = 90.0f;
+    constexpr float NOTCH_MAX_HZ = 125.0f;
+    constexpr float NOTCH_STEP_HZ = 0.5f;
+    constexpr uint32_t NOTCH_PROBE_STEPS = 8;
+    constexpr uint32_t NOTCH_TRACK_MIN_MV = 10;
+    
+    // Baseline tracker after the low-pass: cancels the ~0.6 Hz drift
+    // found in the 2025-11-21 analysis so thresholds can be relative.
+    // Asymmetric EMA, weight 1/2^shift per sample: rises in ~51 ms, falls
+    // in ~102 ms @ 5 kHz, so it sits near the top of the noise
+    constexpr uint32_t BASELINE_UP_SHIFT = 8;
+    constexpr uint32_t BASELINE_DOWN_SHIFT = 9;
+
+    // Held while the signal is more than BASELINE_GATE_MV (battery side)
+    // below it, i.e. during a sag. A hold longer than BASELINE_MAX_HOLD
+    // samples (250 ms) is a level change and restarts it from the signal
+    constexpr uint32_t BASELINE_GATE_MV = 100;
+    constexpr uint32_t BASELINE_MAX_HOLD = 1250;
+
+    // First samples after a reset: fast tracking (1/16), no gating, no
+    // deviation output
+    constexpr uint32_t BASELINE_WARMUP = 1024;
+}
+
+// ==================================================
+// Shot Detection Constants
+// Hysteresis on the deviation from the filter's baseline tracker
+// (FilterConfig::BASELINE_*), see
+// docs/devlog/2025-11-21-filter-improvement-implementation-plan.md
+// ==================================================
+
+namespace ShotConfig {
+    // A shot starts when the filtered voltage falls ENTER_MV (battery
+    // side) below the baseline and ends when it is back within EXIT_MV.
+    // Idle dips in the 2025-11 captures reach 100-230 mV
+    constexpr uint32_t ENTER_MV = 300;
+    constexpr uint32_t EXIT_MV = 150;
+
+    // Counted once it has lasted MIN_SAG_MS (shorter dips are noise). A
+    // sag of MAX_SAG_MS or more is a load step, not logged as a shot; the
+    // tracker restarts its baseline after BASELINE_MAX_HOLD, which ends it
+    constexpr uint32_t MIN_SAG_MS = 2;
+    constexpr uint32_t MAX_SAG_MS = 200;
+
+    // Finished shots kept for the SHOTS command
+    constexpr uint32_t EVENT_LOG_SIZE = 16;
+}
+
+// ==================================================
+// Data Collection Constants
+// ==================================================
+
+namespace CollectConfig {
+    // Captures up to this size (raw + filtered) are held in RAM with DMA
+    // writing straight into them and go to flash in one pass at the end.
+    // Longer ones stream to flash as they are collected (FlashStorage::
+    // CaptureStream), bounded by free flash instead of the 264KB of SRAM.
+    constexpr uint32_t RAM_CAPTURE_MAX_BYTES = 64 * 1024;  // 3.2s raw + filtered @ 5kHz
+
+    // Longest COLLECT the serial command accepts; free flash decides
+    // whether it actually fits
+    constexpr uint32_t MAX_DURATION_S = 3600;
+
+    // Store captures as format version 3: delta + Rice coded blocks
+    // (lib/sample_codec.h) instead of raw uint16_t arrays (version 2)
+    constexpr bool COMPRESS = true;
+
+    // Coded size assumed when sizing a capture, bits per sample. The
+    // 2025-11 captures code to 5-6.5 (raw) and ~2.3 (filtered); a noisier
+    // signal that outgrows the reservation ends the capture early
+    constexpr uint32_t CODED_BITS_RAW = 8;
+    constexpr uint32_t CODED_BITS_FILTERED = 4;
+
+    // ARM: a RAM ring keeps the last ARM_PRE_MS of samples until the
+    // filtered voltage sags ARM_SAG_MV (battery side) below its running
+    // level; the ring plus ARM_POST_MS from the trigger on become the
+    // capture. The windows must fit RAM_CAPTURE_MAX_BYTES. Idle dips in
+    // the 2025-11 captures reach 100-230 mV, so the default sag is the
+    // shot detector's threshold
+    constexpr uint32_t ARM_PRE_MS = 500;
+    constexpr uint32_t ARM_POST_MS = 1500;
+    constexpr uint32_t ARM_SAG_MV = ShotConfig::ENTER_MV;
+
+    // Running level: buffer means, weight 1/2^ARM_BASELINE_SHIFT per
+    // buffer (~0.8 s time constant at 512 samples, 5 kHz)
+    constexpr uint32_t ARM_BASELINE_SHIFT = 3;
+}
+
+// ==================================================
+// Decimation Constants
+// ==================================================
+
+namespace DecimationConfig {
+    // Filtered samples -> MID (CIC) -> LOW (CIC, then half-band / 2);
+    // 5 kHz -> 500 Hz -> 10 Hz. The ratios are fixed, so the output rates
+    // follow the RATE command
+    constexpr uint32_t MID_CIC_RATIO = 10;
+    constexpr uint32_t LOW_CIC_RATIO = 25;
+    constexpr uint32_t CIC_ORDER = 3;
+    constexpr uint32_t HALF_BAND_TAPS = 11;
+    constexpr uint32_t HALF_BAND_COEF_BITS = 15;
+    constexpr uint32_t MID_RATIO = MID_CIC_RATIO;
+    constexpr uint32_t LOW_RATIO = MID_CIC_RATIO * LOW_CIC_RATIO * 2;
+
+    // Filter start-up skipped after a reset before the chain is seeded
+    // (notch and low-pass ring for ~10 ms)
+    constexpr uint32_t SETTLE_SAMPLES = 256;
+
+    // Consumers per output rate
+    constexpr uint32_t MAX_SUBSCRIBERS = 4;
+}
+
+// ==================================================
+// Spectrum Analyzer Constants
+// ==================================================
+
+namespace SpectrumConfig {
+    // Core 0 averages the amplitude spectrum of the DMA buffers in its
+    // idle time (SPECTRUM command, display page); see lib/fft_q15.h
+    constexpr bool ENABLE = true;
+    constexpr uint32_t FFT_SIZE = ADCConfig::BUFFER_SIZE;  // 9.8 Hz bins @ 5 kHz
+
+    // Average: weight 1/2^AVERAGE_SHIFT per buffer (~0.8 s at 5 kHz)
+    constexpr uint32_t AVERAGE_SHIFT = 3;
+
+    // Strongest local maxima listed by SPECTRUM
+    constexpr uint32_t PEAK_COUNT = 8;
+
+    // Add a spectrum page to the display rotation
+    constexpr bool DISPLAY_PAGE = true;
+}
+
+// ==================================================
+// Inter-Core Event Constants
+// ==================================================
+
+namespace EventConfig {
+    // Core 1 -> Core 0 events (shots, captures, battery) between display
+    // frames; see lib/event_queue.h. Power of 2
+    constexpr uint32_t RING_SIZE = 32;
+
+    // SIO FIFO word that wakes Core 0; never a multicore lockout magic
+    constexpr uint32_t DOORBELL = 0xE7E70001;
+
+    // 3S LiPo at 3.5 V per cell, battery side (after DIODE_DROP_MV is
+    // added back); clears HYSTERESIS_MV higher
+    constexpr float LOW_BATTERY_MV = 10500.0f;
+    constexpr float LOW_BATTERY_HYSTERESIS_MV = 200.0f;
+
+    // Display banner for capture and battery events
+    constexpr uint32_t BANNER_MS = 2000;
+}
+
+// ==================================================
+// Checksum Constants
+// ==================================================
+
+namespace CrcConfig {
+    // Capture checksums via the DMA sniffer (a word per DMA transfer
+    // while the CPU waits) instead of slice-by-8 tables; see lib/crc32.h
+    constexpr bool USE_DMA_SNIFFER = true;
+
+    // Shorter spans are not worth claiming and programming a channel for
+    constexpr uint32_t SNIFFER_MIN_BYTES = 64;
 }
 
 #endif // ADC_CONFIG_H
@@ -0,0 +1,156 @@
+#ifndef BIQUAD_CASCADE_H
+#define BIQUAD_CASCADE_H
+
+#include <stdint.h>
+#include <type_traits>
+#include "filter_design.h"
+
+// ==================================================
+// BiquadCascade<N>: N float biquad sections in series (transposed
+// direct form II, two state variables per section), coefficients from
+// a FilterDesign::Cascade<N>. The sections are walked by template
+// recursion, so the per-sample path is fully unrolled for any N.
+// ==================================================
+
+template <uint32_t N>
+class BiquadCascade {
+    static_assert(N >= 1, "A cascade needs at least one section");
+
+public:
+    explicit BiquadCascade(const FilterDesign::Cascade<N>& design) {
+        for (uint32_t i = 0; i < N; ++i) {
+            const FilterDesign::Biquad& s = design.sections[i];
+            sections[i].b0 = static_cast<float>(s.b0);
+            sections[i].b1 = static_cast<float>(s.b1);
+            sections[i].b2 = static_cast<float>(s.b2);
+            sections[i].a1 = static_cast<float>(s.a1);
+            sections[i].a2 = static_cast<float>(s.a2);
+        }
+        reset();
+    }
+
+    void reset() {
+        for (uint32_t i = 0; i < N; ++i) {
+            sections[i].s1 = 0.0f;
+            sections[i].s2 = 0.0f;
+        }
+    }
+
+    float process(float x) {
+        return run<0>(x);
+    }
+
+    // in may equal out
+    void process_block(const float* in, float* out, uint32_t n) {
+        for (uint32_t i = 0; i < n; ++i) {
+            out[i] = run<0>(in[i]);
+        }
+    }
+
+private:
+    struct Section {
+        float b0, b1, b2;
+        float a1, a2;
+        float s1, s2;
+    };
+
+    Section sections[N];
+
+    template <uint32_t I>
+    float run(float x) {
+        if constexpr (I == N) {
+            return x;
+        } else {
+            Section& s = sections[I];
+            float y = s.b0 * x + s.s1;
+            s.s1 = s.b1 * x - s.a1 * y + s.s2;
+            s.s2 = s.b2 * x - s.a2 * y;
+            return run<I + 1>(y);
+        }
+    }
+};
+
+// ==================================================
+// BiquadCascadeQ<DESIGN, STATE_MAX>: the fixed-point counterpart for the
+// M0+, which has no FPU. Direct form I on int32_t state, input in
+// 0..STATE_MAX, coefficients from a FilterDesign::CascadeQ baked in at
+// compile time, so zero taps (b2 = a2 = 0 in a first-order section) cost
+// nothing. The sections run unclamped within the ranges
+// FilterDesign::cascade_range() proves; only the cascade output is
+// clamped to 0..STATE_MAX, and only if it can overshoot. The accumulator
+// is the narrowest of uint32_t (no negative terms, as in a first-order
+// low-pass), int32_t and int64_t that FilterDesign::accumulator_range()
+// allows.
+// ==================================================
+
+template <const auto& DESIGN, uint32_t STATE_MAX>
+class BiquadCascadeQ {
+    static constexpr uint32_t N = std::remove_reference_t<decltype(DESIGN)>::SECTIONS;
+    static constexpr uint32_t BITS = DESIGN.frac_bits;
+    static constexpr FilterDesign::AccumulatorRange RANGE = FilterDesign::accumulator_range(DESIGN, STATE_MAX);
+    static constexpr FilterDesign::StateRange OUTPUT = FilterDesign::cascade_range(DESIGN, STATE_MAX, N);
+    static_assert(N >= 1, "A cascade needs at least one section");
+    static_assert(STATE_MAX < (1u << 31), "State must fit a signed 32-bit word");
+    static_assert(RANGE.fits_signed64(), "Fixed-point cascade accumulator would overflow");
+
+    // Unsigned wraps modulo 2^32, so only the final sum has to fit
+    using Acc = std::conditional_t<RANGE.fits_unsigned32(), uint32_t,
+                std::conditional_t<RANGE.fits_signed32(), int32_t, int64_t>>;
+
+public:
+    BiquadCascadeQ() {
+        reset();
+    }
+
+    void reset() {
+        for (uint32_t i = 0; i < N; ++i) {
+            state[i] = State{0, 0, 0, 0};
+        }
+    }
+
+    // x in 0..STATE_MAX; output clamped to the same range
+    uint32_t process(uint32_t x) {
+        int32_t y = run<0>(static_cast<int32_t>(x));
+        if constexpr (OUTPUT.lo < 0) {
+            if (y < 0) y = 0;
+        }
+        if constexpr (OUTPUT.hi > STATE_MAX) {
+            if (y > static_cast<int32_t>(STATE_MAX)) y = static_cast<int32_t>(STATE_MAX);
+        }
+        return static_cast<uint32_t>(y);
+    }
+
+private:
+    struct State {
+        int32_t x1, x2;
+        int32_t y1, y2;
+    };
+
+    State state[N];
+
+    template <uint32_t I>
+    int32_t run(int32_t x) {
+        if constexpr (I == N) {
+            return x;
+        } else {
+            constexpr FilterDesign::BiquadQ c = DESIGN.sections[I];
+            constexpr FilterDesign::StateRange OUT = FilterDesign::cascade_range(DESIGN, STATE_MAX, I + 1);
+            static_assert(OUT.lo >= INT32_MIN && OUT.hi <= INT32_MAX, "Section state must fit int32_t");
+
+            State& s = state[I];
+            Acc acc = static_cast<Acc>(c.b0) * x + (static_cast<Acc>(1) << (BITS - 1));
+            if constexpr (c.b1 != 0) acc += static_cast<Acc>(c.b1) * s.x1;
+            if constexpr (c.b2 != 0) acc += static_cast<Acc>(c.b2) * s.x2;
+            if constexpr (c.a1 != 0) acc -= static_cast<Acc>(c.a1) * s.y1;
+            if constexpr (c.a2 != 0) acc -= static_cast<Acc>(c.a2) * s.y2;
+            int32_t y = static_cast<int32_t>(acc >> BITS);
+            if constexpr (c.b2 != 0) s.x2 = s.x1;
+            if constexpr (c.a2 != 0) s.y2 = s.y1;
+            s.x1 = x;
+            s.y1 = y;
+            return run<I + 1>(y);
+        }
+    }
+};
+
+#endif // BIQUAD_CASCADE_H
@@ -0,0 +1,245 @@
+#include "crc32.h"
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include "hardware/dma.h"
+#include "adc_config.h"
+#include "stage_profiler.h"
+
+namespace {
+
+constexpr uint32_t POLY_REFLECTED = 0xEDB88320;
+
+// ==================================================
+// Slice-by-8 tables
+// table[0] is the classic byte table; table[k][i] is the CRC of byte i
+// followed by k zero bytes, so eight lookups advance eight bytes
+// ==================================================
+
+struct SliceTables {
+    uint32_t table[8][256];
+};
+
+constexpr SliceTables make_slice_tables() {
+    SliceTables tables = {};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; ++j) {
+            crc = (crc >> 1) ^ (POLY_REFLECTED & (0u - (crc & 1)));
+        }
+        tables.table[0][i] = crc;
+    }
+    for (uint32_t k = 1; k < 8; ++k) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t prev = tables.table[k - 1][i];
+            tables.table[k][i] = (prev >> 8) ^ tables.table[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr SliceTables SLICE = make_slice_tables();
+static_assert(SLICE.table[0][1] == 0x77073096, "CRC-32 table mismatch");
+
+// The sniffer's accumulator runs MSB-first; the reflected state is its
+// bit reversal (the M0+ has no RBIT)
+uint32_t reverse_bits(uint32_t value) {
+    value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+    value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+    value = ((value >> 4) & 0x0F0F0F0F) | ((value & 0x0F0F0F0F) << 4);
+    value = ((value >> 8) & 0x00FF00FF) | ((value & 0x00FF00FF) << 8);
+    return (value >> 16) | (value << 16);
+}
+
+// Benchmark pass over a buffer in chunks short enough for one SysTick span
+constexpr uint32_t BENCH_CHUNK = 4096;
+
+uint32_t bench_pass(uint32_t (*method)(uint32_t, const void*, uint32_t),
+                    const uint8_t* data, uint32_t length, uint64_t* cycles) {
+    uint32_t crc = Crc32::INIT;
+    *cycles = 0;
+    for (uint32_t offset = 0; offset < length; offset += BENCH_CHUNK) {
+        uint32_t n = length - offset;
+        if (n > BENCH_CHUNK) n = BENCH_CHUNK;
+        uint32_t start = StageProfiler::now();
+        crc = method(crc, data + offset, n);
+        *cycles += StageProfiler::elapsed(start, StageProfiler::now());
+    }
+    return ~crc;
+}
+
+} // namespace
+
+namespace Crc32 {
+
+// ==================================================
+// Software CRC
+// ==================================================
+
+uint32_t update_bitwise(uint32_t crc, const void* data, uint32_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= bytes[i];
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ (POLY_REFLECTED & -(crc & 1));
+        }
+    }
+    return crc;
+}
+
+uint32_t update_slice8(uint32_t crc, const void* data, uint32_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const auto& t = SLICE.table;
+
+    // Little-endian words (RP2040 and host alike)
+    while (length >= 8) {
+        uint32_t one;
+        uint32_t two;
+        memcpy(&one, bytes, 4);
+        memcpy(&two, bytes + 4, 4);
+        one ^= crc;
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^
+              t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+              t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^
+              t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+        bytes += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *bytes++) & 0xFF];
+        length--;
+    }
+    return crc;
+}
+
+// ==================================================
+// DMA sniffer CRC
+// ==================================================
+
+uint32_t update_sniffer(uint32_t crc, const void* data, uint32_t length) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    // Word transfers need an aligned start
+    uint32_t head = static_cast<uint32_t>(-reinterpret_cast<uintptr_t>(bytes)) & 3;
+    if (head > length) head = length;
+    crc = update_slice8(crc, bytes, head);
+    bytes += head;
+    length -= head;
+
+    uint32_t words = length / 4;
+    if (words == 0) {
+        return update_slice8(crc, bytes, length);
+    }
+
+    int channel = dma_claim_unused_channel(false);
+    if (channel < 0) {
+        return update_slice8(crc, bytes, length);
+    }
+
+    // Bit-reversed CRC-32 over little-endian words is the reflected CRC of
+    // the byte stream; reading back through OUT_REV gives the reflected state
+    static uint32_t sink;
+    dma_channel_config config = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, DREQ_FORCE);
+    channel_config_set_irq_quiet(&config, true);
+    channel_config_set_sniff_enable(&config, true);
+
+    dma_sniffer_enable(channel, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, false);
+    dma_sniffer_set_output_reverse_enabled(true);
+    dma_sniffer_set_output_invert_enabled(false);
+    dma_sniffer_set_data_accumulator(reverse_bits(crc));
+
+    dma_channel_configure(channel, &config, &sink, bytes, words, true);
+    dma_channel_wait_for_finish_blocking(channel);
+
+    crc = dma_sniffer_get_data_accumulator();
+    dma_sniffer_disable();
+    dma_channel_unclaim(static_cast<uint>(channel));
+
+    return update_slice8(crc, bytes + words * 4, length - words * 4);
+}
+
+uint32_t update(uint32_t crc, const void* data, uint32_t length) {
+    if (CrcConfig::USE_DMA_SNIFFER && length >= CrcConfig::SNIFFER_MIN_BYTES) {
+        return update_sniffer(crc, data, length);
+    }
+    return update_slice8(crc, data, length);
+}
+
+// ==================================================
+// Benchmark
+// ==================================================
+
+void run_benchmark(uint32_t bytes) {
+    // Check value for "123456789"
+    static const uint8_t CHECK[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    bool check_ok = ~update_bitwise(INIT, CHECK, sizeof(CHECK)) == 0xCBF43926 &&
+                    ~update_slice8(INIT, CHECK, sizeof(CHECK)) == 0xCBF43926 &&
+                    ~update_sniffer(INIT, CHECK, sizeof(CHECK)) == 0xCBF43926;
+
+    // No larger than a RAM capture, whatever the caller asks for
+    if (bytes > CollectConfig::RAM_CAPTURE_MAX_BYTES) {
+        printf("CRC benchmark limited to %lu bytes\n", static_cast<unsigned long>(CollectConfig::RAM_CAPTURE_MAX_BYTES));
+        bytes = CollectConfig::RAM_CAPTURE_MAX_BYTES;
+    }
+    uint8_t* buffer = new (std::nothrow) uint8_t[bytes];
+    if (buffer == nullptr) {
+        printf("ERROR: Cannot allocate %lu bytes\n", static_cast<unsigned long>(bytes));
+        return;
+    }
+
+    // Battery-like 12-bit samples, as stored in captures
+    uint32_t lcg = 12345;
+    for (uint32_t i = 0; i + 1 < bytes; i += 2) {
+        lcg = lcg * 1664525u + 1013904223u;
+        uint16_t sample = static_cast<uint16_t>(2000 + ((lcg >> 24) & 0x1F));
+        memcpy(buffer + i, &sample, sizeof(sample));
+    }
+
+    struct Row {
+        const char* name;
+        uint32_t (*method)(uint32_t, const void*, uint32_t);
+        uint64_t cycles;
+        uint32_t crc;
+    };
+    Row rows[] = {
+        {"bitwise", update_bitwise, 0, 0},
+        {"slice-by-8", update_slice8, 0, 0},
+        {"DMA sniffer", update_sniffer, 0, 0},
+    };
+    for (Row& row : rows) {
+        row.crc = bench_pass(row.method, buffer, bytes, &row.cycles);
+    }
+    delete[] buffer;
+
+    // On the device, extrapolate to one full capture slot
+    constexpr uint32_t SLOT_BYTES = 256 * 1024;
+    if (StageProfiler::HOST_TIMER) {
+        printf("CRC-32, %lu bytes (%s):\n", static_cast<unsigned long>(bytes), StageProfiler::UNIT);
+        printf("  %-12s %12s %10s\n", "method", "host ns/byte", "crc");
+    } else {
+        printf("CRC-32, %lu bytes (%s @ %lu MHz):\n", static_cast<unsigned long>(bytes), StageProfiler::UNIT,
+               static_cast<unsigned long>(StageProfiler::CYCLES_PER_US));
+        printf("  %-12s %12s %14s %10s\n", "method", "cycles/byte", "us per 256KB", "crc");
+    }
+    for (const Row& row : rows) {
+        float per_byte = bytes ? static_cast<float>(row.cycles) / bytes : 0.0f;
+        if (StageProfiler::HOST_TIMER) {
+            printf("  %-12s %12.2f   %08lx\n", row.name, per_byte * StageProfiler::UNITS_PER_TICK,
+                   static_cast<unsigned long>(row.crc));
+        } else {
+            printf("  %-12s %12.2f %14lu   %08lx\n", row.name, per_byte,
+                   static_cast<unsigned long>(per_byte * SLOT_BYTES / StageProfiler::CYCLES_PER_US),
+                   static_cast<unsigned long>(row.crc));
+        }
+    }
+    bool agree = rows[0].crc == rows[1].crc && rows[1].crc == rows[2].crc;
+    printf("  check value %s, methods %s, active: %s\n",
+           check_ok ? "ok" : "FAILED", agree ? "agree" : "DISAGREE",
+           CrcConfig::USE_DMA_SNIFFER ? "DMA sniffer" : "slice-by-8");
+}
+
+} // namespace Crc32
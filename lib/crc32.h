@@ -0,0 +1,45 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+// ==================================================
+// CRC-32 (IEEE 802.3, reflected; same as zlib.crc32) for capture checksums
+//
+// update_bitwise  reference shift/xor loop, 8 rounds per byte
+// update_slice8   slice-by-8 tables (8 KB, const), 8 bytes per step
+// update_sniffer  DMA sniffer in bit-reversed CRC-32 mode during a
+//                 32-bit memory-to-memory pass into a dummy word; the
+//                 unaligned head and tail bytes go through slice-by-8.
+//                 Claims a free DMA channel for the call and falls back
+//                 to slice-by-8 if there is none. The sniffer is a single
+//                 shared unit: only call from one core, never from an IRQ.
+// update          sniffer for spans of CrcConfig::SNIFFER_MIN_BYTES and
+//                 up (if CrcConfig::USE_DMA_SNIFFER), slice-by-8 below.
+//
+// All continue a running state: start at INIT, invert at the end
+// (compute() does both). The host stub models the sniffer, so host
+// builds run the same paths.
+// ==================================================
+
+namespace Crc32 {
+    constexpr uint32_t INIT = 0xFFFFFFFF;
+
+    uint32_t update_bitwise(uint32_t crc, const void* data, uint32_t length);
+    uint32_t update_slice8(uint32_t crc, const void* data, uint32_t length);
+    uint32_t update_sniffer(uint32_t crc, const void* data, uint32_t length);
+    uint32_t update(uint32_t crc, const void* data, uint32_t length);
+
+    inline uint32_t compute(const void* data, uint32_t length) {
+        return ~update(INIT, data, length);
+    }
+
+    // Cycles/byte (host ns/byte on the host build) of the three methods
+    // over `bytes` of synthetic samples in RAM plus a check that they
+    // agree (prints a table). Allocates the buffer for the run; `bytes`
+    // is capped at CollectConfig::RAM_CAPTURE_MAX_BYTES.
+    // StageProfiler::init_counter() must have been called on this core.
+    void run_benchmark(uint32_t bytes);
+}
+
+#endif // CRC32_H
@@ -1,8 +1,11 @@
 #include "data_collector.h"
 #include "adc_config.h"
+#include "dma_adc_sampler.h"
+#include "voltage_filter.h"
 #include "pico/stdlib.h"
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include <new>
 
 // ==================================================
@@ -16,8 +19,21 @@ DataCollector::DataCollector()
       samples_collected(0),
       target_samples(0),
       buffer_size(0),
-      last_capture_slot(0),
-      filtering_enabled(false) {
+      raw_capacity(0),
+      dma_source(nullptr),
+      last_capture_id(0),
+      sample_rate_hz(ADCConfig::SAMPLE_RATE_HZ),
+      filtering_enabled(false),
+      streaming(false),
+      samples_written(0),
+      capture_timestamp(0),
+      capture_start_ms(0),
+      ring_size(0),
+      ring_head(0),
+      ring_filled(0),
+      post_samples(0),
+      sag_q4(0),
+      baseline_q4(0) {
 }
 
 DataCollector::~DataCollector() {
@@ -29,13 +45,13 @@ DataCollector::~DataCollector() {
 // ==================================================
 
 bool DataCollector::start_collection(uint32_t duration_ms, bool enable_filtering) {
-    if (is_collecting()) {
+    if (is_busy()) {
         printf("DataCollector: Already collecting\n");
         return false;
     }
     
     // Calculate target samples based on duration and sample rate
-    target_samples = (ADCConfig::SAMPLE_RATE_HZ * duration_ms) / 1000;
+    target_samples = static_cast<uint32_t>(static_cast<uint64_t>(sample_rate_hz) * duration_ms / 1000);
     filtering_enabled = enable_filtering;
     
     printf("DataCollector: Starting collection\n");
@@ -45,6 +61,31 @@ bool DataCollector::start_collection(uint32_t duration_ms, bool enable_filtering
     
     state = State::PREPARING;
     
+    // Reset counters
+    samples_collected = 0;
+
+    // Too large for RAM: write to flash as samples arrive
+    uint64_t capture_bytes = static_cast<uint64_t>(target_samples) * sizeof(uint16_t) * (filtering_enabled ? 2 : 1);
+    streaming = capture_bytes > CollectConfig::RAM_CAPTURE_MAX_BYTES;
+    if (streaming) {
+        free_buffers();
+        if (!stream.begin(target_samples, filtering_enabled, sample_rate_hz)) {
+            printf("DataCollector: Failed to start flash stream\n");
+            streaming = false;
+            state = State::ERROR;
+            return false;
+        }
+        state = State::COLLECTING;
+        printf("DataCollector: Collection started (streaming to flash)\n");
+        return true;
+    }
+    
+    // Refuse now rather than lose the samples when the write starts
+    if (!FlashStorage::CaptureStream::can_begin(target_samples, filtering_enabled)) {
+        state = State::ERROR;
+        return false;
+    }
+
     // Allocate buffers
     if (!allocate_buffers(target_samples, filtering_enabled)) {
         printf("DataCollector: Failed to allocate buffers\n");
@@ -52,9 +93,6 @@ bool DataCollector::start_collection(uint32_t duration_ms, bool enable_filtering
         return false;
     }
     
-    // Reset counters
-    samples_collected = 0;
-    
     // Ready to collect
     state = State::COLLECTING;
     printf("DataCollector: Collection started (buffer size: %lu samples)\n", 
@@ -63,8 +101,71 @@ bool DataCollector::start_collection(uint32_t duration_ms, bool enable_filtering
     return true;
 }
 
+bool DataCollector::arm(uint32_t pre_ms, uint32_t post_ms, uint32_t sag_mv, bool enable_filtering) {
+    if (is_busy()) {
+        printf("DataCollector: Already collecting\n");
+        return false;
+    }
+
+    uint32_t pre = static_cast<uint32_t>(static_cast<uint64_t>(sample_rate_hz) * pre_ms / 1000);
+    uint32_t post = static_cast<uint32_t>(static_cast<uint64_t>(sample_rate_hz) * post_ms / 1000);
+    uint64_t capture_bytes = static_cast<uint64_t>(pre + post) * sizeof(uint16_t) * (enable_filtering ? 2 : 1);
+    if (post == 0 || sag_mv == 0 || capture_bytes > CollectConfig::RAM_CAPTURE_MAX_BYTES) {
+        printf("DataCollector: ARM needs a post-trigger window, a sag and at most %lu KB of samples\n",
+               static_cast<unsigned long>(CollectConfig::RAM_CAPTURE_MAX_BYTES / 1024));
+        return false;
+    }
+
+    if (!FlashStorage::CaptureStream::can_begin(pre + post, enable_filtering)) {
+        return false;
+    }
+
+    state = State::PREPARING;
+    streaming = false;
+    filtering_enabled = enable_filtering;
+    samples_collected = 0;
+    target_samples = 0;  // Set by the trigger
+    if (!allocate_buffers(pre + post, enable_filtering)) {
+        printf("DataCollector: Failed to allocate buffers\n");
+        state = State::ERROR;
+        return false;
+    }
+
+    ring_size = pre;
+    ring_head = 0;
+    ring_filled = 0;
+    post_samples = post;
+    baseline_q4 = 0;
+    sag_q4 = static_cast<uint32_t>(sag_mv * static_cast<float>(1u << VoltageFilter::Q4_SHIFT) / ADCConfig::MV_PER_COUNT + 0.5f);
+
+    state = State::ARMED;
+    printf("DataCollector: Armed (%lu ms before, %lu ms after a %lu mV sag, %s)\n",
+           static_cast<unsigned long>(pre_ms), static_cast<unsigned long>(post_ms),
+           static_cast<unsigned long>(sag_mv), enable_filtering ? "raw + filtered" : "raw only");
+    return true;
+}
+
+bool DataCollector::attach_dma(DMAADCSampler* sampler) {
+    if (state != State::COLLECTING || streaming || dma_source != nullptr || samples_collected != 0 ||
+        sampler == nullptr) {
+        return false;
+    }
+
+    if (!sampler->start_capture(raw_buffer, raw_capacity)) {
+        return false;
+    }
+
+    dma_source = sampler;
+    printf("DataCollector: DMA writing raw samples directly (%lu strides)\n",
+           static_cast<unsigned long>(raw_capacity / ADCConfig::BUFFER_SIZE));
+    return true;
+}
+
 bool DataCollector::process_buffer(const uint16_t* raw_samples, const uint16_t* filtered_samples, uint32_t count) {
-    if (state != State::COLLECTING) {
+    if (state == State::ARMED) {
+        return process_armed(raw_samples, filtered_samples, count);
+    }
+    if (state != State::COLLECTING && state != State::TRIGGERED) {
         return false;  // Not collecting
     }
     
@@ -77,30 +178,69 @@ bool DataCollector::process_buffer(const uint16_t* raw_samples, const uint16_t*
         printf("DataCollector: WARNING - Filtering enabled but no filtered samples provided\n");
     }
     
+    // Zero-copy: the span is already in place; its offset is its position
+    uint32_t offset = samples_collected;
+    if (dma_source != nullptr) {
+        if (raw_samples < raw_buffer || raw_samples >= raw_buffer + raw_capacity) {
+            return false;  // Ping-pong buffer from before the switch-over
+        }
+        offset = static_cast<uint32_t>(raw_samples - raw_buffer);
+        if (offset >= target_samples) {
+            return false;  // Stride padding past the target
+        }
+        if (offset != samples_collected) {
+            // Core 1 skipped a stride (sampler overflow); raw data is intact
+            printf("DataCollector: WARNING - filtered gap at sample %lu\n",
+                   static_cast<unsigned long>(samples_collected));
+        }
+    }
+
     // Calculate how many samples to copy
-    uint32_t remaining = target_samples - samples_collected;
+    uint32_t remaining = target_samples - offset;
     uint32_t to_copy = (count < remaining) ? count : remaining;
-    
-    // Copy raw samples to collection buffer
-    memcpy(raw_buffer + samples_collected, raw_samples, to_copy * sizeof(uint16_t));
+
+    // The first span was sampled over the buffer period before now (a
+    // trigger has already placed its capture)
+    if (offset == 0 && state == State::COLLECTING) {
+        uint32_t span_ms = static_cast<uint32_t>(static_cast<uint64_t>(count) * 1000 / sample_rate_hz);
+        capture_start_ms = to_ms_since_boot(get_absolute_time()) - span_ms;
+        if (streaming) {
+            stream.set_start_time(capture_start_ms);
+        }
+    }
+
+    if (streaming) {
+        // Pages are programmed (and sectors erased ahead) before returning
+        if (!stream.append(raw_samples, filtering_enabled ? filtered_samples : nullptr, to_copy)) {
+            printf("DataCollector: Flash stream failed\n");
+            streaming = false;
+            state = State::ERROR;
+            return false;
+        }
+        if (stream.is_full()) {
+            // Coded samples outgrew the reservation; keep what fitted
+            to_copy = stream.get_samples_written() - offset;
+            target_samples = stream.get_samples_written();
+        }
+    } else if (dma_source == nullptr) {
+        // Copy raw samples to collection buffer
+        memcpy(raw_buffer + offset, raw_samples, to_copy * sizeof(uint16_t));
+    }
     
     // Copy filtered samples if available
-    if (filtering_enabled && filtered_samples != nullptr) {
-        memcpy(filtered_buffer + samples_collected, filtered_samples, to_copy * sizeof(uint16_t));
+    if (!streaming && filtering_enabled && filtered_samples != nullptr) {
+        memcpy(filtered_buffer + offset, filtered_samples, to_copy * sizeof(uint16_t));
     }
     
-    samples_collected += to_copy;
+    samples_collected = offset + to_copy;
     
     // Check if collection complete
     if (samples_collected >= target_samples) {
         printf("DataCollector: Target reached (%lu samples)\n", 
                static_cast<unsigned long>(samples_collected));
         
-        // Auto-finalize (write to flash)
-        int slot = finalize_collection();
-        if (slot >= 0) {
-            printf("DataCollector: Saved to flash slot %d\n", slot);
-        } else {
+        // Auto-finalize (streams finish here; RAM captures start writing)
+        if (finalize_collection() < 0) {
             printf("DataCollector: Failed to write to flash\n");
             state = State::ERROR;
         }
@@ -109,8 +249,111 @@ bool DataCollector::process_buffer(const uint16_t* raw_samples, const uint16_t*
     return true;
 }
 
+bool DataCollector::process_armed(const uint16_t* raw_samples, const uint16_t* filtered_samples, uint32_t count) {
+    if (raw_samples == nullptr || filtered_samples == nullptr || count == 0) {
+        return false;
+    }
+
+    // First filtered sample (12-bit counts) below the trigger level. The
+    // buffer that seeds the running level is not checked (level 0)
+    uint32_t level = (baseline_q4 > sag_q4) ? (baseline_q4 - sag_q4) >> VoltageFilter::Q4_SHIFT : 0;
+    uint32_t trigger = count;
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (filtered_samples[i] < level) {
+            trigger = i;
+            break;
+        }
+        sum += filtered_samples[i];
+    }
+    push_ring(raw_samples, filtered_samples, trigger);
+
+    if (trigger == count) {
+        // Quiet buffer: move the running level toward its mean
+        uint32_t mean = static_cast<uint32_t>((static_cast<uint64_t>(sum) << VoltageFilter::Q4_SHIFT) / count);
+        if (baseline_q4 == 0) {
+            baseline_q4 = mean;
+        } else {
+            int32_t delta = static_cast<int32_t>(mean) - static_cast<int32_t>(baseline_q4);
+            baseline_q4 = static_cast<uint32_t>(static_cast<int32_t>(baseline_q4) +
+                                                delta / (1 << CollectConfig::ARM_BASELINE_SHIFT));
+        }
+        return true;
+    }
+
+    // Oldest ring sample first; the capture carries on from the trigger
+    if (ring_filled == ring_size && ring_head != 0) {
+        std::rotate(raw_buffer, raw_buffer + ring_head, raw_buffer + ring_size);
+        if (filtered_buffer != nullptr) {
+            std::rotate(filtered_buffer, filtered_buffer + ring_head, filtered_buffer + ring_size);
+        }
+    }
+    uint32_t trigger_ms = to_ms_since_boot(get_absolute_time()) -
+                          static_cast<uint32_t>(static_cast<uint64_t>(count - trigger) * 1000 / sample_rate_hz);
+    capture_start_ms = trigger_ms - static_cast<uint32_t>(static_cast<uint64_t>(ring_filled) * 1000 / sample_rate_hz);
+    samples_collected = ring_filled;
+    target_samples = ring_filled + post_samples;
+    state = State::TRIGGERED;
+    printf("DataCollector: Triggered at %lu ms, %.0f mV below the running level (%lu pre-trigger samples)\n",
+           static_cast<unsigned long>(trigger_ms),
+           static_cast<double>((baseline_q4 - (static_cast<uint32_t>(filtered_samples[trigger]) << VoltageFilter::Q4_SHIFT)) *
+                               ADCConfig::MV_PER_COUNT / (1u << VoltageFilter::Q4_SHIFT)),
+           static_cast<unsigned long>(ring_filled));
+
+    return process_buffer(raw_samples + trigger, filtered_samples + trigger, count - trigger);
+}
+
+void DataCollector::push_ring(const uint16_t* raw_samples, const uint16_t* filtered_samples, uint32_t count) {
+    if (count > ring_size) {
+        raw_samples += count - ring_size;
+        filtered_samples += count - ring_size;
+        count = ring_size;
+    }
+    while (count > 0) {
+        uint32_t n = ring_size - ring_head;
+        if (n > count) n = count;
+        memcpy(raw_buffer + ring_head, raw_samples, n * sizeof(uint16_t));
+        if (filtered_buffer != nullptr) {
+            memcpy(filtered_buffer + ring_head, filtered_samples, n * sizeof(uint16_t));
+        }
+        ring_head = (ring_head + n == ring_size) ? 0 : ring_head + n;
+        ring_filled = (ring_filled + n > ring_size) ? ring_size : ring_filled + n;
+        raw_samples += n;
+        filtered_samples += n;
+        count -= n;
+    }
+}
+
+bool DataCollector::service_write() {
+    if (state != State::WRITING_FLASH || streaming) {
+        return false;
+    }
+
+    // One DMA buffer's worth per call, so the write keeps pace with
+    // sampling and each pass erases at most one sector
+    uint32_t n = samples_collected - samples_written;
+    if (n > ADCConfig::BUFFER_SIZE) n = ADCConfig::BUFFER_SIZE;
+
+    bool ok = true;
+    if (n > 0) {
+        const uint16_t* filtered = (filtered_buffer != nullptr) ? filtered_buffer + samples_written : nullptr;
+        ok = stream.append(raw_buffer + samples_written, filtered, n);
+        samples_written += n;
+    }
+
+    if (ok && (samples_written >= samples_collected || stream.is_full())) {
+        if (stream.is_full()) {
+            samples_collected = stream.get_samples_written();
+        }
+        finish_write(stream.finish(capture_timestamp));
+    } else if (!ok) {
+        finish_write(-1);
+    }
+    return true;
+}
+
 int DataCollector::finalize_collection() {
-    if (state != State::COLLECTING) {
+    if (state != State::COLLECTING && state != State::TRIGGERED) {
         printf("DataCollector: Cannot finalize - not collecting\n");
         return -1;
     }
@@ -119,22 +362,40 @@ int DataCollector::finalize_collection() {
     state = State::WRITING_FLASH;
     
     // Get current uptime as timestamp
-    uint32_t timestamp = to_ms_since_boot(get_absolute_time());
+    capture_timestamp = to_ms_since_boot(get_absolute_time());
     
-    // Write to flash (with or without filtered data)
-    int slot;
-    if (filtering_enabled && filtered_buffer != nullptr) {
-        slot = FlashStorage::write_capture_dual(raw_buffer, filtered_buffer, samples_collected, timestamp);
-        printf("DataCollector: Wrote raw + filtered samples\n");
-    } else {
-        slot = FlashStorage::write_capture_dual(raw_buffer, nullptr, samples_collected, timestamp);
-        printf("DataCollector: Wrote raw samples only\n");
+    if (streaming) {
+        // Samples are already in flash; program the remaining pages and the header
+        int id = stream.finish(capture_timestamp);
+        streaming = false;
+        printf("DataCollector: Finished flash stream\n");
+        finish_write(id);
+        return id;
     }
-    
-    if (slot >= 0) {
-        printf("DataCollector: Successfully wrote %lu samples to slot %d\n", 
-               static_cast<unsigned long>(samples_collected), slot);
-        last_capture_slot = slot;
+
+    // RAM capture: written a buffer at a time by service_write() while
+    // sampling carries on
+    bool with_filtered = filtering_enabled && filtered_buffer != nullptr;
+    if (!with_filtered && filtered_buffer != nullptr) {
+        delete[] filtered_buffer;
+        filtered_buffer = nullptr;
+    }
+    samples_written = 0;
+    if (!stream.begin(samples_collected, with_filtered, sample_rate_hz)) {
+        finish_write(-1);
+        return -1;
+    }
+    stream.set_start_time(capture_start_ms);
+    printf("DataCollector: Writing %s to capture %d, one buffer per pass\n",
+           with_filtered ? "raw + filtered samples" : "raw samples only", stream.get_id());
+    return stream.get_id();
+}
+
+void DataCollector::finish_write(int id) {
+    if (id >= 0) {
+        printf("DataCollector: Successfully wrote %lu samples to capture %d\n", 
+               static_cast<unsigned long>(samples_collected), id);
+        last_capture_id = id;
         state = State::COMPLETE;
         
         // Free buffers to reclaim RAM
@@ -143,19 +404,24 @@ int DataCollector::finalize_collection() {
         printf("DataCollector: Collection complete, state reset to IDLE\n");
     } else {
         printf("DataCollector: Flash write failed\n");
+        stream.abort();
+        free_buffers();
         state = State::ERROR;
     }
     
     printf("DataCollector: Returning to normal operation\n");
-    return slot;
 }
 
 void DataCollector::cancel_collection() {
-    if (!is_collecting()) {
+    if (!is_busy()) {
         return;
     }
     
     printf("DataCollector: Collection cancelled\n");
+    if (streaming || state == State::WRITING_FLASH) {
+        stream.abort();
+        streaming = false;
+    }
     free_buffers();
     state = State::IDLE;
     samples_collected = 0;
@@ -189,14 +455,18 @@ bool DataCollector::allocate_buffers(uint32_t num_samples, bool enable_filtering
            static_cast<unsigned long>(num_samples),
            enable_filtering ? "raw + filtered" : "raw only");
     
-    // Allocate raw buffer
-    raw_buffer = new (std::nothrow) uint16_t[num_samples];
+    // Allocate raw buffer in whole DMA buffers so zero-copy capture can
+    // write its last stride in full
+    uint32_t raw_samples = ((num_samples + ADCConfig::BUFFER_SIZE - 1) / ADCConfig::BUFFER_SIZE)
+                           * ADCConfig::BUFFER_SIZE;
+    raw_buffer = new (std::nothrow) uint16_t[raw_samples];
     if (raw_buffer == nullptr) {
         printf("DataCollector: Failed to allocate raw buffer (%lu bytes)\n", 
                static_cast<unsigned long>(bytes_per_buffer));
         return false;
     }
-    memset(raw_buffer, 0, bytes_per_buffer);
+    memset(raw_buffer, 0, raw_samples * sizeof(uint16_t));
+    raw_capacity = raw_samples;
     
     // Allocate filtered buffer if enabled
     if (enable_filtering) {
@@ -218,6 +488,13 @@ bool DataCollector::allocate_buffers(uint32_t num_samples, bool enable_filtering
 }
 
 void DataCollector::free_buffers() {
+    // Never free memory the DMA may still be writing
+    if (dma_source != nullptr) {
+        if (dma_source->is_capturing()) {
+            dma_source->cancel_capture();
+        }
+        dma_source = nullptr;
+    }
     if (raw_buffer != nullptr) {
         delete[] raw_buffer;
         raw_buffer = nullptr;
@@ -229,4 +506,5 @@ void DataCollector::free_buffers() {
         printf("DataCollector: Filtered buffer freed\n");
     }
     buffer_size = 0;
+    raw_capacity = 0;
 }
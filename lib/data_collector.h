@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include "flash_storage.h"
 
+class DMAADCSampler;
+
 // ==================================================
 // Data Collector Class
 // Manages collection of ADC samples for analysis
@@ -14,9 +16,11 @@ class DataCollector {
 public:
     enum class State {
         IDLE,           // Not collecting
-        PREPARING,      // Allocating buffer
-        COLLECTING,     // Actively collecting samples
-        WRITING_FLASH,  // Writing to flash
+        PREPARING,      // Allocating buffer / erasing the first sectors
+        ARMED,          // Filling the pre-trigger ring, waiting for a sag (see arm)
+        TRIGGERED,      // Sag seen; collecting the post-trigger window
+        COLLECTING,     // Actively collecting samples (streaming: also writing flash)
+        WRITING_FLASH,  // RAM capture being written to flash (see service_write)
         COMPLETE,       // Ready for download
         ERROR           // Collection failed
     };
@@ -26,18 +30,50 @@ public:
     
     // Start collection (specify duration in milliseconds)
     // enable_filtering: if true, also collect filtered samples
+    // Captures over CollectConfig::RAM_CAPTURE_MAX_BYTES stream to flash
+    // as they arrive instead of being buffered in RAM
     // Returns true if collection started successfully
     bool start_collection(uint32_t duration_ms, bool enable_filtering = true);
+
+    // Keep the last pre_ms of samples in a RAM ring and wait for the
+    // filtered voltage to sag sag_mv (battery mV) below its running level.
+    // The trigger turns the ring plus post_ms from the trigger sample on
+    // into a RAM capture, written like one from start_collection().
+    // One-shot: re-arm for the next event.
+    // Returns true if armed
+    bool arm(uint32_t pre_ms, uint32_t post_ms, uint32_t sag_mv, bool enable_filtering = true);
+
+    // Rate the sampler runs at; sizes captures and goes into the file header
+    void set_sample_rate(uint32_t rate_hz) { sample_rate_hz = rate_hz; }
+    uint32_t get_sample_rate_hz() const { return sample_rate_hz; }
     
+    // Hand the raw buffer to the sampler so DMA writes samples into it
+    // directly (zero-copy). Call from the Core 1 loop each pass; it only
+    // acts on a RAM capture that has not received any samples yet.
+    // Returns true if the sampler accepted the buffer
+    bool attach_dma(DMAADCSampler* sampler);
+
     // Called by Core 1 when DMA buffer ready
     // raw_samples: raw ADC samples
     // filtered_samples: optional filtered samples (can be nullptr if not enabled)
+    // Both spans are copied before returning, so callers may pass reusable
+    // scratch buffers (SamplePipeline does). With attach_dma() active the
+    // raw span already lives in the capture buffer and is not copied;
+    // buffers from outside it (before the DMA switched over) are ignored.
     // Returns true if buffer was processed
     bool process_buffer(const uint16_t* raw_samples, const uint16_t* filtered_samples, uint32_t count);
     
     // Finalize collection (write to flash)
-    // Returns flash slot number or -1 on error
+    // A streamed capture is finished here. A RAM capture only starts its
+    // write: service_write() then programs it one DMA buffer at a time so
+    // no flash operation holds off sampling for long.
+    // Returns flash capture id or -1 on error
     int finalize_collection();
+
+    // Advance a pending RAM capture write by one DMA buffer (at most one
+    // sector erase). SamplePipeline calls it once per buffer.
+    // Returns true if a write was pending
+    bool service_write();
     
     // Cancel ongoing collection
     void cancel_collection();
@@ -51,13 +87,24 @@ public:
     // Get statistics
     uint32_t get_samples_collected() const { return samples_collected; }
     uint32_t get_target_samples() const { return target_samples; }
-    uint32_t get_last_capture_slot() const { return last_capture_slot; }
+    uint32_t get_last_capture_id() const { return last_capture_id; }
     
-    // Check if currently collecting
+    // True if the current capture streams to flash
+    bool is_streaming() const { return streaming; }
+
+    // Check if currently collecting (armed counts: the ring is filling)
     bool is_collecting() const { 
-        return state == State::COLLECTING || state == State::PREPARING; 
+        return state == State::COLLECTING || state == State::PREPARING ||
+               state == State::ARMED || state == State::TRIGGERED; 
     }
+
+    bool is_armed() const { return state == State::ARMED; }
     
+    // Collecting or still writing the capture to flash
+    bool is_busy() const {
+        return is_collecting() || state == State::WRITING_FLASH;
+    }
+
     // Check if collection complete
     bool is_complete() const { 
         return state == State::COMPLETE; 
@@ -70,8 +117,34 @@ private:
     uint32_t samples_collected;
     uint32_t target_samples;
     uint32_t buffer_size;         // Allocated buffer size
-    uint32_t last_capture_slot;   // Flash slot of last capture
+    uint32_t raw_capacity;        // Raw buffer size, rounded up to whole DMA buffers
+    DMAADCSampler* dma_source;    // Sampler writing raw_buffer directly (nullptr: copy mode)
+    uint32_t last_capture_id;     // Flash capture id of last capture
+    uint32_t sample_rate_hz;      // Sampler rate (ADCConfig::SAMPLE_RATE_HZ by default)
     bool filtering_enabled;       // Whether to collect filtered samples
+    bool streaming;               // Capture goes to flash as it arrives (no RAM buffers)
+    FlashStorage::CaptureStream stream;
+    uint32_t samples_written;     // RAM capture samples handed to the stream so far
+    uint32_t capture_timestamp;   // Uptime (ms) when the capture was finalized
+    uint32_t capture_start_ms;    // Uptime (ms) of the first sample (chunk timestamps)
+
+    // ARM: pre-trigger ring at the start of the capture buffers
+    uint32_t ring_size;           // Pre-trigger samples kept
+    uint32_t ring_head;           // Next slot to write
+    uint32_t ring_filled;
+    uint32_t post_samples;        // Samples from the trigger on
+    uint32_t sag_q4;              // Trigger depth below baseline (Q4 ADC counts)
+    uint32_t baseline_q4;         // Running filtered level (Q4, 0 until the first buffer)
+    
+    // Scan a buffer for the trigger while armed; from the trigger on the
+    // buffer is collected as usual
+    bool process_armed(const uint16_t* raw_samples, const uint16_t* filtered_samples, uint32_t count);
+
+    // Copy samples into the ring (only the last ring_size of a longer span)
+    void push_ring(const uint16_t* raw_samples, const uint16_t* filtered_samples, uint32_t count);
+    
+    // Record the outcome of a write and release the buffers
+    void finish_write(int id);
     
     // Allocate collection buffers
     bool allocate_buffers(uint32_t num_samples, bool enable_filtering);
@@ -0,0 +1,79 @@
+#include "decimator.h"
+#include "voltage_filter.h"
+
+// ==================================================
+// Constructor
+// ==================================================
+
+DecimationChain::DecimationChain() {
+    for (uint32_t r = 0; r < RATE_COUNT; ++r) {
+        subscriber_count[r] = 0;
+    }
+    reset();
+}
+
+void DecimationChain::reset() {
+    mid_cic.reset();
+    low_cic.reset();
+    low_half_band.reset();
+    for (uint32_t r = 0; r < RATE_COUNT; ++r) {
+        output_count[r] = 0;
+    }
+    settle_remaining = DecimationConfig::SETTLE_SAMPLES;
+    seeded = false;
+}
+
+bool DecimationChain::subscribe(Rate rate, Consumer consumer, void* context) {
+    if (rate >= RATE_COUNT || consumer == nullptr ||
+        subscriber_count[rate] >= DecimationConfig::MAX_SUBSCRIBERS) {
+        return false;
+    }
+    subscribers[rate][subscriber_count[rate]++] = Subscriber{consumer, context};
+    return true;
+}
+
+void DecimationChain::publish(Rate rate, uint32_t value_q4) {
+    output_count[rate]++;
+    for (uint32_t i = 0; i < subscriber_count[rate]; ++i) {
+        subscribers[rate][i].consumer(subscribers[rate][i].context, value_q4);
+    }
+}
+
+// ==================================================
+// Block Processing
+// ==================================================
+
+void DecimationChain::process_block(const uint16_t* counts, uint32_t n) {
+    bool run_low = subscriber_count[RATE_LOW] > 0;
+    if (n == 0 || (!run_low && subscriber_count[RATE_MID] == 0)) {
+        return;
+    }
+
+    uint32_t i = 0;
+    if (!seeded) {
+        if (settle_remaining >= n) {
+            settle_remaining -= n;
+            return;
+        }
+        i = settle_remaining;
+        settle_remaining = 0;
+        uint32_t first_q4 = static_cast<uint32_t>(counts[i]) << VoltageFilter::Q4_SHIFT;
+        mid_cic.seed(first_q4);
+        low_cic.seed(first_q4);
+        low_half_band.seed(first_q4);
+        seeded = true;
+    }
+
+    for (; i < n; ++i) {
+        uint32_t mid_q4;
+        if (!mid_cic.push(static_cast<uint32_t>(counts[i]) << VoltageFilter::Q4_SHIFT, &mid_q4)) {
+            continue;
+        }
+        publish(RATE_MID, mid_q4);
+
+        uint32_t low_q4;
+        if (run_low && low_cic.push(mid_q4, &low_q4) && low_half_band.push(low_q4, &low_q4)) {
+            publish(RATE_LOW, low_q4);
+        }
+    }
+}
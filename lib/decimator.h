@@ -0,0 +1,186 @@
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <stdint.h>
+#include "adc_config.h"
+#include "filter_design.h"
+
+// ==================================================
+// CicDecimator<R, ORDER>: ORDER integrators at the input rate, ORDER
+// combs at 1/R of it, output divided by the gain R^ORDER (the average of
+// the input, same scale). Registers are uint32_t and wrap; only the
+// output range has to fit 32 bits.
+// ==================================================
+
+template <uint32_t R, uint32_t ORDER>
+class CicDecimator {
+public:
+    static constexpr uint32_t gain() {
+        uint32_t g = 1;
+        for (uint32_t i = 0; i < ORDER; ++i) g *= R;
+        return g;
+    }
+    static constexpr uint32_t GAIN = gain();
+
+    CicDecimator() { reset(); }
+
+    void reset() {
+        for (uint32_t i = 0; i < ORDER; ++i) {
+            integrator[i] = 0;
+            comb[i] = 0;
+        }
+        phase = 0;
+    }
+
+    // State of a constant input x; later outputs have no start-up ramp
+    void seed(uint32_t x) {
+        reset();
+        uint32_t unused;
+        for (uint32_t i = 0; i < ORDER * R; ++i) {
+            push(x, &unused);
+        }
+    }
+
+    // Returns true when x completes an output
+    bool push(uint32_t x, uint32_t* out) {
+        uint32_t v = x;
+        for (uint32_t i = 0; i < ORDER; ++i) {
+            integrator[i] += v;
+            v = integrator[i];
+        }
+        if (++phase < R) {
+            return false;
+        }
+        phase = 0;
+        for (uint32_t i = 0; i < ORDER; ++i) {
+            uint32_t d = v - comb[i];
+            comb[i] = v;
+            v = d;
+        }
+        *out = (v + GAIN / 2) / GAIN;
+        return true;
+    }
+
+private:
+    uint32_t integrator[ORDER];
+    uint32_t comb[ORDER];
+    uint32_t phase;
+};
+
+// ==================================================
+// HalfBandDecimator<TAPS>: half-band FIR (FilterDesign::half_band), one
+// output per two inputs. Cleans up the band between a quarter and half
+// the output rate that the CIC droops into. Int64 accumulator; it runs
+// at the lowest rate only.
+// ==================================================
+
+template <uint32_t TAPS>
+class HalfBandDecimator {
+public:
+    static constexpr uint32_t COEF_BITS = DecimationConfig::HALF_BAND_COEF_BITS;
+    static constexpr FilterDesign::FirQ<TAPS> COEFFICIENTS =
+        FilterDesign::quantize(FilterDesign::half_band<TAPS>(), COEF_BITS);
+
+    HalfBandDecimator() { reset(); }
+
+    void reset() { seed(0); }
+
+    void seed(uint32_t x) {
+        for (uint32_t i = 0; i < TAPS; ++i) {
+            history[i] = static_cast<int32_t>(x);
+        }
+        odd = false;
+    }
+
+    bool push(uint32_t x, uint32_t* out) {
+        for (uint32_t i = TAPS - 1; i > 0; --i) {
+            history[i] = history[i - 1];
+        }
+        history[0] = static_cast<int32_t>(x);
+        odd = !odd;
+        if (odd) {
+            return false;
+        }
+
+        int64_t acc = 1ll << (COEF_BITS - 1);
+        for (uint32_t i = 0; i < TAPS; ++i) {
+            acc += static_cast<int64_t>(COEFFICIENTS.taps[i]) * history[i];
+        }
+        int64_t y = acc >> COEF_BITS;
+        *out = (y < 0) ? 0 : static_cast<uint32_t>(y);
+        return true;
+    }
+
+private:
+    int32_t history[TAPS];
+    bool odd;
+};
+
+// ==================================================
+// DecimationChain Class
+// Filtered samples -> MID (CIC / MID_CIC_RATIO) -> LOW (CIC /
+// LOW_CIC_RATIO, then half-band / 2): 500 Hz and 10 Hz at 5 kHz
+// (DecimationConfig). Consumers subscribe to the rate they need; a block
+// only runs the stages down to the lowest subscribed rate, so the 10 Hz
+// path costs three adds per input sample. Full-rate consumers (shot
+// detector, collector, spectrum) take the filter output directly.
+// Values are Q4 ADC counts. Core 1 only.
+// ==================================================
+
+class DecimationChain {
+public:
+    enum Rate : uint8_t {
+        RATE_MID,
+        RATE_LOW,
+        RATE_COUNT
+    };
+
+    // Called on Core 1 for every output of the subscribed rate
+    typedef void (*Consumer)(void* context, uint32_t value_q4);
+
+    DecimationChain();
+
+    // Returns false if the rate already has MAX_SUBSCRIBERS consumers
+    bool subscribe(Rate rate, Consumer consumer, void* context);
+
+    // Filtered samples, whole ADC counts
+    void process_block(const uint16_t* counts, uint32_t n);
+
+    // Filter state only; subscriptions stay. The first SETTLE_SAMPLES
+    // after a reset are skipped and the next one seeds every stage, so
+    // outputs start at that level instead of ramping from zero
+    void reset();
+
+    // Input samples per output
+    static constexpr uint32_t ratio(Rate rate) {
+        return (rate == RATE_MID) ? DecimationConfig::MID_RATIO : DecimationConfig::LOW_RATIO;
+    }
+
+    uint32_t get_output_count(Rate rate) const { return output_count[rate]; }
+
+private:
+    struct Subscriber {
+        Consumer consumer;
+        void* context;
+    };
+
+    CicDecimator<DecimationConfig::MID_CIC_RATIO, DecimationConfig::CIC_ORDER> mid_cic;
+    CicDecimator<DecimationConfig::LOW_CIC_RATIO, DecimationConfig::CIC_ORDER> low_cic;
+    HalfBandDecimator<DecimationConfig::HALF_BAND_TAPS> low_half_band;
+
+    Subscriber subscribers[RATE_COUNT][DecimationConfig::MAX_SUBSCRIBERS];
+    uint32_t subscriber_count[RATE_COUNT];
+    uint32_t output_count[RATE_COUNT];
+    uint32_t settle_remaining;
+    bool seeded;
+
+    void publish(Rate rate, uint32_t value_q4);
+
+    static_assert(2ull * FilterConfig::LPF_STATE_MAX * CicDecimator<DecimationConfig::MID_CIC_RATIO,
+                  DecimationConfig::CIC_ORDER>::GAIN < (1ull << 32) &&
+                  2ull * FilterConfig::LPF_STATE_MAX * CicDecimator<DecimationConfig::LOW_CIC_RATIO,
+                  DecimationConfig::CIC_ORDER>::GAIN < (1ull << 32),
+                  "CIC output range must fit 32 bits");
+};
+
+#endif // DECIMATOR_H
@@ -1,10 +1,12 @@
 #include "dma_adc_sampler.h"
+#include "flash_safe_irq.h"
 #include "hardware/irq.h"
 #include "hardware/sync.h"
 #include "hardware/regs/adc.h"
 #include "hardware/gpio.h"
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
 // ==================================================
 // Static member initialization
@@ -17,14 +19,37 @@ DMAADCSampler* DMAADCSampler::instance = nullptr;
 // ==================================================
 
 DMAADCSampler::DMAADCSampler()
-        : dma_channel(-1),
+        : dma_channels{-1, -1},
+            capture_state(CAPTURE_IDLE),
+            capture_dest(nullptr),
+            capture_strides(0),
+            capture_assigned(0),
+            capture_completed(0),
             buffer_a_ready(false),
             buffer_b_ready(false),
-            using_buffer_a(true),
+            next_slot(0),
+            slot_target{buffer_a, buffer_b},
+            buffer_a_data(buffer_a),
+            buffer_b_data(buffer_b),
             buffer_count(0),
             overflow_count(0),
+            sample_sequence(0),
+            continuity_errors(0),
+            missed_buffers(0),
+            missed_triggers(0),
             buffer_locked(false),
             locked_buffer_is_a(false),
+            sample_rate_hz(0),
+            pacing(ADCConfig::HARDWARE_PACING ? Pacing::ADC_CLKDIV : Pacing::TIMER),
+            period_us(0),
+            clkdiv_q8(0),
+            buffer_period_us(0),
+            last_trigger_us(0),
+            last_buffer_us(0),
+            buffer_timed(false),
+            last_irq_us(0),
+            irq_timed(false),
+            irq_reported(false),
             timer_running(false),
             hardware_alarm_id(-1),
             dma_irq_count(0),
@@ -35,6 +60,8 @@ DMAADCSampler::DMAADCSampler()
     // Zero buffers
     memset(buffer_a, 0, sizeof(buffer_a));
     memset(buffer_b, 0, sizeof(buffer_b));
+    configure(ADCConfig::SAMPLE_RATE_HZ, pacing);
+    reset_pacing_stats();
     
     // Set singleton instance for interrupt handler
     instance = this;
@@ -43,9 +70,11 @@ DMAADCSampler::DMAADCSampler()
 DMAADCSampler::~DMAADCSampler() {
     stop();
     
-    // Free DMA channel if allocated
-    if (dma_channel >= 0) {
-        dma_channel_unclaim(dma_channel);
+    // Free DMA channels if allocated
+    for (uint32_t slot = 0; slot < 2; ++slot) {
+        if (dma_channels[slot] >= 0) {
+            dma_channel_unclaim(dma_channels[slot]);
+        }
     }
 
     if (hardware_alarm_id >= 0) {
@@ -53,6 +82,10 @@ DMAADCSampler::~DMAADCSampler() {
         hardware_alarm_unclaim(hardware_alarm_id);
         hardware_alarm_id = -1;
     }
+
+    if (initialized) {
+        FlashSafeIRQ::allow(DMA_IRQ_0, false);
+    }
     
     instance = nullptr;
 }
@@ -89,34 +122,48 @@ bool DMAADCSampler::init() {
     hw_clear_bits(&adc_hw->cs, ADC_CS_START_MANY_BITS);
     hw_set_bits(&adc_hw->cs, ADC_CS_EN_BITS);
     
-    // Claim a DMA channel
-    dma_channel = dma_claim_unused_channel(true);
-    if (dma_channel < 0) {
-        printf("DMAADCSampler: Failed to claim DMA channel\n");
-        return false;
+    // Claim the two ring channels
+    for (uint32_t slot = 0; slot < 2; ++slot) {
+        dma_channels[slot] = dma_claim_unused_channel(true);
+        if (dma_channels[slot] < 0) {
+            printf("DMAADCSampler: Failed to claim DMA channel\n");
+            return false;
+        }
     }
     
-    // Configure DMA channel
-    dma_config = dma_channel_get_default_config(dma_channel);
-    channel_config_set_transfer_data_size(&dma_config, DMA_SIZE_16);  // 16-bit transfers
-    channel_config_set_read_increment(&dma_config, false);  // Always read from ADC FIFO
-    channel_config_set_write_increment(&dma_config, true);  // Increment write address
-    channel_config_set_dreq(&dma_config, DREQ_ADC);  // Pace transfers using ADC DREQ
-    
-    // Start with buffer A
-    dma_channel_configure(
-        dma_channel,
-        &dma_config,
-        buffer_a,           // Write to buffer A
-        &adc_hw->fifo,      // Read from ADC FIFO
-        BUFFER_SIZE,        // Transfer count
-        false               // Don't start yet
-    );
-    
+    // Configure DMA channels: each fills its own buffer, wraps back to its
+    // start (write ring) and hands over to the other channel
+    for (uint32_t slot = 0; slot < 2; ++slot) {
+        dma_channel_config config = dma_channel_get_default_config(dma_channels[slot]);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_16);  // 16-bit transfers
+        channel_config_set_read_increment(&config, false);  // Always read from ADC FIFO
+        channel_config_set_write_increment(&config, true);  // Increment write address
+        channel_config_set_dreq(&config, DREQ_ADC);  // Pace transfers using ADC DREQ
+        channel_config_set_chain_to(&config, dma_channels[slot ^ 1]);
+
+        // Capture strides are contiguous, so no ring
+        capture_config[slot] = config;
+        channel_config_set_ring(&config, true, RING_BITS);
+        ring_config[slot] = config;
+
+        dma_channel_configure(
+            dma_channels[slot],
+            &ring_config[slot],
+            slot_target[slot],  // Own buffer
+            &adc_hw->fifo,      // Read from ADC FIFO
+            BUFFER_SIZE,        // Transfer count (reloaded on every trigger)
+            false               // Don't start yet
+        );
+    }
+
     // Enable DMA interrupt on completion
-    dma_channel_set_irq0_enabled(dma_channel, true);
+    dma_channel_set_irq0_enabled(dma_channels[0], true);
+    dma_channel_set_irq0_enabled(dma_channels[1], true);
     irq_set_exclusive_handler(DMA_IRQ_0, dma_irq_handler);
     irq_set_enabled(DMA_IRQ_0, true);
+
+    // The handler runs from RAM, so it may stay live during flash operations
+    FlashSafeIRQ::allow(DMA_IRQ_0, true);
     
         if (hardware_alarm_id < 0) {
             hardware_alarm_id = hardware_alarm_claim_unused(false);
@@ -127,11 +174,53 @@ bool DMAADCSampler::init() {
     }
 
     initialized = true;
-    printf("DMAADCSampler: Initialized (DMA channel %d)\n", dma_channel);
+    printf("DMAADCSampler: Initialized (DMA channels %d <-> %d)\n", dma_channels[0], dma_channels[1]);
     
     return true;
 }
 
+bool DMAADCSampler::configure(uint32_t rate_hz, Pacing new_pacing) {
+    if (running) {
+        printf("DMAADCSampler: Stop before changing rate or pacing\n");
+        return false;
+    }
+    if (rate_hz < ADCConfig::MIN_SAMPLE_RATE_HZ || rate_hz > ADCConfig::MAX_SAMPLE_RATE_HZ) {
+        printf("DMAADCSampler: Sample rate %lu Hz out of range (%lu-%lu)\n",
+               static_cast<unsigned long>(rate_hz),
+               static_cast<unsigned long>(ADCConfig::MIN_SAMPLE_RATE_HZ),
+               static_cast<unsigned long>(ADCConfig::MAX_SAMPLE_RATE_HZ));
+        return false;
+    }
+
+    sample_rate_hz = rate_hz;
+    pacing = new_pacing;
+    period_us = (1000000 + rate_hz / 2) / rate_hz;
+
+    // One conversion every (1 + DIV) ADC clocks
+    uint64_t cycles_q8 = (static_cast<uint64_t>(ADCConfig::ADC_CLOCK_HZ) * 256 + rate_hz / 2) / rate_hz;
+    clkdiv_q8 = static_cast<uint32_t>(cycles_q8 - 256);
+
+    if (pacing == Pacing::ADC_CLKDIV) {
+        uint64_t buffer_q8_us = static_cast<uint64_t>(BUFFER_SIZE) * (clkdiv_q8 + 256) * 1000000;
+        uint64_t clock_q8 = static_cast<uint64_t>(ADCConfig::ADC_CLOCK_HZ) * 256;
+        buffer_period_us = static_cast<uint32_t>((buffer_q8_us + clock_q8 / 2) / clock_q8);
+    } else {
+        buffer_period_us = BUFFER_SIZE * period_us;
+    }
+    return true;
+}
+
+float DMAADCSampler::get_actual_sample_rate_hz() const {
+    if (pacing == Pacing::ADC_CLKDIV) {
+        return static_cast<float>(ADCConfig::ADC_CLOCK_HZ) * 256.0f / static_cast<float>(clkdiv_q8 + 256);
+    }
+    return 1000000.0f / static_cast<float>(period_us);
+}
+
+const char* DMAADCSampler::pacing_name(Pacing pacing) {
+    return (pacing == Pacing::ADC_CLKDIV) ? "ADC clock divider" : "timer alarm";
+}
+
 // ==================================================
 // Start/Stop
 // ==================================================
@@ -149,24 +238,44 @@ void DMAADCSampler::start() {
     // Reset state
     buffer_a_ready = false;
     buffer_b_ready = false;
-    using_buffer_a = true;
+    next_slot = 0;
+    buffer_a_data = buffer_a;
+    buffer_b_data = buffer_b;
+    capture_state = CAPTURE_IDLE;
     buffer_count = 0;
     overflow_count = 0;
+    sample_sequence = 0;
+    continuity_errors = 0;
+    missed_buffers = 0;
+    missed_triggers = 0;
     buffer_locked = false;
     dma_irq_count = 0;
     timer_trigger_count = 0;
+    irq_timed = false;
+    irq_reported = false;
+    
+    reset_pacing_stats();
     
     // Start DMA transfer first (ready to receive ADC data)
-    dma_channel_start(dma_channel);
+    adc_fifo_drain();
+    hw_set_bits(&adc_hw->fcs, ADC_FCS_OVER_BITS);  // Write 1 to clear
+    restart_ring();
     
+    if (pacing == Pacing::ADC_CLKDIV) {
+        // Free-running conversions, no per-sample interrupt
+        adc_set_clkdiv(static_cast<float>(clkdiv_q8) / 256.0f);
+        adc_run(true);
+    } else {
         // Configure hardware alarm for periodic sampling
         hardware_alarm_set_callback(hardware_alarm_id, hardware_alarm_callback);
-        absolute_time_t target = delayed_by_us(get_absolute_time(), ADCConfig::SAMPLE_PERIOD_US);
+        absolute_time_t target = delayed_by_us(get_absolute_time(), period_us);
         hardware_alarm_set_target(hardware_alarm_id, target);
 
         timer_running = true;
+    }
     running = true;
-    printf("DMAADCSampler: Started (5 kHz sampling)\n");
+    printf("DMAADCSampler: Started (%lu Hz, %s)\n",
+           static_cast<unsigned long>(sample_rate_hz), pacing_name(pacing));
 }
 
 void DMAADCSampler::stop() {
@@ -179,9 +288,11 @@ void DMAADCSampler::stop() {
             hardware_alarm_cancel(hardware_alarm_id);
             timer_running = false;
         }
+    adc_run(false);
     
-    // Disable DMA channel
-    dma_channel_abort(dma_channel);
+    // Disable DMA channels
+    halt_channels();
+    capture_state = CAPTURE_IDLE;
     
     running = false;
     printf("DMAADCSampler: Stopped\n");
@@ -205,6 +316,24 @@ void DMAADCSampler::hardware_alarm_callback(uint alarm_id) {
         printf("DMAADCSampler: Timer callback active\n");
     }
 
+    // Period between conversion starts, as actually achieved
+    uint32_t now_us = time_us_32();
+    if (instance->timer_trigger_count > 1) {
+        PacingStats& stats = instance->pacing_stats;
+        uint32_t interval_us = now_us - instance->last_trigger_us;
+
+        // The alarm re-arms from now, so a late callback loses the
+        // conversions it should have started in between
+        uint32_t periods = (interval_us + instance->period_us / 2) / instance->period_us;
+        if (periods > 1) {
+            instance->missed_triggers += periods - 1;
+        }
+        record_interval(interval_us, &stats.trigger_count, &stats.trigger_min_us,
+                        &stats.trigger_max_us, &stats.trigger_sum_us);
+        stats.trigger_sum_sq_us += static_cast<uint64_t>(interval_us) * interval_us;
+    }
+    instance->last_trigger_us = now_us;
+
     // Only trigger a conversion when ADC is ready
     if (adc_hw->cs & ADC_CS_READY_BITS) {
         // Pulse START_ONCE to initiate a single conversion
@@ -215,59 +344,156 @@ void DMAADCSampler::hardware_alarm_callback(uint alarm_id) {
     }
 
     // Schedule next alarm
-    absolute_time_t next_time = delayed_by_us(get_absolute_time(), ADCConfig::SAMPLE_PERIOD_US);
+    absolute_time_t next_time = delayed_by_us(get_absolute_time(), instance->period_us);
     hardware_alarm_set_target(alarm_id, next_time);
 }
 
 // ==================================================
 // DMA Interrupt Handler
+// Runs from RAM (__not_in_flash_func) so it keeps working while flash is
+// busy: everything reached from here must be RAM code or inline SDK
+// register access, with no printf, no 64-bit timer read and no division
+// (the divider helpers live in flash).
 // ==================================================
 
-void DMAADCSampler::dma_irq_handler() {
+void __not_in_flash_func(DMAADCSampler::dma_irq_handler)() {
     if (instance == nullptr) {
         return;
     }
-    
-    // Check if our channel triggered the interrupt
-    if (!dma_channel_get_irq0_status(instance->dma_channel)) {
-        return;
+
+    // Service completions in ring order; if the IRQ ran late both channels
+    // may be pending, the expected one finished first
+    uint32_t serviced = 0;
+    for (uint32_t i = 0; i < 2; ++i) {
+        uint32_t slot = instance->next_slot;
+        if (!dma_channel_get_irq0_status(instance->dma_channels[slot])) {
+            if (!dma_channel_get_irq0_status(instance->dma_channels[slot ^ 1])) {
+                break;
+            }
+            slot ^= 1;  // Out of order (e.g. after a restart); follow the hardware
+        }
+
+        // Clear interrupt
+        dma_channel_acknowledge_irq0(instance->dma_channels[slot]);
+        instance->next_slot = slot ^ 1;
+        instance->complete_slot(slot);
+        serviced++;
     }
-    
-    // Clear interrupt
-    dma_channel_acknowledge_irq0(instance->dma_channel);
-    
-    instance->dma_irq_count++;
-    if (instance->dma_irq_count == 1) {
-        printf("DMAADCSampler: DMA IRQ handler active\n");
+    if (serviced > 0 && instance->pacing == Pacing::ADC_CLKDIV) {
+        instance->count_missed_buffers(serviced);
+    }
+}
+
+// A channel that completes twice before the IRQ runs raises one pending
+// flag, so compare the buffer periods elapsed since the last IRQ with the
+// completions serviced. Exact while IRQ latency jitter stays under half a
+// buffer period. Timer pacing is excluded: skipped triggers stretch its
+// buffers and are counted in the alarm callback instead.
+void __not_in_flash_func(DMAADCSampler::count_missed_buffers)(uint32_t serviced) {
+    uint32_t now_us = time_us_32();
+    if (irq_timed) {
+        uint32_t remainder = now_us - last_irq_us + buffer_period_us / 2;
+        uint32_t periods = 0;
+        while (remainder >= buffer_period_us) {  // Usually 1-2 iterations
+            remainder -= buffer_period_us;
+            periods++;
+        }
+        if (periods > serviced) {
+            missed_buffers += periods - serviced;
+        }
     }
+    last_irq_us = now_us;
+    irq_timed = true;
+}
+
+void __not_in_flash_func(DMAADCSampler::complete_slot)(uint32_t slot) {
+    dma_irq_count++;
 
     // Buffer just completed
-    instance->buffer_count++;
+    buffer_count++;
+    sample_sequence += BUFFER_SIZE;
+
+    uint32_t now_us = time_us_32();
+    if (buffer_timed) {
+        record_interval(now_us - last_buffer_us, &pacing_stats.buffer_count,
+                        &pacing_stats.buffer_min_us, &pacing_stats.buffer_max_us,
+                        &pacing_stats.buffer_span_us);
+    }
+    last_buffer_us = now_us;
+    buffer_timed = true;
+
+    // A dropped conversion since the last boundary breaks continuity
+    if (adc_hw->fcs & ADC_FCS_OVER_BITS) {
+        continuity_errors++;
+        hw_set_bits(&adc_hw->fcs, ADC_FCS_OVER_BITS);  // Write 1 to clear
+    }
     
     // Mark the buffer that just filled as ready
-    if (instance->using_buffer_a) {
-        // Buffer A is now full
-        if (instance->buffer_a_ready) {
-            // Buffer A wasn't processed before next fill - overflow!
-            instance->overflow_count++;
+    const uint16_t* filled = slot_target[slot];
+    if (slot == 0) {
+        if (buffer_a_ready) {
+            // Slot A wasn't processed before next fill - overflow!
+            overflow_count++;
         }
-        instance->buffer_a_ready = true;
-        
-        // Switch to buffer B for next transfer
-        instance->using_buffer_a = false;
-        dma_channel_set_write_addr(instance->dma_channel, instance->buffer_b, true);
+        buffer_a_data = filled;
+        buffer_a_ready = true;
     } else {
-        // Buffer B is now full
-        if (instance->buffer_b_ready) {
-            // Buffer B wasn't processed before next fill - overflow!
-            instance->overflow_count++;
+        if (buffer_b_ready) {
+            // Slot B wasn't processed before next fill - overflow!
+            overflow_count++;
+        }
+        buffer_b_data = filled;
+        buffer_b_ready = true;
+    }
+
+    if (capture_state == CAPTURE_RUNNING && filled != buffer_a && filled != buffer_b) {
+        capture_completed++;
+        if (capture_completed == capture_strides) {
+            capture_state = CAPTURE_IDLE;
         }
-        instance->buffer_b_ready = true;
-        
-        // Switch to buffer A for next transfer
-        instance->using_buffer_a = true;
-        dma_channel_set_write_addr(instance->dma_channel, instance->buffer_a, true);
     }
+
+    prepare_slot(slot);
+}
+
+void __not_in_flash_func(DMAADCSampler::prepare_slot)(uint32_t slot) {
+    // The channel is idle until the other one finishes and chains to it
+    uint32_t channel = dma_channels[slot];
+    if (capture_state != CAPTURE_IDLE && capture_assigned < capture_strides) {
+        capture_state = CAPTURE_RUNNING;
+        slot_target[slot] = capture_dest + capture_assigned * BUFFER_SIZE;
+        capture_assigned++;
+        dma_channel_set_config(channel, &capture_config[slot], false);
+    } else {
+        slot_target[slot] = (slot == 0) ? buffer_a : buffer_b;
+        dma_channel_set_config(channel, &ring_config[slot], false);
+    }
+    // A no-op for the ring (already wrapped); moves a capture stride
+    dma_channel_set_write_addr(channel, slot_target[slot], false);
+}
+
+void DMAADCSampler::halt_channels() {
+    // Break the chains first so aborting one channel cannot start the other
+    for (uint32_t slot = 0; slot < 2; ++slot) {
+        dma_channel_config config = ring_config[slot];
+        channel_config_set_chain_to(&config, dma_channels[slot]);
+        dma_channel_set_config(dma_channels[slot], &config, false);
+    }
+    dma_channel_abort(dma_channels[0]);
+    dma_channel_abort(dma_channels[1]);
+    dma_channel_acknowledge_irq0(dma_channels[0]);
+    dma_channel_acknowledge_irq0(dma_channels[1]);
+}
+
+void DMAADCSampler::restart_ring() {
+    halt_channels();
+    for (uint32_t slot = 0; slot < 2; ++slot) {
+        slot_target[slot] = (slot == 0) ? buffer_a : buffer_b;
+        dma_channel_set_config(dma_channels[slot], &ring_config[slot], false);
+        dma_channel_set_trans_count(dma_channels[slot], BUFFER_SIZE, false);
+        dma_channel_set_write_addr(dma_channels[slot], slot_target[slot], false);
+    }
+    dma_channel_start(dma_channels[next_slot]);
 }
 
 // ==================================================
@@ -279,12 +505,18 @@ bool DMAADCSampler::is_buffer_ready() {
 }
 
 const uint16_t* DMAADCSampler::get_ready_buffer(uint32_t* size) {
+    // Reported here because the IRQ handler must not call printf
+    if (!irq_reported && dma_irq_count > 0) {
+        irq_reported = true;
+        printf("DMAADCSampler: DMA IRQ handler active\n");
+    }
+
     // Return buffer A if ready and not locked
     if (buffer_a_ready && !buffer_locked) {
         buffer_locked = true;
         locked_buffer_is_a = true;
         if (size) *size = BUFFER_SIZE;
-        return buffer_a;
+        return buffer_a_data;
     }
     
     // Return buffer B if ready and not locked
@@ -292,7 +524,7 @@ const uint16_t* DMAADCSampler::get_ready_buffer(uint32_t* size) {
         buffer_locked = true;
         locked_buffer_is_a = false;
         if (size) *size = BUFFER_SIZE;
-        return buffer_b;
+        return buffer_b_data;
     }
     
     // No buffer ready
@@ -321,16 +553,129 @@ void DMAADCSampler::release_buffer() {
     restore_interrupts(irq_status);
 }
 
+// ==================================================
+// Zero-copy Capture
+// ==================================================
+
+bool DMAADCSampler::start_capture(uint16_t* dest, uint32_t samples) {
+    if (!running || dest == nullptr || samples == 0 || samples % BUFFER_SIZE != 0) {
+        printf("DMAADCSampler: Invalid capture request\n");
+        return false;
+    }
+
+    uint32_t irq_status = save_and_disable_interrupts();
+    if (capture_state != CAPTURE_IDLE) {
+        restore_interrupts(irq_status);
+        printf("DMAADCSampler: Capture already active\n");
+        return false;
+    }
+    capture_dest = dest;
+    capture_strides = samples / BUFFER_SIZE;
+    capture_assigned = 0;
+    capture_completed = 0;
+    capture_state = CAPTURE_PENDING;
+    restore_interrupts(irq_status);
+    return true;
+}
+
+void DMAADCSampler::cancel_capture() {
+    uint32_t irq_status = save_and_disable_interrupts();
+    if (capture_state == CAPTURE_RUNNING) {
+        // Drop the partial stride and restart the ring on the current slot
+        restart_ring();
+    }
+    capture_state = CAPTURE_IDLE;
+    restore_interrupts(irq_status);
+}
+
+// ==================================================
+// Pacing Measurement
+// ==================================================
+
+void __not_in_flash_func(DMAADCSampler::record_interval)(uint32_t interval_us, uint32_t* count, uint32_t* min_us,
+                                    uint32_t* max_us, uint64_t* sum_us) {
+    if (*count == 0 || interval_us < *min_us) *min_us = interval_us;
+    if (interval_us > *max_us) *max_us = interval_us;
+    *sum_us += interval_us;
+    (*count)++;
+}
+
+DMAADCSampler::PacingStats DMAADCSampler::get_pacing_stats() const {
+    uint32_t irq_status = save_and_disable_interrupts();
+    PacingStats stats = pacing_stats;
+    restore_interrupts(irq_status);
+    return stats;
+}
+
+void DMAADCSampler::reset_pacing_stats() {
+    uint32_t irq_status = save_and_disable_interrupts();
+    memset(&pacing_stats, 0, sizeof(pacing_stats));
+    last_buffer_us = 0;
+    buffer_timed = false;
+    restore_interrupts(irq_status);
+}
+
+void DMAADCSampler::print_pacing_report() const {
+    PacingStats stats = get_pacing_stats();
+    float ideal_us = 1000000.0f / static_cast<float>(sample_rate_hz);
+
+    printf("Pacing: %s, %lu Hz requested, %.2f Hz actual\n",
+           pacing_name(pacing), static_cast<unsigned long>(sample_rate_hz),
+           static_cast<double>(get_actual_sample_rate_hz()));
+
+    if (pacing == Pacing::ADC_CLKDIV) {
+        printf("  Sample period: hardware-paced, DIV %lu.%02lu (no per-sample interrupt)\n",
+               static_cast<unsigned long>(clkdiv_q8 >> 8),
+               static_cast<unsigned long>((clkdiv_q8 & 0xFF) * 100 / 256));
+    } else if (stats.trigger_count > 0) {
+        float mean = static_cast<float>(stats.trigger_sum_us) / stats.trigger_count;
+        float variance = static_cast<float>(stats.trigger_sum_sq_us) / stats.trigger_count - mean * mean;
+        printf("  Sample period: n=%lu min %lu us, avg %.2f us, max %lu us, jitter %.2f us rms (ideal %.1f us)\n",
+               static_cast<unsigned long>(stats.trigger_count),
+               static_cast<unsigned long>(stats.trigger_min_us),
+               static_cast<double>(mean),
+               static_cast<unsigned long>(stats.trigger_max_us),
+               static_cast<double>(sqrtf(variance > 0.0f ? variance : 0.0f)),
+               static_cast<double>(ideal_us));
+    }
+
+    printf("  Dropped: %lu samples (%lu overflowed + %lu missed buffers, %lu missed triggers, %lu FIFO overruns)\n",
+           static_cast<unsigned long>(get_dropped_sample_count()),
+           static_cast<unsigned long>(overflow_count),
+           static_cast<unsigned long>(missed_buffers),
+           static_cast<unsigned long>(missed_triggers),
+           static_cast<unsigned long>(continuity_errors));
+
+    if (stats.buffer_count == 0) {
+        printf("  Buffer period: no complete intervals yet\n");
+        return;
+    }
+    float buffer_avg = static_cast<float>(stats.buffer_span_us) / stats.buffer_count;
+    float effective_hz = BUFFER_SIZE * 1000000.0f / buffer_avg;
+    printf("  Buffer period: n=%lu min %lu us, avg %.1f us, max %lu us (ideal %.1f us)\n",
+           static_cast<unsigned long>(stats.buffer_count),
+           static_cast<unsigned long>(stats.buffer_min_us),
+           static_cast<double>(buffer_avg),
+           static_cast<unsigned long>(stats.buffer_max_us),
+           static_cast<double>(ideal_us * BUFFER_SIZE));
+    printf("  Effective rate: %.2f Hz (%+.0f ppm vs requested)\n",
+           static_cast<double>(effective_hz),
+           static_cast<double>((effective_hz / sample_rate_hz - 1.0f) * 1e6f));
+}
+
 bool DMAADCSampler::is_dma_busy() const {
-    if (dma_channel < 0) {
+    // The channel expected to complete next is the one transferring
+    int channel = dma_channels[next_slot];
+    if (channel < 0) {
         return false;
     }
-    return dma_channel_is_busy(dma_channel);
+    return dma_channel_is_busy(channel);
 }
 
 uint32_t DMAADCSampler::get_dma_transfer_remaining() const {
-    if (dma_channel < 0) {
+    int channel = dma_channels[next_slot];
+    if (channel < 0) {
         return 0;
     }
-    return dma_hw->ch[dma_channel].transfer_count;
+    return dma_hw->ch[channel].transfer_count;
 }
@@ -13,15 +13,82 @@
 // ==================================================
 // DMA ADC Sampler Class
 // Implements 5 kHz sampling with double-buffering
+//
+// Two DMA channels form a gapless ring: channel A fills buffer_a and
+// chains to channel B, which fills buffer_b and chains back to A. Each
+// buffer is aligned to its size and the channels use a write address
+// ring, so a finished channel already points at the start of its buffer
+// again; the hand-over happens in hardware and nothing has to be
+// reprogrammed before the next sample arrives. The completion IRQ only
+// publishes the buffer and, for captures, prepares the now idle channel,
+// which has a whole buffer period to do so.
+//
+// Capture mode (zero-copy): start_capture() hands over a caller-owned
+// buffer. From the next buffer boundary the channels take turns writing
+// BUFFER_SIZE strides of it, and get_ready_buffer() returns pointers into
+// the capture buffer. After the last stride they return to the ring.
+//
+// Continuity: every completed buffer advances a sample sequence number,
+// and the ADC FIFO overflow flag is checked at each boundary; a set flag
+// means a conversion was dropped and is counted as a continuity error.
+// get_dropped_sample_count() totals every way a sample can be lost:
+// buffers overwritten before Core 1 released them, completions the IRQ
+// never saw (ADC mode: more buffer periods elapsed than completions
+// serviced), missed timer triggers and FIFO overruns.
+//
+// Flash: the DMA completion path runs from RAM and DMA_IRQ_0 is
+// registered with FlashSafeIRQ, so with ADC_CLKDIV pacing sampling and
+// buffer hand-over continue while flash is being erased or programmed.
+// The timer alarm goes through SDK code in flash and is masked then, so
+// TIMER pacing misses the conversions that fall inside a flash operation.
+//
+// Pacing: ADC_CLKDIV lets the ADC free-run (START_MANY) with its clock
+// divider set to the sample period, so conversions are exact and need no
+// CPU. TIMER is the original scheme: a hardware alarm pulses START_ONCE
+// and re-arms relative to the callback time, so callback latency shows up
+// as period jitter and drift. PacingStats measures both for comparison.
 // ==================================================
 
 class DMAADCSampler {
 public:
+    enum class Pacing : uint8_t {
+        TIMER,       // Hardware alarm callback pulses START_ONCE every period
+        ADC_CLKDIV   // ADC free-runs (START_MANY), paced by its clock divider
+    };
+
+    // Timing measured since start() or reset_pacing_stats()
+    struct PacingStats {
+        uint32_t trigger_count;      // Timer mode: START_ONCE intervals measured
+        uint32_t trigger_min_us;
+        uint32_t trigger_max_us;
+        uint64_t trigger_sum_us;
+        uint64_t trigger_sum_sq_us;  // For the standard deviation (jitter)
+        uint32_t buffer_count;       // Buffer completion intervals measured
+        uint32_t buffer_min_us;
+        uint32_t buffer_max_us;
+        uint64_t buffer_span_us;     // First to last measured completion
+    };
+
     DMAADCSampler();
     ~DMAADCSampler();
     
-    // Initialize DMA, ADC, and timer for 5 kHz sampling
+    // Initialize DMA, ADC, and timer for the configured rate (5 kHz default)
     bool init();
+
+    // Choose sample rate and pacing; only while stopped.
+    // Returns false if the rate is outside MIN/MAX_SAMPLE_RATE_HZ
+    bool configure(uint32_t sample_rate_hz, Pacing pacing);
+    uint32_t get_sample_rate_hz() const { return sample_rate_hz; }
+    Pacing get_pacing() const { return pacing; }
+
+    // Rate after quantisation to whole microseconds (timer) or the 16.8
+    // divider (ADC clock)
+    float get_actual_sample_rate_hz() const;
+
+    PacingStats get_pacing_stats() const;
+    void reset_pacing_stats();
+    void print_pacing_report() const;
+    static const char* pacing_name(Pacing pacing);
     
     // Start DMA sampling
     void start();
@@ -38,12 +105,32 @@ public:
     
     // Mark current buffer as processed (enables next swap)
     void release_buffer();
+
+    // Stream the next `samples` samples straight into dest, starting at the
+    // next buffer boundary. samples must be a multiple of BUFFER_SIZE.
+    // dest must stay valid until is_capturing() returns false.
+    bool start_capture(uint16_t* dest, uint32_t samples);
+
+    // Abandon an armed or running capture and return to the ring
+    void cancel_capture();
+
+    bool is_capturing() const { return capture_state != CAPTURE_IDLE; }
     
     // Get statistics
     uint32_t get_buffer_count() const { return buffer_count; }
     uint32_t get_overflow_count() const { return overflow_count; }
     uint32_t get_irq_count() const { return dma_irq_count; }
     uint32_t get_timer_trigger_count() const { return timer_trigger_count; }
+    uint32_t get_samples_delivered() const { return sample_sequence; }
+    uint32_t get_continuity_error_count() const { return continuity_errors; }
+    uint32_t get_missed_buffer_count() const { return missed_buffers; }
+    uint32_t get_missed_trigger_count() const { return missed_triggers; }
+
+    // Samples lost since start(): overflowed and missed buffers, missed
+    // triggers and FIFO overruns (each overrun counts as one sample, its minimum)
+    uint32_t get_dropped_sample_count() const {
+        return (overflow_count + missed_buffers) * BUFFER_SIZE + missed_triggers + continuity_errors;
+    }
     bool is_dma_busy() const;
     uint32_t get_dma_transfer_remaining() const;
     
@@ -54,27 +141,83 @@ private:
     
     // Instance pointer for interrupt handler
     static DMAADCSampler* instance;
+
+    // Publish the buffer a channel just finished, then point the channel
+    // at its next destination (IRQ context; the other channel is running)
+    void complete_slot(uint32_t slot);
+    void prepare_slot(uint32_t slot);
+
+    // ADC mode: count completions lost while the IRQ was held off
+    void count_missed_buffers(uint32_t serviced);
+
+    // Record one interval into min/max/sum (IRQ context)
+    static void record_interval(uint32_t interval_us, uint32_t* count, uint32_t* min_us,
+                                uint32_t* max_us, uint64_t* sum_us);
+
+    // Abort both channels; restart the ring on the expected slot
+    void halt_channels();
+    void restart_ring();
     
-    // Double buffers (ping-pong)
+    // Double buffers (ping-pong), aligned for the DMA write ring
     static constexpr uint32_t BUFFER_SIZE = ADCConfig::BUFFER_SIZE;
-    uint16_t buffer_a[BUFFER_SIZE];
-    uint16_t buffer_b[BUFFER_SIZE];
+    static constexpr uint32_t RING_BITS = 10;
+    static_assert((1u << RING_BITS) == BUFFER_SIZE * sizeof(uint16_t),
+                  "DMA write ring must span exactly one buffer");
+    alignas(1u << RING_BITS) uint16_t buffer_a[BUFFER_SIZE];
+    alignas(1u << RING_BITS) uint16_t buffer_b[BUFFER_SIZE];
     
-    // DMA configuration
-    int dma_channel;
-    dma_channel_config dma_config;
+    // DMA configuration (index 0 = channel A / slot A, 1 = channel B / slot B)
+    int dma_channels[2];
+    dma_channel_config ring_config[2];     // Own buffer, write ring, chain to the other
+    dma_channel_config capture_config[2];  // Capture stride, no ring, chain to the other
+
+    // Capture state
+    enum CaptureState : uint8_t {
+        CAPTURE_IDLE = 0,
+        CAPTURE_PENDING,   // Armed, first stride not yet assigned
+        CAPTURE_RUNNING    // Strides assigned to the channels
+    };
+    volatile CaptureState capture_state;
+    uint16_t* capture_dest;
+    uint32_t capture_strides;          // Total strides in the capture
+    uint32_t capture_assigned;         // Strides handed to a channel so far
+    uint32_t capture_completed;        // Strides finished so far
     
     // Buffer management
     volatile bool buffer_a_ready;  // true when buffer A is full and ready to process
     volatile bool buffer_b_ready;  // true when buffer B is full and ready to process
-    volatile bool using_buffer_a;  // true when DMA is writing to buffer A
+    volatile uint32_t next_slot;   // Channel expected to complete next
+    uint16_t* slot_target[2];      // Where each channel writes on its next/current run
+    const uint16_t* volatile buffer_a_data;  // Contents of slot A (buffer_a or a capture stride)
+    const uint16_t* volatile buffer_b_data;  // Contents of slot B (buffer_b or a capture stride)
     volatile uint32_t buffer_count;  // Number of buffers filled
     volatile uint32_t overflow_count;  // Number of buffer overflows (data loss)
+    volatile uint32_t sample_sequence;  // Samples delivered by DMA (buffer boundaries)
+    volatile uint32_t continuity_errors;  // Boundaries with an ADC FIFO overflow
+    volatile uint32_t missed_buffers;     // Completions overwritten before the IRQ saw them
+    volatile uint32_t missed_triggers;    // Timer mode: conversion slots the alarm skipped
     
     // Processing state
     volatile bool buffer_locked;  // true when application is processing a buffer
     volatile bool locked_buffer_is_a;  // true if buffer A is locked, false if buffer B
     
+    // Pacing
+    uint32_t sample_rate_hz;
+    Pacing pacing;
+    uint32_t period_us;     // Timer mode alarm period
+    uint32_t clkdiv_q8;     // ADC mode divider (INT.FRAC, 16.8 fixed point)
+    uint32_t buffer_period_us;  // Time to fill one buffer at the actual rate
+
+    // Timing measurement (written from the alarm and DMA IRQs; 32-bit
+    // timestamps because time_us_32() is the only inline timer read)
+    PacingStats pacing_stats;
+    uint32_t last_trigger_us;
+    uint32_t last_buffer_us;
+    bool buffer_timed;      // last_buffer_us holds a completion
+    uint32_t last_irq_us;   // Last DMA IRQ that serviced a completion
+    bool irq_timed;
+    bool irq_reported;      // "DMA IRQ handler active" printed (outside the IRQ)
+
     // Timer for ADC triggering
     bool timer_running;
     int hardware_alarm_id;
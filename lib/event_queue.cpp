@@ -0,0 +1,51 @@
+#include "event_queue.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+EventQueue::EventQueue() : posted(0), dropped(0) {
+}
+
+const char* EventQueue::type_name(CoreEvent::Type type) {
+    switch (type) {
+        case CoreEvent::Type::SHOT:         return "shot";
+        case CoreEvent::Type::SHOTS_DOWN:   return "shots down";
+        case CoreEvent::Type::CAPTURE_DONE: return "capture";
+        case CoreEvent::Type::LOW_BATTERY:  return "low battery";
+        case CoreEvent::Type::BATTERY_OK:   return "battery ok";
+    }
+    return "?";
+}
+
+// ==================================================
+// Core 1 Side
+// ==================================================
+
+bool EventQueue::post(CoreEvent::Type type, uint32_t value) {
+    CoreEvent event = {type, value, time_us_32()};
+    if (!ring.push(event)) {
+        dropped++;
+        return false;
+    }
+    posted++;
+
+    // Doorbell: the word raises Core 0's FIFO IRQ, which wakes its WFE.
+    // A full FIFO already has one pending; the SEV covers it either way
+    if (multicore_fifo_wready()) {
+        multicore_fifo_push_blocking(EventConfig::DOORBELL);
+    }
+    __sev();
+    return true;
+}
+
+// ==================================================
+// Core 0 Side
+// ==================================================
+
+void EventQueue::wait() {
+    // A post between the check and WFE leaves the event register set,
+    // so WFE returns at once
+    if (ring.empty()) {
+        __wfe();
+    }
+}
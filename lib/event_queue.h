@@ -0,0 +1,66 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <stdint.h>
+#include "adc_config.h"
+#include "spsc_ring.h"
+
+// ==================================================
+// Core Events
+// Discrete things Core 1 sees that the display must not miss between
+// frames. Polled snapshots (TripleBuffer) only carry the latest state.
+// ==================================================
+
+struct CoreEvent {
+    enum class Type : uint8_t {
+        SHOT,          // value: shot count
+        SHOTS_DOWN,    // value: lower shot count (load step taken back, SHOTS RESET)
+        CAPTURE_DONE,  // value: capture id
+        LOW_BATTERY,   // value: battery mV
+        BATTERY_OK     // value: battery mV
+    };
+
+    Type type;
+    uint32_t value;
+    uint32_t time_us;  // time_us_32() when posted
+};
+
+// ==================================================
+// EventQueue Class
+// Core 1 -> Core 0 events: an SpscRing in SRAM holds them, the SIO FIFO
+// only rings a doorbell. Each post pushes a DOORBELL word, which raises
+// Core 0's FIFO IRQ and wakes it from WFE within microseconds. That IRQ
+// belongs to the multicore lockout handler, which discards any word but
+// its own, so the ring is the only record; Core 0 never pops the FIFO
+// itself (it could take a lockout word). A full ring drops the event and
+// counts it.
+// ==================================================
+
+class EventQueue {
+public:
+    EventQueue();
+
+    // Core 1: queue an event and wake Core 0. Returns false if the ring
+    // was full
+    bool post(CoreEvent::Type type, uint32_t value);
+
+    // Core 0: next event in order. Returns false if none
+    bool poll(CoreEvent* event) { return ring.pop(event); }
+
+    // Core 0: sleep until an event, an interrupt or a SEV. Returns at once
+    // if one is queued
+    void wait();
+
+    bool pending() const { return !ring.empty(); }
+    uint32_t get_posted() const { return posted; }
+    uint32_t get_dropped() const { return dropped; }
+
+    static const char* type_name(CoreEvent::Type type);
+
+private:
+    SpscRing<CoreEvent, EventConfig::RING_SIZE> ring;
+    volatile uint32_t posted;   // Core 1 only; read for statistics
+    volatile uint32_t dropped;
+};
+
+#endif // EVENT_QUEUE_H
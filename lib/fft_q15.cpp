@@ -0,0 +1,226 @@
+#include "fft_q15.h"
+#include "filter_design.h"
+
+namespace {
+
+constexpr uint32_t SIZE = FftQ15::SIZE;
+constexpr uint32_t HALF = SIZE / 2;  // Complex points
+
+constexpr uint32_t log2_of(uint32_t n) {
+    uint32_t bits = 0;
+    while ((1u << bits) < n) bits++;
+    return bits;
+}
+
+constexpr uint32_t LOG2_SIZE = log2_of(SIZE);
+static_assert((1u << LOG2_SIZE) == SIZE && (LOG2_SIZE & 1) == 1 && SIZE >= 8,
+              "FFT_SIZE must be 2 * 4^k (the complex half is radix-4)");
+
+// cos(2 pi k / SIZE), Q15 (1.0 saturates to 32767)
+struct CosineTable {
+    int16_t values[SIZE];
+};
+
+constexpr CosineTable make_cosine_table() {
+    CosineTable table{};
+    for (uint32_t k = 0; k < SIZE; ++k) {
+        int32_t q = FilterDesign::to_q(FilterDesign::cosine(2.0 * FilterDesign::PI * k / SIZE), 15);
+        table.values[k] = static_cast<int16_t>(q > 32767 ? 32767 : q);
+    }
+    return table;
+}
+
+constexpr CosineTable COSINE = make_cosine_table();
+
+// W^k = exp(-2 pi i k / SIZE) = cos - i sin; sin(x) = cos(x - pi/2)
+inline int32_t twiddle_re(uint32_t k) {
+    return COSINE.values[k % SIZE];
+}
+
+inline int32_t twiddle_im(uint32_t k) {
+    return -COSINE.values[(k + 3 * SIZE / 4) % SIZE];
+}
+
+// Butterfly inputs stay below this, so sums of four are below 2^15 and
+// every Q15 product fits 32 bits
+constexpr int32_t STAGE_LIMIT = 1 << 13;
+
+int32_t s_re[HALF];
+int32_t s_im[HALF];
+
+int32_t block_max() {
+    int32_t max = 0;
+    for (uint32_t i = 0; i < HALF; ++i) {
+        int32_t r = s_re[i] < 0 ? -s_re[i] : s_re[i];
+        int32_t m = s_im[i] < 0 ? -s_im[i] : s_im[i];
+        if (r > max) max = r;
+        if (m > max) max = m;
+    }
+    return max;
+}
+
+// Shift the block down below STAGE_LIMIT; returns the shift
+int32_t normalize() {
+    int32_t max = block_max();
+    int32_t shift = 0;
+    while ((max >> shift) >= STAGE_LIMIT) shift++;
+    if (shift > 0) {
+        for (uint32_t i = 0; i < HALF; ++i) {
+            s_re[i] >>= shift;
+            s_im[i] >>= shift;
+        }
+    }
+    return shift;
+}
+
+inline void rotate(int32_t& re, int32_t& im, uint32_t k) {
+    int32_t wr = twiddle_re(k);
+    int32_t wi = twiddle_im(k);
+    int32_t r = (re * wr - im * wi) >> 15;
+    im = (re * wi + im * wr) >> 15;
+    re = r;
+}
+
+// Radix-4 DIF over the HALF complex points; output in base-4
+// digit-reversed order. Returns the total normalisation shift
+int32_t radix4() {
+    int32_t shift = 0;
+    for (uint32_t span = HALF; span >= 4; span /= 4) {
+        shift += normalize();
+        uint32_t quarter = span / 4;
+        uint32_t stride = SIZE / span;  // W_span^j = W_SIZE^(j * stride)
+        for (uint32_t base = 0; base < HALF; base += span) {
+            for (uint32_t j = 0; j < quarter; ++j) {
+                uint32_t i0 = base + j;
+                uint32_t i1 = i0 + quarter;
+                uint32_t i2 = i1 + quarter;
+                uint32_t i3 = i2 + quarter;
+
+                int32_t t0r = s_re[i0] + s_re[i2], t0i = s_im[i0] + s_im[i2];
+                int32_t t1r = s_re[i0] - s_re[i2], t1i = s_im[i0] - s_im[i2];
+                int32_t t2r = s_re[i1] + s_re[i3], t2i = s_im[i1] + s_im[i3];
+                // -i * (b - d)
+                int32_t t3r = s_im[i1] - s_im[i3], t3i = s_re[i3] - s_re[i1];
+
+                s_re[i0] = t0r + t2r;
+                s_im[i0] = t0i + t2i;
+
+                int32_t y1r = t1r + t3r, y1i = t1i + t3i;
+                int32_t y2r = t0r - t2r, y2i = t0i - t2i;
+                int32_t y3r = t1r - t3r, y3i = t1i - t3i;
+                if (j != 0) {
+                    uint32_t k = j * stride;
+                    rotate(y1r, y1i, k);
+                    rotate(y2r, y2i, 2 * k);
+                    rotate(y3r, y3i, 3 * k);
+                }
+                s_re[i1] = y1r;
+                s_im[i1] = y1i;
+                s_re[i2] = y2r;
+                s_im[i2] = y2i;
+                s_re[i3] = y3r;
+                s_im[i3] = y3i;
+            }
+        }
+    }
+    return shift;
+}
+
+uint32_t digit_reverse(uint32_t index) {
+    uint32_t reversed = 0;
+    for (uint32_t n = HALF; n > 1; n /= 4) {
+        reversed = (reversed << 2) | (index & 3);
+        index >>= 2;
+    }
+    return reversed;
+}
+
+void reorder() {
+    for (uint32_t i = 0; i < HALF; ++i) {
+        uint32_t r = digit_reverse(i);
+        if (r > i) {
+            int32_t t = s_re[i]; s_re[i] = s_re[r]; s_re[r] = t;
+            t = s_im[i]; s_im[i] = s_im[r]; s_im[r] = t;
+        }
+    }
+}
+
+uint32_t isqrt(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+} // namespace
+
+void FftQ15::amplitude_spectrum(const uint16_t* samples, uint32_t* amplitude_q8) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < SIZE; ++i) {
+        sum += samples[i];
+    }
+    int32_t mean = static_cast<int32_t>((sum + SIZE / 2) / SIZE);
+
+    // Hann window (32768 - cos) / 2, packed even/odd as re/im, with 12
+    // fraction bits kept (x * w * 2^12)
+    for (uint32_t n = 0; n < HALF; ++n) {
+        int32_t even = static_cast<int32_t>(samples[2 * n]) - mean;
+        int32_t odd = static_cast<int32_t>(samples[2 * n + 1]) - mean;
+        s_re[n] = (even * (32768 - COSINE.values[2 * n])) >> 4;
+        s_im[n] = (odd * (32768 - COSINE.values[2 * n + 1])) >> 4;
+    }
+    int32_t exponent = -12;
+
+    // Into the working range: down for large signals, up for small ones
+    int32_t max = block_max();
+    if (max == 0) {
+        for (uint32_t k = 0; k < BINS; ++k) amplitude_q8[k] = 0;
+        return;
+    }
+    if (max >= STAGE_LIMIT) {
+        exponent += normalize();
+    } else {
+        int32_t up = 0;
+        while ((max << (up + 1)) < STAGE_LIMIT) up++;
+        for (uint32_t i = 0; i < HALF; ++i) {
+            s_re[i] *= (1 << up);
+            s_im[i] *= (1 << up);
+        }
+        exponent -= up;
+    }
+
+    exponent += radix4();
+    reorder();
+    exponent += normalize();
+
+    // Split: X[k] = E[k] + W^k O[k], with E = (Z[k] + conj Z[-k]) / 2 and
+    // O = (Z[k] - conj Z[-k]) / 2i. A Hann-windowed tone of amplitude A
+    // gives |X| = A * SIZE / 4, so A (Q8) = |X| * 2^(exponent + 10 - log2 SIZE)
+    int32_t out_shift = exponent + 10 - static_cast<int32_t>(LOG2_SIZE);
+    for (uint32_t k = 0; k < BINS; ++k) {
+        uint32_t a = k % HALF;
+        uint32_t b = (HALF - k) % HALF;
+        int32_t er = (s_re[a] + s_re[b]) / 2;
+        int32_t ei = (s_im[a] - s_im[b]) / 2;
+        int32_t orr = (s_im[a] + s_im[b]) / 2;
+        int32_t oi = (s_re[b] - s_re[a]) / 2;
+        rotate(orr, oi, k);
+        int32_t xr = er + orr;
+        int32_t xi = ei + oi;
+
+        uint32_t magnitude = isqrt(static_cast<uint32_t>(xr * xr) + static_cast<uint32_t>(xi * xi));
+        if (k == 0 || k == HALF) {
+            magnitude /= 2;  // No negative-frequency twin
+        }
+        amplitude_q8[k] = (out_shift >= 0) ? (magnitude << out_shift) : (magnitude >> -out_shift);
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef FFT_Q15_H
+#define FFT_Q15_H
+
+#include <stdint.h>
+#include "adc_config.h"
+
+// ==================================================
+// Fixed-point real FFT for the spectrum analyzer
+//
+// SIZE real samples (Hann window, mean removed) are packed as SIZE/2
+// complex points and transformed by a radix-4 decimation-in-frequency
+// FFT with Q15 twiddles, then split into the SIZE/2 + 1 bins of the real
+// spectrum. Data is int32 with block floating point: before every stage
+// the block is shifted down just enough that no butterfly can overflow
+// the 32-bit products, and the shifts are folded into the result.
+// Integer only; the window and twiddles are one compile-time cosine
+// table (lib/filter_design.h).
+//
+// Not reentrant: the work buffers are static (one caller, Core 0).
+// ==================================================
+
+namespace FftQ15 {
+    constexpr uint32_t SIZE = SpectrumConfig::FFT_SIZE;
+    constexpr uint32_t BINS = SIZE / 2 + 1;
+
+    // Amplitude spectrum of SIZE samples (ADC counts): bin k is the
+    // amplitude of a sinusoid at k * rate / SIZE, Q8 ADC counts (a tone
+    // of 10 counts peak reads 2560 in its bin, spread over the
+    // neighbours by the window)
+    void amplitude_spectrum(const uint16_t* samples, uint32_t* amplitude_q8);
+}
+
+#endif // FFT_Q15_H
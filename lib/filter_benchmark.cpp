@@ -0,0 +1,180 @@
+#include "filter_benchmark.h"
+#include <stdio.h>
+#include "adc_config.h"
+#include "voltage_filter.h"
+#include "stage_profiler.h"
+#include "running_median.h"
+
+namespace {
+
+constexpr uint32_t BUFFER_SIZE = ADCConfig::BUFFER_SIZE;
+
+uint16_t input[BUFFER_SIZE];
+float float_output[BUFFER_SIZE];
+uint32_t fixed_output_q4[BUFFER_SIZE];
+
+// Battery-like signal (~2000 counts, +/-16 noise, occasional spikes) with
+// a full-scale step every 16 buffers to exercise the accumulator range
+void fill_buffer(uint32_t buffer_index, uint32_t* lcg) {
+    uint32_t base = ((buffer_index / 16) & 1) ? ADCConfig::ADC_MAX - 40 : 2000;
+    if (buffer_index % 32 == 31) base = 20;
+    for (uint32_t i = 0; i < BUFFER_SIZE; ++i) {
+        *lcg = *lcg * 1664525u + 1013904223u;
+        int32_t value = static_cast<int32_t>(base) + static_cast<int32_t>((*lcg >> 24) & 0x1F) - 16;
+        if ((*lcg & 0x3FF) == 0) {
+            value += 400;
+        }
+        if (value < 0) value = 0;
+        if (value > static_cast<int32_t>(ADCConfig::ADC_MAX)) value = ADCConfig::ADC_MAX;
+        input[i] = static_cast<uint16_t>(value);
+    }
+}
+
+// Previous MedianFilter approach: copy the window and insertion-sort it
+template <uint32_t W>
+class InsertionSortMedian {
+public:
+    InsertionSortMedian() : index(0) {
+        for (uint32_t i = 0; i < W; ++i) window[i] = 0;
+    }
+
+    uint16_t process(uint16_t sample) {
+        window[index] = sample;
+        index = (index + 1) % W;
+        uint16_t sorted[W];
+        for (uint32_t i = 0; i < W; ++i) {
+            uint16_t key = window[i];
+            int32_t j = static_cast<int32_t>(i) - 1;
+            while (j >= 0 && sorted[j] > key) {
+                sorted[j + 1] = sorted[j];
+                j--;
+            }
+            sorted[j + 1] = key;
+        }
+        return sorted[W / 2];
+    }
+
+private:
+    uint16_t window[W];
+    uint32_t index;
+};
+
+// Average cycles/sample (host ns on the host build) of one median
+// implementation over the test signal
+template <typename Median>
+float median_cycles(uint32_t buffers) {
+    Median median;
+    uint32_t lcg = 12345;
+    uint64_t cycles = 0;
+    uint32_t checksum = 0;
+    for (uint32_t b = 0; b < buffers; ++b) {
+        fill_buffer(b, &lcg);
+        uint32_t start = StageProfiler::now();
+        for (uint32_t i = 0; i < BUFFER_SIZE; ++i) {
+            checksum += median.process(input[i]);
+        }
+        cycles += StageProfiler::elapsed(start, StageProfiler::now());
+    }
+    fixed_output_q4[0] = checksum;  // Keep the result observable
+    return static_cast<float>(cycles) * StageProfiler::UNITS_PER_TICK / (buffers * BUFFER_SIZE);
+}
+
+template <uint32_t W>
+void print_median_row(uint32_t buffers) {
+    float insertion = median_cycles<InsertionSortMedian<W>>(buffers);
+    float heaps = median_cycles<DoubleHeapMedian<uint16_t, W>>(buffers);
+    if constexpr (W <= 9) {
+        float network = median_cycles<NetworkMedian<uint16_t, W>>(buffers);
+        printf("  %6lu %10.1f %10.1f %10.1f\n", static_cast<unsigned long>(W), insertion, network, heaps);
+    } else {
+        printf("  %6lu %10.1f %10s %10.1f\n", static_cast<unsigned long>(W), insertion, "-", heaps);
+    }
+}
+
+} // namespace
+
+namespace FilterBenchmark {
+
+Result run(uint32_t buffers) {
+    Result result = {0, 0, 0, 0.0f, 0.0f};
+
+    MedianFilter median;
+    LowPassFilter lpf;
+    FixedMedianFilter fixed_median;
+    FixedLowPassFilter fixed_lpf;
+
+    uint32_t lcg = 12345;
+    float error_sum = 0.0f;
+
+    for (uint32_t b = 0; b < buffers; ++b) {
+        fill_buffer(b, &lcg);
+
+        uint32_t start = StageProfiler::now();
+        for (uint32_t i = 0; i < BUFFER_SIZE; ++i) {
+            float_output[i] = lpf.process(median.process(input[i]));
+        }
+        result.float_cycles += StageProfiler::elapsed(start, StageProfiler::now());
+
+        start = StageProfiler::now();
+        for (uint32_t i = 0; i < BUFFER_SIZE; ++i) {
+            fixed_output_q4[i] = fixed_lpf.process(fixed_median.process(input[i]));
+        }
+        result.fixed_cycles += StageProfiler::elapsed(start, StageProfiler::now());
+
+        for (uint32_t i = 0; i < BUFFER_SIZE; ++i) {
+            float fixed = static_cast<float>(fixed_output_q4[i]) / (1u << FilterConfig::LPF_STATE_BITS);
+            float error = fixed - float_output[i];
+            if (error < 0.0f) error = -error;
+            if (error > result.max_error_lsb) result.max_error_lsb = error;
+            error_sum += error;
+        }
+        result.samples += BUFFER_SIZE;
+    }
+
+    result.mean_error_lsb = result.samples ? error_sum / result.samples : 0.0f;
+    return result;
+}
+
+void print(const Result& result) {
+    if (result.samples == 0) {
+        printf("No samples processed\n");
+        return;
+    }
+    float float_cps = static_cast<float>(result.float_cycles) * StageProfiler::UNITS_PER_TICK / result.samples;
+    float fixed_cps = static_cast<float>(result.fixed_cycles) * StageProfiler::UNITS_PER_TICK / result.samples;
+    if (StageProfiler::HOST_TIMER) {
+        printf("Filter chain, %lu samples (%s):\n",
+               static_cast<unsigned long>(result.samples), StageProfiler::UNIT);
+    } else {
+        printf("Filter chain, %lu samples (%s @ %lu MHz):\n",
+               static_cast<unsigned long>(result.samples), StageProfiler::UNIT,
+               static_cast<unsigned long>(StageProfiler::CYCLES_PER_US));
+    }
+    printf("  float  median+IIR: %8.1f %s/sample\n", float_cps, StageProfiler::UNIT);
+    printf("  fixed  median+IIR: %8.1f %s/sample (%.2fx)\n",
+           fixed_cps, StageProfiler::UNIT, fixed_cps > 0.0f ? float_cps / fixed_cps : 0.0f);
+    printf("  fixed vs float error: max %.3f LSB, mean %.4f LSB\n",
+           result.max_error_lsb, result.mean_error_lsb);
+    printf("  active path: %s\n", FilterConfig::FIXED_POINT ? "fixed" : "float");
+}
+
+void run_median_sweep(uint32_t buffers) {
+    if (StageProfiler::HOST_TIMER) {
+        printf("Median, %lu samples per size (%s/sample):\n",
+               static_cast<unsigned long>(buffers * BUFFER_SIZE), StageProfiler::UNIT);
+    } else {
+        printf("Median, %lu samples per size (%s/sample @ %lu MHz):\n",
+               static_cast<unsigned long>(buffers * BUFFER_SIZE), StageProfiler::UNIT,
+               static_cast<unsigned long>(StageProfiler::CYCLES_PER_US));
+    }
+    printf("  %6s %10s %10s %10s\n", "window", "insertion", "network", "heaps");
+    print_median_row<3>(buffers);
+    print_median_row<5>(buffers);
+    print_median_row<7>(buffers);
+    print_median_row<9>(buffers);
+    print_median_row<15>(buffers);
+    print_median_row<21>(buffers);
+    print_median_row<31>(buffers);
+}
+
+} // namespace FilterBenchmark
@@ -0,0 +1,36 @@
+#ifndef FILTER_BENCHMARK_H
+#define FILTER_BENCHMARK_H
+
+#include <stdint.h>
+
+// ==================================================
+// FilterBenchmark
+// Runs the float (MedianFilter + LowPassFilter) and fixed-point
+// (FixedMedianFilter + FixedLowPassFilter) chains over the same
+// synthetic signal, timing each with StageProfiler's cycle counter and
+// measuring the fixed-point error against float.
+// On the RP2040 the figures are processor cycles (BENCH command); on
+// the host they are wall time scaled to 125 MHz (airsoft-bench fixed).
+// StageProfiler::init_counter() must have been called on this core.
+// ==================================================
+
+namespace FilterBenchmark {
+    struct Result {
+        uint32_t samples;
+        uint64_t float_cycles;
+        uint64_t fixed_cycles;
+        float max_error_lsb;   // Worst |fixed - float| in ADC counts
+        float mean_error_lsb;
+    };
+
+    // Process `buffers` buffers of ADCConfig::BUFFER_SIZE samples
+    Result run(uint32_t buffers);
+
+    void print(const Result& result);
+
+    // Cycles/sample for copy+insertion sort, sorting network and
+    // double-heap medians across window sizes (prints a table)
+    void run_median_sweep(uint32_t buffers);
+}
+
+#endif // FILTER_BENCHMARK_H
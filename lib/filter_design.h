@@ -0,0 +1,328 @@
+#ifndef FILTER_DESIGN_H
+#define FILTER_DESIGN_H
+
+#include <stdint.h>
+
+// ==================================================
+// Compile-time filter design
+//
+// Butterworth low-pass cascades (bilinear transform, pre-warped cutoff),
+// notch biquads and half-band FIRs as constexpr functions, so FilterConfig derives its
+// coefficients from the cutoff and sample rate instead of carrying
+// numbers pasted from a calculator. Double precision throughout; convert
+// to float or quantize with to_q() / quantize() at the point of use.
+//
+// Sections use y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2 (a0 normalised to
+// 1). A first-order section has b2 = a2 = 0. See lib/biquad_cascade.h
+// for the filter that runs them.
+// ==================================================
+
+namespace FilterDesign {
+
+constexpr double PI = 3.14159265358979323846;
+
+struct Biquad {
+    double b0, b1, b2;
+    double a1, a2;
+};
+
+template <uint32_t N>
+struct Cascade {
+    static constexpr uint32_t SECTIONS = N;
+    Biquad sections[N];
+};
+
+// Biquads for an order-ORDER filter: one per pole pair, plus a
+// first-order section if ORDER is odd
+constexpr uint32_t sections_for_order(uint32_t order) {
+    return (order + 1) / 2;
+}
+
+// ==================================================
+// constexpr trigonometry (std::sin/cos are not constexpr in C++17)
+// Taylor series after reduction to [-pi, pi]; double precision there
+// ==================================================
+
+constexpr double reduce_angle(double x) {
+    while (x > PI) x -= 2.0 * PI;
+    while (x < -PI) x += 2.0 * PI;
+    return x;
+}
+
+constexpr double sine(double x) {
+    x = reduce_angle(x);
+    double term = x;
+    double sum = x;
+    for (uint32_t n = 1; n < 30; ++n) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cosine(double x) {
+    x = reduce_angle(x);
+    double term = 1.0;
+    double sum = 1.0;
+    for (uint32_t n = 1; n < 30; ++n) {
+        term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double tangent(double x) {
+    return sine(x) / cosine(x);
+}
+
+// ==================================================
+// Sections
+// ==================================================
+
+// First-order low-pass, -3 dB at cutoff_hz
+constexpr Biquad first_order_lowpass(double cutoff_hz, double rate_hz) {
+    double k = tangent(PI * cutoff_hz / rate_hz);
+    double norm = 1.0 / (1.0 + k);
+    return Biquad{k * norm, k * norm, 0.0, (k - 1.0) * norm, 0.0};
+}
+
+// Second-order low-pass with quality factor q (1/sqrt(2): Butterworth)
+constexpr Biquad second_order_lowpass(double cutoff_hz, double rate_hz, double q) {
+    double k = tangent(PI * cutoff_hz / rate_hz);
+    double norm = 1.0 / (1.0 + k / q + k * k);
+    double b0 = k * k * norm;
+    return Biquad{b0, 2.0 * b0, b0, 2.0 * (k * k - 1.0) * norm, (1.0 - k / q + k * k) * norm};
+}
+
+// Notch at center_hz, -3 dB bandwidth center_hz / q, unity gain elsewhere
+constexpr Biquad notch(double center_hz, double rate_hz, double q) {
+    double w0 = 2.0 * PI * center_hz / rate_hz;
+    double alpha = sine(w0) / (2.0 * q);
+    double norm = 1.0 / (1.0 + alpha);
+    double c = -2.0 * cosine(w0) * norm;
+    return Biquad{norm, c, norm, c, (1.0 - alpha) * norm};
+}
+
+// Order-ORDER Butterworth low-pass: pole pairs as second-order sections
+// with Q = 1 / (2 sin((2k + 1) pi / 2N)), then the real pole if ORDER is odd
+template <uint32_t ORDER>
+constexpr Cascade<sections_for_order(ORDER)> butterworth_lowpass(double cutoff_hz, double rate_hz) {
+    static_assert(ORDER >= 1, "Filter order must be at least 1");
+    Cascade<sections_for_order(ORDER)> cascade{};
+    for (uint32_t k = 0; k < ORDER / 2; ++k) {
+        double q = 1.0 / (2.0 * sine((2.0 * k + 1.0) * PI / (2.0 * ORDER)));
+        cascade.sections[k] = second_order_lowpass(cutoff_hz, rate_hz, q);
+    }
+    if (ORDER % 2 != 0) {
+        cascade.sections[ORDER / 2] = first_order_lowpass(cutoff_hz, rate_hz);
+    }
+    return cascade;
+}
+
+// ==================================================
+// FIR
+// ==================================================
+
+template <uint32_t TAPS>
+struct Fir {
+    static constexpr uint32_t LENGTH = TAPS;
+    double taps[TAPS];
+};
+
+// Half-band low-pass (cutoff at a quarter of the rate) for decimation by
+// 2: Blackman-windowed sinc, unity DC gain. Every second tap except the
+// centre is exactly zero
+template <uint32_t TAPS>
+constexpr Fir<TAPS> half_band() {
+    static_assert(TAPS >= 3 && (TAPS + 1) % 4 == 0, "Half-band length must be 4k - 1");
+    Fir<TAPS> fir{};
+    constexpr int32_t CENTER = (TAPS - 1) / 2;
+    double sum = 0.0;
+    for (uint32_t n = 0; n < TAPS; ++n) {
+        int32_t m = static_cast<int32_t>(n) - CENTER;
+        double sinc = 0.5;
+        if (m != 0) {
+            sinc = (m % 2 == 0) ? 0.0 : sine(PI * m / 2.0) / (PI * m);
+        }
+        // Window over TAPS + 2 points so the outer taps are not zeroed
+        double phase = 2.0 * PI * (n + 1) / (TAPS + 1);
+        double window = 0.42 - 0.5 * cosine(phase) + 0.08 * cosine(2.0 * phase);
+        fir.taps[n] = sinc * window;
+        sum += fir.taps[n];
+    }
+    for (uint32_t n = 0; n < TAPS; ++n) {
+        fir.taps[n] /= sum;
+    }
+    return fir;
+}
+
+// ==================================================
+// Fixed-point coefficients
+// ==================================================
+
+struct BiquadQ {
+    int32_t b0, b1, b2;
+    int32_t a1, a2;
+};
+
+// Coefficient with frac_bits fraction bits, rounded to nearest
+constexpr int32_t to_q(double coefficient, uint32_t frac_bits) {
+    double scaled = coefficient * static_cast<double>(1ull << frac_bits);
+    return static_cast<int32_t>(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+constexpr BiquadQ quantize(const Biquad& section, uint32_t frac_bits) {
+    return BiquadQ{to_q(section.b0, frac_bits), to_q(section.b1, frac_bits), to_q(section.b2, frac_bits),
+                   to_q(section.a1, frac_bits), to_q(section.a2, frac_bits)};
+}
+
+template <uint32_t TAPS>
+struct FirQ {
+    int32_t taps[TAPS];
+};
+
+// Taps with frac_bits fraction bits; the centre tap absorbs the rounding
+// so the DC gain stays exactly 1
+template <uint32_t TAPS>
+constexpr FirQ<TAPS> quantize(const Fir<TAPS>& fir, uint32_t frac_bits) {
+    FirQ<TAPS> q{};
+    int32_t sum = 0;
+    for (uint32_t n = 0; n < TAPS; ++n) {
+        q.taps[n] = to_q(fir.taps[n], frac_bits);
+        sum += q.taps[n];
+    }
+    q.taps[(TAPS - 1) / 2] += static_cast<int32_t>(1u << frac_bits) - sum;
+    return q;
+}
+
+template <uint32_t N>
+struct CascadeQ {
+    static constexpr uint32_t SECTIONS = N;
+    uint32_t frac_bits;
+    BiquadQ sections[N];
+};
+
+// Low-pass cascade with frac_bits fraction bits; each section's a1
+// absorbs the rounding so b0 + b1 + b2 == 1 + a1 + a2 and the DC gain
+// stays exactly 1
+template <uint32_t N>
+constexpr CascadeQ<N> quantize(const Cascade<N>& cascade, uint32_t frac_bits) {
+    CascadeQ<N> q{};
+    q.frac_bits = frac_bits;
+    for (uint32_t k = 0; k < N; ++k) {
+        BiquadQ s = quantize(cascade.sections[k], frac_bits);
+        s.a1 = s.b0 + s.b1 + s.b2 - static_cast<int32_t>(1u << frac_bits) - s.a2;
+        q.sections[k] = s;
+    }
+    return q;
+}
+
+// ==================================================
+// Fixed-point ranges
+// A CascadeQ runs on integer state without clamping between sections,
+// so every section's output range has to be known at compile time. A
+// section whose terms are all non-negative has unity DC gain from
+// quantize(), so its output is a weighted mean of values in its input
+// range and stays there, rounding included. Otherwise (overshooting
+// second-order sections) the bound comes from the impulse response of
+// the quantized section, plus the rounding error it can accumulate
+// (+-1/2 per sample through the feedback, 1/A(z)).
+// ==================================================
+
+struct StateRange {
+    int64_t lo, hi;
+};
+
+constexpr bool in_range_by_construction(const BiquadQ& s) {
+    return s.b0 >= 0 && s.b1 >= 0 && s.b2 >= 0 && s.a1 <= 0 && s.a2 <= 0;
+}
+
+constexpr double magnitude(double x) {
+    return x < 0.0 ? -x : x;
+}
+
+constexpr StateRange section_range(const BiquadQ& s, uint32_t frac_bits, StateRange in) {
+    if (in_range_by_construction(s)) {
+        return in;
+    }
+    double scale = 1.0 / static_cast<double>(1ull << frac_bits);
+    double b0 = s.b0 * scale, b1 = s.b1 * scale, b2 = s.b2 * scale;
+    double a1 = s.a1 * scale, a2 = s.a2 * scale;
+
+    // Sums of the positive and negative impulse response taps, and of
+    // the rounding response, until both have died away
+    double positive = 0.0, negative = 0.0, rounding = 0.0;
+    double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0, e1 = 0.0, e2 = 0.0;
+    for (uint32_t n = 0; n < (1u << 16); ++n) {
+        double x = (n == 0) ? 1.0 : 0.0;
+        double y = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+        double e = x - a1 * e1 - a2 * e2;
+        if (y > 0.0) positive += y;
+        else negative -= y;
+        rounding += magnitude(e);
+        x2 = x1; x1 = x;
+        y2 = y1; y1 = y;
+        e2 = e1; e1 = e;
+        if (n > 16 && magnitude(y) + magnitude(y2) + magnitude(e) + magnitude(e2) < 1e-12) break;
+    }
+
+    // One count of margin covers the truncated tail and double rounding
+    double hi = positive * in.hi - negative * in.lo + 0.5 * rounding;
+    double lo = positive * in.lo - negative * in.hi - 0.5 * rounding;
+    return StateRange{static_cast<int64_t>(lo) - 2, static_cast<int64_t>(hi) + 2};
+}
+
+// Range of the state after the first `sections` sections, with the
+// cascade input in 0..state_max
+template <uint32_t N>
+constexpr StateRange cascade_range(const CascadeQ<N>& q, uint32_t state_max, uint32_t sections) {
+    StateRange range{0, state_max};
+    for (uint32_t k = 0; k < sections && k < N; ++k) {
+        range = section_range(q.sections[k], q.frac_bits, range);
+    }
+    return range;
+}
+
+// Accumulator range over all sections of a CascadeQ with its input in
+// 0..state_max: the largest sums of the positive and of the negative
+// terms, rounding included. Every partial sum lies between the two, in
+// whatever order the terms are added
+struct AccumulatorRange {
+    uint64_t positive;
+    uint64_t negative;
+
+    constexpr bool fits_unsigned32() const { return negative == 0 && positive < (1ull << 32); }
+    constexpr bool fits_signed32() const { return positive < (1ull << 31) && negative <= (1ull << 31); }
+    constexpr bool fits_signed64() const { return positive < (1ull << 63) && negative <= (1ull << 63); }
+};
+
+template <uint32_t N>
+constexpr AccumulatorRange accumulator_range(const CascadeQ<N>& q, uint32_t state_max) {
+    AccumulatorRange range{0, 0};
+    StateRange in{0, state_max};
+    for (uint32_t k = 0; k < N; ++k) {
+        const BiquadQ& s = q.sections[k];
+        StateRange out = section_range(s, q.frac_bits, in);
+        // Feedback terms enter with a minus sign
+        const int64_t coefficients[5] = {s.b0, s.b1, s.b2, -static_cast<int64_t>(s.a1), -static_cast<int64_t>(s.a2)};
+        uint64_t positive = 1ull << (q.frac_bits - 1);
+        uint64_t negative = 0;
+        for (uint32_t t = 0; t < 5; ++t) {
+            const StateRange& v = (t < 3) ? in : out;
+            int64_t a = coefficients[t] * v.lo;
+            int64_t b = coefficients[t] * v.hi;
+            int64_t top = a > b ? a : b;
+            int64_t bottom = a < b ? a : b;
+            if (top > 0) positive += static_cast<uint64_t>(top);
+            if (bottom < 0) negative += static_cast<uint64_t>(-bottom);
+        }
+        if (positive > range.positive) range.positive = positive;
+        if (negative > range.negative) range.negative = negative;
+        in = out;
+    }
+    return range;
+}
+
+} // namespace FilterDesign
+
+#endif // FILTER_DESIGN_H
@@ -0,0 +1,36 @@
+#include "flash_safe_irq.h"
+#include "hardware/irq.h"
+
+namespace FlashSafeIRQ {
+
+static_assert(NUM_IRQS <= 32, "IRQ masks are 32 bits wide");
+
+static volatile uint32_t s_allowed = 0;
+
+void allow(uint num, bool allowed) {
+    if (num >= NUM_IRQS) {
+        return;
+    }
+    if (allowed) {
+        s_allowed = s_allowed | (1u << num);
+    } else {
+        s_allowed = s_allowed & ~(1u << num);
+    }
+}
+
+uint32_t begin() {
+    uint32_t masked = 0;
+    for (uint num = 0; num < NUM_IRQS; ++num) {
+        if (irq_is_enabled(num) && !(s_allowed & (1u << num))) {
+            masked |= 1u << num;
+        }
+    }
+    irq_set_mask_enabled(masked, false);
+    return masked;
+}
+
+void end(uint32_t masked) {
+    irq_set_mask_enabled(masked, true);
+}
+
+} // namespace FlashSafeIRQ
@@ -0,0 +1,28 @@
+#ifndef FLASH_SAFE_IRQ_H
+#define FLASH_SAFE_IRQ_H
+
+#include <stdint.h>
+#include "pico.h"
+
+// ==================================================
+// Flash-safe IRQs
+// Flash erase/program switches XIP off, so nothing may run from flash
+// until the operation returns. Rather than disabling every interrupt for
+// the whole operation, begin() masks only the enabled IRQs that have not
+// been allowed here. An allowed IRQ keeps running while flash is busy, so
+// its handler and everything it calls must be placed in RAM
+// (__not_in_flash_func) and must not touch flash-resident data.
+// ==================================================
+
+namespace FlashSafeIRQ {
+    // Register (or unregister) an IRQ whose handler lives in RAM
+    void allow(uint num, bool allowed);
+
+    // Mask every enabled IRQ that is not allowed; returns what was masked
+    uint32_t begin();
+
+    // Unmask what begin() masked; pending IRQs are delivered now
+    void end(uint32_t masked);
+}
+
+#endif // FLASH_SAFE_IRQ_H
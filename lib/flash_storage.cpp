@@ -1,39 +1,321 @@
 #include "flash_storage.h"
+#include "flash_safe_irq.h"
+#include "crc32.h"
+#include "adc_config.h"
 #include "hardware/flash.h"
-#include "hardware/sync.h"
 #include "hardware/watchdog.h"
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 
-// CRC32 implementation for data verification
-static uint32_t crc32(const uint8_t* data, uint32_t length) {
-    uint32_t crc = 0xFFFFFFFF;
-    for (uint32_t i = 0; i < length; i++) {
-        crc ^= data[i];
-        for (int j = 0; j < 8; j++) {
-            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+// ==================================================
+// Flash operations
+// XIP is off while flash is busy. Only flash-safe IRQs (the sampler's
+// RAM-resident DMA completion handler) stay live; the rest of this core's
+// IRQs are masked and the caller parks the other core with
+// multicore_lockout. Everything is done one sector erase (~45 ms) or one
+// page program at a time, which keeps each stall inside the sampler's
+// two-buffer ring and lets the watchdog be fed between operations instead
+// of being disabled.
+// ==================================================
+
+static void erase_one_sector(uint32_t offset) {
+    uint32_t masked = FlashSafeIRQ::begin();
+    flash_range_erase(offset, FLASH_SECTOR_SIZE);
+    FlashSafeIRQ::end(masked);
+    watchdog_update();
+}
+
+static void program_one_page(uint32_t offset, const uint8_t* data) {
+    uint32_t masked = FlashSafeIRQ::begin();
+    flash_range_program(offset, data, FLASH_PAGE_SIZE);
+    FlashSafeIRQ::end(masked);
+}
+
+namespace FlashStorage {
+
+// ==================================================
+// Index
+// Live records in id order (oldest first). Only Core 1 touches the
+// store, so the index needs no locking.
+// ==================================================
+
+struct IndexEntry {
+    uint32_t id;
+    uint16_t first_sector;
+    uint16_t sector_count;
+};
+
+static IndexEntry s_index[MAX_CAPTURES];
+static uint32_t s_index_count = 0;
+static uint32_t s_next_id = 0;
+
+// Record and capture headers come first, then raw and filtered samples
+static constexpr uint32_t PAYLOAD_OFFSET = sizeof(RecordHeader) + sizeof(CaptureHeader);
+
+static uint32_t sector_offset(uint32_t sector) {
+    return DATA_FLASH_OFFSET + sector * FLASH_SECTOR_SIZE;
+}
+
+static const RecordHeader* record_at(uint32_t sector) {
+    return reinterpret_cast<const RecordHeader*>(XIP_BASE + sector_offset(sector));
+}
+
+static uint32_t record_header_crc(const RecordHeader& record) {
+    return Crc32::compute(&record, offsetof(RecordHeader, header_crc));
+}
+
+// A record header that is intact and fits the partition (deleted or not)
+static bool is_record(uint32_t sector) {
+    const RecordHeader* record = record_at(sector);
+    return record->magic == RECORD_MAGIC &&
+           record->sector_count > 0 &&
+           record->sector_count <= DATA_SECTOR_COUNT - sector &&
+           record->header_crc == record_header_crc(*record);
+}
+
+static int find_entry(int id) {
+    for (uint32_t i = 0; i < s_index_count; ++i) {
+        if (static_cast<int>(s_index[i].id) == id) {
+            return static_cast<int>(i);
         }
     }
-    return ~crc;
+    return -1;
 }
 
-namespace FlashStorage {
+static uint32_t sectors_for(uint32_t payload_bytes) {
+    return (PAYLOAD_OFFSET + payload_bytes + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+}
+
+// Per chunk of a version 3 capture, on top of its coded samples: the
+// header, the flush byte and padding, and its index entry
+static constexpr uint32_t CHUNK_OVERHEAD = sizeof(ChunkHeader) + 4 + sizeof(uint32_t);
+static_assert(CHUNK_SAMPLES % SampleCodec::BLOCK_SAMPLES == 0, "Chunks must hold whole codec blocks");
+static_assert(CHUNK_SAMPLES <= 0xFFFF, "ChunkHeader::sample_count is 16 bits");
+
+// Coded size planned for a capture, with room for the block in progress
+static uint32_t planned_coded_bytes(uint32_t count, bool with_filtered) {
+    uint32_t bits = CollectConfig::CODED_BITS_RAW + (with_filtered ? CollectConfig::CODED_BITS_FILTERED : 0);
+    uint32_t chunks = count / CHUNK_SAMPLES + 1;
+    return static_cast<uint32_t>((static_cast<uint64_t>(count) * bits + 7) / 8) +
+           chunks * CHUNK_OVERHEAD + sizeof(IndexTrailer) + SampleCodec::MAX_BLOCK_BYTES;
+}
+
+// CRC of a span of samples; nullptr stands for zeros (a filtered channel
+// with no filtered samples)
+static uint32_t update_crc(uint32_t crc, const uint16_t* samples, uint32_t length) {
+    if (samples != nullptr) {
+        return Crc32::update(crc, samples, length);
+    }
+    static const uint8_t zeros[FLASH_PAGE_SIZE] = {};
+    while (length > 0) {
+        uint32_t chunk = (length < FLASH_PAGE_SIZE) ? length : FLASH_PAGE_SIZE;
+        crc = Crc32::update(crc, zeros, chunk);
+        length -= chunk;
+    }
+    return crc;
+}
+
+// Sectors held by live records, one bit each
+static void occupied_map(uint32_t* map) {
+    memset(map, 0, DATA_SECTOR_COUNT / 8);
+    for (uint32_t i = 0; i < s_index_count; ++i) {
+        for (uint32_t s = 0; s < s_index[i].sector_count; ++s) {
+            uint32_t sector = s_index[i].first_sector + s;
+            map[sector / 32] |= 1u << (sector % 32);
+        }
+    }
+}
+
+// Index of a version 3 payload, checked against its trailer
+struct ChunkIndex {
+    const uint8_t* payload;
+    const uint8_t* entries;   // uint32_t offsets, possibly unaligned in a file buffer
+    uint32_t count;
+    uint32_t end;             // Payload offset of the index; chunks lie before it
+};
+
+static bool open_index(const uint8_t* payload, uint32_t size, ChunkIndex* index) {
+    if (size < sizeof(IndexTrailer)) {
+        return false;
+    }
+    IndexTrailer trailer;
+    memcpy(&trailer, payload + size - sizeof(trailer), sizeof(trailer));
+    uint32_t room = size - sizeof(trailer);
+    if (trailer.magic != INDEX_MAGIC || trailer.chunk_count > room / sizeof(uint32_t)) {
+        return false;
+    }
+    index->payload = payload;
+    index->count = trailer.chunk_count;
+    index->end = room - trailer.chunk_count * sizeof(uint32_t);
+    index->entries = payload + index->end;
+    return Crc32::compute(index->entries, index->count * sizeof(uint32_t)) == trailer.crc;
+}
+
+// Chunk i of an index: its header must fit before the index and its CRC
+// must match the stored bytes
+static bool chunk_at(const ChunkIndex& index, uint32_t i, ChunkHeader* header, const uint8_t** coded) {
+    uint32_t offset;
+    memcpy(&offset, index.entries + i * sizeof(uint32_t), sizeof(offset));
+    if (index.end < sizeof(ChunkHeader) || offset > index.end - sizeof(ChunkHeader)) {
+        return false;
+    }
+    memcpy(header, index.payload + offset, sizeof(ChunkHeader));
+    if (header->magic != CHUNK_MAGIC || header->sample_count == 0 || header->sample_count > CHUNK_SAMPLES ||
+        header->coded_size > index.end - offset - sizeof(ChunkHeader)) {
+        return false;
+    }
+    *coded = index.payload + offset + sizeof(ChunkHeader);
+    uint32_t crc = Crc32::update(Crc32::INIT, *coded, header->coded_size);
+    crc = Crc32::update(crc, header, offsetof(ChunkHeader, crc));
+    return ~crc == header->crc;
+}
+
+static uint32_t free_sector_count() {
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < s_index_count; ++i) {
+        used += s_index[i].sector_count;
+    }
+    return DATA_SECTOR_COUNT - used;
+}
+
+// First free run of `count` sectors at or after the log head (just past
+// the newest record), else the first one from sector 0. Returns
+// DATA_SECTOR_COUNT if there is none; *largest gets the longest run and
+// *largest_first (if not nullptr) where it starts. One scan of the whole
+// partition, so a run that reaches across the head counts in full
+static uint32_t find_free_run(uint32_t count, uint32_t* largest, uint32_t* largest_first = nullptr) {
+    uint32_t map[DATA_SECTOR_COUNT / 32];
+    occupied_map(map);
+
+    uint32_t head = 0;
+    if (s_index_count > 0) {
+        const IndexEntry& newest = s_index[s_index_count - 1];
+        head = (newest.first_sector + newest.sector_count) % DATA_SECTOR_COUNT;
+    }
+
+    uint32_t after_head = DATA_SECTOR_COUNT;
+    uint32_t before_head = DATA_SECTOR_COUNT;
+    uint32_t longest = 0;
+    uint32_t longest_first = DATA_SECTOR_COUNT;
+    uint32_t run = 0;
+    for (uint32_t sector = 0; sector < DATA_SECTOR_COUNT; ++sector) {
+        bool used = (map[sector / 32] >> (sector % 32)) & 1u;
+        run = used ? 0 : run + 1;
+        if (run > longest) {
+            longest = run;
+            longest_first = sector + 1 - run;
+        }
+        if (run >= count) {
+            // Latest start within the run so far; moves past the head as
+            // the run goes on
+            uint32_t first = sector + 1 - count;
+            if (first >= head && after_head == DATA_SECTOR_COUNT) {
+                after_head = first;
+            } else if (first < head && before_head == DATA_SECTOR_COUNT) {
+                before_head = first;
+            }
+        }
+    }
+    if (largest != nullptr) {
+        *largest = longest;
+    }
+    if (largest_first != nullptr) {
+        *largest_first = longest_first;
+    }
+    return (after_head != DATA_SECTOR_COUNT) ? after_head : before_head;
+}
+
+// Program the deleted word; the rest of the page is 0xFF so programming
+// leaves it unchanged
+static void mark_deleted(uint32_t sector) {
+    uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xFF, FLASH_PAGE_SIZE);
+    uint32_t zero = 0;
+    memcpy(page + offsetof(RecordHeader, deleted), &zero, sizeof(zero));
+
+    multicore_lockout_start_blocking();
+    program_one_page(sector_offset(sector), page);
+    multicore_lockout_end_blocking();
+}
+
+static bool add_entry(uint32_t id, uint32_t first_sector, uint32_t sector_count) {
+    if (s_index_count >= MAX_CAPTURES) {
+        return false;
+    }
+    s_index[s_index_count].id = id;
+    s_index[s_index_count].first_sector = static_cast<uint16_t>(first_sector);
+    s_index[s_index_count].sector_count = static_cast<uint16_t>(sector_count);
+    s_index_count++;
+    return true;
+}
+
+static void remove_entry(int index) {
+    for (uint32_t i = static_cast<uint32_t>(index) + 1; i < s_index_count; ++i) {
+        s_index[i - 1] = s_index[i];
+    }
+    s_index_count--;
+}
+
+// ==================================================
+// Public Functions
+// ==================================================
 
 bool init() {
-    // Verify flash is accessible and partition is within bounds
-    // The RP2040 has 2MB flash, our partition is at 1MB-2MB
     printf("FlashStorage: Initializing flash storage\n");
     printf("FlashStorage: Partition offset: 0x%08lx\n", static_cast<unsigned long>(DATA_FLASH_OFFSET));
     printf("FlashStorage: Partition size: %lu bytes\n", static_cast<unsigned long>(DATA_FLASH_SIZE));
-    printf("FlashStorage: Max captures: %lu\n", static_cast<unsigned long>(MAX_CAPTURES));
-    
-    // Read first few bytes to ensure flash is accessible
-    const uint8_t* flash_ptr = (const uint8_t*)(XIP_BASE + DATA_FLASH_OFFSET);
-    volatile uint32_t test = *(uint32_t*)flash_ptr;
-    (void)test;  // Suppress unused variable warning
-    
+
+    // Walk the sector heads. A live record's sectors hold only its own
+    // data, so the walk skips them; anything else is free space
+    s_index_count = 0;
+    s_next_id = 0;
+    uint32_t sector = 0;
+    while (sector < DATA_SECTOR_COUNT) {
+        if (!is_record(sector)) {
+            sector++;
+            continue;
+        }
+        const RecordHeader* record = record_at(sector);
+        if (record->id >= s_next_id) {
+            s_next_id = record->id + 1;
+        }
+        if (record->deleted != 0xFFFFFFFF) {
+            sector++;
+            continue;
+        }
+        if (find_entry(static_cast<int>(record->id)) >= 0) {
+            // Left behind by an interrupted compaction; both copies are
+            // complete, keep the one found first
+            printf("FlashStorage: Dropping duplicate of capture %lu at sector %lu\n",
+                   static_cast<unsigned long>(record->id), static_cast<unsigned long>(sector));
+            mark_deleted(sector);
+            sector++;
+            continue;
+        }
+        if (!add_entry(record->id, sector, record->sector_count)) {
+            printf("FlashStorage: Index full, ignoring capture %lu\n", static_cast<unsigned long>(record->id));
+        }
+        sector += record->sector_count;
+    }
+
+    // Oldest first
+    for (uint32_t i = 1; i < s_index_count; ++i) {
+        IndexEntry entry = s_index[i];
+        uint32_t j = i;
+        while (j > 0 && s_index[j - 1].id > entry.id) {
+            s_index[j] = s_index[j - 1];
+            j--;
+        }
+        s_index[j] = entry;
+    }
+
+    printf("FlashStorage: %lu captures, %lu of %lu sectors free\n",
+           static_cast<unsigned long>(s_index_count),
+           static_cast<unsigned long>(free_sector_count()),
+           static_cast<unsigned long>(DATA_SECTOR_COUNT));
     printf("FlashStorage: Initialized successfully\n");
     return true;
 }
@@ -44,330 +326,881 @@ int write_capture(const uint16_t* samples, uint32_t count, uint32_t timestamp) {
 }
 
 int write_capture_dual(const uint16_t* raw_samples, const uint16_t* filtered_samples, 
-                       uint32_t count, uint32_t timestamp) {
+                       uint32_t count, uint32_t timestamp, uint32_t sample_rate) {
     if (raw_samples == nullptr || count == 0) {
         printf("FlashStorage: Invalid parameters\n");
         return -1;
     }
-    
-    // Calculate data size
-    uint32_t raw_data_size = count * sizeof(uint16_t);
-    uint32_t filtered_data_size = (filtered_samples != nullptr) ? (count * sizeof(uint16_t)) : 0;
-    uint32_t total_data_size = raw_data_size + filtered_data_size;
-    uint32_t total_size = sizeof(CaptureHeader) + total_data_size;
-    
-    if (total_size > CAPTURE_SLOT_SIZE) {
-        printf("FlashStorage: Data too large (%lu bytes > %lu bytes)\n", 
-               static_cast<unsigned long>(total_size), 
-               static_cast<unsigned long>(CAPTURE_SLOT_SIZE));
+
+    // Static: the stream carries page and coded-block buffers (~1.6 KB)
+    static CaptureStream stream;
+    if (!stream.begin(count, filtered_samples != nullptr, sample_rate)) {
         return -1;
     }
-    
-    // Find first empty slot or use next sequential slot
-    int slot = get_capture_count();
-    if (slot >= static_cast<int>(MAX_CAPTURES)) {
-        printf("FlashStorage: No free slots (max %lu captures)\n", 
-               static_cast<unsigned long>(MAX_CAPTURES));
-        return -1;
+
+    // A page's worth at a time keeps each lockout short
+    constexpr uint32_t CHUNK = FLASH_PAGE_SIZE / sizeof(uint16_t);
+    for (uint32_t offset = 0; offset < count; offset += CHUNK) {
+        uint32_t n = (count - offset < CHUNK) ? count - offset : CHUNK;
+        const uint16_t* filtered = (filtered_samples != nullptr) ? filtered_samples + offset : nullptr;
+        if (!stream.append(raw_samples + offset, filtered, n)) {
+            return -1;
+        }
     }
-    
-    if (filtered_samples != nullptr) {
-        printf("FlashStorage: Writing %lu raw + filtered samples to slot %d...\n", 
-               static_cast<unsigned long>(count), slot);
-    } else {
-        printf("FlashStorage: Writing %lu raw samples to slot %d...\n", 
-               static_cast<unsigned long>(count), slot);
+    return stream.finish(timestamp);
+}
+
+bool read_capture(int id, CaptureHeader* header, const uint16_t** samples) {
+    const uint16_t* filtered;
+    return read_capture_dual(id, header, samples, &filtered);
+}
+
+bool read_capture_dual(int id, CaptureHeader* header, 
+                       const uint16_t** raw_samples, const uint16_t** filtered_samples) {
+    int index = find_entry(id);
+    if (index < 0) {
+        printf("FlashStorage: No capture %d\n", id);
+        return false;
+    }
+
+    const uint8_t* record = reinterpret_cast<const uint8_t*>(record_at(s_index[index].first_sector));
+    memcpy(header, record + sizeof(RecordHeader), sizeof(CaptureHeader));
+    if (header->magic != CAPTURE_MAGIC) {
+        return false;
     }
     
-    // Calculate flash offset for this slot
-    uint32_t slot_offset = DATA_FLASH_OFFSET + (slot * CAPTURE_SLOT_SIZE);
-    
-    // Create header
-    CaptureHeader header;
-    header.magic = 0x41444353;  // "ADCS"
-    header.version = (filtered_samples != nullptr) ? 2 : 1;
-    header.sample_rate = 5000;
-    header.sample_count = count;
-    header.timestamp = timestamp;
-    header.checksum = crc32((const uint8_t*)raw_samples, raw_data_size);
-    header.has_filtered = (filtered_samples != nullptr) ? 1 : 0;
-    header.checksum_filt = (filtered_samples != nullptr) ? 
-                           crc32((const uint8_t*)filtered_samples, filtered_data_size) : 0;
+    // Set raw samples pointer (memory-mapped flash)
+    *raw_samples = reinterpret_cast<const uint16_t*>(record + PAYLOAD_OFFSET);
     
-    // Calculate erase and write sizes
-    uint32_t erase_size = ((total_size + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE) * FLASH_SECTOR_SIZE;
-    printf("FlashStorage: Erasing %lu bytes at offset 0x%lx...\n", 
-           static_cast<unsigned long>(erase_size),
-           static_cast<unsigned long>(slot_offset));
+    // Coded captures have no sample arrays
+    if (header->version >= 3) {
+        *raw_samples = nullptr;
+        *filtered_samples = nullptr;
+        return true;
+    }
+
+    // Set filtered samples pointer if present
+    if (header->version == 2 && header->has_filtered == 1) {
+        uint32_t raw_data_size = header->sample_count * sizeof(uint16_t);
+        *filtered_samples = reinterpret_cast<const uint16_t*>(record + PAYLOAD_OFFSET + raw_data_size);
+    } else {
+        *filtered_samples = nullptr;
+    }
     
-    // CRITICAL: Disable watchdog before flash operations
-    // Flash erase can take >2 seconds which exceeds watchdog timeout
-    bool watchdog_was_enabled = watchdog_hw->ctrl & WATCHDOG_CTRL_ENABLE_BITS;
-    if (watchdog_was_enabled) {
-        hw_clear_bits(&watchdog_hw->ctrl, WATCHDOG_CTRL_ENABLE_BITS);
+    return true;
+}
+
+bool read_capture_payload(int id, CaptureHeader* header, const uint8_t** payload, uint32_t* size) {
+    int index = find_entry(id);
+    if (index < 0) {
+        printf("FlashStorage: No capture %d\n", id);
+        return false;
     }
 
-    // Pause the other core to avoid flash contention
-    multicore_lockout_start_blocking();
+    const RecordHeader* record = record_at(s_index[index].first_sector);
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(record) + sizeof(RecordHeader);
+    memcpy(header, data, sizeof(CaptureHeader));
+    if (header->magic != CAPTURE_MAGIC || record->data_size < sizeof(CaptureHeader)) {
+        return false;
+    }
+    *payload = data + sizeof(CaptureHeader);
+    *size = record->data_size - sizeof(CaptureHeader);
+    return true;
+}
 
-    // Both cores will freeze during flash operations
-    // This is unavoidable - code cannot execute from flash while it's being modified
-    uint32_t ints = save_and_disable_interrupts();
-    flash_range_erase(slot_offset, erase_size);
-    restore_interrupts(ints);
+uint32_t read_samples(int id, uint32_t first, uint32_t count, uint16_t* raw, uint16_t* filtered) {
+    CaptureHeader header;
+    const uint8_t* payload;
+    uint32_t payload_size;
+    if (!read_capture_payload(id, &header, &payload, &payload_size) || first >= header.sample_count) {
+        return 0;
+    }
+    if (count > header.sample_count - first) {
+        count = header.sample_count - first;
+    }
+    bool with_filtered = header.has_filtered == 1;
 
-    printf("FlashStorage: Erase complete\n");
-    
-    // Write data (256 bytes at a time) without staging the entire capture in RAM.
-    uint32_t bytes_written = 0;
-    uint8_t page_buffer[FLASH_PAGE_SIZE];
-
-    auto fill_page = [&](uint32_t global_offset, uint32_t bytes_to_copy) {
-        uint32_t copied = 0;
-        while (copied < bytes_to_copy) {
-            uint32_t current_offset = global_offset + copied;
-            uint8_t* dest_ptr = page_buffer + copied;
-            uint32_t remaining = bytes_to_copy - copied;
-
-            if (current_offset < sizeof(CaptureHeader)) {
-                uint32_t header_offset = current_offset;
-                uint32_t available = sizeof(CaptureHeader) - header_offset;
-                uint32_t copy_len = (available < remaining) ? available : remaining;
-                memcpy(dest_ptr,
-                       reinterpret_cast<const uint8_t*>(&header) + header_offset,
-                       copy_len);
-                copied += copy_len;
-                continue;
-            }
+    if (header.version < 3) {
+        const uint16_t* samples = reinterpret_cast<const uint16_t*>(payload);
+        if (raw != nullptr) {
+            memcpy(raw, samples + first, count * sizeof(uint16_t));
+        }
+        if (filtered != nullptr && with_filtered && header.version == 2) {
+            memcpy(filtered, samples + header.sample_count + first, count * sizeof(uint16_t));
+        } else if (filtered != nullptr) {
+            memset(filtered, 0, count * sizeof(uint16_t));
+        }
+        return count;
+    }
 
-            uint32_t raw_offset = current_offset - sizeof(CaptureHeader);
-            if (raw_offset < raw_data_size) {
-                uint32_t available = raw_data_size - raw_offset;
-                uint32_t copy_len = (available < remaining) ? available : remaining;
-                memcpy(dest_ptr,
-                       reinterpret_cast<const uint8_t*>(raw_samples) + raw_offset,
-                       copy_len);
-                copied += copy_len;
-                continue;
-            }
+    ChunkIndex index;
+    if (!open_index(payload, payload_size, &index)) {
+        printf("FlashStorage: Chunk index of capture %d is damaged\n", id);
+        return 0;
+    }
 
-            if (filtered_data_size > 0) {
-                uint32_t filt_offset = current_offset - sizeof(CaptureHeader) - raw_data_size;
-                if (filt_offset < filtered_data_size) {
-                    uint32_t available = filtered_data_size - filt_offset;
-                    uint32_t copy_len = (available < remaining) ? available : remaining;
-                    memcpy(dest_ptr,
-                           reinterpret_cast<const uint8_t*>(filtered_samples) + filt_offset,
-                           copy_len);
-                    copied += copy_len;
-                    continue;
+    // Decode from the chunk holding first, dropping the samples before it
+    uint16_t block_raw[SampleCodec::BLOCK_SAMPLES];
+    uint16_t block_filtered[SampleCodec::BLOCK_SAMPLES];
+    uint32_t done = 0;
+    for (uint32_t c = first / CHUNK_SAMPLES; c < index.count && done < count; ++c) {
+        ChunkHeader chunk;
+        const uint8_t* coded;
+        if (!chunk_at(index, c, &chunk, &coded) || chunk.first_sample > first + done) {
+            printf("FlashStorage: Chunk %lu of capture %d is damaged\n", static_cast<unsigned long>(c), id);
+            break;
+        }
+        SampleCodec::Decoder decoder(coded, chunk.coded_size, chunk.sample_count, with_filtered);
+        uint32_t position = chunk.first_sample;
+        uint32_t n;
+        while (done < count && (n = decoder.next_block(block_raw, with_filtered ? block_filtered : nullptr)) > 0) {
+            uint32_t skip = first + done - position;
+            if (skip < n) {
+                uint32_t take = (n - skip < count - done) ? n - skip : count - done;
+                if (raw != nullptr) {
+                    memcpy(raw + done, block_raw + skip, take * sizeof(uint16_t));
+                }
+                if (filtered != nullptr && with_filtered) {
+                    memcpy(filtered + done, block_filtered + skip, take * sizeof(uint16_t));
+                } else if (filtered != nullptr) {
+                    memset(filtered + done, 0, take * sizeof(uint16_t));
                 }
+                done += take;
             }
-
-            // Should not reach here
+            position += n;
+        }
+        if (decoder.is_corrupt()) {
             break;
         }
-    };
+    }
+    return done;
+}
 
-    while (bytes_written < total_size) {
-        uint32_t chunk_size = (total_size - bytes_written) > FLASH_PAGE_SIZE ?
-                               FLASH_PAGE_SIZE : (total_size - bytes_written);
+uint32_t get_chunk_count(const uint8_t* payload, uint32_t size) {
+    ChunkIndex index;
+    return open_index(payload, size, &index) ? index.count : 0;
+}
 
-        memset(page_buffer, 0xFF, FLASH_PAGE_SIZE);
-        fill_page(bytes_written, chunk_size);
+bool read_chunk(const uint8_t* payload, uint32_t size, uint32_t i, ChunkHeader* header, const uint8_t** coded) {
+    ChunkIndex index;
+    return open_index(payload, size, &index) && i < index.count && chunk_at(index, i, header, coded);
+}
 
-        ints = save_and_disable_interrupts();
-        flash_range_program(slot_offset + bytes_written, page_buffer, FLASH_PAGE_SIZE);
-        restore_interrupts(ints);
+int get_capture_count() {
+    return static_cast<int>(s_index_count);
+}
 
-        bytes_written += FLASH_PAGE_SIZE;
+int get_capture_id(int index) {
+    if (index < 0 || index >= static_cast<int>(s_index_count)) {
+        return -1;
     }
-    
-    // Release the other core now that flash operations are done
-    multicore_lockout_end_blocking();
+    return static_cast<int>(s_index[index].id);
+}
 
-    // Re-enable watchdog if it was enabled before
-    if (watchdog_was_enabled) {
-        watchdog_enable(2000, 1);  // Re-enable with 2s timeout
+bool delete_capture(int id) {
+    int index = find_entry(id);
+    if (index < 0) {
+        return false;
     }
-    
-    printf("FlashStorage: Write complete, slot %d\n", slot);
-    
-    // Verify write
-    if (!verify_capture(slot)) {
-        printf("FlashStorage: WARNING - Verification failed for slot %d\n", slot);
-        return -1;
+
+    printf("FlashStorage: Deleting capture %d...\n", id);
+    mark_deleted(s_index[index].first_sector);
+    remove_entry(index);
+    printf("FlashStorage: Capture %d deleted\n", id);
+    return true;
+}
+
+bool delete_all_captures() {
+    printf("FlashStorage: Deleting all captures...\n");
+    while (s_index_count > 0) {
+        mark_deleted(s_index[s_index_count - 1].first_sector);
+        s_index_count--;
     }
-    
-    return slot;
+    printf("FlashStorage: All captures deleted\n");
+    return true;
 }
 
-bool read_capture(int slot, CaptureHeader* header, const uint16_t** samples) {
-    if (slot < 0 || slot >= static_cast<int>(MAX_CAPTURES)) {
-        printf("FlashStorage: Invalid slot %d\n", slot);
+// Check the index and each chunk's CRC over its stored bytes (no
+// decoding, so a few ms even for a long capture)
+static bool verify_chunks(int id, const CaptureHeader& header, const uint8_t* payload, uint32_t size) {
+    ChunkIndex index;
+    if (!open_index(payload, size, &index)) {
+        printf("FlashStorage: Chunk index of capture %d is damaged\n", id);
         return false;
     }
-    
-    // Calculate flash address for this slot
-    uint32_t slot_offset = DATA_FLASH_OFFSET + (slot * CAPTURE_SLOT_SIZE);
-    const uint8_t* flash_ptr = (const uint8_t*)(XIP_BASE + slot_offset);
-    
-    // Read header
-    memcpy(header, flash_ptr, sizeof(CaptureHeader));
-    
-    // Verify magic number
-    if (header->magic != 0x41444353) {
-        // Empty slot
+
+    uint32_t samples = 0;
+    for (uint32_t i = 0; i < index.count; ++i) {
+        ChunkHeader chunk;
+        const uint8_t* coded;
+        if (!chunk_at(index, i, &chunk, &coded) || chunk.first_sample != samples) {
+            printf("FlashStorage: Chunk %lu of capture %d is damaged\n", static_cast<unsigned long>(i), id);
+            return false;
+        }
+        samples += chunk.sample_count;
+    }
+    if (samples != header.sample_count) {
+        printf("FlashStorage: Chunks of capture %d hold %lu of %lu samples\n", id,
+               static_cast<unsigned long>(samples), static_cast<unsigned long>(header.sample_count));
         return false;
     }
-    
-    // Set samples pointer (memory-mapped flash) - always points to raw data
-    *samples = (const uint16_t*)(flash_ptr + sizeof(CaptureHeader));
-    
     return true;
 }
 
-bool read_capture_dual(int slot, CaptureHeader* header, 
-                       const uint16_t** raw_samples, const uint16_t** filtered_samples) {
-    if (slot < 0 || slot >= static_cast<int>(MAX_CAPTURES)) {
-        printf("FlashStorage: Invalid slot %d\n", slot);
+bool verify_capture(int id) {
+    CaptureHeader header;
+    const uint8_t* payload;
+    uint32_t payload_size;
+    if (!read_capture_payload(id, &header, &payload, &payload_size)) {
         return false;
     }
-    
-    // Calculate flash address for this slot
-    uint32_t slot_offset = DATA_FLASH_OFFSET + (slot * CAPTURE_SLOT_SIZE);
-    const uint8_t* flash_ptr = (const uint8_t*)(XIP_BASE + slot_offset);
-    
-    // Read header
-    memcpy(header, flash_ptr, sizeof(CaptureHeader));
-    
-    // Verify magic number
-    if (header->magic != 0x41444353) {
-        // Empty slot
-        return false;
+    if (header.version >= 3) {
+        return verify_chunks(id, header, payload, payload_size);
     }
+
+    const uint16_t* samples = reinterpret_cast<const uint16_t*>(payload);
+
+    // Verify checksum
+    uint32_t data_size = header.sample_count * sizeof(uint16_t);
+    uint32_t calculated_crc = Crc32::compute(samples, data_size);
     
-    // Set raw samples pointer (memory-mapped flash)
-    *raw_samples = (const uint16_t*)(flash_ptr + sizeof(CaptureHeader));
-    
-    // Set filtered samples pointer if present
-    if (header->version >= 2 && header->has_filtered == 1) {
-        uint32_t raw_data_size = header->sample_count * sizeof(uint16_t);
-        *filtered_samples = (const uint16_t*)(flash_ptr + sizeof(CaptureHeader) + raw_data_size);
-    } else {
-        *filtered_samples = nullptr;
+    if (calculated_crc != header.checksum) {
+        printf("FlashStorage: Checksum mismatch in capture %d (expected 0x%08lx, got 0x%08lx)\n", 
+               id, static_cast<unsigned long>(header.checksum), 
+               static_cast<unsigned long>(calculated_crc));
+        return false;
     }
     
     return true;
 }
 
-int get_capture_count() {
-    int count = 0;
-    
-    for (int slot = 0; slot < static_cast<int>(MAX_CAPTURES); slot++) {
-        uint32_t slot_offset = DATA_FLASH_OFFSET + (slot * CAPTURE_SLOT_SIZE);
-        const uint32_t* magic_ptr = (const uint32_t*)(XIP_BASE + slot_offset);
-        
-        if (*magic_ptr == 0x41444353) {
-            count++;
-        } else {
-            // First empty slot - assume sequential writes
+// Copy a record sector by sector to a free run that does not overlap it.
+// The first page (both headers) goes last, so an interrupted copy is not
+// a record; the original is marked deleted once the copy is complete.
+// Power lost in between leaves two complete records with the same id
+// (init() keeps one). No source sector is touched before that
+static void move_record(IndexEntry& entry, uint32_t to_sector) {
+    uint32_t from = sector_offset(entry.first_sector);
+    uint32_t to = sector_offset(to_sector);
+
+    uint8_t header_page[FLASH_PAGE_SIZE];
+    uint8_t page[FLASH_PAGE_SIZE];
+    memcpy(header_page, reinterpret_cast<const void*>(XIP_BASE + from), FLASH_PAGE_SIZE);
+
+    for (uint32_t s = 0; s < entry.sector_count; ++s) {
+        uint32_t sector_bytes = s * FLASH_SECTOR_SIZE;
+        multicore_lockout_start_blocking();
+        erase_one_sector(to + sector_bytes);
+        for (uint32_t p = (s == 0) ? FLASH_PAGE_SIZE : 0; p < FLASH_SECTOR_SIZE; p += FLASH_PAGE_SIZE) {
+            memcpy(page, reinterpret_cast<const void*>(XIP_BASE + from + sector_bytes + p), FLASH_PAGE_SIZE);
+            program_one_page(to + sector_bytes + p, page);
+        }
+        multicore_lockout_end_blocking();
+    }
+
+    multicore_lockout_start_blocking();
+    program_one_page(to, header_page);
+    multicore_lockout_end_blocking();
+
+    mark_deleted(entry.first_sector);
+    entry.first_sector = static_cast<uint16_t>(to_sector);
+}
+
+// First free run of `count` sectors starting at or after `start`
+static uint32_t find_free_run_from(uint32_t start, uint32_t count) {
+    uint32_t map[DATA_SECTOR_COUNT / 32];
+    occupied_map(map);
+
+    uint32_t run = 0;
+    for (uint32_t sector = start; sector < DATA_SECTOR_COUNT; ++sector) {
+        bool used = (map[sector / 32] >> (sector % 32)) & 1u;
+        run = used ? 0 : run + 1;
+        if (run == count) {
+            return sector + 1 - count;
+        }
+    }
+    return DATA_SECTOR_COUNT;
+}
+
+bool compact() {
+    printf("FlashStorage: Compacting %lu captures...\n", static_cast<unsigned long>(s_index_count));
+
+    // Pack records down in address order. A record only moves into free
+    // sectors it does not occupy itself: one whose gap below is shorter
+    // than itself first moves up past itself (if there is room), which
+    // widens the gap, and is otherwise left where it is
+    uint32_t target = 0;
+    uint32_t moved_sectors = 0;
+    uint32_t skipped = 0;
+    while (true) {
+        IndexEntry* next = nullptr;
+        for (uint32_t i = 0; i < s_index_count; ++i) {
+            if (s_index[i].first_sector >= target &&
+                (next == nullptr || s_index[i].first_sector < next->first_sector)) {
+                next = &s_index[i];
+            }
+        }
+        if (next == nullptr) {
             break;
         }
+        uint32_t gap = next->first_sector - target;
+        if (gap >= next->sector_count) {
+            moved_sectors += next->sector_count;
+            move_record(*next, target);
+        } else if (gap > 0) {
+            uint32_t above = find_free_run_from(next->first_sector + next->sector_count, next->sector_count);
+            if (above != DATA_SECTOR_COUNT) {
+                moved_sectors += next->sector_count;
+                move_record(*next, above);
+                continue;  // Same target, larger gap
+            }
+            skipped++;
+            target = next->first_sector;
+        }
+        target += next->sector_count;
     }
-    
-    return count;
+
+    uint32_t largest = 0;
+    find_free_run(DATA_SECTOR_COUNT + 1, &largest);
+    printf("FlashStorage: Compaction moved %lu sectors, %lu sectors free, largest run %lu",
+           static_cast<unsigned long>(moved_sectors),
+           static_cast<unsigned long>(free_sector_count()),
+           static_cast<unsigned long>(largest));
+    if (skipped > 0) {
+        printf(" (%lu captures left in place: no free run to move them through)", static_cast<unsigned long>(skipped));
+    }
+    printf("\n");
+    return true;
 }
 
-bool delete_capture(int slot) {
-    if (slot < 0 || slot >= static_cast<int>(MAX_CAPTURES)) {
+bool get_stats(FlashStats* stats) {
+    if (stats == nullptr) {
         return false;
     }
     
-    uint32_t slot_offset = DATA_FLASH_OFFSET + (slot * CAPTURE_SLOT_SIZE);
-    
-    printf("FlashStorage: Deleting slot %d...\n", slot);
+    uint32_t largest = 0;
+    find_free_run(DATA_SECTOR_COUNT + 1, &largest);
+    stats->total_size = DATA_FLASH_SIZE;
+    stats->capture_count = get_capture_count();
+    stats->free_size = free_sector_count() * FLASH_SECTOR_SIZE;
+    stats->used_size = DATA_FLASH_SIZE - stats->free_size;
+    stats->largest_free = largest * FLASH_SECTOR_SIZE;
     
-    bool watchdog_was_enabled = watchdog_hw->ctrl & WATCHDOG_CTRL_ENABLE_BITS;
-    if (watchdog_was_enabled) {
-        hw_clear_bits(&watchdog_hw->ctrl, WATCHDOG_CTRL_ENABLE_BITS);
+    return true;
+}
+
+// ==================================================
+// CaptureStream
+// ==================================================
+
+CaptureStream::CaptureStream()
+    : raw_crc(0),
+      filtered_crc(0),
+      chunk_offset(0),
+      chunk_samples(0),
+      chunk_crc(0),
+      chunk_count(0),
+      start_ms(0),
+      base_offset(0),
+      sector_count(0),
+      sample_count(0),
+      samples_written(0),
+      sample_rate(0),
+      sector_erases(0),
+      page_programs(0),
+      id(-1),
+      open(false),
+      with_filtered(false),
+      compressed(false),
+      full(false),
+      locked_out(false) {
+    memset(&raw_region, 0, sizeof(raw_region));
+    memset(&filtered_region, 0, sizeof(filtered_region));
+    memset(erased, 0, sizeof(erased));
+}
+
+uint32_t CaptureStream::max_samples(bool with_filtered) {
+    uint32_t free_bytes = free_sector_count() * FLASH_SECTOR_SIZE;
+    if (free_bytes <= PAYLOAD_OFFSET || s_index_count >= MAX_CAPTURES) {
+        return 0;
     }
+    if (CollectConfig::COMPRESS) {
+        uint32_t reserve = PAYLOAD_OFFSET + SampleCodec::MAX_BLOCK_BYTES + CHUNK_OVERHEAD + sizeof(IndexTrailer);
+        if (free_bytes <= reserve) {
+            return 0;
+        }
+        uint32_t bits = CollectConfig::CODED_BITS_RAW + (with_filtered ? CollectConfig::CODED_BITS_FILTERED : 0);
+        uint64_t chunk_bits = static_cast<uint64_t>(bits) * CHUNK_SAMPLES + 8 * CHUNK_OVERHEAD;
+        return static_cast<uint32_t>(static_cast<uint64_t>(free_bytes - reserve) * 8 * CHUNK_SAMPLES / chunk_bits);
+    }
+    uint32_t bytes_per_sample = with_filtered ? 2 * sizeof(uint16_t) : sizeof(uint16_t);
+    return (free_bytes - PAYLOAD_OFFSET) / bytes_per_sample;
+}
 
-    multicore_lockout_start_blocking();
-    uint32_t ints = save_and_disable_interrupts();
-    flash_range_erase(slot_offset, CAPTURE_SLOT_SIZE);
-    restore_interrupts(ints);
-    multicore_lockout_end_blocking();
+// Sectors a capture of count samples needs, and the version 2 size it
+// takes if a free run allows (the same unless coded)
+static void plan_sectors(uint32_t count, bool filtered, uint32_t* wanted, uint32_t* needed) {
+    uint32_t region_size = count * sizeof(uint16_t);
+    *wanted = sectors_for(filtered ? 2 * region_size : region_size);
+    *needed = *wanted;
+    if (CollectConfig::COMPRESS) {
+        *needed = sectors_for(planned_coded_bytes(count, filtered));
+        if (*wanted < *needed) *wanted = *needed;
+    }
+}
 
-    if (watchdog_was_enabled) {
-        watchdog_enable(2000, 1);
+bool CaptureStream::can_begin(uint32_t count, bool filtered) {
+    if (count == 0 || count > max_samples(filtered)) {
+        printf("FlashStorage: Stream of %lu samples does not fit (max %lu)\n",
+               static_cast<unsigned long>(count),
+               static_cast<unsigned long>(max_samples(filtered)));
+        return false;
+    }
+    uint32_t wanted;
+    uint32_t needed;
+    plan_sectors(count, filtered, &wanted, &needed);
+    uint32_t largest = 0;
+    if (find_free_run(wanted, &largest) == DATA_SECTOR_COUNT && largest < needed) {
+        // Enough free sectors in total, just not in one run. Compacting
+        // here would block sampling for ~50 ms per moved sector
+        printf("FlashStorage: Free space too fragmented for %lu sectors (largest run %lu), run COMPACT\n",
+               static_cast<unsigned long>(needed), static_cast<unsigned long>(largest));
+        return false;
     }
-    
-    printf("FlashStorage: Slot %d deleted\n", slot);
     return true;
 }
 
-bool delete_all_captures() {
-    printf("FlashStorage: Deleting all captures...\n");
-    
-    bool watchdog_was_enabled = watchdog_hw->ctrl & WATCHDOG_CTRL_ENABLE_BITS;
-    if (watchdog_was_enabled) {
-        hw_clear_bits(&watchdog_hw->ctrl, WATCHDOG_CTRL_ENABLE_BITS);
+bool CaptureStream::begin(uint32_t count, bool filtered, uint32_t rate) {
+    if (open) {
+        printf("FlashStorage: Stream already open\n");
+        return false;
+    }
+    if (!can_begin(count, filtered)) {
+        return false;
     }
 
-    multicore_lockout_start_blocking();
-    uint32_t ints = save_and_disable_interrupts();
-    flash_range_erase(DATA_FLASH_OFFSET, DATA_FLASH_SIZE);
-    restore_interrupts(ints);
-    multicore_lockout_end_blocking();
+    // Version 2 size; a coded capture needs its planned size and takes up
+    // to this much if a free run allows
+    uint32_t region_size = count * sizeof(uint16_t);
+    uint32_t wanted;
+    uint32_t needed;
+    plan_sectors(count, filtered, &wanted, &needed);
 
-    if (watchdog_was_enabled) {
-        watchdog_enable(2000, 1);
+    uint32_t largest = 0;
+    uint32_t largest_first = DATA_SECTOR_COUNT;
+    uint32_t first_sector = find_free_run(wanted, &largest, &largest_first);
+    sector_count = wanted;
+    if (first_sector == DATA_SECTOR_COUNT) {
+        first_sector = largest_first;
+        sector_count = largest;
     }
-    
-    printf("FlashStorage: All captures deleted\n");
+
+    id = static_cast<int>(s_next_id++);
+    base_offset = sector_offset(first_sector);
+    sample_count = count;
+    samples_written = 0;
+    sample_rate = rate;
+    with_filtered = filtered;
+    compressed = CollectConfig::COMPRESS;
+    full = false;
+    chunk_samples = 0;
+    chunk_count = 0;
+    start_ms = 0;
+    sector_erases = 0;
+    page_programs = 0;
+    memset(erased, 0, sizeof(erased));
+
+    // Record header, capture header, then raw and filtered, or the
+    // coded stream filling the reservation
+    raw_region.cursor = base_offset + PAYLOAD_OFFSET;
+    if (compressed) {
+        raw_region.end = base_offset + sector_count * FLASH_SECTOR_SIZE;
+        filtered_region.cursor = raw_region.end;
+        filtered_region.end = raw_region.end;
+    } else {
+        raw_region.end = raw_region.cursor + region_size;
+        filtered_region.cursor = raw_region.end;
+        filtered_region.end = filtered ? filtered_region.cursor + region_size : filtered_region.cursor;
+    }
+    raw_crc = Crc32::INIT;
+    filtered_crc = Crc32::INIT;
+    memset(raw_region.page, 0xFF, FLASH_PAGE_SIZE);  // Header bytes stay erased
+    memset(filtered_region.page, 0xFF, FLASH_PAGE_SIZE);
+
+    printf("FlashStorage: Streaming %lu %s samples%s to capture %d (sectors %lu-%lu)\n",
+           static_cast<unsigned long>(count), filtered ? "raw + filtered" : "raw",
+           compressed ? ", coded," : "", id, static_cast<unsigned long>(first_sector),
+           static_cast<unsigned long>(first_sector + sector_count - 1));
+
+    // Erase the first sector of each region now (at most two sector times,
+    // inside the sampler ring); erase-ahead builds the window from here
+    open = true;
+    erase_ahead(raw_region);
+    if (with_filtered && !compressed) {
+        erase_ahead(filtered_region);
+    }
+    lockout_end();
     return true;
 }
 
-bool verify_capture(int slot) {
-    CaptureHeader header;
-    const uint16_t* samples;
-    
-    if (!read_capture(slot, &header, &samples)) {
+bool CaptureStream::append(const uint16_t* raw, const uint16_t* filtered, uint32_t count) {
+    if (!open || raw == nullptr) {
         return false;
     }
-    
-    // Verify magic number
-    if (header.magic != 0x41444353) {
-        printf("FlashStorage: Invalid magic number in slot %d\n", slot);
+    uint32_t remaining = sample_count - samples_written;
+    if (count > remaining || full) {
+        count = full ? 0 : remaining;
+    }
+
+    bool ok = true;
+    if (compressed) {
+        count = append_coded(raw, filtered, count, &ok);
+    } else {
+        uint32_t length = count * sizeof(uint16_t);
+        ok = stage(raw_region, reinterpret_cast<const uint8_t*>(raw), length);
+        if (ok && with_filtered) {
+            ok = stage(filtered_region, reinterpret_cast<const uint8_t*>(filtered), length);
+        }
+    }
+
+    // One CRC pass per span (one sniffer run per buffer); coded chunks
+    // carry their own
+    if (!compressed) {
+        raw_crc = update_crc(raw_crc, raw, count * sizeof(uint16_t));
+        if (with_filtered) {
+            filtered_crc = update_crc(filtered_crc, filtered, count * sizeof(uint16_t));
+        }
+    }
+
+    // One sector per call keeps the added stall near one erase time
+    if (ok && !erase_ahead(raw_region) && with_filtered && !compressed) {
+        erase_ahead(filtered_region);
+    }
+    lockout_end();
+
+    if (!ok) {
+        printf("FlashStorage: Stream write failed at sample %lu\n", static_cast<unsigned long>(samples_written));
+        abort();
         return false;
     }
-    
-    // Verify checksum
-    uint32_t data_size = header.sample_count * sizeof(uint16_t);
-    uint32_t calculated_crc = crc32((const uint8_t*)samples, data_size);
-    
-    if (calculated_crc != header.checksum) {
-        printf("FlashStorage: Checksum mismatch in slot %d (expected 0x%08lx, got 0x%08lx)\n", 
-               slot, static_cast<unsigned long>(header.checksum), 
-               static_cast<unsigned long>(calculated_crc));
+    samples_written += count;
+    return true;
+}
+
+// Feed the encoder and stage each block as it fills, opening a chunk
+// (header left erased) at its first sample and closing it once it holds
+// CHUNK_SAMPLES. A block is only started with room for its worst case,
+// closing its chunk and the rest of the index, so staging cannot overrun.
+// Returns the number of samples taken
+uint32_t CaptureStream::append_coded(const uint16_t* raw, const uint16_t* filtered, uint32_t count, bool* ok) {
+    uint32_t taken = 0;
+    while (*ok && taken < count) {
+        if (encoder.get_pending() == 0) {
+            uint32_t room = SampleCodec::MAX_BLOCK_BYTES + CHUNK_OVERHEAD +
+                            chunk_count * sizeof(uint32_t) + sizeof(IndexTrailer);
+            if (raw_region.end - raw_region.cursor < room) {
+                printf("FlashStorage: Coded stream full at sample %lu of %lu\n",
+                       static_cast<unsigned long>(samples_written + taken),
+                       static_cast<unsigned long>(sample_count));
+                full = true;
+                break;
+            }
+        }
+        if (chunk_samples == 0) {
+            ChunkHeader erased_header;
+            memset(&erased_header, 0xFF, sizeof(erased_header));
+            chunk_offset = raw_region.cursor;
+            chunk_crc = Crc32::INIT;
+            encoder.reset(with_filtered);
+            *ok = stage(raw_region, reinterpret_cast<const uint8_t*>(&erased_header), sizeof(erased_header));
+        }
+
+        uint32_t n = encoder.push(raw + taken, (filtered != nullptr) ? filtered + taken : nullptr, count - taken);
+        taken += n;
+        chunk_samples += n;
+        if (*ok && encoder.block_full()) {
+            *ok = (chunk_samples == CHUNK_SAMPLES) ? close_chunk() : stage_coded(encoder.encode_block(coded));
+        }
+    }
+    return taken;
+}
+
+bool CaptureStream::stage_coded(uint32_t length) {
+    chunk_crc = Crc32::update(chunk_crc, coded, length);
+    return stage(raw_region, coded, length);
+}
+
+// Code the chunk's last block, pad its stream to 4 bytes (keeping every
+// header and the index aligned) and program its header
+bool CaptureStream::close_chunk() {
+    uint32_t length = encoder.encode_block(coded);
+    length += encoder.flush(coded + length);
+    uint32_t coded_size = raw_region.cursor + length - chunk_offset - sizeof(ChunkHeader);
+    uint32_t padding = (4 - coded_size % 4) % 4;
+    memset(coded + length, 0, padding);
+    if (!stage_coded(length + padding)) {
         return false;
     }
-    
+
+    ChunkHeader header;
+    header.magic = CHUNK_MAGIC;
+    header.sample_count = static_cast<uint16_t>(chunk_samples);
+    header.first_sample = chunk_count * CHUNK_SAMPLES;
+    header.timestamp = start_ms;
+    if (sample_rate > 0) {
+        header.timestamp += static_cast<uint32_t>(static_cast<uint64_t>(header.first_sample) * 1000 / sample_rate);
+    }
+    header.coded_size = coded_size + padding;
+    header.crc = ~Crc32::update(chunk_crc, &header, offsetof(ChunkHeader, crc));
+    chunk_count++;
+    chunk_samples = 0;
+    return patch(chunk_offset, reinterpret_cast<const uint8_t*>(&header), sizeof(header));
+}
+
+// Index entries read back from the chunk headers in flash (the stream
+// is flushed first so the last one is readable), then the trailer
+bool CaptureStream::write_index() {
+    if (!flush(raw_region)) {
+        return false;
+    }
+    uint32_t payload = base_offset + PAYLOAD_OFFSET;
+    uint32_t offset = 0;
+    uint32_t crc = Crc32::INIT;
+    for (uint32_t i = 0; i < chunk_count; ++i) {
+        const ChunkHeader* header = reinterpret_cast<const ChunkHeader*>(XIP_BASE + payload + offset);
+        if (header->magic != CHUNK_MAGIC || !stage(raw_region, reinterpret_cast<const uint8_t*>(&offset), sizeof(offset))) {
+            return false;
+        }
+        crc = Crc32::update(crc, &offset, sizeof(offset));
+        offset += sizeof(ChunkHeader) + header->coded_size;
+    }
+
+    IndexTrailer trailer;
+    trailer.chunk_count = chunk_count;
+    trailer.crc = ~crc;
+    trailer.magic = INDEX_MAGIC;
+    return stage(raw_region, reinterpret_cast<const uint8_t*>(&trailer), sizeof(trailer)) && flush(raw_region);
+}
+
+// Program bytes behind the cursor that were staged as 0xFF: into the
+// page buffer while their page is still being staged, otherwise by
+// programming the page again with only these bytes set
+bool CaptureStream::patch(uint32_t offset, const uint8_t* data, uint32_t length) {
+    while (length > 0) {
+        uint32_t page_pos = offset % FLASH_PAGE_SIZE;
+        uint32_t page = offset - page_pos;
+        uint32_t chunk = FLASH_PAGE_SIZE - page_pos;
+        if (chunk > length) {
+            chunk = length;
+        }
+        if (page == raw_region.cursor - (raw_region.cursor % FLASH_PAGE_SIZE)) {
+            memcpy(raw_region.page + page_pos, data, chunk);
+        } else {
+            uint8_t buffer[FLASH_PAGE_SIZE];
+            memset(buffer, 0xFF, FLASH_PAGE_SIZE);
+            memcpy(buffer + page_pos, data, chunk);
+            if (!program_page(page, buffer)) {
+                return false;
+            }
+        }
+        offset += chunk;
+        data += chunk;
+        length -= chunk;
+    }
     return true;
 }
 
-bool get_stats(FlashStats* stats) {
-    if (stats == nullptr) {
+int CaptureStream::finish(uint32_t timestamp) {
+    if (!open) {
+        return -1;
+    }
+    if (samples_written != sample_count && !full) {
+        printf("FlashStorage: Stream incomplete (%lu of %lu samples)\n",
+               static_cast<unsigned long>(samples_written),
+               static_cast<unsigned long>(sample_count));
+        abort();
+        return -1;
+    }
+
+    bool ok = true;
+    uint32_t data_end = filtered_region.end;
+    if (compressed) {
+        // Last (partial) chunk and the index; then give back the reserved
+        // sectors the stream did not reach
+        ok = (chunk_samples == 0 || close_chunk()) && write_index();
+        data_end = raw_region.cursor;
+        sector_count = (data_end - base_offset + FLASH_SECTOR_SIZE - 1) / FLASH_SECTOR_SIZE;
+    } else {
+        ok = flush(raw_region) && (!with_filtered || flush(filtered_region));
+    }
+
+    RecordHeader record;
+    record.magic = RECORD_MAGIC;
+    record.id = static_cast<uint32_t>(id);
+    record.sector_count = sector_count;
+    record.data_size = data_end - base_offset - sizeof(RecordHeader);
+    record.header_crc = record_header_crc(record);
+    record.reserved[0] = 0xFFFFFFFF;
+    record.reserved[1] = 0xFFFFFFFF;
+    record.deleted = 0xFFFFFFFF;
+
+    CaptureHeader header;
+    header.magic = CAPTURE_MAGIC;
+    header.version = compressed ? 3 : (with_filtered ? 2 : 1);
+    header.sample_rate = sample_rate;
+    header.sample_count = samples_written;
+    header.timestamp = timestamp;
+    header.checksum = compressed ? 0 : ~raw_crc;
+    header.has_filtered = with_filtered ? 1 : 0;
+    header.checksum_filt = (with_filtered && !compressed) ? ~filtered_crc : 0;
+
+    // The data already programmed in the header page reads back as-is
+    // where the header page is 0xFF, so program it again with the headers
+    // only. This is the commit point: until now the sectors read as free
+    uint8_t header_page[FLASH_PAGE_SIZE];
+    memset(header_page, 0xFF, FLASH_PAGE_SIZE);
+    memcpy(header_page, &record, sizeof(record));
+    memcpy(header_page + sizeof(record), &header, sizeof(header));
+    ok = ok && program_page(base_offset, header_page);
+    lockout_end();
+    open = false;
+
+    if (!ok || !add_entry(record.id, (base_offset - DATA_FLASH_OFFSET) / FLASH_SECTOR_SIZE, sector_count)) {
+        printf("FlashStorage: Stream finish failed\n");
+        return -1;
+    }
+
+    printf("FlashStorage: Stream complete, capture %d (%lu sector erases, %lu page programs)\n",
+           id, static_cast<unsigned long>(sector_erases),
+           static_cast<unsigned long>(page_programs));
+    if (compressed) {
+        uint32_t raw_bytes = samples_written * sizeof(uint16_t) * (with_filtered ? 2 : 1);
+        uint32_t coded_bytes = record.data_size - sizeof(CaptureHeader);
+        printf("FlashStorage: Coded %lu sample bytes into %lu (%.2fx, %lu chunks, %lu sectors)\n",
+               static_cast<unsigned long>(raw_bytes), static_cast<unsigned long>(coded_bytes),
+               coded_bytes ? static_cast<double>(raw_bytes) / coded_bytes : 0.0,
+               static_cast<unsigned long>(chunk_count), static_cast<unsigned long>(sector_count));
+    }
+
+    if (!verify_capture(id)) {
+        printf("FlashStorage: WARNING - Verification failed for capture %d\n", id);
+        return -1;
+    }
+    return id;
+}
+
+void CaptureStream::abort() {
+    if (open) {
+        printf("FlashStorage: Stream to capture %d abandoned after %lu samples\n",
+               id, static_cast<unsigned long>(samples_written));
+    }
+    lockout_end();
+    open = false;
+}
+
+// Copy into the region's page buffer, programming each page as it fills
+bool CaptureStream::stage(Region& region, const uint8_t* data, uint32_t length) {
+    if (region.cursor + length > region.end) {
         return false;
     }
-    
-    stats->total_size = DATA_FLASH_SIZE;
-    stats->capture_count = get_capture_count();
-    stats->used_size = stats->capture_count * CAPTURE_SLOT_SIZE;
-    stats->free_size = DATA_FLASH_SIZE - stats->used_size;
-    
+    while (length > 0) {
+        uint32_t page_pos = region.cursor % FLASH_PAGE_SIZE;
+        uint32_t chunk = FLASH_PAGE_SIZE - page_pos;
+        if (chunk > length) {
+            chunk = length;
+        }
+        if (data != nullptr) {
+            memcpy(region.page + page_pos, data, chunk);
+            data += chunk;
+        } else {
+            memset(region.page + page_pos, 0, chunk);
+        }
+        region.cursor += chunk;
+        length -= chunk;
+
+        if (region.cursor % FLASH_PAGE_SIZE == 0) {
+            if (!program_page(region.cursor - FLASH_PAGE_SIZE, region.page)) {
+                return false;
+            }
+            memset(region.page, 0xFF, FLASH_PAGE_SIZE);
+        }
+    }
+    return true;
+}
+
+// Program the partial last page; bytes past the cursor stay 0xFF, so a
+// page shared with the next region is programmed once by each
+bool CaptureStream::flush(Region& region) {
+    uint32_t page_pos = region.cursor % FLASH_PAGE_SIZE;
+    if (page_pos == 0) {
+        return true;
+    }
+    bool ok = program_page(region.cursor - page_pos, region.page);
+    memset(region.page, 0xFF, FLASH_PAGE_SIZE);
+    return ok;
+}
+
+bool CaptureStream::program_page(uint32_t offset, const uint8_t* data) {
+    if (offset < DATA_FLASH_OFFSET || offset + FLASH_PAGE_SIZE > DATA_FLASH_OFFSET + DATA_FLASH_SIZE) {
+        return false;
+    }
+
+    // Erase-ahead fell behind: erase now, on the critical path
+    if (!is_erased(offset)) {
+        erase_sector(offset - (offset % FLASH_SECTOR_SIZE));
+    }
+
+    lockout_begin();
+    program_one_page(offset, data);
+    page_programs++;
     return true;
 }
 
+// Erase the first sector within the look-ahead window that is not erased
+// yet. Returns true if it erased one
+bool CaptureStream::erase_ahead(const Region& region) {
+    uint32_t sector = region.cursor - (region.cursor % FLASH_SECTOR_SIZE);
+    uint32_t limit = sector + ERASE_AHEAD_SECTORS * FLASH_SECTOR_SIZE;
+    if (limit > region.end) {
+        limit = region.end;
+    }
+    for (; sector < limit; sector += FLASH_SECTOR_SIZE) {
+        if (!is_erased(sector)) {
+            erase_sector(sector);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CaptureStream::is_erased(uint32_t offset) const {
+    uint32_t index = (offset - DATA_FLASH_OFFSET) / FLASH_SECTOR_SIZE;
+    return (erased[index / 32] >> (index % 32)) & 1u;
+}
+
+// Sectors shared by two regions (or the header) are erased only once
+void CaptureStream::erase_sector(uint32_t offset) {
+    lockout_begin();
+    erase_one_sector(offset);
+
+    uint32_t index = (offset - DATA_FLASH_OFFSET) / FLASH_SECTOR_SIZE;
+    erased[index / 32] |= 1u << (index % 32);
+    sector_erases++;
+}
+
+// Hold the other core once per append rather than once per page
+void CaptureStream::lockout_begin() {
+    if (!locked_out) {
+        multicore_lockout_start_blocking();
+        locked_out = true;
+    }
+}
+
+void CaptureStream::lockout_end() {
+    if (locked_out) {
+        multicore_lockout_end_blocking();
+        locked_out = false;
+    }
+}
+
 } // namespace FlashStorage
@@ -3,10 +3,23 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "hardware/flash.h"
+#include "sample_codec.h"
 
 // ==================================================
 // Flash Storage Module
-// Provides simple flash read/write for data logging
+// Log-structured capture store in a 1MB partition. Each capture is one
+// record: a run of whole sectors starting with a RecordHeader, then the
+// capture file (CaptureHeader and samples, see CaptureHeader). Records are
+// appended after the newest one and wrap to the start of the partition;
+// a record never wraps itself, so its samples stay contiguous in XIP.
+// Deleting programs the record's deleted word (one page, no erase);
+// writers erase sectors as they reuse them. compact() (COMPACT command)
+// slides the live records to the start when free space is too
+// fragmented for a capture; captures never compact on their own.
+// init() rebuilds a small RAM index (id, first sector, sector count) by
+// walking the sector heads. Captures are named by id, which increases
+// with every capture written.
 // ==================================================
 
 namespace FlashStorage {
@@ -14,65 +27,264 @@ namespace FlashStorage {
     // Using last 1MB of flash (Pico has 2MB total)
     constexpr uint32_t DATA_FLASH_OFFSET = (1 * 1024 * 1024);  // 1MB offset from start
     constexpr uint32_t DATA_FLASH_SIZE = (1 * 1024 * 1024);    // 1MB total size
-    constexpr uint32_t MAX_CAPTURES = 4;                        // Up to 4 captures (larger slots for filtered data)
-    constexpr uint32_t CAPTURE_SLOT_SIZE = (DATA_FLASH_SIZE / MAX_CAPTURES); // 256KB per slot (header + raw/filtered samples)
+    constexpr uint32_t DATA_SECTOR_COUNT = DATA_FLASH_SIZE / FLASH_SECTOR_SIZE;
+    constexpr uint32_t MAX_CAPTURES = 64;                       // RAM index entries
     
-    // File header structure (32 bytes)
+    constexpr uint32_t CAPTURE_MAGIC = 0x41444353;  // "ADCS"
+    constexpr uint32_t RECORD_MAGIC = 0x474F4C43;   // "CLOG"
+
+    // Record header (32 bytes) at the start of a record's first sector
+    struct RecordHeader {
+        uint32_t magic;          // RECORD_MAGIC
+        uint32_t id;             // Capture id
+        uint32_t sector_count;   // Sectors the record occupies
+        uint32_t data_size;      // Bytes after this header (capture header + samples)
+        uint32_t header_crc;     // CRC32 of the four fields above
+        uint32_t reserved[2];    // 0xFFFFFFFF
+        uint32_t deleted;        // 0xFFFFFFFF while live; programmed to 0 on delete
+    };
+    static_assert(sizeof(RecordHeader) == 32, "RecordHeader must stay 32 bytes");
+
+    // File header structure (32 bytes), followed by the samples:
+    //   version 1/2: uint16_t raw[sample_count], then filtered[sample_count]
+    //                if has_filtered (version 2); checksums are over these
+    //   version 3:   chunks, then the chunk index (see ChunkHeader); the
+    //                chunks carry the checksums and both fields are 0
     struct CaptureHeader {
         uint32_t magic;          // 0x41444353 ("ADCS")
-        uint32_t version;        // File format version (2 = raw + filtered)
-        uint32_t sample_rate;    // Samples per second (5000)
+        uint32_t version;        // File format version (2 = raw + filtered, 3 = coded)
+        uint32_t sample_rate;    // Samples per second (5000 by default)
         uint32_t sample_count;   // Number of samples
         uint32_t timestamp;      // Unix timestamp (or uptime ms)
         uint32_t checksum;       // CRC32 of raw sample data
         uint32_t has_filtered;   // 1 if filtered data present, 0 if not
         uint32_t checksum_filt;  // CRC32 of filtered sample data
     };
+
+    // Version 3 samples are stored in chunks of CHUNK_SAMPLES, each a
+    // ChunkHeader and its own SampleCodec stream (lib/sample_codec.h) of
+    // both channels, zero padded to a multiple of 4 bytes. A chunk decodes
+    // without the ones before it, so a damaged page costs one chunk and a
+    // reader can start at any of them. After the last chunk comes the
+    // index, the offset of each chunk from the end of the CaptureHeader
+    // (uint32_t), and an IndexTrailer that ends the file.
+    constexpr uint32_t CHUNK_SAMPLES = 2048;       // 16 codec blocks, ~0.4s @ 5kHz
+    constexpr uint16_t CHUNK_MAGIC = 0x4B43;       // "CK"
+    constexpr uint32_t INDEX_MAGIC = 0x58444943;   // "CIDX"
+
+    struct ChunkHeader {
+        uint16_t magic;          // CHUNK_MAGIC
+        uint16_t sample_count;   // CHUNK_SAMPLES, fewer in the last chunk
+        uint32_t first_sample;   // Position of the first sample in the capture
+        uint32_t timestamp;      // Uptime (ms) of the first sample
+        uint32_t coded_size;     // Bytes of coded stream after this header
+        uint32_t crc;            // CRC32 of the coded stream, then the fields above
+    };
+    static_assert(sizeof(ChunkHeader) == 20, "ChunkHeader must stay 20 bytes");
+
+    struct IndexTrailer {
+        uint32_t chunk_count;
+        uint32_t crc;            // CRC32 of the index
+        uint32_t magic;          // INDEX_MAGIC
+    };
+
+    // Number of chunks in a version 3 payload (in flash or a file buffer,
+    // 4-byte aligned), read from its index; 0 if the index is damaged
+    uint32_t get_chunk_count(const uint8_t* payload, uint32_t size);
+
+    // Header and coded stream of chunk `index`, located through the index.
+    // Returns false if there is no such chunk or it fails its CRC
+    bool read_chunk(const uint8_t* payload, uint32_t size, uint32_t index,
+                    ChunkHeader* header, const uint8_t** coded);
     
-    // Initialize flash storage (verify partition accessible)
+    // Initialize flash storage (rebuild the index from the partition)
     bool init();
     
     // Write capture to flash (raw samples only - legacy)
-    // Returns capture slot number (0-9) or -1 on error
+    // Returns capture id or -1 on error
     int write_capture(const uint16_t* samples, uint32_t count, uint32_t timestamp = 0);
     
     // Write capture to flash with both raw and filtered samples
     // filtered_samples can be nullptr if not available
-    // Returns capture slot number (0-9) or -1 on error
+    // sample_rate is recorded in the header
+    // Blocks until done (through a CaptureStream); DataCollector streams
+    // its captures instead
+    // Returns capture id or -1 on error
     int write_capture_dual(const uint16_t* raw_samples, const uint16_t* filtered_samples, 
-                           uint32_t count, uint32_t timestamp = 0);
+                           uint32_t count, uint32_t timestamp = 0, uint32_t sample_rate = 5000);
     
     // Read capture from flash
     // Returns true if successful, fills header and sets samples pointer
     // For version 2 files, samples points to raw data, use read_capture_dual for filtered
-    bool read_capture(int slot, CaptureHeader* header, const uint16_t** samples);
+    bool read_capture(int id, CaptureHeader* header, const uint16_t** samples);
     
     // Read capture with both raw and filtered data (version 2)
     // filtered_samples will be nullptr if not present in file
+    // Version 3 captures have no sample arrays: both pointers are nullptr,
+    // use read_samples() instead
     // Returns true if successful
-    bool read_capture_dual(int slot, CaptureHeader* header, 
+    bool read_capture_dual(int id, CaptureHeader* header, 
                           const uint16_t** raw_samples, const uint16_t** filtered_samples);
+
+    // The bytes stored after the capture header (any version), as sent
+    // by DOWNLOAD. Returns true if successful
+    bool read_capture_payload(int id, CaptureHeader* header, const uint8_t** payload, uint32_t* size);
+
+    // Copy samples [first, first + count) of a capture (any version) into
+    // raw and filtered (nullptr to skip); a version 3 capture is decoded
+    // from the chunk holding first onwards. Returns the number of samples
+    // read, short at the end of the capture or at a damaged chunk
+    uint32_t read_samples(int id, uint32_t first, uint32_t count, uint16_t* raw, uint16_t* filtered);
     
     // Get number of stored captures
     int get_capture_count();
+
+    // Id of the index-th stored capture, oldest first (-1 past the end)
+    int get_capture_id(int index);
     
-    // Delete a capture (erase slot)
-    bool delete_capture(int slot);
+    // Delete a capture (marks its record; no erase)
+    bool delete_capture(int id);
     
     // Delete all captures
     bool delete_all_captures();
     
-    // Verify capture integrity (checksum)
-    bool verify_capture(int slot);
+    // Verify capture integrity (checksum; each chunk's CRC in version 3)
+    bool verify_capture(int id);
+
+    // Move the live records to the start of the partition so free space
+    // becomes one run. A record is only copied into sectors it does not
+    // occupy, so a power cut mid-move loses nothing; one with too short a
+    // gap below it first moves up past itself, or stays if there is no
+    // room. Costs one erase per moved sector (about 45 ms each); sampling
+    // keeps running but Core 1 is blocked meanwhile (COMPACT command only).
+    bool compact();
     
     // Get flash usage statistics
     struct FlashStats {
         uint32_t total_size;
-        uint32_t used_size;
+        uint32_t used_size;      // Sectors held by live captures
         uint32_t free_size;
+        uint32_t largest_free;   // Longest contiguous free run (without compacting)
         int capture_count;
     };
     bool get_stats(FlashStats* stats);
+
+    // ==================================================
+    // CaptureStream
+    // Writes a capture to flash while it is being collected, so its length
+    // is bounded by free flash instead of RAM. Each region (raw, filtered)
+    // has a write cursor and a one-page staging buffer; a page is
+    // programmed as soon as it fills, and sectors are erased up to
+    // ERASE_AHEAD_SECTORS ahead of each cursor (at most one per append) so
+    // the cursor rarely waits for an erase. An append of one DMA buffer
+    // normally costs one sector erase and a few page programs, and sampling
+    // keeps running during them (see flash_safe_irq.h).
+    // With CollectConfig::COMPRESS the file is version 3: samples go
+    // through a SampleCodec::Encoder into one coded region, a block at a
+    // time, and a chunk header is programmed as each chunk closes (like
+    // the record header, it is left erased until then). finish() writes
+    // the index from the chunk headers. begin() reserves room for the
+    // planned coded size (CODED_BITS_*) and, where free space allows, up
+    // to the version 2 size; finish() keeps only the sectors used. A
+    // signal that codes worse than the reservation allows ends the capture
+    // early (is_full()).
+    // Otherwise the file keeps the version 2 layout with the sample count
+    // fixed by begin(). The record and capture headers stay erased until
+    // finish() programs them; a capture that is aborted never shows up.
+    // ==================================================
+
+    constexpr uint32_t ERASE_AHEAD_SECTORS = 2;
+
+    class CaptureStream {
+    public:
+        CaptureStream();
+
+        // Reserve a record for sample_count samples and erase the first
+        // sectors of each region. Fails if no free run is long enough
+        // (see can_begin()); it never compacts
+        bool begin(uint32_t sample_count, bool with_filtered, uint32_t sample_rate);
+
+        // True if begin() would find room now; prints why not otherwise
+        // (too long, or free space too fragmented: run COMPACT)
+        static bool can_begin(uint32_t sample_count, bool with_filtered);
+
+        // Uptime (ms) of the first sample, from which chunk timestamps
+        // are counted; set after begin() and before the first append
+        void set_start_time(uint32_t ms) { start_ms = ms; }
+
+        // Append samples to both regions; filtered may be nullptr (zeros
+        // are written if the capture has a filtered region). Once a coded
+        // stream is full the remaining samples are dropped (still true)
+        bool append(const uint16_t* raw, const uint16_t* filtered, uint32_t count);
+
+        // Flush the partial pages, program the header and verify.
+        // A full coded stream stores the samples it took.
+        // Returns the capture id or -1 on error
+        int finish(uint32_t timestamp);
+
+        // Drop the capture; its sectors stay free
+        void abort();
+
+        bool is_open() const { return open; }
+        int get_id() const { return id; }
+        uint32_t get_samples_written() const { return samples_written; }
+        uint32_t get_sector_erase_count() const { return sector_erases; }
+        uint32_t get_page_program_count() const { return page_programs; }
+
+        // Coded stream ran out of reserved room; it takes no more samples
+        bool is_full() const { return full; }
+
+        // Longest capture the free space can hold (after COMPACT);
+        // for coded captures this assumes the planned bits per sample
+        static uint32_t max_samples(bool with_filtered);
+
+    private:
+        struct Region {
+            uint32_t cursor;                 // Flash offset of the next byte
+            uint32_t end;                    // Flash offset one past the region
+            uint8_t page[FLASH_PAGE_SIZE];   // Page containing the cursor
+        };
+
+        Region raw_region;            // Raw samples, or the whole coded stream
+        Region filtered_region;       // Filtered samples (version 2 only)
+        SampleCodec::Encoder encoder;
+        uint8_t coded[SampleCodec::MAX_BLOCK_BYTES + 4];  // One coded block, flush byte, padding
+        uint32_t raw_crc;             // Running CRC32 of the samples (version 2)
+        uint32_t filtered_crc;
+        uint32_t chunk_offset;        // Flash offset of the open chunk's header
+        uint32_t chunk_samples;       // Samples coded into the open chunk
+        uint32_t chunk_crc;           // Running CRC32 of its coded stream
+        uint32_t chunk_count;         // Chunks closed so far
+        uint32_t start_ms;
+        uint32_t erased[DATA_SECTOR_COUNT / 32];  // Sectors erased for this capture
+        uint32_t base_offset;         // Flash offset of the record
+        uint32_t sector_count;
+        uint32_t sample_count;
+        uint32_t samples_written;
+        uint32_t sample_rate;
+        uint32_t sector_erases;
+        uint32_t page_programs;
+        int id;
+        bool open;
+        bool with_filtered;
+        bool compressed;              // Version 3 (CollectConfig::COMPRESS)
+        bool full;
+        bool locked_out;              // Other core held in multicore lockout
+
+        uint32_t append_coded(const uint16_t* raw, const uint16_t* filtered, uint32_t count, bool* ok);
+        bool stage_coded(uint32_t length);
+        bool close_chunk();
+        bool write_index();
+        bool patch(uint32_t offset, const uint8_t* data, uint32_t length);
+        bool stage(Region& region, const uint8_t* data, uint32_t length);
+        bool flush(Region& region);
+        bool program_page(uint32_t offset, const uint8_t* data);
+        bool erase_ahead(const Region& region);
+        bool is_erased(uint32_t offset) const;
+        void erase_sector(uint32_t offset);
+        void lockout_begin();
+        void lockout_end();
+    };
 }
 
 #endif // FLASH_STORAGE_H
@@ -0,0 +1,235 @@
+#ifndef RUNNING_MEDIAN_H
+#define RUNNING_MEDIAN_H
+
+#include <stdint.h>
+#include <type_traits>
+
+// ==================================================
+// Sliding-window medians for the filter chain
+//
+// NetworkMedian<T, W>    W in {3, 5, 7, 9}: copies the window and runs a
+//                        fixed compare-exchange network (no data-dependent
+//                        loop, branch-free for uint16_t).
+// DoubleHeapMedian<T, W> any odd W: max-heap of the lower half and
+//                        min-heap of the upper half, each sample tracked
+//                        by position so the oldest one is replaced in
+//                        place. O(log W) per sample.
+// RunningMedian<T, W>    picks the network up to 9 taps, heaps above.
+//
+// All start with a window of zeros, matching the previous filters.
+// ==================================================
+
+namespace RunningMedianDetail {
+
+// Order a <= b
+template <typename T>
+inline void compare_exchange(T& a, T& b) {
+    T lo = (b < a) ? b : a;
+    T hi = (b < a) ? a : b;
+    a = lo;
+    b = hi;
+}
+
+// Branch-free for 12-bit ADC counts (the M0+ has no conditional move)
+template <>
+inline void compare_exchange<uint16_t>(uint16_t& a, uint16_t& b) {
+    int32_t diff = static_cast<int32_t>(b) - static_cast<int32_t>(a);
+    int32_t neg = diff & (diff >> 31);  // diff if b < a, else 0
+    a = static_cast<uint16_t>(a + neg);
+    b = static_cast<uint16_t>(b - neg);
+}
+
+} // namespace RunningMedianDetail
+
+// ==================================================
+// NetworkMedian: median-selection networks (Devillard / Paeth)
+// ==================================================
+
+template <typename T, uint32_t W>
+class NetworkMedian {
+    static_assert(W == 3 || W == 5 || W == 7 || W == 9, "No median network for this window size");
+
+public:
+    NetworkMedian() { reset(); }
+
+    void reset() {
+        for (uint32_t i = 0; i < W; ++i) {
+            window[i] = T();
+        }
+        index = 0;
+    }
+
+    T process(T sample) {
+        window[index] = sample;
+        index = (index + 1 == W) ? 0 : index + 1;
+
+        T p[W];
+        for (uint32_t i = 0; i < W; ++i) {
+            p[i] = window[i];
+        }
+        return select(p);
+    }
+
+private:
+    T window[W];
+    uint32_t index;
+
+    static T select(T* p) {
+        using RunningMedianDetail::compare_exchange;
+        if constexpr (W == 3) {
+            compare_exchange(p[0], p[1]); compare_exchange(p[1], p[2]);
+            compare_exchange(p[0], p[1]);
+            return p[1];
+        } else if constexpr (W == 5) {
+            compare_exchange(p[0], p[1]); compare_exchange(p[3], p[4]);
+            compare_exchange(p[0], p[3]); compare_exchange(p[1], p[4]);
+            compare_exchange(p[1], p[2]); compare_exchange(p[2], p[3]);
+            compare_exchange(p[1], p[2]);
+            return p[2];
+        } else if constexpr (W == 7) {
+            compare_exchange(p[0], p[5]); compare_exchange(p[0], p[3]);
+            compare_exchange(p[1], p[6]); compare_exchange(p[2], p[4]);
+            compare_exchange(p[0], p[1]); compare_exchange(p[3], p[5]);
+            compare_exchange(p[2], p[6]); compare_exchange(p[2], p[3]);
+            compare_exchange(p[3], p[6]); compare_exchange(p[4], p[5]);
+            compare_exchange(p[1], p[4]); compare_exchange(p[1], p[3]);
+            compare_exchange(p[3], p[4]);
+            return p[3];
+        } else {
+            compare_exchange(p[1], p[2]); compare_exchange(p[4], p[5]);
+            compare_exchange(p[7], p[8]); compare_exchange(p[0], p[1]);
+            compare_exchange(p[3], p[4]); compare_exchange(p[6], p[7]);
+            compare_exchange(p[1], p[2]); compare_exchange(p[4], p[5]);
+            compare_exchange(p[7], p[8]); compare_exchange(p[0], p[3]);
+            compare_exchange(p[5], p[8]); compare_exchange(p[4], p[7]);
+            compare_exchange(p[3], p[6]); compare_exchange(p[1], p[4]);
+            compare_exchange(p[2], p[5]); compare_exchange(p[4], p[7]);
+            compare_exchange(p[2], p[4]); compare_exchange(p[4], p[6]);
+            compare_exchange(p[2], p[4]);
+            return p[4];
+        }
+    }
+};
+
+// ==================================================
+// DoubleHeapMedian: indexed two-heap running median
+// ==================================================
+
+template <typename T, uint32_t W>
+class DoubleHeapMedian {
+    static_assert(W % 2 == 1 && W >= 3, "Window must be odd");
+    static_assert(W <= 255, "Slot indices are stored as uint8_t");
+
+public:
+    DoubleHeapMedian() { reset(); }
+
+    void reset() {
+        // Slots 0..LO_SIZE-1 fill the lower heap, the rest the upper heap;
+        // all values equal, so both heap orders already hold
+        for (uint32_t slot = 0; slot < W; ++slot) {
+            values[slot] = T();
+            if (slot < LO_SIZE) {
+                place(LOWER, slot, static_cast<uint8_t>(slot));
+            } else {
+                place(UPPER, slot - LO_SIZE, static_cast<uint8_t>(slot));
+            }
+        }
+        oldest = 0;
+    }
+
+    T process(T sample) {
+        uint8_t slot = oldest;
+        oldest = (oldest + 1 == W) ? 0 : oldest + 1;
+
+        T previous = values[slot];
+        values[slot] = sample;
+
+        // Restore the order of the heap the slot lives in
+        uint32_t pos = slot_pos[slot];
+        if (slot_heap[slot] == LOWER) {
+            if (previous < sample) sift_up(LOWER, pos); else sift_down(LOWER, pos);
+        } else {
+            if (sample < previous) sift_up(UPPER, pos); else sift_down(UPPER, pos);
+        }
+
+        // One exchange of the two roots restores max(lower) <= min(upper)
+        uint8_t lower_root = at(LOWER, 0);
+        uint8_t upper_root = at(UPPER, 0);
+        if (values[upper_root] < values[lower_root]) {
+            place(LOWER, 0, upper_root);
+            place(UPPER, 0, lower_root);
+            sift_down(LOWER, 0);
+            sift_down(UPPER, 0);
+        }
+
+        return values[at(LOWER, 0)];
+    }
+
+private:
+    static constexpr uint32_t LO_SIZE = (W + 1) / 2;  // Max-heap, root is the median
+    static constexpr uint32_t HI_SIZE = W / 2;        // Min-heap
+    static constexpr uint8_t LOWER = 0;
+    static constexpr uint8_t UPPER = 1;
+
+    T values[W];             // Sample per slot (ring order)
+    uint8_t heaps[W];        // Lower heap, then upper heap; entries are slots
+    uint8_t slot_heap[W];    // Which heap each slot lives in
+    uint8_t slot_pos[W];     // Position within that heap
+    uint8_t oldest;
+
+    // a sits above b in the heap's order
+    bool above(uint8_t heap, uint8_t a, uint8_t b) const {
+        return (heap == LOWER) ? (values[b] < values[a]) : (values[a] < values[b]);
+    }
+
+    void place(uint8_t heap, uint32_t pos, uint8_t slot) {
+        heaps[(heap == LOWER) ? pos : LO_SIZE + pos] = slot;
+        slot_heap[slot] = heap;
+        slot_pos[slot] = static_cast<uint8_t>(pos);
+    }
+
+    uint8_t at(uint8_t heap, uint32_t pos) const {
+        return heaps[(heap == LOWER) ? pos : LO_SIZE + pos];
+    }
+
+    void sift_up(uint8_t heap, uint32_t pos) {
+        if (pos >= ((heap == LOWER) ? LO_SIZE : HI_SIZE)) return;
+        uint8_t slot = at(heap, pos);
+        while (pos > 0) {
+            uint32_t parent = (pos - 1) / 2;
+            uint8_t parent_slot = at(heap, parent);
+            if (!above(heap, slot, parent_slot)) break;
+            place(heap, pos, parent_slot);
+            pos = parent;
+        }
+        place(heap, pos, slot);
+    }
+
+    void sift_down(uint8_t heap, uint32_t pos) {
+        uint32_t size = (heap == LOWER) ? LO_SIZE : HI_SIZE;
+        uint8_t slot = at(heap, pos);
+        while (true) {
+            uint32_t child = 2 * pos + 1;
+            if (child >= size) break;
+            if (child + 1 < size && above(heap, at(heap, child + 1), at(heap, child))) {
+                child++;
+            }
+            uint8_t child_slot = at(heap, child);
+            if (!above(heap, child_slot, slot)) break;
+            place(heap, pos, child_slot);
+            pos = child;
+        }
+        place(heap, pos, slot);
+    }
+};
+
+// ==================================================
+// RunningMedian: network for small windows, heaps for large
+// ==================================================
+
+template <typename T, uint32_t W>
+using RunningMedian = typename std::conditional<(W <= 9),
+                                                NetworkMedian<T, (W <= 9 ? W : 9)>,
+                                                DoubleHeapMedian<T, W>>::type;
+
+#endif // RUNNING_MEDIAN_H
@@ -0,0 +1,335 @@
+#include "sample_codec.h"
+#include <stdio.h>
+#include <string.h>
+#include <new>
+#include "adc_config.h"
+#include "stage_profiler.h"
+#include "voltage_filter.h"
+
+namespace SampleCodec {
+
+namespace {
+
+inline uint16_t zigzag(uint16_t value, uint16_t prev) {
+    int16_t diff = static_cast<int16_t>(static_cast<uint16_t>(value - prev));
+    return static_cast<uint16_t>((static_cast<uint16_t>(diff) << 1) ^ static_cast<uint16_t>(diff >> 15));
+}
+
+inline uint16_t unzigzag(uint32_t z, uint16_t prev) {
+    uint16_t diff = static_cast<uint16_t>((z >> 1) ^ (0u - (z & 1)));
+    return static_cast<uint16_t>(prev + diff);
+}
+
+// Largest k with n * 2^k <= sum, i.e. floor(log2(mean)), which is
+// within a fraction of a bit of the best Rice parameter
+uint32_t choose_k(uint32_t sum, uint32_t n) {
+    uint32_t k = 0;
+    while (k < MAX_K && (static_cast<uint64_t>(n) << (k + 1)) <= sum) {
+        k++;
+    }
+    return k;
+}
+
+} // namespace
+
+// ==================================================
+// Encoder
+// ==================================================
+
+Encoder::Encoder() {
+    reset(false);
+}
+
+void Encoder::reset(bool filtered) {
+    with_filtered = filtered;
+    raw_sum = 0;
+    filtered_sum = 0;
+    pending = 0;
+    raw_prev = 0;
+    filtered_prev = 0;
+    bits = 0;
+    bit_count = 0;
+}
+
+uint32_t Encoder::push(const uint16_t* raw, const uint16_t* filtered, uint32_t count) {
+    uint32_t n = BLOCK_SAMPLES - pending;
+    if (n > count) n = count;
+
+    uint16_t prev = raw_prev;
+    uint32_t sum = raw_sum;
+    for (uint32_t i = 0; i < n; ++i) {
+        uint16_t z = zigzag(raw[i], prev);
+        prev = raw[i];
+        raw_z[pending + i] = z;
+        sum += z;
+    }
+    raw_prev = prev;
+    raw_sum = sum;
+
+    if (with_filtered) {
+        prev = filtered_prev;
+        sum = filtered_sum;
+        for (uint32_t i = 0; i < n; ++i) {
+            uint16_t value = (filtered != nullptr) ? filtered[i] : 0;
+            uint16_t z = zigzag(value, prev);
+            prev = value;
+            filtered_z[pending + i] = z;
+            sum += z;
+        }
+        filtered_prev = prev;
+        filtered_sum = sum;
+    }
+
+    pending += n;
+    return n;
+}
+
+uint32_t Encoder::encode_block(uint8_t* out) {
+    if (pending == 0) {
+        return 0;
+    }
+
+    uint32_t raw_k = choose_k(raw_sum, pending);
+    uint32_t filtered_k = choose_k(filtered_sum, pending);
+
+    // Both parameters first, then each channel's codes
+    uint32_t written = 0;
+    bits |= raw_k << bit_count;
+    bit_count += K_BITS;
+    if (with_filtered) {
+        bits |= filtered_k << bit_count;
+        bit_count += K_BITS;
+    }
+    while (bit_count >= 8) {
+        out[written++] = static_cast<uint8_t>(bits);
+        bits >>= 8;
+        bit_count -= 8;
+    }
+
+    written += put_channel(out + written, raw_z, raw_k);
+    if (with_filtered) {
+        written += put_channel(out + written, filtered_z, filtered_k);
+    }
+
+    raw_sum = 0;
+    filtered_sum = 0;
+    pending = 0;
+    return written;
+}
+
+// The bit buffer holds < 8 bits on entry to each put, so up to 24 bits
+// can be added at once
+uint32_t Encoder::put_channel(uint8_t* out, const uint16_t* z, uint32_t k) {
+    uint32_t acc = bits;
+    uint32_t count = bit_count;
+    uint32_t written = 0;
+    uint32_t low_mask = (1u << k) - 1;
+
+    for (uint32_t i = 0; i < pending; ++i) {
+        uint32_t value = z[i];
+        uint32_t q = value >> k;
+        if (q < ESCAPE_Q) {
+            // q ones and the terminating zero, then the low bits
+            acc |= ((1u << q) - 1) << count;
+            count += q + 1;
+            while (count >= 8) {
+                out[written++] = static_cast<uint8_t>(acc);
+                acc >>= 8;
+                count -= 8;
+            }
+            acc |= (value & low_mask) << count;
+            count += k;
+        } else {
+            acc |= ((1u << ESCAPE_Q) - 1) << count;
+            count += ESCAPE_Q;
+            while (count >= 8) {
+                out[written++] = static_cast<uint8_t>(acc);
+                acc >>= 8;
+                count -= 8;
+            }
+            acc |= value << count;
+            count += 16;
+        }
+        while (count >= 8) {
+            out[written++] = static_cast<uint8_t>(acc);
+            acc >>= 8;
+            count -= 8;
+        }
+    }
+
+    bits = acc;
+    bit_count = count;
+    return written;
+}
+
+uint32_t Encoder::flush(uint8_t* out) {
+    if (bit_count == 0) {
+        return 0;
+    }
+    out[0] = static_cast<uint8_t>(bits);
+    bits = 0;
+    bit_count = 0;
+    return 1;
+}
+
+// ==================================================
+// Decoder
+// ==================================================
+
+Decoder::Decoder(const uint8_t* data, uint32_t size, uint32_t sample_count, bool with_filtered)
+    : data(data),
+      size(size),
+      position(0),
+      bits(0),
+      bit_count(0),
+      sample_count(sample_count),
+      decoded(0),
+      raw_prev(0),
+      filtered_prev(0),
+      with_filtered(with_filtered),
+      corrupt(false) {
+}
+
+// n <= 16
+uint32_t Decoder::get(uint32_t n) {
+    while (bit_count < n) {
+        if (position >= size) {
+            corrupt = true;
+            return 0;
+        }
+        bits |= static_cast<uint32_t>(data[position++]) << bit_count;
+        bit_count += 8;
+    }
+    uint32_t value = bits & ((1u << n) - 1);
+    bits >>= n;
+    bit_count -= n;
+    return value;
+}
+
+void Decoder::get_channel(uint16_t* out, uint32_t n, uint32_t k, uint16_t* prev) {
+    uint16_t value = *prev;
+    for (uint32_t i = 0; i < n && !corrupt; ++i) {
+        uint32_t q = 0;
+        while (q < ESCAPE_Q && get(1) != 0) {
+            q++;
+        }
+        uint32_t z = (q < ESCAPE_Q) ? (q << k) | get(k) : get(16);
+        value = unzigzag(z, value);
+        if (out != nullptr) {
+            out[i] = value;
+        }
+    }
+    *prev = value;
+}
+
+uint32_t Decoder::next_block(uint16_t* raw, uint16_t* filtered) {
+    if (corrupt || decoded >= sample_count) {
+        return 0;
+    }
+    uint32_t n = sample_count - decoded;
+    if (n > BLOCK_SAMPLES) n = BLOCK_SAMPLES;
+
+    uint32_t raw_k = get(K_BITS);
+    uint32_t filtered_k = with_filtered ? get(K_BITS) : 0;
+    get_channel(raw, n, raw_k, &raw_prev);
+    if (with_filtered) {
+        get_channel(filtered, n, filtered_k, &filtered_prev);
+    }
+    if (corrupt) {
+        return 0;
+    }
+    decoded += n;
+    return n;
+}
+
+// ==================================================
+// Benchmark
+// ==================================================
+
+void run_benchmark(uint32_t count) {
+    uint32_t blocks = (count + BLOCK_SAMPLES - 1) / BLOCK_SAMPLES;
+    count = blocks * BLOCK_SAMPLES;
+    uint16_t* raw = new (std::nothrow) uint16_t[2 * count];
+    uint8_t* coded = new (std::nothrow) uint8_t[blocks * MAX_BLOCK_BYTES];
+    if (raw == nullptr || coded == nullptr) {
+        delete[] raw;
+        delete[] coded;
+        printf("ERROR: Cannot allocate buffers for %lu samples\n", static_cast<unsigned long>(count));
+        return;
+    }
+    uint16_t* filtered = raw + count;
+
+    // Battery-like 12-bit signal with commutation spikes, filtered by the
+    // live chain
+    uint32_t lcg = 12345;
+    for (uint32_t i = 0; i < count; ++i) {
+        lcg = lcg * 1664525u + 1013904223u;
+        int32_t value = 2000 + static_cast<int32_t>((lcg >> 24) & 0x1F) - 16;
+        if ((lcg & 0x3FF) == 0) {
+            value += 400;
+        }
+        raw[i] = static_cast<uint16_t>(value);
+    }
+    VoltageFilter filter;
+    filter.process_block(raw, filtered, count, nullptr);
+
+    // Encode and decode one block per SysTick span
+    static Encoder encoder;
+    uint64_t encode_cycles = 0;
+    uint32_t coded_bytes = 0;
+    encoder.reset(true);
+    for (uint32_t b = 0; b < blocks; ++b) {
+        uint32_t offset = b * BLOCK_SAMPLES;
+        uint32_t start = StageProfiler::now();
+        encoder.push(raw + offset, filtered + offset, BLOCK_SAMPLES);
+        coded_bytes += encoder.encode_block(coded + coded_bytes);
+        encode_cycles += StageProfiler::elapsed(start, StageProfiler::now());
+    }
+    coded_bytes += encoder.flush(coded + coded_bytes);
+
+    Decoder decoder(coded, coded_bytes, count, true);
+    uint16_t raw_out[BLOCK_SAMPLES];
+    uint16_t filtered_out[BLOCK_SAMPLES];
+    uint64_t decode_cycles = 0;
+    bool match = true;
+    for (uint32_t b = 0; b < blocks; ++b) {
+        uint32_t offset = b * BLOCK_SAMPLES;
+        uint32_t start = StageProfiler::now();
+        uint32_t n = decoder.next_block(raw_out, filtered_out);
+        decode_cycles += StageProfiler::elapsed(start, StageProfiler::now());
+        if (n != BLOCK_SAMPLES ||
+            memcmp(raw_out, raw + offset, sizeof(raw_out)) != 0 ||
+            memcmp(filtered_out, filtered + offset, sizeof(filtered_out)) != 0) {
+            match = false;
+            break;
+        }
+    }
+
+    delete[] raw;
+    delete[] coded;
+
+    // On the device, a DMA buffer of raw + filtered samples against its
+    // time budget
+    float encode_per_sample = static_cast<float>(encode_cycles) / count;
+    float decode_per_sample = static_cast<float>(decode_cycles) / count;
+    if (StageProfiler::HOST_TIMER) {
+        printf("Sample codec, %lu raw + filtered samples (%s):\n",
+               static_cast<unsigned long>(count), StageProfiler::UNIT);
+        printf("  encode %8.2f %s/sample\n",
+               static_cast<double>(encode_per_sample * StageProfiler::UNITS_PER_TICK), StageProfiler::UNIT);
+    } else {
+        float buffer_us = encode_per_sample * ADCConfig::BUFFER_SIZE / StageProfiler::CYCLES_PER_US;
+        printf("Sample codec, %lu raw + filtered samples (%s @ %lu MHz):\n",
+               static_cast<unsigned long>(count), StageProfiler::UNIT,
+               static_cast<unsigned long>(StageProfiler::CYCLES_PER_US));
+        printf("  encode %8.2f %s/sample (%.0f us per %lu-sample buffer)\n",
+               static_cast<double>(encode_per_sample), StageProfiler::UNIT, static_cast<double>(buffer_us),
+               static_cast<unsigned long>(ADCConfig::BUFFER_SIZE));
+    }
+    printf("  decode %8.2f %s/sample\n",
+           static_cast<double>(decode_per_sample * StageProfiler::UNITS_PER_TICK), StageProfiler::UNIT);
+    printf("  %.2f bits/sample pair, %.2fx smaller than version 2, round trip %s\n",
+           coded_bytes * 8.0 / count, 4.0 * count / coded_bytes, match ? "ok" : "FAILED");
+}
+
+} // namespace SampleCodec
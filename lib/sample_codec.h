@@ -0,0 +1,134 @@
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stdint.h>
+
+// ==================================================
+// Sample Codec
+// Lossless coding of capture samples (file format version 3).
+//
+// Samples are coded in blocks of BLOCK_SAMPLES. Raw samples are coded as
+// the difference from the previous raw sample, filtered samples as the
+// difference from the previous filtered sample (the low-pass output is
+// smooth: ~2.3 bits/sample against ~5.5 for its difference from raw on
+// the 2025-11-20 capture). Differences are taken modulo 2^16, so any
+// uint16_t data round-trips. Each is zigzag mapped (0, -1, 1, -2 ... ->
+// 0, 1, 2, 3 ...) and Rice coded with a parameter k chosen per block and
+// channel from the block's mean:
+//
+//   q = z >> k < ESCAPE_Q:  q one bits, a zero bit, the low k bits of z
+//   otherwise:              ESCAPE_Q one bits, z in 16 bits
+//
+// Block: raw k (4 bits), filtered k (4 bits, if present), the raw codes,
+// then the filtered codes. Blocks follow each other without padding; the
+// stream is padded to a whole byte at the end. Bits are packed LSB first.
+// Prediction state carries across blocks, starting from 0. A capture is
+// a series of such streams, one per chunk (FlashStorage::ChunkHeader).
+//
+// Typical cost on the 2025-11 captures: 5-6.5 bits per raw sample and
+// ~2.3 per filtered sample, i.e. 3x (raw only) to 4.4x (raw + filtered)
+// smaller than version 2.
+// ==================================================
+
+namespace SampleCodec {
+    constexpr uint32_t BLOCK_SAMPLES = 128;
+    constexpr uint32_t K_BITS = 4;
+    constexpr uint32_t MAX_K = (1u << K_BITS) - 1;
+    constexpr uint32_t ESCAPE_Q = 16;
+
+    // Longest a block can code to (every sample escaped), plus the byte
+    // left over from the previous block
+    constexpr uint32_t MAX_BLOCK_BYTES = (2 * (K_BITS + BLOCK_SAMPLES * (ESCAPE_Q + 16)) + 7) / 8 + 1;
+
+    // ==================================================
+    // Encoder
+    // Collects samples a block at a time and codes each full block into a
+    // caller buffer. Costs one pass to gather the block (difference,
+    // zigzag, sum) and one to emit it; no division or multiply per sample.
+    // ==================================================
+
+    class Encoder {
+    public:
+        Encoder();
+
+        // Start a new stream
+        void reset(bool with_filtered);
+
+        // Take up to count samples into the current block (filtered may be
+        // nullptr for zeros; it is ignored without a filtered channel).
+        // Returns the number taken; stops when the block is full
+        uint32_t push(const uint16_t* raw, const uint16_t* filtered, uint32_t count);
+
+        bool block_full() const { return pending == BLOCK_SAMPLES; }
+        uint32_t get_pending() const { return pending; }
+
+        // Code the pending samples (a full block, or the final partial
+        // one) into out, which must hold MAX_BLOCK_BYTES. Whole bytes are
+        // written; up to 7 bits carry over to the next block.
+        // Returns the number of bytes written
+        uint32_t encode_block(uint8_t* out);
+
+        // Pad the carried-over bits to a byte (call once, after the last
+        // block). Returns the number of bytes written (0 or 1)
+        uint32_t flush(uint8_t* out);
+
+    private:
+        uint16_t raw_z[BLOCK_SAMPLES];
+        uint16_t filtered_z[BLOCK_SAMPLES];
+        uint32_t raw_sum;
+        uint32_t filtered_sum;
+        uint32_t pending;
+        uint16_t raw_prev;
+        uint16_t filtered_prev;
+        bool with_filtered;
+
+        uint32_t bits;       // Bits not yet written out, LSB first
+        uint32_t bit_count;  // < 8 between calls
+
+        uint32_t put_channel(uint8_t* out, const uint16_t* z, uint32_t k);
+    };
+
+    // ==================================================
+    // Decoder
+    // Reads a stream block by block from memory (XIP flash or a file
+    // buffer). Never reads past size; a stream that ends early or codes
+    // more than sample_count samples is reported as corrupt.
+    // ==================================================
+
+    class Decoder {
+    public:
+        Decoder(const uint8_t* data, uint32_t size, uint32_t sample_count, bool with_filtered);
+
+        // Decode the next block into raw and filtered (each BLOCK_SAMPLES
+        // long; filtered may be nullptr to skip that channel).
+        // Returns the block's sample count, 0 at the end or on error
+        uint32_t next_block(uint16_t* raw, uint16_t* filtered);
+
+        bool is_corrupt() const { return corrupt; }
+        uint32_t get_samples_decoded() const { return decoded; }
+
+    private:
+        const uint8_t* data;
+        uint32_t size;
+        uint32_t position;    // Next byte to load
+        uint32_t bits;
+        uint32_t bit_count;
+        uint32_t sample_count;
+        uint32_t decoded;
+        uint16_t raw_prev;
+        uint16_t filtered_prev;
+        bool with_filtered;
+        bool corrupt;
+
+        uint32_t get(uint32_t n);
+        void get_channel(uint16_t* out, uint32_t n, uint32_t k, uint16_t* prev);
+    };
+
+    // Cycles/sample (host ns/sample on the host build) to encode and
+    // decode ~count synthetic raw + filtered samples, the bits/sample
+    // achieved and a round-trip check (prints a table).
+    // StageProfiler::init_counter() must have been called on this core.
+    void run_benchmark(uint32_t count);
+}
+
+#endif // SAMPLE_CODEC_H
@@ -0,0 +1,124 @@
+#include "sample_pipeline.h"
+#include "adc_config.h"
+#include "pico/stdlib.h"
+
+// Filter output is in Q4 ADC counts
+static constexpr float Q4_TO_COUNTS = 1.0f / (1u << VoltageFilter::Q4_SHIFT);
+
+// ==================================================
+// Constructor & Destructor
+// ==================================================
+
+SamplePipeline::SamplePipeline() : profiler(nullptr), spectrum(nullptr) {
+    reset();
+    decimator.subscribe(DecimationChain::RATE_LOW, on_low_rate, this);
+}
+
+SamplePipeline::~SamplePipeline() {
+}
+
+void SamplePipeline::reset() {
+    voltage_filter.reset();
+    shot_detector.reset();
+    decimator.reset();
+    total_samples_processed = 0;
+    last_filtered_value = 0.0f;
+    last_avg_voltage_mv = 0.0f;
+    last_raw_avg = 0.0f;
+    last_raw_adc_mv = 0.0f;
+    last_raw_min = 0;
+    last_raw_max = 0;
+}
+
+// ==================================================
+// Buffer Processing
+// ==================================================
+
+void SamplePipeline::process_buffer(const uint16_t* buffer, uint32_t count, DataCollector* collector) {
+    if (buffer == nullptr || count == 0) {
+        return;
+    }
+
+    bool collecting = (collector != nullptr) && collector->is_collecting();
+
+    // One pass per chunk: filter chain and raw min/max/sum. Filtered
+    // samples land in the static scratch buffer for the decimation chain,
+    // spectrum and collector, their deviation from the tracked baseline in
+    // another for the shot detector. DMA buffers are a single chunk.
+    VoltageFilter::BlockStats total = {0, 0xFFFF, 0, 0};
+    uint32_t filter_cycles = 0;
+    uint32_t detect_cycles = 0;
+    uint32_t reduce_cycles = 0;
+    uint32_t collect_cycles = 0;
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    for (uint32_t offset = 0; offset < count; offset += SCRATCH_SIZE) {
+        uint32_t n = count - offset;
+        if (n > SCRATCH_SIZE) n = SCRATCH_SIZE;
+
+        uint32_t stage_start = StageProfiler::now();
+        VoltageFilter::BlockStats block;
+        voltage_filter.process_block(buffer + offset, filtered_scratch, n, &block, deviation_scratch);
+        total.raw_sum += block.raw_sum;
+        if (block.raw_min < total.raw_min) total.raw_min = block.raw_min;
+        if (block.raw_max > total.raw_max) total.raw_max = block.raw_max;
+        total.last_filtered_q4 = block.last_filtered_q4;
+
+        uint32_t filter_end = StageProfiler::now();
+        filter_cycles += StageProfiler::elapsed(stage_start, filter_end);
+
+        // Uptime of the chunk's last sample: the buffer just completed
+        uint32_t chunk_end_ms = now_ms - (count - offset - n) * 1000 / shot_detector.get_sample_rate_hz();
+        shot_detector.process_block(deviation_scratch, n, chunk_end_ms);
+        uint32_t detect_end = StageProfiler::now();
+        detect_cycles += StageProfiler::elapsed(filter_end, detect_end);
+
+        decimator.process_block(filtered_scratch, n);
+        uint32_t reduce_end = StageProfiler::now();
+        reduce_cycles += StageProfiler::elapsed(detect_end, reduce_end);
+
+        if (collecting) {
+            collector->process_buffer(buffer + offset, filtered_scratch, n);
+            collect_cycles += StageProfiler::elapsed(reduce_end, StageProfiler::now());
+        }
+    }
+
+    // A finished RAM capture is written one buffer per pass
+    if (!collecting && collector != nullptr) {
+        uint32_t write_start = StageProfiler::now();
+        collecting = collector->service_write();
+        collect_cycles += StageProfiler::elapsed(write_start, StageProfiler::now());
+    }
+
+    uint32_t stage_start = StageProfiler::now();
+
+    // Raw and filtered samples of a whole buffer; copied only when Core 0
+    // has transformed the previous one
+    if (spectrum != nullptr && count <= SCRATCH_SIZE) {
+        spectrum->offer(buffer, filtered_scratch, count, shot_detector.get_sample_rate_hz());
+    }
+
+    // Derived statistics for the display
+    float buffer_avg = static_cast<float>(total.raw_sum) / static_cast<float>(count);
+    last_raw_avg = buffer_avg;
+    last_raw_min = total.raw_min;
+    last_raw_max = total.raw_max;
+    last_raw_adc_mv = (buffer_avg / static_cast<float>(ADCConfig::ADC_MAX)) * ADCConfig::ADC_VREF * ADCConfig::ADC_CALIBRATION * 1000.0f;
+
+    last_filtered_value = static_cast<float>(total.last_filtered_q4) * Q4_TO_COUNTS;
+    total_samples_processed += count;
+
+    if (profiler != nullptr) {
+        profiler->record(StageProfiler::STAGE_REDUCE,
+                         reduce_cycles + StageProfiler::elapsed(stage_start, StageProfiler::now()));
+        profiler->record(StageProfiler::STAGE_FILTER, filter_cycles);
+        profiler->record(StageProfiler::STAGE_DETECT, detect_cycles);
+        if (collecting) {
+            profiler->record(StageProfiler::STAGE_COLLECT, collect_cycles);
+        }
+    }
+}
+
+void SamplePipeline::on_low_rate(void* context, uint32_t value_q4) {
+    SamplePipeline* pipeline = static_cast<SamplePipeline*>(context);
+    pipeline->last_avg_voltage_mv = static_cast<float>(value_q4) * Q4_TO_COUNTS * ADCConfig::MV_PER_COUNT;
+}
@@ -0,0 +1,82 @@
+#ifndef SAMPLE_PIPELINE_H
+#define SAMPLE_PIPELINE_H
+
+#include <stdint.h>
+#include "adc_config.h"
+#include "voltage_filter.h"
+#include "data_collector.h"
+#include "shot_detector.h"
+#include "stage_profiler.h"
+#include "spectrum_analyzer.h"
+#include "decimator.h"
+
+// ==================================================
+// SamplePipeline Class
+// Core 1 per-buffer processing: filter chain, raw statistics,
+// shot detection, decimation, spectrum and data collector feed. Shared by the firmware
+// loop in main.cpp and the host replay engine.
+// ==================================================
+
+class SamplePipeline {
+public:
+    SamplePipeline();
+    ~SamplePipeline();
+
+    // Process one DMA buffer; collector may be nullptr
+    void process_buffer(const uint16_t* buffer, uint32_t count, DataCollector* collector);
+
+    // Filtered voltage (mV, before DIODE_DROP_MV compensation) from the
+    // 10 Hz output of the decimation chain; 0 until the first output
+    float get_voltage_mv() const { return last_avg_voltage_mv; }
+
+    // Reset filter state and statistics
+    void reset();
+
+    // Shot detector fed with every filtered sample (count, events, rate)
+    ShotDetector& get_shot_detector() { return shot_detector; }
+    const ShotDetector& get_shot_detector() const { return shot_detector; }
+
+    // Decimated filtered signal; subscribe for 500 Hz / 10 Hz outputs
+    DecimationChain& get_decimator() { return decimator; }
+
+    // Record filter/detect/reduce/collect stage timings (nullptr disables)
+    void set_profiler(StageProfiler* profiler) { this->profiler = profiler; }
+
+    // Offer each full DMA buffer to the spectrum analyzer (nullptr disables)
+    void set_spectrum(SpectrumAnalyzer* spectrum) { this->spectrum = spectrum; }
+
+    // Latest buffer statistics
+    float get_last_filtered_value() const { return last_filtered_value; }
+    float get_last_raw_avg() const { return last_raw_avg; }
+    float get_last_raw_adc_mv() const { return last_raw_adc_mv; }
+    uint16_t get_last_raw_min() const { return last_raw_min; }
+    uint16_t get_last_raw_max() const { return last_raw_max; }
+    uint32_t get_total_samples_processed() const { return total_samples_processed; }
+
+private:
+    VoltageFilter voltage_filter;
+    ShotDetector shot_detector;
+    DecimationChain decimator;
+    StageProfiler* profiler;
+    SpectrumAnalyzer* spectrum;
+
+    // Filtered samples for the collector and baseline deviation for the
+    // detector; one DMA buffer per chunk.
+    // Keep the pipeline itself in static storage (it is ~2.5 KB).
+    static constexpr uint32_t SCRATCH_SIZE = ADCConfig::BUFFER_SIZE;
+    uint16_t filtered_scratch[SCRATCH_SIZE];
+    int16_t deviation_scratch[SCRATCH_SIZE];
+
+    uint32_t total_samples_processed;
+    float last_filtered_value;
+    float last_avg_voltage_mv;
+    float last_raw_avg;
+    float last_raw_adc_mv;
+    uint16_t last_raw_min;
+    uint16_t last_raw_max;
+
+    // DecimationChain consumer (RATE_LOW) behind get_voltage_mv()
+    static void on_low_rate(void* context, uint32_t value_q4);
+};
+
+#endif // SAMPLE_PIPELINE_H
@@ -4,17 +4,57 @@
 #include <stdlib.h>
 #include "pico/stdlib.h"
 #include "flash_storage.h"
+#include "filter_benchmark.h"
+#include "crc32.h"
+#include "sample_codec.h"
+#include "adc_config.h"
 
 // Static member initialization
 DataCollector* SerialCommands::s_collector = nullptr;
+StageProfiler* SerialCommands::s_profiler = nullptr;
+DMAADCSampler* SerialCommands::s_sampler = nullptr;
+ShotDetector* SerialCommands::s_detector = nullptr;
+SpectrumAnalyzer* SerialCommands::s_spectrum = nullptr;
 char SerialCommands::s_cmd_buffer[64] = {0};
 int SerialCommands::s_cmd_len = 0;
 
-void SerialCommands::init(DataCollector* collector) {
+void SerialCommands::init(DataCollector* collector, StageProfiler* profiler, DMAADCSampler* sampler,
+                          ShotDetector* detector, SpectrumAnalyzer* spectrum) {
     s_collector = collector;
+    s_profiler = profiler;
+    s_sampler = sampler;
+    s_detector = detector;
+    s_spectrum = spectrum;
     s_cmd_len = 0;
 }
 
+bool SerialCommands::reconfigure_sampler(uint32_t rate_hz, DMAADCSampler::Pacing pacing) {
+    if (s_sampler == nullptr) {
+        printf("ERROR: Sampler not available\n");
+        return false;
+    }
+    if (s_collector && s_collector->is_collecting()) {
+        printf("ERROR: Collection in progress\n");
+        return false;
+    }
+
+    DMAADCSampler::Pacing old_pacing = s_sampler->get_pacing();
+    uint32_t old_rate = s_sampler->get_sample_rate_hz();
+    s_sampler->stop();
+    bool ok = s_sampler->configure(rate_hz, pacing);
+    if (!ok) {
+        s_sampler->configure(old_rate, old_pacing);
+    }
+    s_sampler->start();
+    if (s_detector) {
+        s_detector->set_sample_rate(s_sampler->get_sample_rate_hz());
+    }
+    if (s_collector) {
+        s_collector->set_sample_rate(s_sampler->get_sample_rate_hz());
+    }
+    return ok;
+}
+
 void SerialCommands::check_input() {
     while (true) {
         int c = getchar_timeout_us(0);
@@ -39,75 +79,201 @@ void SerialCommands::handle_command(const char* cmd) {
     while (*cmd == ' ' || *cmd == '\t') cmd++;
     
     if (strncmp(cmd, "COLLECT ", 8) == 0) {
-        // Parse duration
+        // Parse duration; RAW skips the filtered copy (twice the length fits)
         int duration_sec = atoi(cmd + 8);
-        if (duration_sec <= 0 || duration_sec > 60) {
-            printf("ERROR: Invalid duration (1-60 seconds)\n");
+        if (duration_sec <= 0 || duration_sec > static_cast<int>(CollectConfig::MAX_DURATION_S)) {
+            printf("ERROR: Invalid duration (1-%lu seconds)\n",
+                   static_cast<unsigned long>(CollectConfig::MAX_DURATION_S));
             return;
         }
+        bool filtered = (strstr(cmd + 8, " RAW") == nullptr);
         
         printf("Starting %d second collection...\n", duration_sec);
-        if (s_collector && s_collector->start_collection(duration_sec * 1000)) {
+        if (s_collector && s_collector->start_collection(duration_sec * 1000, filtered)) {
             printf("Collection started\n");
         } else {
             printf("ERROR: Failed to start collection\n");
         }
         
+    } else if (strcmp(cmd, "ARM") == 0 || strncmp(cmd, "ARM ", 4) == 0) {
+        // Optional windows and sag; RAW as for COLLECT
+        uint32_t pre_ms = CollectConfig::ARM_PRE_MS;
+        uint32_t post_ms = CollectConfig::ARM_POST_MS;
+        uint32_t sag_mv = CollectConfig::ARM_SAG_MV;
+        const char* args = cmd + 3;
+        char* end;
+        unsigned long value = strtoul(args, &end, 10);
+        if (end != args) {
+            pre_ms = value;
+            args = end;
+            value = strtoul(args, &end, 10);
+            if (end == args) {
+                printf("ERROR: ARM needs both <pre_ms> and <post_ms>\n");
+                return;
+            }
+            post_ms = value;
+            args = end;
+            value = strtoul(args, &end, 10);
+            if (end != args) {
+                sag_mv = value;
+            }
+        }
+        bool filtered = (strstr(cmd + 3, " RAW") == nullptr);
+
+        if (s_collector && s_collector->arm(pre_ms, post_ms, sag_mv, filtered)) {
+            printf("Armed, waiting for a %lu mV sag\n", static_cast<unsigned long>(sag_mv));
+        } else {
+            printf("ERROR: Failed to arm\n");
+        }
+
+    } else if (strcmp(cmd, "DISARM") == 0) {
+        if (s_collector && s_collector->is_armed()) {
+            s_collector->cancel_collection();
+            printf("Disarmed\n");
+        } else {
+            printf("ERROR: Not armed\n");
+        }
+
     } else if (strcmp(cmd, "LIST") == 0) {
         // List stored captures
         printf("Stored captures:\n");
         int count = FlashStorage::get_capture_count();
         
         for (int i = 0; i < count; i++) {
+            int id = FlashStorage::get_capture_id(i);
             FlashStorage::CaptureHeader header;
-            const uint16_t* raw_samples;
-            const uint16_t* filtered_samples;
+            const uint8_t* payload;
+            uint32_t payload_size;
             
-            if (FlashStorage::read_capture_dual(i, &header, &raw_samples, &filtered_samples)) {
-                printf("Slot %d: %lu samples, v%lu, %s, timestamp: %lu ms\n", 
-                       i, 
+            if (FlashStorage::read_capture_payload(id, &header, &payload, &payload_size)) {
+                printf("Capture %d: %lu samples, v%lu, %s, timestamp: %lu ms, %lu bytes\n", 
+                       id, 
                        static_cast<unsigned long>(header.sample_count),
                        static_cast<unsigned long>(header.version),
                        (header.has_filtered ? "raw+filtered" : "raw only"),
-                       static_cast<unsigned long>(header.timestamp));
+                       static_cast<unsigned long>(header.timestamp),
+                       static_cast<unsigned long>(sizeof(header) + payload_size));
             }
         }
         
+        FlashStorage::FlashStats stats;
+        if (FlashStorage::get_stats(&stats)) {
+            printf("Free: %lu KB (largest run %lu KB) of %lu KB\n",
+                   static_cast<unsigned long>(stats.free_size / 1024),
+                   static_cast<unsigned long>(stats.largest_free / 1024),
+                   static_cast<unsigned long>(stats.total_size / 1024));
+        }
+        
         if (count == 0) {
             printf("  No captures stored\n");
         }
         
     } else if (strncmp(cmd, "DOWNLOAD ", 9) == 0) {
-        // Download a capture
-        int slot = atoi(cmd + 9);
+        // Download a capture, or the chunks of a version 3 capture that
+        // overlap [from_ms, to_ms) after its start
+        char* end;
+        int id = static_cast<int>(strtol(cmd + 9, &end, 10));
+        bool ranged = (*end == ' ');
+        uint32_t from_ms = 0;
+        uint32_t to_ms = 0;
+        if (ranged) {
+            from_ms = strtoul(end, &end, 10);
+            to_ms = strtoul(end, nullptr, 10);
+            if (to_ms <= from_ms) {
+                printf("ERROR: Invalid range (from_ms < to_ms)\n");
+                return;
+            }
+        }
         
         FlashStorage::CaptureHeader header;
-        const uint16_t* raw_samples;
-        const uint16_t* filtered_samples;
+        const uint8_t* payload;
+        uint32_t payload_size;
+        
+        if (!FlashStorage::read_capture_payload(id, &header, &payload, &payload_size)) {
+            printf("ERROR: Invalid capture %d\n", id);
+            return;
+        }
         
-        if (!FlashStorage::read_capture_dual(slot, &header, &raw_samples, &filtered_samples)) {
-            printf("ERROR: Invalid slot %d\n", slot);
+        if (!ranged) {
+            // Header plus the samples as stored (raw arrays, or the
+            // chunks and index of a version 3 capture; the host decodes them)
+            uint32_t total_size = sizeof(FlashStorage::CaptureHeader) + payload_size;
+            
+            printf("START %lu\n", static_cast<unsigned long>(total_size));
+            fflush(stdout);
+            
+            fwrite(&header, sizeof(FlashStorage::CaptureHeader), 1, stdout);
+            fwrite(payload, 1, payload_size, stdout);
+            
+            fflush(stdout);
+            
+            printf("END\n");
             return;
         }
         
-        // Calculate total size (header + raw samples + filtered samples if present)
-        uint32_t raw_data_size = header.sample_count * sizeof(uint16_t);
-        uint32_t filtered_data_size = (header.version >= 2 && header.has_filtered) ? raw_data_size : 0;
-        uint32_t total_size = sizeof(FlashStorage::CaptureHeader) + raw_data_size + filtered_data_size;
+        uint32_t chunk_count = FlashStorage::get_chunk_count(payload, payload_size);
+        if (header.version < 3 || chunk_count == 0 || header.sample_rate == 0) {
+            printf("ERROR: Capture %d has no chunk index\n", id);
+            return;
+        }
         
-        printf("START %lu\n", static_cast<unsigned long>(total_size));
-        fflush(stdout);
+        // Chunks are CHUNK_SAMPLES long, so the range maps straight to them
+        uint64_t from_sample = static_cast<uint64_t>(from_ms) * header.sample_rate / 1000;
+        uint64_t to_sample = (static_cast<uint64_t>(to_ms) * header.sample_rate + 999) / 1000;
+        uint32_t first = static_cast<uint32_t>(from_sample / FlashStorage::CHUNK_SAMPLES);
+        uint64_t last = (to_sample - 1) / FlashStorage::CHUNK_SAMPLES;
+        if (first >= chunk_count) {
+            printf("ERROR: Range starts after the capture ends\n");
+            return;
+        }
+        if (last >= chunk_count) {
+            last = chunk_count - 1;
+        }
+        uint32_t selected = static_cast<uint32_t>(last) - first + 1;
         
-        // Send header
-        fwrite(&header, sizeof(FlashStorage::CaptureHeader), 1, stdout);
+        // Check the chunks before sending anything. They are stored back
+        // to back, so they go out as one span with the offsets rebased
+        FlashStorage::ChunkHeader chunk;
+        const uint8_t* coded;
+        uint32_t base = 0;
+        uint32_t span = 0;
+        uint32_t crc = Crc32::INIT;
+        header.sample_count = 0;
+        for (uint32_t c = first; c <= last; ++c) {
+            if (!FlashStorage::read_chunk(payload, payload_size, c, &chunk, &coded)) {
+                printf("ERROR: Chunk %lu of capture %d is damaged\n", static_cast<unsigned long>(c), id);
+                return;
+            }
+            uint32_t offset = static_cast<uint32_t>(coded - payload) - sizeof(chunk);
+            if (c == first) {
+                base = offset;
+            }
+            if (offset - base != span) {
+                printf("ERROR: Chunk %lu of capture %d is out of place\n", static_cast<unsigned long>(c), id);
+                return;
+            }
+            crc = Crc32::update(crc, &span, sizeof(span));
+            span += sizeof(chunk) + chunk.coded_size;
+            header.sample_count += chunk.sample_count;
+        }
         
-        // Send raw samples
-        fwrite(raw_samples, sizeof(uint16_t), header.sample_count, stdout);
+        uint32_t total_size = sizeof(header) + span + selected * sizeof(uint32_t) +
+                              sizeof(FlashStorage::IndexTrailer);
         
-        // Send filtered samples if present
-        if (filtered_samples != nullptr) {
-            fwrite(filtered_samples, sizeof(uint16_t), header.sample_count, stdout);
+        printf("START %lu\n", static_cast<unsigned long>(total_size));
+        fflush(stdout);
+        
+        fwrite(&header, sizeof(header), 1, stdout);
+        fwrite(payload + base, 1, span, stdout);
+        for (uint32_t offset = 0; offset < span; offset += sizeof(chunk) + chunk.coded_size) {
+            memcpy(&chunk, payload + base + offset, sizeof(chunk));
+            fwrite(&offset, sizeof(offset), 1, stdout);
         }
+        FlashStorage::IndexTrailer trailer;
+        trailer.chunk_count = selected;
+        trailer.crc = ~crc;
+        trailer.magic = FlashStorage::INDEX_MAGIC;
+        fwrite(&trailer, sizeof(trailer), 1, stdout);
         
         fflush(stdout);
         
@@ -115,20 +281,191 @@ void SerialCommands::handle_command(const char* cmd) {
         
     } else if (strncmp(cmd, "DELETE ", 7) == 0) {
         // Delete a capture
-        int slot = atoi(cmd + 7);
+        int id = atoi(cmd + 7);
         
-        if (FlashStorage::delete_capture(slot)) {
+        if (s_collector && s_collector->is_busy()) {
+            printf("ERROR: Collection in progress\n");
+        } else if (FlashStorage::delete_capture(id)) {
             printf("OK\n");
         } else {
-            printf("ERROR: Failed to delete slot %d\n", slot);
+            printf("ERROR: Failed to delete capture %d\n", id);
         }
         
+    } else if (strcmp(cmd, "COMPACT") == 0) {
+        // Blocks this core for ~45 ms per live sector moved
+        if (s_collector && s_collector->is_busy()) {
+            printf("ERROR: Collection in progress\n");
+        } else if (FlashStorage::compact()) {
+            printf("OK\n");
+        } else {
+            printf("ERROR: Compaction failed\n");
+        }
+        
+    } else if (strcmp(cmd, "SHOTS") == 0) {
+        if (s_detector == nullptr) {
+            printf("ERROR: Shot detection not available\n");
+            return;
+        }
+        printf("Shots: %lu (%lu load steps)\n",
+               static_cast<unsigned long>(s_detector->get_shot_count()),
+               static_cast<unsigned long>(s_detector->get_load_steps()));
+        // Oldest kept event first
+        ShotDetector::Event event;
+        for (uint32_t age = ShotConfig::EVENT_LOG_SIZE; age-- > 0;) {
+            if (s_detector->get_event(age, &event)) {
+                printf("  start %lu ms, end %lu ms, depth %u mV, recovery %u ms\n",
+                       static_cast<unsigned long>(event.start_ms), static_cast<unsigned long>(event.end_ms),
+                       event.depth_mv, event.recovery_ms);
+            }
+        }
+
+    } else if (strcmp(cmd, "SHOTS RESET") == 0) {
+        if (s_detector == nullptr) {
+            printf("ERROR: Shot detection not available\n");
+            return;
+        }
+        s_detector->reset_count();
+        printf("OK\n");
+
+    } else if (strcmp(cmd, "SPECTRUM") == 0 || strncmp(cmd, "SPECTRUM ", 9) == 0) {
+        if (s_spectrum == nullptr || !SpectrumConfig::ENABLE) {
+            printf("ERROR: Spectrum not available\n");
+            return;
+        }
+        const char* option = (cmd[8] == ' ') ? cmd + 9 : "";
+        if (option[0] == '\0' || strcmp(option, "ALL") == 0) {
+            s_spectrum->print_report(option[0] != '\0');
+        } else if (strcmp(option, "RAW") == 0) {
+            s_spectrum->set_source(SpectrumAnalyzer::Source::RAW);
+            printf("OK\n");
+        } else if (strcmp(option, "FILTERED") == 0) {
+            s_spectrum->set_source(SpectrumAnalyzer::Source::FILTERED);
+            printf("OK\n");
+        } else if (strcmp(option, "RESET") == 0) {
+            s_spectrum->request_reset();
+            printf("OK\n");
+        } else {
+            printf("ERROR: Expected SPECTRUM [ALL|RAW|FILTERED|RESET]\n");
+        }
+
+    } else if (strcmp(cmd, "STATS") == 0) {
+        // Print Core 1 stage timing
+        if (s_profiler == nullptr) {
+            printf("ERROR: Stage profiling not available\n");
+            return;
+        }
+        s_profiler->print_report(s_sampler ? s_sampler->get_sample_rate_hz() : ADCConfig::SAMPLE_RATE_HZ);
+        
+    } else if (strcmp(cmd, "STATS RESET") == 0) {
+        if (s_profiler == nullptr) {
+            printf("ERROR: Stage profiling not available\n");
+            return;
+        }
+        s_profiler->reset();
+        printf("OK\n");
+        
+    } else if (strcmp(cmd, "BENCH") == 0) {
+        // Blocks this core for a few ms; one buffer may be dropped
+        FilterBenchmark::print(FilterBenchmark::run(8));
+        
+    } else if (strcmp(cmd, "BENCH MEDIAN") == 0) {
+        // Window-size sweep; blocks this core for ~100 ms
+        FilterBenchmark::run_median_sweep(2);
+        
+    } else if (strcmp(cmd, "BENCH CRC") == 0) {
+        // 16 KB through each CRC method; blocks this core for ~10 ms
+        Crc32::run_benchmark(16 * 1024);
+        
+    } else if (strcmp(cmd, "BENCH CODEC") == 0) {
+        // 2048 sample pairs through the capture codec; blocks this core for ~10 ms
+        SampleCodec::run_benchmark(2048);
+        
+    } else if (strncmp(cmd, "RATE ", 5) == 0) {
+        // Changes the sampling rate only; the filters and the decimation
+        // chain are designed at compile time for ADCConfig::SAMPLE_RATE_HZ
+        int rate_hz = atoi(cmd + 5);
+        if (rate_hz <= 0 || s_sampler == nullptr ||
+            !reconfigure_sampler(static_cast<uint32_t>(rate_hz), s_sampler->get_pacing())) {
+            printf("ERROR: Rate not changed\n");
+            return;
+        }
+        printf("OK %lu Hz (%.2f Hz actual)\n",
+               static_cast<unsigned long>(s_sampler->get_sample_rate_hz()),
+               static_cast<double>(s_sampler->get_actual_sample_rate_hz()));
+        if (s_sampler->get_sample_rate_hz() != ADCConfig::SAMPLE_RATE_HZ) {
+            // Every designed frequency moves with the rate
+            float scale = static_cast<float>(s_sampler->get_sample_rate_hz()) / FilterConfig::LPF_SAMPLE_RATE;
+            printf("WARNING: Filters are designed for %lu Hz. At this rate the low-pass is at %.0f Hz, "
+                   "the notch at %.0f Hz, the baseline tracker %.2fx as fast and the voltage output %.1f Hz\n",
+                   static_cast<unsigned long>(ADCConfig::SAMPLE_RATE_HZ),
+                   static_cast<double>(FilterConfig::LPF_CUTOFF_HZ * scale),
+                   static_cast<double>(FilterConfig::NOTCH_CENTER_HZ * scale),
+                   static_cast<double>(scale),
+                   static_cast<double>(scale * ADCConfig::SAMPLE_RATE_HZ / DecimationConfig::LOW_RATIO));
+        }
+
+    } else if (strcmp(cmd, "PACING TIMER") == 0 || strcmp(cmd, "PACING ADC") == 0) {
+        DMAADCSampler::Pacing pacing = (strcmp(cmd + 7, "ADC") == 0) ?
+            DMAADCSampler::Pacing::ADC_CLKDIV : DMAADCSampler::Pacing::TIMER;
+        if (s_sampler == nullptr || !reconfigure_sampler(s_sampler->get_sample_rate_hz(), pacing)) {
+            printf("ERROR: Pacing not changed\n");
+            return;
+        }
+        printf("OK %s\n", DMAADCSampler::pacing_name(pacing));
+
+    } else if (strcmp(cmd, "JITTER") == 0) {
+        if (s_sampler == nullptr) {
+            printf("ERROR: Sampler not available\n");
+            return;
+        }
+        s_sampler->print_pacing_report();
+
+    } else if (strncmp(cmd, "JITTER COMPARE", 14) == 0) {
+        // Runs each pacing mode for N ms; blocks this core meanwhile, so
+        // buffers overflow and the sampler counters restart
+        int duration_ms = (cmd[14] == ' ') ? atoi(cmd + 15) : 2000;
+        if (duration_ms < 500 || duration_ms > 10000) {
+            printf("ERROR: Invalid duration (500-10000 ms)\n");
+            return;
+        }
+        if (s_sampler == nullptr) {
+            printf("ERROR: Sampler not available\n");
+            return;
+        }
+
+        DMAADCSampler::Pacing original = s_sampler->get_pacing();
+        const DMAADCSampler::Pacing modes[] = {
+            DMAADCSampler::Pacing::TIMER, DMAADCSampler::Pacing::ADC_CLKDIV
+        };
+        for (DMAADCSampler::Pacing mode : modes) {
+            if (!reconfigure_sampler(s_sampler->get_sample_rate_hz(), mode)) {
+                return;
+            }
+            sleep_ms(duration_ms);
+            s_sampler->print_pacing_report();
+        }
+        reconfigure_sampler(s_sampler->get_sample_rate_hz(), original);
+
     } else if (strcmp(cmd, "HELP") == 0) {
         printf("Available commands:\n");
-        printf("  COLLECT <seconds>  - Collect data for N seconds (1-60)\n");
+        printf("  COLLECT <seconds> [RAW] - Collect data for N seconds (streams to flash if long)\n");
+        printf("  ARM [<pre_ms> <post_ms> [<sag_mv>]] [RAW] - Capture around the next voltage sag\n");
+        printf("  DISARM             - Stop waiting for a sag\n");
         printf("  LIST               - List stored captures\n");
-        printf("  DOWNLOAD <slot>    - Download a capture\n");
-        printf("  DELETE <slot>      - Delete a capture\n");
+        printf("  DOWNLOAD <id> [<from_ms> <to_ms>] - Download a capture (or a time range of it)\n");
+        printf("  DELETE <id>        - Delete a capture\n");
+        printf("  COMPACT            - Move captures together to defragment free space\n");
+        printf("  SHOTS [RESET]      - Show shot count and recent shots (or clear the count)\n");
+        printf("  STATS [RESET]      - Show (or clear) Core 1 stage timing\n");
+        printf("  SPECTRUM [ALL]     - Averaged spectrum peaks (or every bin)\n");
+        printf("  SPECTRUM RAW|FILTERED|RESET - Spectrum source, or restart the average\n");
+        printf("  BENCH              - Float vs fixed-point filter cycles/sample\n");
+        printf("  BENCH MEDIAN       - Median cycles/sample across window sizes\n");
+        printf("  BENCH CRC          - Bitwise vs slice-by-8 vs DMA sniffer CRC-32\n");
+        printf("  BENCH CODEC        - Capture codec cycles/sample and compression\n");
+        printf("  RATE <hz>          - Set the sample rate (1000-50000)\n");
+        printf("  PACING TIMER|ADC   - Timer alarm or ADC clock divider pacing\n");
+        printf("  JITTER [COMPARE [ms]] - Sample/buffer period stats (or run both modes)\n");
         printf("  HELP               - Show this help\n");
         
     } else {
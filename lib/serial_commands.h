@@ -1,6 +1,10 @@
 #pragma once
 
 #include "data_collector.h"
+#include "stage_profiler.h"
+#include "dma_adc_sampler.h"
+#include "shot_detector.h"
+#include "spectrum_analyzer.h"
 
 /**
  * @brief Serial command handler for data collection system
@@ -10,6 +14,11 @@
  * - Listing stored captures (LIST)
  * - Downloading captures (DOWNLOAD)
  * - Deleting captures (DELETE)
+ * - Shot count and recent shot events (SHOTS)
+ * - Core 1 stage timing report (STATS)
+ * - Averaged buffer spectrum and its peaks (SPECTRUM)
+ * - Float vs fixed-point filter benchmark (BENCH)
+ * - Sample rate, pacing and jitter (RATE, PACING, JITTER)
  * - Help text (HELP)
  */
 class SerialCommands {
@@ -17,8 +26,14 @@ public:
     /**
      * @brief Initialize serial command handler
      * @param collector Reference to data collector instance
+     * @param profiler Core 1 stage profiler reported by STATS (optional)
+     * @param sampler ADC sampler for RATE/PACING/JITTER (optional)
+     * @param detector Shot detector reported by SHOTS (optional)
+     * @param spectrum Spectrum analyzer reported by SPECTRUM (optional)
      */
-    static void init(DataCollector* collector);
+    static void init(DataCollector* collector, StageProfiler* profiler = nullptr,
+                     DMAADCSampler* sampler = nullptr, ShotDetector* detector = nullptr,
+                     SpectrumAnalyzer* spectrum = nullptr);
     
     /**
      * @brief Check for and process any pending serial input
@@ -30,6 +45,10 @@ public:
     
 private:
     static DataCollector* s_collector;
+    static StageProfiler* s_profiler;
+    static DMAADCSampler* s_sampler;
+    static ShotDetector* s_detector;
+    static SpectrumAnalyzer* s_spectrum;
     static char s_cmd_buffer[64];
     static int s_cmd_len;
     
@@ -38,4 +57,10 @@ private:
      * @param cmd Null-terminated command string
      */
     static void handle_command(const char* cmd);
+
+    /**
+     * @brief Restart the sampler with a new rate/pacing (not while collecting)
+     * @return true if the sampler accepted the configuration
+     */
+    static bool reconfigure_sampler(uint32_t rate_hz, DMAADCSampler::Pacing pacing);
 };
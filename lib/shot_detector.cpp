@@ -0,0 +1,127 @@
+#include "shot_detector.h"
+#include <string.h>
+
+static constexpr float Q4_SCALE = static_cast<float>(1u << FilterConfig::LPF_STATE_BITS);
+
+// Thresholds in Q4 counts
+static constexpr int32_t mv_to_q4(uint32_t mv) {
+    return static_cast<int32_t>(mv / ADCConfig::MV_PER_COUNT * Q4_SCALE + 0.5f);
+}
+
+// ==================================================
+// Constructor & Configuration
+// ==================================================
+
+ShotDetector::ShotDetector()
+    : sample_rate_hz(0),
+      enter_q4(mv_to_q4(ShotConfig::ENTER_MV)),
+      exit_q4(mv_to_q4(ShotConfig::EXIT_MV)),
+      min_samples(1),
+      max_samples(1) {
+    set_sample_rate(ADCConfig::SAMPLE_RATE_HZ);
+    reset();
+}
+
+void ShotDetector::set_sample_rate(uint32_t rate_hz) {
+    if (rate_hz == sample_rate_hz || rate_hz == 0) {
+        return;
+    }
+    sample_rate_hz = rate_hz;
+    min_samples = rate_hz * ShotConfig::MIN_SAG_MS / 1000;
+    if (min_samples == 0) min_samples = 1;
+    max_samples = rate_hz * ShotConfig::MAX_SAG_MS / 1000;
+}
+
+void ShotDetector::reset() {
+    state = State::IDLE;
+    sample_index = 0;
+    sag_start = 0;
+    sag_detect = 0;
+    sag_peak_sample = 0;
+    sag_peak_q4 = 0;
+    sag_counted = false;
+    sag_load_step = false;
+    shot_count = 0;
+    load_steps = 0;
+    event_count = 0;
+    memset(events, 0, sizeof(events));
+}
+
+// ==================================================
+// Detection
+// ==================================================
+
+void ShotDetector::process_block(const int16_t* deviation, uint32_t n, uint32_t end_ms) {
+    uint32_t block_end = sample_index + n;
+
+    for (uint32_t i = 0; i < n; ++i) {
+        int32_t d = deviation[i];
+        uint32_t index = sample_index + i;
+
+        if (state == State::IDLE) {
+            if (d < enter_q4) {
+                continue;
+            }
+            state = State::SAG;
+            sag_start = index;
+            sag_peak_sample = index;
+            sag_peak_q4 = d;
+            sag_counted = false;
+            sag_load_step = false;
+        }
+
+        if (d > sag_peak_q4) {
+            sag_peak_q4 = d;
+            sag_peak_sample = index;
+        }
+        if (d <= exit_q4) {
+            finish_sag(index, block_end, end_ms);
+            state = State::IDLE;
+        } else if (!sag_counted && index - sag_start + 1 >= min_samples) {
+            sag_counted = true;
+            sag_detect = index;
+            shot_count++;
+        } else if (sag_counted && !sag_load_step && index - sag_start + 1 >= max_samples) {
+            // Not a shot: the level itself moved. Take the count back now
+            // rather than when (if ever) the sag ends
+            sag_load_step = true;
+            load_steps++;
+            if (shot_count > 0) shot_count--;  // Unless SHOTS RESET came mid-sag
+        }
+    }
+
+    sample_index = block_end;
+}
+
+void ShotDetector::finish_sag(uint32_t end, uint32_t block_end, uint32_t block_end_ms) {
+    if (!sag_counted || sag_load_step) {
+        return;  // Too short, or taken back as a load step
+    }
+
+    Event& event = events[event_count % ShotConfig::EVENT_LOG_SIZE];
+    event.start_sample = sag_start;
+    event.detect_sample = sag_detect;
+    event.end_sample = end;
+    event.start_ms = sample_ms(sag_start, block_end, block_end_ms);
+    event.end_ms = sample_ms(end, block_end, block_end_ms);
+    float depth_mv = sag_peak_q4 * (ADCConfig::MV_PER_COUNT / Q4_SCALE);
+    event.depth_mv = static_cast<uint16_t>(depth_mv + 0.5f);
+    event.recovery_ms = static_cast<uint16_t>((end - sag_peak_sample) * 1000 / sample_rate_hz);
+    event_count++;
+}
+
+uint32_t ShotDetector::sample_ms(uint32_t sample, uint32_t block_end, uint32_t block_end_ms) const {
+    return block_end_ms - (block_end - 1 - sample) * 1000 / sample_rate_hz;
+}
+
+// ==================================================
+// Accessors
+// ==================================================
+
+bool ShotDetector::get_event(uint32_t age, Event* event) const {
+    if (age >= event_count || age >= ShotConfig::EVENT_LOG_SIZE || event == nullptr) {
+        return false;
+    }
+    *event = events[(event_count - 1 - age) % ShotConfig::EVENT_LOG_SIZE];
+    return true;
+}
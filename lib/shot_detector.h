@@ -0,0 +1,97 @@
+#ifndef SHOT_DETECTOR_H
+#define SHOT_DETECTOR_H
+
+#include <stdint.h>
+#include "adc_config.h"
+
+// ==================================================
+// ShotDetector Class
+// Streaming shot detection on the deviation from BaselineTracker (Q4
+// counts below the baseline, as VoltageFilter::process_block writes it),
+// so the thresholds are relative and the slow drift is already gone. A
+// shot starts ShotConfig::ENTER_MV below the baseline and ends back
+// within EXIT_MV (hysteresis). A few integer operations per sample;
+// per-shot bookkeeping only at its start and end.
+// ==================================================
+
+class ShotDetector {
+public:
+    struct Event {
+        uint32_t start_sample;   // First sample ENTER_MV below the baseline
+        uint32_t detect_sample;  // Sample the shot was counted at
+        uint32_t end_sample;     // First sample back within EXIT_MV
+        uint32_t start_ms;       // Uptime of start_sample
+        uint32_t end_ms;         // Uptime of end_sample
+        uint16_t depth_mv;       // Largest deviation (battery mV)
+        uint16_t recovery_ms;    // Lowest sample to end
+    };
+
+    ShotDetector();
+
+    // Thresholds in samples follow the rate; call when it changes (cheap
+    // if it does not)
+    void set_sample_rate(uint32_t rate_hz);
+    uint32_t get_sample_rate_hz() const { return sample_rate_hz; }
+
+    // Feed n deviation samples; end_ms is the uptime of the last one.
+    // Sample numbers count from the last reset()
+    void process_block(const int16_t* deviation, uint32_t n, uint32_t end_ms);
+
+    // Shots counted since reset() / reset_count(). A sag counts once it
+    // has lasted MIN_SAG_MS (a few ms after it starts) and is taken back
+    // when it reaches MAX_SAG_MS, so a load step shows as a shot for
+    // 200 ms. Counting only finished sags would be exact but would delay
+    // every shot by its whole sag and recovery (~20 ms and more)
+    uint32_t get_shot_count() const { return shot_count; }
+    void reset_count() { shot_count = 0; }
+
+    // Finished shots since reset(); the last EVENT_LOG_SIZE are kept.
+    // get_event(0, ...) is the newest. Returns false if not kept
+    uint32_t get_event_count() const { return event_count; }
+    bool get_event(uint32_t age, Event* event) const;
+
+    // Sags that reached MAX_SAG_MS: taken back out of the shot count and
+    // not logged as shot events
+    uint32_t get_load_steps() const { return load_steps; }
+
+    bool in_shot() const { return state == State::SAG; }
+
+    // Start over: count, events and sample numbering
+    void reset();
+
+private:
+    enum class State : uint8_t {
+        IDLE,
+        SAG
+    };
+
+    State state;
+    uint32_t sample_rate_hz;
+    uint32_t sample_index;      // Next sample's number
+
+    // Q4 counts
+    int32_t enter_q4;
+    int32_t exit_q4;
+
+    uint32_t min_samples;       // MIN_SAG_MS / MAX_SAG_MS in samples
+    uint32_t max_samples;
+
+    // Shot in progress
+    uint32_t sag_start;
+    uint32_t sag_detect;
+    uint32_t sag_peak_sample;
+    int32_t sag_peak_q4;
+    bool sag_counted;
+    bool sag_load_step;
+
+    uint32_t shot_count;
+    uint32_t load_steps;
+    uint32_t event_count;
+    Event events[ShotConfig::EVENT_LOG_SIZE];
+
+    // Close the shot in progress at sample end
+    void finish_sag(uint32_t end, uint32_t block_end, uint32_t block_end_ms);
+    uint32_t sample_ms(uint32_t sample, uint32_t block_end, uint32_t block_end_ms) const;
+};
+
+#endif // SHOT_DETECTOR_H
@@ -0,0 +1,186 @@
+#include "spectrum_analyzer.h"
+#include <stdio.h>
+#include <string.h>
+#include "hardware/sync.h"
+
+// Q8 ADC counts to battery mV
+static constexpr float Q8_TO_MV = ADCConfig::MV_PER_COUNT / 256.0f;
+
+// ==================================================
+// Constructor
+// ==================================================
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+    : input_rate_hz(0),
+      input_source(Source::RAW),
+      input_full(false),
+      source(Source::RAW),
+      reset_generation(0),
+      average_rate_hz(0),
+      average_frames(0),
+      average_source(Source::RAW),
+      applied_generation(0),
+      sequence(0) {
+    memset(input, 0, sizeof(input));
+    memset(frame_q8, 0, sizeof(frame_q8));
+    memset(average_q8, 0, sizeof(average_q8));
+}
+
+const char* SpectrumAnalyzer::source_name(Source source) {
+    return (source == Source::FILTERED) ? "filtered" : "raw";
+}
+
+// ==================================================
+// Core 1 Side
+// ==================================================
+
+void SpectrumAnalyzer::offer(const uint16_t* raw, const uint16_t* filtered, uint32_t n, uint32_t rate_hz) {
+    if (!SpectrumConfig::ENABLE || input_full || n != FftQ15::SIZE) {
+        return;
+    }
+    const uint16_t* samples = (source == Source::FILTERED) ? filtered : raw;
+    if (samples == nullptr) {
+        return;
+    }
+
+    memcpy(input, samples, sizeof(input));
+    input_rate_hz = rate_hz;
+    input_source = source;
+    __dmb();  // Samples visible before the flag
+    input_full = true;
+}
+
+void SpectrumAnalyzer::set_source(Source new_source) {
+    if (new_source != source) {
+        source = new_source;
+        request_reset();
+    }
+}
+
+// ==================================================
+// Core 0 Side
+// ==================================================
+
+bool SpectrumAnalyzer::update() {
+    if (!input_full) {
+        return false;
+    }
+    __dmb();  // Flag seen before the samples
+
+    FftQ15::amplitude_spectrum(input, frame_q8);
+    uint32_t rate_hz = input_rate_hz;
+    Source frame_source = input_source;
+    __dmb();
+    input_full = false;  // Core 1 may refill input now
+
+    uint32_t generation = reset_generation;
+    bool restart = (average_frames == 0) || (generation != applied_generation) ||
+                   (rate_hz != average_rate_hz) || (frame_source != average_source);
+
+    sequence++;
+    __dmb();
+    if (restart) {
+        memcpy(average_q8, frame_q8, sizeof(average_q8));
+        average_rate_hz = rate_hz;
+        average_source = frame_source;
+        average_frames = 1;
+        applied_generation = generation;
+    } else {
+        for (uint32_t k = 0; k < FftQ15::BINS; ++k) {
+            int32_t delta = static_cast<int32_t>(frame_q8[k]) - static_cast<int32_t>(average_q8[k]);
+            average_q8[k] = static_cast<uint32_t>(static_cast<int32_t>(average_q8[k]) +
+                                                  delta / (1 << SpectrumConfig::AVERAGE_SHIFT));
+        }
+        average_frames++;
+    }
+    __dmb();
+    sequence++;
+    return true;
+}
+
+// ==================================================
+// Readers
+// ==================================================
+
+bool SpectrumAnalyzer::read(Snapshot* snapshot) const {
+    uint32_t before;
+    do {
+        before = sequence;
+        __dmb();
+        memcpy(snapshot->amplitude_q8, average_q8, sizeof(snapshot->amplitude_q8));
+        snapshot->sample_rate_hz = average_rate_hz;
+        snapshot->frames = average_frames;
+        snapshot->source = average_source;
+        __dmb();
+    } while ((before & 1) != 0 || sequence != before);
+    return snapshot->frames > 0;
+}
+
+uint32_t SpectrumAnalyzer::find_peaks(const Snapshot& snapshot, Peak* peaks, uint32_t max) {
+    uint32_t bins[SpectrumConfig::PEAK_COUNT];
+    uint32_t count = 0;
+    if (max > SpectrumConfig::PEAK_COUNT) max = SpectrumConfig::PEAK_COUNT;
+
+    // Local maxima, kept sorted strongest first
+    const uint32_t* a = snapshot.amplitude_q8;
+    for (uint32_t k = 1; k + 1 < FftQ15::BINS; ++k) {
+        if (a[k] == 0 || a[k] <= a[k - 1] || a[k] < a[k + 1]) {
+            continue;
+        }
+        uint32_t pos = count;
+        while (pos > 0 && a[bins[pos - 1]] < a[k]) pos--;
+        if (pos >= max) {
+            continue;
+        }
+        uint32_t last = (count < max) ? count : max - 1;
+        for (uint32_t i = last; i > pos; --i) bins[i] = bins[i - 1];
+        bins[pos] = k;
+        if (count < max) count++;
+    }
+
+    // Vertex of a parabola through the peak bin and its neighbours
+    float bin_hz = static_cast<float>(snapshot.sample_rate_hz) / FftQ15::SIZE;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t k = bins[i];
+        float left = static_cast<float>(a[k - 1]);
+        float centre = static_cast<float>(a[k]);
+        float right = static_cast<float>(a[k + 1]);
+        float curvature = left - 2.0f * centre + right;
+        float offset = (curvature < 0.0f) ? 0.5f * (left - right) / curvature : 0.0f;
+        peaks[i].hz = (static_cast<float>(k) + offset) * bin_hz;
+        peaks[i].amplitude_mv = centre * Q8_TO_MV;
+    }
+    return count;
+}
+
+void SpectrumAnalyzer::print_report(bool all) const {
+    static Snapshot snapshot;  // Too large for the caller's stack
+    if (!read(&snapshot)) {
+        printf("Spectrum: no data yet\n");
+        return;
+    }
+
+    printf("Spectrum: %s, %lu Hz, %lu-point Hann, %.1f Hz bins, %lu buffers averaged\n",
+           source_name(snapshot.source), static_cast<unsigned long>(snapshot.sample_rate_hz),
+           static_cast<unsigned long>(FftQ15::SIZE),
+           static_cast<double>(snapshot.sample_rate_hz) / FftQ15::SIZE,
+           static_cast<unsigned long>(snapshot.frames));
+
+    if (all) {
+        printf("  bin      Hz        mV\n");
+        for (uint32_t k = 0; k < FftQ15::BINS; ++k) {
+            printf("  %3lu  %6.1f  %8.2f\n", static_cast<unsigned long>(k),
+                   static_cast<double>(k) * snapshot.sample_rate_hz / FftQ15::SIZE,
+                   static_cast<double>(snapshot.amplitude_q8[k] * Q8_TO_MV));
+        }
+        return;
+    }
+
+    Peak peaks[SpectrumConfig::PEAK_COUNT];
+    uint32_t count = find_peaks(snapshot, peaks, SpectrumConfig::PEAK_COUNT);
+    printf("  Peaks (amplitude, battery side):\n");
+    for (uint32_t i = 0; i < count; ++i) {
+        printf("  %7.1f Hz  %7.2f mV\n", static_cast<double>(peaks[i].hz),
+               static_cast<double>(peaks[i].amplitude_mv));
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef SPECTRUM_ANALYZER_H
+#define SPECTRUM_ANALYZER_H
+
+#include <stdint.h>
+#include "adc_config.h"
+#include "fft_q15.h"
+
+// ==================================================
+// SpectrumAnalyzer Class
+// Averaged amplitude spectrum of the DMA buffers (SpectrumConfig).
+// Core 1 offers each buffer; it is copied only when Core 0 has taken
+// the previous one. Core 0 transforms it in its idle time (update()) and
+// folds it into a running average. Readers on either core get a
+// consistent copy through a sequence counter.
+// ==================================================
+
+class SpectrumAnalyzer {
+public:
+    enum class Source : uint8_t {
+        RAW,
+        FILTERED
+    };
+
+    struct Snapshot {
+        uint32_t amplitude_q8[FftQ15::BINS];  // Q8 ADC counts per bin
+        uint32_t sample_rate_hz;
+        uint32_t frames;                      // Buffers averaged since the reset
+        Source source;
+    };
+
+    struct Peak {
+        float hz;            // Interpolated between bins
+        float amplitude_mv;  // Battery side
+    };
+
+    SpectrumAnalyzer();
+
+    // Core 1: offer a buffer (raw and filtered samples of the same n);
+    // ignored unless n is FFT_SIZE and Core 0 is ready for another
+    void offer(const uint16_t* raw, const uint16_t* filtered, uint32_t n, uint32_t rate_hz);
+
+    // Core 1: choose the channel; the average restarts
+    void set_source(Source source);
+    Source get_source() const { return source; }
+
+    // Core 1: restart the average with the next buffer
+    void request_reset() { reset_generation++; }
+
+    // Core 0: transform a pending buffer into the average. Returns true if
+    // there was one
+    bool update();
+
+    // Either core: copy of the current average. Returns false before the
+    // first buffer
+    bool read(Snapshot* snapshot) const;
+
+    // Up to max strongest local maxima of a snapshot, strongest first
+    static uint32_t find_peaks(const Snapshot& snapshot, Peak* peaks, uint32_t max);
+
+    // SPECTRUM report: peaks, or every bin if all
+    void print_report(bool all) const;
+
+    static const char* source_name(Source source);
+
+private:
+    // Core 1 -> Core 0 handoff; input belongs to Core 0 while input_full
+    uint16_t input[FftQ15::SIZE];
+    uint32_t input_rate_hz;
+    Source input_source;
+    volatile bool input_full;
+    Source source;
+    volatile uint32_t reset_generation;
+
+    // Core 0 state; sequence is odd while average is being written
+    uint32_t frame_q8[FftQ15::BINS];
+    uint32_t average_q8[FftQ15::BINS];
+    uint32_t average_rate_hz;
+    uint32_t average_frames;
+    Source average_source;
+    uint32_t applied_generation;
+    volatile uint32_t sequence;
+};
+
+#endif // SPECTRUM_ANALYZER_H
@@ -0,0 +1,59 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include "hardware/sync.h"
+
+// ==================================================
+// SpscRing<T, N>: bounded FIFO from one producer core to one consumer
+// core, without locks. head is written only by the producer and tail
+// only by the consumer (free-running counters, N a power of two), so
+// plain stores and barriers are enough on the M0+. Items come out in
+// order and none is lost unless push() reports the ring full.
+// ==================================================
+
+template <typename T, uint32_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "Ring size must be a power of 2");
+
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    // Producer: false if the ring is full (item not queued)
+    bool push(const T& item) {
+        uint32_t h = head;
+        if (h - tail >= N) {
+            return false;
+        }
+        slots[h & (N - 1)] = item;
+        __dmb();  // Item before the index
+        head = h + 1;
+        return true;
+    }
+
+    // Consumer: false if empty
+    bool pop(T* item) {
+        uint32_t t = tail;
+        if (head == t) {
+            return false;
+        }
+        __dmb();  // Index before the item
+        *item = slots[t & (N - 1)];
+        __dmb();  // Item copied before the slot is handed back
+        tail = t + 1;
+        return true;
+    }
+
+    // Either side; a snapshot
+    uint32_t size() const { return head - tail; }
+    bool empty() const { return head == tail; }
+
+    static constexpr uint32_t capacity() { return N; }
+
+private:
+    T slots[N];
+    volatile uint32_t head;  // Producer
+    volatile uint32_t tail;  // Consumer
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,138 @@
+#include "stage_profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include "hardware/regs/m0plus.h"
+#include "adc_config.h"
+
+// ==================================================
+// Constructor & Counter Setup
+// ==================================================
+
+StageProfiler::StageProfiler() {
+    reset();
+}
+
+void StageProfiler::init_counter() {
+    systick_hw->csr = 0;
+    systick_hw->rvr = COUNTER_MASK;
+    systick_hw->cvr = 0;  // Any write clears the counter
+    systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+void StageProfiler::reset() {
+    memset(stages, 0, sizeof(stages));
+    for (uint32_t i = 0; i < STAGE_COUNT; ++i) {
+        stages[i].min = UINT32_MAX;
+    }
+}
+
+// ==================================================
+// Recording
+// ==================================================
+
+// Bins 0-3 hold exact values; above that each octave [2^k, 2^(k+1))
+// is split into four equal bins keyed by the two bits below the MSB
+uint32_t StageProfiler::bin_for(uint32_t cycles) {
+    if (cycles < BINS_PER_OCTAVE) {
+        return cycles;
+    }
+    uint32_t msb = 31 - __builtin_clz(cycles);
+    uint32_t sub = (cycles >> (msb - 2)) & (BINS_PER_OCTAVE - 1);
+    uint32_t bin = BINS_PER_OCTAVE + (msb - 2) * BINS_PER_OCTAVE + sub;
+    return (bin < HISTOGRAM_BINS) ? bin : HISTOGRAM_BINS - 1;
+}
+
+uint32_t StageProfiler::bin_upper_bound(uint32_t bin) {
+    if (bin < BINS_PER_OCTAVE) {
+        return bin;
+    }
+    uint32_t octave = (bin - BINS_PER_OCTAVE) / BINS_PER_OCTAVE;
+    uint32_t sub = (bin - BINS_PER_OCTAVE) % BINS_PER_OCTAVE;
+    return ((BINS_PER_OCTAVE + 1 + sub) << octave) - 1;
+}
+
+void StageProfiler::record(Stage stage, uint32_t cycles) {
+    StageData& data = stages[stage];
+    data.count++;
+    data.sum += cycles;
+    if (cycles < data.min) data.min = cycles;
+    if (cycles > data.max) data.max = cycles;
+    data.histogram[bin_for(cycles)]++;
+}
+
+// ==================================================
+// Reporting
+// ==================================================
+
+StageProfiler::Summary StageProfiler::summarize(Stage stage) const {
+    const StageData& data = stages[stage];
+    Summary summary = {0, 0, 0, 0, 0};
+    if (data.count == 0) {
+        return summary;
+    }
+
+    summary.count = data.count;
+    summary.min = data.min;
+    summary.max = data.max;
+    summary.avg = static_cast<uint32_t>(data.sum / data.count);
+
+    // Smallest bin whose cumulative count covers 99% of samples
+    uint32_t target = data.count - data.count / 100;
+    uint32_t cumulative = 0;
+    for (uint32_t bin = 0; bin < HISTOGRAM_BINS; ++bin) {
+        cumulative += data.histogram[bin];
+        if (cumulative >= target) {
+            uint32_t upper = bin_upper_bound(bin);
+            summary.p99 = (upper < data.max) ? upper : data.max;
+            break;
+        }
+    }
+    return summary;
+}
+
+const char* StageProfiler::stage_name(Stage stage) {
+    switch (stage) {
+        case STAGE_FETCH:   return "fetch";
+        case STAGE_FILTER:  return "filter";
+        case STAGE_DETECT:  return "detect";
+        case STAGE_REDUCE:  return "reduce";
+        case STAGE_COLLECT: return "collect";
+        case STAGE_SERIAL:  return "serial";
+        case STAGE_PUBLISH: return "publish";
+        case STAGE_BUFFER:  return "buffer";
+        default:            return "?";
+    }
+}
+
+void StageProfiler::print_report(uint32_t sample_rate_hz) const {
+    if (HOST_TIMER) {
+        printf("Core 1 stage timing (%s):\n", UNIT);
+    } else {
+        printf("Core 1 stage timing (%s @ %lu MHz):\n", UNIT, static_cast<unsigned long>(CYCLES_PER_US));
+    }
+    printf("  %-8s %10s %9s %9s %9s %9s\n", "stage", "count", "min", "avg", "max", "p99");
+    for (uint32_t i = 0; i < STAGE_COUNT; ++i) {
+        Summary s = summarize(static_cast<Stage>(i));
+        printf("  %-8s %10lu %9lu %9lu %9lu %9lu\n",
+               stage_name(static_cast<Stage>(i)),
+               static_cast<unsigned long>(s.count),
+               static_cast<unsigned long>(s.min) * UNITS_PER_TICK,
+               static_cast<unsigned long>(s.avg) * UNITS_PER_TICK,
+               static_cast<unsigned long>(s.max) * UNITS_PER_TICK,
+               static_cast<unsigned long>(s.p99) * UNITS_PER_TICK);
+    }
+
+    // Per-buffer work against the time one buffer takes to fill; host
+    // time says nothing about the RP2040's budget
+    if (HOST_TIMER) {
+        return;
+    }
+    const uint32_t BUDGET_US = static_cast<uint32_t>(static_cast<uint64_t>(ADCConfig::BUFFER_SIZE) * 1000000 / sample_rate_hz);
+    Summary buffer = summarize(STAGE_BUFFER);
+    printf("Buffer budget %lu us: worst %lu us (%lu.%lu%%), p99 %lu us\n",
+           static_cast<unsigned long>(BUDGET_US),
+           static_cast<unsigned long>(buffer.max / CYCLES_PER_US),
+           static_cast<unsigned long>(buffer.max / CYCLES_PER_US * 100 / BUDGET_US),
+           static_cast<unsigned long>(buffer.max / CYCLES_PER_US * 1000 / BUDGET_US % 10),
+           static_cast<unsigned long>(buffer.p99 / CYCLES_PER_US));
+}
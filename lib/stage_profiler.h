@@ -0,0 +1,103 @@
+#ifndef STAGE_PROFILER_H
+#define STAGE_PROFILER_H
+
+#include <stdint.h>
+#include "hardware/structs/systick.h"
+
+// ==================================================
+// StageProfiler Class
+// Cycle-count timing for the Core 1 processing loop. Each stage keeps
+// count/min/max/sum plus a log-scale histogram (4 bins per octave) from
+// which p99 is estimated to within one bin (~19%).
+// Timestamps come from the calling core's SysTick running on the
+// processor clock; a 24-bit down-counter wraps every 134 ms at 125 MHz,
+// so a single measured span must be shorter than that.
+// ==================================================
+
+class StageProfiler {
+public:
+    enum Stage : uint8_t {
+        STAGE_FETCH = 0,     // is_buffer_ready() + get_ready_buffer()
+        STAGE_FILTER,        // VoltageFilter::process_block (fused raw min/max/sum)
+        STAGE_DETECT,        // ShotDetector::process_block
+        STAGE_REDUCE,        // Decimation, block sums -> display statistics
+        STAGE_COLLECT,       // DataCollector::process_buffer
+        STAGE_SERIAL,        // SerialCommands::check_input()
+        STAGE_PUBLISH,       // Shared-data publish to the display core
+        STAGE_BUFFER,        // Whole buffer: fetch through release
+        STAGE_COUNT
+    };
+
+    struct Summary {
+        uint32_t count;
+        uint32_t min;
+        uint32_t avg;
+        uint32_t max;
+        uint32_t p99;
+    };
+
+    static constexpr uint32_t CPU_HZ = 125000000;  // Default RP2040 clk_sys
+    static constexpr uint32_t CYCLES_PER_US = CPU_HZ / 1000000;
+    static constexpr uint32_t COUNTER_MASK = 0x00FFFFFF;
+
+    // The host build's SysTick stand-in counts host time at CPU_HZ, so
+    // there elapsed() spans are host nanoseconds / NS_PER_TICK rather
+    // than RP2040 cycles. Reports print them as host ns and skip
+    // extrapolations to device time budgets
+#ifdef AIRSOFT_HOST_BUILD
+    static constexpr bool HOST_TIMER = true;
+#else
+    static constexpr bool HOST_TIMER = false;
+#endif
+    static constexpr uint32_t NS_PER_TICK = 1000 / CYCLES_PER_US;
+    static constexpr const char* UNIT = HOST_TIMER ? "host ns" : "cycles";
+    static constexpr uint32_t UNITS_PER_TICK = HOST_TIMER ? NS_PER_TICK : 1;
+
+    StageProfiler();
+
+    // Start SysTick free-running on the calling core (call once per core)
+    static void init_counter();
+
+    // Current counter value; pass two readings to elapsed()
+    static inline uint32_t now() { return systick_hw->cvr; }
+
+    // Cycles between two now() readings (SysTick counts down)
+    static inline uint32_t elapsed(uint32_t start, uint32_t end) {
+        return (start - end) & COUNTER_MASK;
+    }
+
+    void record(Stage stage, uint32_t cycles);
+
+    // Convenience: record the span from start until now
+    inline void record_since(Stage stage, uint32_t start) {
+        record(stage, elapsed(start, now()));
+    }
+
+    Summary summarize(Stage stage) const;
+    void reset();
+
+    // Print the stage table (serial STATS command and host replay); the
+    // buffer budget follows the sampling rate
+    void print_report(uint32_t sample_rate_hz) const;
+
+    static const char* stage_name(Stage stage);
+
+private:
+    static constexpr uint32_t BINS_PER_OCTAVE = 4;
+    static constexpr uint32_t HISTOGRAM_BINS = BINS_PER_OCTAVE * 23;  // Up to 2^24 cycles
+
+    struct StageData {
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint64_t sum;
+        uint32_t histogram[HISTOGRAM_BINS];
+    };
+
+    StageData stages[STAGE_COUNT];
+
+    static uint32_t bin_for(uint32_t cycles);
+    static uint32_t bin_upper_bound(uint32_t bin);
+};
+
+#endif // STAGE_PROFILER_H
@@ -0,0 +1,95 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdint.h>
+#include "hardware/sync.h"
+
+// ==================================================
+// TripleBuffer<T>: latest-value handoff from one producer core to one
+// consumer core, without locks.
+//
+// Three slots. The producer fills a slot that is neither the latest
+// published one nor the one the consumer holds, then publishes it; the
+// consumer claims the latest. Each index has a single writer (latest:
+// producer, reading: consumer), so no atomic read-modify-write is needed
+// (the M0+ has none). The producer never waits and never skips a
+// publish. The consumer always gets a complete snapshot, the newest at
+// the time of the call; it only retries if a publish lands between its
+// two loads of latest.
+//
+// Why a claimed slot is never written: the consumer stores reading, then
+// checks latest is unchanged; the producer stores latest, then loads
+// reading before choosing a slot. With a barrier between each store and
+// load, the producer either sees the claim or the consumer sees the new
+// latest and claims again.
+// ==================================================
+
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : latest(0), reading(0), writing(1), published(0), last_sequence(0) {
+        for (uint32_t i = 0; i < SLOTS; ++i) {
+            slots[i] = T{};
+            sequence[i] = 0;
+        }
+    }
+
+    // Producer: slot for the next snapshot. Holds whatever was published
+    // in it before, so fill every field
+    T& begin_write() {
+        uint32_t held = reading;
+        uint32_t slot = 0;
+        while (slot == latest || slot == held) slot++;
+        writing = slot;
+        return slots[slot];
+    }
+
+    // Producer: make the slot from begin_write() the latest
+    void publish() {
+        sequence[writing] = ++published;
+        __dmb();  // Contents before the index
+        latest = writing;
+        __dmb();  // Index before the next load of reading
+    }
+
+    void publish(const T& value) {
+        begin_write() = value;
+        publish();
+    }
+
+    // Consumer: the newest snapshot. The reference stays valid and
+    // unchanged until the next acquire(); fresh (optional) is set if it
+    // was published since the previous acquire()
+    const T& acquire(bool* fresh = nullptr) {
+        uint32_t slot;
+        do {
+            slot = latest;
+            reading = slot;
+            __dmb();  // Claim before the check
+        } while (latest != slot);
+        __dmb();  // Check before the contents
+
+        uint32_t seq = sequence[slot];
+        if (fresh != nullptr) {
+            *fresh = (seq != last_sequence);
+        }
+        last_sequence = seq;
+        return slots[slot];
+    }
+
+    // Snapshots published so far
+    uint32_t get_published() const { return published; }
+
+private:
+    static constexpr uint32_t SLOTS = 3;
+
+    T slots[SLOTS];
+    uint32_t sequence[SLOTS];      // Publish number of each slot's contents
+    volatile uint32_t latest;      // Written by the producer
+    volatile uint32_t reading;     // Written by the consumer
+    uint32_t writing;              // Producer only
+    volatile uint32_t published;   // Producer only; read for statistics
+    uint32_t last_sequence;        // Consumer only
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -1,91 +1,396 @@
 #include "voltage_filter.h"
-#include <string.h>
 
 // ==================================================
 // MedianFilter Implementation
 // ==================================================
 
-MedianFilter::MedianFilter() : index(0) {
-    reset();
+MedianFilter::MedianFilter() {
 }
 
 void MedianFilter::reset() {
-    for (uint32_t i = 0; i < WINDOW_SIZE; ++i) {
-        buffer[i] = 0.0f;
-    }
-    index = 0;
+    window.reset();
 }
 
 float MedianFilter::process(uint16_t raw_adc) {
-    // Add new sample to circular buffer
-    buffer[index] = static_cast<float>(raw_adc);
-    index = (index + 1) % WINDOW_SIZE;
+    return window.process(static_cast<float>(raw_adc));
+}
+
+void MedianFilter::process_block(const uint16_t* in, float* out, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        out[i] = process(in[i]);
+    }
+}
+
+// ==================================================
+// LowPassFilter Implementation
+// ==================================================
+
+LowPassFilter::LowPassFilter() : cascade(FilterConfig::LPF_DESIGN) {
+}
+
+void LowPassFilter::reset() {
+    cascade.reset();
+}
+
+float LowPassFilter::process(float input) {
+    return cascade.process(input);
+}
+
+void LowPassFilter::process_block(const float* in, float* out, uint32_t n) {
+    cascade.process_block(in, out, n);
+}
+
+// ==================================================
+// FixedMedianFilter Implementation
+// ==================================================
+
+FixedMedianFilter::FixedMedianFilter() {
+}
+
+void FixedMedianFilter::reset() {
+    window.reset();
+}
+
+uint16_t FixedMedianFilter::process(uint16_t raw_adc) {
+    return window.process(raw_adc);
+}
+
+void FixedMedianFilter::process_block(const uint16_t* in, uint16_t* out, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        out[i] = process(in[i]);
+    }
+}
+
+// ==================================================
+// FixedLowPassFilter Implementation
+// ==================================================
+
+FixedLowPassFilter::FixedLowPassFilter() {
+}
+
+void FixedLowPassFilter::reset() {
+    cascade.reset();
+}
+
+uint32_t FixedLowPassFilter::process(uint16_t input) {
+    return process_q4(static_cast<uint32_t>(input) << FilterConfig::LPF_STATE_BITS);
+}
+
+uint32_t FixedLowPassFilter::process_q4(uint32_t x_q4) {
+    return cascade.process(x_q4);
+}
+
+void FixedLowPassFilter::process_block(const uint16_t* in, uint32_t* out_q4, uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        out_q4[i] = process(in[i]);
+    }
+}
+
+// ==================================================
+// TrackingNotchFilter Implementation
+// ==================================================
+
+namespace {
+
+// Band-pass part of the notch, y = x - bp with
+// bp = gain*(x - x2) - a1*bp1 - a2*bp2 (Q28), plus the Goertzel
+// coefficient 2cos(w) (Q16) for probing the same frequency
+struct NotchEntry {
+    int32_t gain;
+    int32_t a1;
+    int32_t a2;
+    int32_t goertzel;
+};
+
+constexpr uint32_t GOERTZEL_BITS = 16;
+
+// Tracking range plus the probe steps beyond either end
+constexpr uint32_t NOTCH_RANGE_STEPS = static_cast<uint32_t>(
+    (FilterConfig::NOTCH_MAX_HZ - FilterConfig::NOTCH_MIN_HZ) / FilterConfig::NOTCH_STEP_HZ + 0.5f);
+constexpr uint32_t NOTCH_TABLE_SIZE = NOTCH_RANGE_STEPS + 1 + 2 * FilterConfig::NOTCH_PROBE_STEPS;
+constexpr uint32_t NOTCH_FIRST = FilterConfig::NOTCH_PROBE_STEPS;
+constexpr uint32_t NOTCH_LAST = NOTCH_FIRST + NOTCH_RANGE_STEPS;
+
+constexpr float notch_hz(uint32_t index) {
+    return FilterConfig::NOTCH_MIN_HZ +
+           (static_cast<float>(index) - static_cast<float>(NOTCH_FIRST)) * FilterConfig::NOTCH_STEP_HZ;
+}
+
+struct NotchTable {
+    NotchEntry entries[NOTCH_TABLE_SIZE];
+};
+
+constexpr NotchTable make_notch_table() {
+    NotchTable table{};
+    for (uint32_t i = 0; i < NOTCH_TABLE_SIZE; ++i) {
+        double hz = notch_hz(i);
+        FilterDesign::Biquad s = FilterDesign::notch(hz, FilterConfig::LPF_SAMPLE_RATE, FilterConfig::NOTCH_Q);
+        table.entries[i].gain = FilterDesign::to_q(1.0 - s.b0, FilterConfig::NOTCH_COEF_BITS);
+        table.entries[i].a1 = FilterDesign::to_q(s.a1, FilterConfig::NOTCH_COEF_BITS);
+        table.entries[i].a2 = FilterDesign::to_q(s.a2, FilterConfig::NOTCH_COEF_BITS);
+        double w = 2.0 * FilterDesign::PI * hz / FilterConfig::LPF_SAMPLE_RATE;
+        table.entries[i].goertzel = FilterDesign::to_q(2.0 * FilterDesign::cosine(w), GOERTZEL_BITS);
+    }
+    return table;
+}
+
+constexpr NotchTable NOTCH_TABLE = make_notch_table();
+
+constexpr uint32_t NOTCH_START = static_cast<uint32_t>(
+    NOTCH_FIRST + (FilterConfig::NOTCH_CENTER_HZ - FilterConfig::NOTCH_MIN_HZ) / FilterConfig::NOTCH_STEP_HZ + 0.5f);
+static_assert(NOTCH_START >= NOTCH_FIRST && NOTCH_START <= NOTCH_LAST, "NOTCH_CENTER_HZ outside the tracking range");
+
+// Smallest tone tracked, ADC counts
+constexpr float NOTCH_TRACK_MIN_COUNTS = FilterConfig::NOTCH_TRACK_MIN_MV / ADCConfig::MV_PER_COUNT;
+
+} // namespace
+
+TrackingNotchFilter::TrackingNotchFilter() {
+    reset();
+}
+
+void TrackingNotchFilter::reset() {
+    index = NOTCH_START;
+    x1_q4 = 0;
+    x2_q4 = 0;
+    bp1 = 0;
+    bp2 = 0;
+}
+
+uint32_t TrackingNotchFilter::process(uint32_t x_q4) {
+    const NotchEntry& c = NOTCH_TABLE.entries[index];
+    int32_t x = static_cast<int32_t>(x_q4);
     
-    // Copy buffer for sorting (don't modify original)
-    float sorted[WINDOW_SIZE];
-    memcpy(sorted, buffer, WINDOW_SIZE * sizeof(float));
+    int64_t acc = static_cast<int64_t>(c.gain) * ((x - x2_q4) * (1 << BP_FRAC_BITS))
+                - static_cast<int64_t>(c.a1) * bp1
+                - static_cast<int64_t>(c.a2) * bp2;
+    int32_t bp = static_cast<int32_t>((acc + (1ll << (FilterConfig::NOTCH_COEF_BITS - 1))) >> FilterConfig::NOTCH_COEF_BITS);
     
-    // Sort array
-    insertion_sort(sorted, WINDOW_SIZE);
+    x2_q4 = x1_q4;
+    x1_q4 = x;
+    bp2 = bp1;
+    bp1 = bp;
     
-    // Return median (middle value)
-    return sorted[WINDOW_SIZE / 2];
+    int32_t y = x - ((bp + (1 << (BP_FRAC_BITS - 1))) >> BP_FRAC_BITS);
+    if (y < 0) return 0;
+    if (y > static_cast<int32_t>(FilterConfig::LPF_STATE_MAX)) return FilterConfig::LPF_STATE_MAX;
+    return static_cast<uint32_t>(y);
 }
 
-void MedianFilter::insertion_sort(float* arr, uint32_t size) {
-    for (uint32_t i = 1; i < size; ++i) {
-        float key = arr[i];
-        int32_t j = i - 1;
-        
-        while (j >= 0 && arr[j] > key) {
-            arr[j + 1] = arr[j];
-            j--;
+void TrackingNotchFilter::track(const uint16_t* in, uint32_t n) {
+    if (n < 2) {
+        return;
+    }
+    
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+        sum += in[i];
+    }
+    int32_t mean = static_cast<int32_t>(sum / n);
+    
+    // Goertzel at the notch frequency and a probe either side, one pass
+    const int32_t coef[3] = {
+        NOTCH_TABLE.entries[index - FilterConfig::NOTCH_PROBE_STEPS].goertzel,
+        NOTCH_TABLE.entries[index].goertzel,
+        NOTCH_TABLE.entries[index + FilterConfig::NOTCH_PROBE_STEPS].goertzel,
+    };
+    int32_t s1[3] = {0, 0, 0};
+    int32_t s2[3] = {0, 0, 0};
+    for (uint32_t i = 0; i < n; ++i) {
+        int32_t x = static_cast<int32_t>(in[i]) - mean;
+        for (uint32_t p = 0; p < 3; ++p) {
+            int32_t s0 = x + static_cast<int32_t>((static_cast<int64_t>(coef[p]) * s1[p]) >> GOERTZEL_BITS) - s2[p];
+            s2[p] = s1[p];
+            s1[p] = s0;
         }
-        arr[j + 1] = key;
+    }
+    
+    // |X|^2; a tone of amplitude A gives about (A * n / 2)^2
+    int64_t power[3];
+    int64_t peak = 0;
+    for (uint32_t p = 0; p < 3; ++p) {
+        int64_t cross = (static_cast<int64_t>(coef[p]) * s1[p]) >> GOERTZEL_BITS;
+        power[p] = static_cast<int64_t>(s1[p]) * s1[p] + static_cast<int64_t>(s2[p]) * s2[p] - cross * s2[p];
+        if (power[p] > peak) peak = power[p];
+    }
+    int64_t min_amplitude = static_cast<int64_t>(NOTCH_TRACK_MIN_COUNTS * n / 2);
+    if (peak < min_amplitude * min_amplitude) {
+        return;  // No tone worth following
+    }
+    
+    // Vertex of a parabola through the three powers, in table steps; a
+    // probe above the centre means the tone is beyond it
+    int64_t curvature = power[0] - 2 * power[1] + power[2];
+    int64_t offset;
+    if (curvature < 0) {
+        offset = (power[0] - power[2]) * static_cast<int64_t>(FilterConfig::NOTCH_PROBE_STEPS) / (2 * curvature);
+    } else {
+        offset = (power[2] > power[0]) ? 1 : -1;
+    }
+    
+    if (offset > 0 && index < NOTCH_LAST) {
+        index++;
+    } else if (offset < 0 && index > NOTCH_FIRST) {
+        index--;
     }
 }
 
+float TrackingNotchFilter::get_center_hz() const {
+    return notch_hz(index);
+}
+
 // ==================================================
-// LowPassFilter Implementation
+// BaselineTracker Implementation
 // ==================================================
 
-LowPassFilter::LowPassFilter() : x_prev(0.0f), y_prev(0.0f) {
+BaselineTracker::BaselineTracker() : level_changes(0) {
+    reset();
 }
 
-void LowPassFilter::reset() {
-    x_prev = 0.0f;
-    y_prev = 0.0f;
+void BaselineTracker::reset() {
+    baseline = 0;
+    hold_count = 0;
+    warmup_left = FilterConfig::BASELINE_WARMUP;
 }
 
-float LowPassFilter::process(float input) {
-    // IIR filter equation; B1 is stored negative so subtract to apply +|B1| feedback
-    float output = A0 * input + A1 * x_prev - B1 * y_prev;
+int32_t BaselineTracker::process(uint32_t input_q4) {
+    int32_t x = static_cast<int32_t>(input_q4) << FRACTION_BITS;
+    int32_t delta = x - baseline;
     
-    // Update state
-    x_prev = input;
-    y_prev = output;
+    if (warmup_left > 0) {
+        // Settle on the filter's start-up output
+        baseline = (warmup_left == FilterConfig::BASELINE_WARMUP) ? x : baseline + delta / 16;
+        warmup_left--;
+        return 0;
+    } else if (-delta > (GATE << FRACTION_BITS)) {
+        // Sag in progress: hold, unless the level itself has moved
+        if (++hold_count > FilterConfig::BASELINE_MAX_HOLD) {
+            baseline = x;
+            hold_count = 0;
+            level_changes++;
+        }
+    } else {
+        hold_count = 0;
+        baseline += (delta > 0) ? delta / (1 << FilterConfig::BASELINE_UP_SHIFT)
+                                : delta / (1 << FilterConfig::BASELINE_DOWN_SHIFT);
+    }
     
-    return output;
+    return (baseline - x) >> FRACTION_BITS;
 }
 
 // ==================================================
 // VoltageFilter Implementation
 // ==================================================
 
-VoltageFilter::VoltageFilter() {
+VoltageFilter::VoltageFilter() : notch(FilterConfig::NOTCH_DESIGN) {
 }
 
 void VoltageFilter::reset() {
     median.reset();
+    notch.reset();
     lpf.reset();
+    fixed_median.reset();
+    fixed_notch.reset();
+    fixed_lpf.reset();
+    baseline.reset();
 }
 
 float VoltageFilter::process(uint16_t raw_adc) {
+    if constexpr (FilterConfig::FIXED_POINT) {
+        return static_cast<float>(process_q4(raw_adc)) * (1.0f / (1u << Q4_SHIFT));
+    }
+    
     // Stage 1: Remove spikes with median filter
     float despiked = median.process(raw_adc);
     
-    // Stage 2: Smooth noise with low-pass filter
+    // Stage 2: Notch out the interference (fixed frequency on this path)
+    if constexpr (FilterConfig::NOTCH_ENABLE) {
+        despiked = notch.process(despiked);
+    }
+    
+    // Stage 3: Smooth noise with low-pass filter
     float smoothed = lpf.process(despiked);
     
     return smoothed;
 }
+
+uint32_t VoltageFilter::process_q4(uint16_t raw_adc) {
+    if constexpr (FilterConfig::FIXED_POINT) {
+        uint32_t x_q4 = static_cast<uint32_t>(fixed_median.process(raw_adc)) << Q4_SHIFT;
+        if constexpr (FilterConfig::NOTCH_ENABLE) {
+            x_q4 = fixed_notch.process(x_q4);
+        }
+        return fixed_lpf.process_q4(x_q4);
+    }
+    
+    float smoothed = process(raw_adc);
+    float scaled = smoothed * (1u << Q4_SHIFT) + 0.5f;
+    if (scaled < 0.0f) return 0;
+    if (scaled > static_cast<float>(Q4_MAX)) return Q4_MAX;
+    return static_cast<uint32_t>(scaled);
+}
+
+void VoltageFilter::process_block(const uint16_t* in, uint16_t* out, uint32_t n, BlockStats* stats,
+                                  int16_t* deviation) {
+    if (deviation != nullptr) {
+        if (out != nullptr) {
+            process_block_impl<true, true>(in, out, deviation, n, stats);
+        } else {
+            process_block_impl<false, true>(in, out, deviation, n, stats);
+        }
+    } else if (out != nullptr) {
+        process_block_impl<true, false>(in, out, deviation, n, stats);
+    } else {
+        process_block_impl<false, false>(in, out, deviation, n, stats);
+    }
+}
+
+// One loop over the buffer: raw reduction, filter chain (inlined from
+// this translation unit), optional rounded store and optional baseline
+// deviation
+template <bool STORE, bool TRACK>
+void VoltageFilter::process_block_impl(const uint16_t* in, uint16_t* out, int16_t* deviation, uint32_t n,
+                                       BlockStats* stats) {
+    uint32_t raw_sum = 0;
+    uint16_t raw_min = 0xFFFF;
+    uint16_t raw_max = 0;
+    uint32_t filtered_q4 = 0;
+    
+    for (uint32_t i = 0; i < n; ++i) {
+        uint16_t sample = in[i];
+        raw_sum += sample;
+        if (sample < raw_min) raw_min = sample;
+        if (sample > raw_max) raw_max = sample;
+        
+        filtered_q4 = process_q4(sample);
+        
+        if constexpr (STORE) {
+            out[i] = static_cast<uint16_t>((filtered_q4 + (1u << (Q4_SHIFT - 1))) >> Q4_SHIFT);
+        }
+        if constexpr (TRACK) {
+            int32_t d = baseline.process(filtered_q4);
+            if (d > INT16_MAX) d = INT16_MAX;
+            if (d < INT16_MIN) d = INT16_MIN;
+            deviation[i] = static_cast<int16_t>(d);
+        }
+    }
+    
+    // New notch frequency applies from the next block
+    if constexpr (FilterConfig::FIXED_POINT && FilterConfig::NOTCH_ENABLE && FilterConfig::NOTCH_TRACK) {
+        fixed_notch.track(in, n);
+    }
+    
+    if (stats != nullptr) {
+        stats->raw_sum = raw_sum;
+        stats->raw_min = raw_min;
+        stats->raw_max = raw_max;
+        stats->last_filtered_q4 = filtered_q4;
+    }
+}
+
+float VoltageFilter::get_notch_hz() const {
+    if constexpr (FilterConfig::FIXED_POINT) {
+        return fixed_notch.get_center_hz();
+    }
+    return FilterConfig::NOTCH_CENTER_HZ;
+}
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include "adc_config.h"
+#include "running_median.h"
+#include "biquad_cascade.h"
 
 // ==================================================
 // MedianFilter Class
@@ -16,21 +18,21 @@ public:
     // Process a new sample and return filtered value
     float process(uint16_t raw_adc);
     
+    // Process n samples; equivalent to calling process() on each
+    void process_block(const uint16_t* in, float* out, uint32_t n);
+    
     // Reset filter state
     void reset();
     
 private:
     static constexpr uint32_t WINDOW_SIZE = FilterConfig::MEDIAN_WINDOW;
-    float buffer[WINDOW_SIZE];
-    uint32_t index;
-    
-    // Simple insertion sort for small arrays (fast for size=5)
-    void insertion_sort(float* arr, uint32_t size);
+    RunningMedian<float, WINDOW_SIZE> window;
 };
 
 // ==================================================
 // LowPassFilter Class
-// IIR Butterworth filter for smoothing noise
+// IIR Butterworth filter for smoothing noise, FilterConfig::LPF_ORDER
+// designed at compile time
 // ==================================================
 
 class LowPassFilter {
@@ -40,37 +42,198 @@ public:
     // Process a new sample and return filtered value
     float process(float input);
     
+    // Process n samples; in may equal out
+    void process_block(const float* in, float* out, uint32_t n);
+    
     // Reset filter state
     void reset();
     
 private:
-    float x_prev;  // Previous input
-    float y_prev;  // Previous output
+    BiquadCascade<FilterConfig::LPF_DESIGN.SECTIONS> cascade;
+};
+
+// ==================================================
+// FixedMedianFilter Class
+// Integer MedianFilter: identical output, no float conversion
+// ==================================================
+
+class FixedMedianFilter {
+public:
+    FixedMedianFilter();
     
-    // Coefficients for 100 Hz cutoff @ 5 kHz sample rate
-    static constexpr float A0 = FilterConfig::LPF_A0;
-    static constexpr float A1 = FilterConfig::LPF_A1;
-    static constexpr float B1 = FilterConfig::LPF_B1;
+    // Process a new sample and return the median in ADC counts
+    uint16_t process(uint16_t raw_adc);
+    
+    // Process n samples; in may equal out
+    void process_block(const uint16_t* in, uint16_t* out, uint32_t n);
+    
+    // Reset filter state
+    void reset();
+    
+private:
+    static constexpr uint32_t WINDOW_SIZE = FilterConfig::MEDIAN_WINDOW;
+    RunningMedian<uint16_t, WINDOW_SIZE> window;
+};
+
+// ==================================================
+// FixedLowPassFilter Class
+// LowPassFilter as a BiquadCascadeQ of FilterConfig::LPF_DESIGN_Q: Q16
+// coefficients, Q4 state, any LPF_ORDER. The first-order design runs in
+// 32-bit integers only. Its error against the float chain on 12-bit
+// input is below 0.5 LSB: state rounding contributes
+// <= (1/32) / (1 + a1) = 0.26 LSB, coefficient quantisation <= 0.24 LSB
+// on full-scale steps. Measured max 0.15 LSB (`airsoft-bench fixed`,
+// serial BENCH); 12-bit outputs differ by <= 1. Higher orders overshoot
+// on steps, and the output is clamped at the ADC rails where the float
+// chain is not.
+// ==================================================
+
+class FixedLowPassFilter {
+public:
+    FixedLowPassFilter();
+    
+    // Process a new sample (ADC counts) and return output in Q4 counts
+    uint32_t process(uint16_t input);
+    
+    // Same with the input already in Q4 counts (at most LPF_STATE_MAX)
+    uint32_t process_q4(uint32_t x_q4);
+    
+    // Process n samples into Q4 outputs
+    void process_block(const uint16_t* in, uint32_t* out_q4, uint32_t n);
+    
+    // Reset filter state
+    void reset();
+    
+private:
+    BiquadCascadeQ<FilterConfig::LPF_DESIGN_Q, FilterConfig::LPF_STATE_MAX> cascade;
+};
+
+// ==================================================
+// TrackingNotchFilter Class
+// Fixed-point notch (FilterConfig::NOTCH_*), Q4 counts in and out, run
+// as input minus a band-pass so the feedback state only carries the
+// interference. track() moves it toward the tone measured in a block;
+// coefficients come from a compile-time table over the tracking range.
+// ==================================================
+
+class TrackingNotchFilter {
+public:
+    TrackingNotchFilter();
+    
+    // Process a sample in Q4 counts; output clamped to 0..LPF_STATE_MAX
+    uint32_t process(uint32_t x_q4);
+    
+    // Goertzel estimate of the interference in n raw samples (ADC counts);
+    // steps the notch one NOTCH_STEP_HZ toward it
+    void track(const uint16_t* in, uint32_t n);
+    
+    float get_center_hz() const;
+    
+    // Reset filter state and return to NOTCH_CENTER_HZ
+    void reset();
+    
+private:
+    static constexpr uint32_t BP_FRAC_BITS = 8;  // Band-pass state below Q4
+    
+    uint32_t index;  // Coefficient table entry
+    int32_t x1_q4;
+    int32_t x2_q4;
+    int32_t bp1;     // Band-pass output, Q4 << BP_FRAC_BITS
+    int32_t bp2;
+};
+
+// ==================================================
+// BaselineTracker Class
+// Slow asymmetric baseline of the low-pass output, held during sags
+// (see FilterConfig::BASELINE_*). Q4 counts in; the baseline is kept
+// with 12 more fraction bits. Integer only.
+// ==================================================
+
+class BaselineTracker {
+public:
+    BaselineTracker();
+    
+    // Process a low-pass output (Q4 counts) and return the deviation,
+    // baseline minus input in Q4 counts: positive below the baseline.
+    // 0 until settled, so filter start-up transients never look like sags
+    int32_t process(uint32_t input_q4);
+    
+    uint32_t get_baseline_q4() const { return static_cast<uint32_t>(baseline >> FRACTION_BITS); }
+    bool is_held() const { return hold_count > 0; }
+    bool is_settled() const { return warmup_left == 0; }
+    
+    // Holds that outlasted BASELINE_MAX_HOLD and restarted the baseline
+    uint32_t get_level_changes() const { return level_changes; }
+    
+    // Reset tracker state (warm-up starts again)
+    void reset();
+    
+private:
+    static constexpr uint32_t FRACTION_BITS = 12;
+    static constexpr int32_t GATE = static_cast<int32_t>(
+        FilterConfig::BASELINE_GATE_MV * (1u << FilterConfig::LPF_STATE_BITS) / ADCConfig::MV_PER_COUNT + 0.5f);
+    
+    int32_t baseline;       // Q4 counts << FRACTION_BITS
+    uint32_t hold_count;    // Consecutive samples held
+    uint32_t warmup_left;
+    uint32_t level_changes;
 };
 
 // ==================================================
 // VoltageFilter Class
-// Two-stage filtering: Median → Low-pass
+// Median → notch (NOTCH_ENABLE) → low-pass, plus the baseline tracker on
+// request (process_block with a deviation output)
+// Chain selected at compile time by FilterConfig::FIXED_POINT
 // ==================================================
 
 class VoltageFilter {
 public:
     VoltageFilter();
     
-    // Process raw ADC sample through complete filter chain
+    // Process raw ADC sample through complete filter chain (ADC counts)
     float process(uint16_t raw_adc);
     
+    // Same, returning Q4 ADC counts (x16); integer-only when FIXED_POINT
+    uint32_t process_q4(uint16_t raw_adc);
+    
+    // Per-block statistics gathered in the same pass as the filter
+    struct BlockStats {
+        uint32_t raw_sum;
+        uint16_t raw_min;
+        uint16_t raw_max;
+        uint32_t last_filtered_q4;
+    };
+    
+    // Filter a whole DMA buffer in one pass. out (may be nullptr) receives
+    // the filtered samples rounded to 12-bit counts; stats may be nullptr.
+    // deviation (may be nullptr) receives BaselineTracker's output in Q4
+    // counts, clamped to int16_t; the tracker only advances on calls that
+    // ask for it.
+    void process_block(const uint16_t* in, uint16_t* out, uint32_t n, BlockStats* stats,
+                       int16_t* deviation = nullptr);
+    
+    const BaselineTracker& get_baseline() const { return baseline; }
+    
+    // Notch frequency; tracked by process_block on the fixed-point chain
+    float get_notch_hz() const;
+    
     // Reset all filter states
     void reset();
     
+    static constexpr uint32_t Q4_SHIFT = FilterConfig::LPF_STATE_BITS;
+    static constexpr uint32_t Q4_MAX = FilterConfig::LPF_STATE_MAX;
+    
 private:
     MedianFilter median;
+    BiquadCascade<1> notch;
     LowPassFilter lpf;
+    FixedMedianFilter fixed_median;
+    TrackingNotchFilter fixed_notch;
+    FixedLowPassFilter fixed_lpf;
+    BaselineTracker baseline;
+    
+    template <bool STORE, bool TRACK>
+    void process_block_impl(const uint16_t* in, uint16_t* out, int16_t* deviation, uint32_t n, BlockStats* stats);
 };
 
 #endif // VOLTAGE_FILTER_H
@@ -2,7 +2,6 @@
 #include <string.h>
 #include "pico/stdlib.h"
 #include "pico/multicore.h"
-#include "pico/sync.h"
 #include "hardware/spi.h"
 #include "hardware/gpio.h"
 #include "hardware/adc.h"
@@ -20,10 +19,12 @@
 #include "flash_storage.h"
 #include "data_collector.h"
 #include "serial_commands.h"
-#include <new>
+#include "sample_pipeline.h"
+#include "stage_profiler.h"
+#include "spectrum_analyzer.h"
+#include "triple_buffer.h"
+#include "event_queue.h"
 
-// Pre-computed constants for ADC conversion (optimization for ARM Cortex-M0+)
-static constexpr float ADC_TO_VOLTAGE_SCALE = (ADCConfig::ADC_VREF * 1000.0f * ADCConfig::VDIV_RATIO * ADCConfig::ADC_CALIBRATION) / (1 << ADCConfig::ADC_BITS);
 // --- Pin assignments ---
 // Display pins (SPI1)
 #define PIN_SPI_SCK     14
@@ -48,35 +49,66 @@ typedef struct {
     float raw_adc_voltage_mv;
     uint16_t raw_min_adc;
     uint16_t raw_max_adc;
-    bool data_updated;
     // Live core metrics
     uint32_t core1_uptime_ms;
     float core1_loop_hz;
     uint32_t debug_counter; // Debug: increments in Core 1 loop
-    uint32_t fallback_counter; // Debug: always increments regardless of mutex
     // DMA sampling statistics
     uint32_t dma_buffer_count;   // Total buffers processed
     uint32_t dma_overflow_count; // Buffer overflow count (data loss)
     uint32_t samples_processed;  // Total samples processed through filter
     uint32_t dma_irq_count;      // Total DMA IRQs serviced
     uint32_t dma_timer_count;    // Total ADC timer triggers
+    // Core 1 stage timing (refreshed once per second)
+    uint32_t stage_avg_us[StageProfiler::STAGE_COUNT];
+    uint32_t stage_p99_us[StageProfiler::STAGE_COUNT];
+    float buffer_load_pct;       // Worst buffer processing time vs buffer period
 } shared_data_t;
 
-// Global shared data and mutex
-volatile shared_data_t g_shared_data = {0};
-mutex_t g_data_mutex;
+// Core 1 publishes a snapshot every loop; Core 0 takes the newest per
+// frame. Neither side waits for the other
+static TripleBuffer<shared_data_t> g_shared_data;
 
 // Data collection globals
 static DataCollector g_data_collector;
 
+// Core 1 stage timing (read by the STATS command)
+static StageProfiler g_stage_profiler;
+
+// Buffer spectrum: offered by Core 1, transformed by Core 0 between frames
+static SpectrumAnalyzer g_spectrum;
+
+// Shots, captures and battery alarms from Core 1; each one wakes Core 0
+// for an immediate frame
+static EventQueue g_events;
+
 // --- Core 0 Functions (Display & UI) ---
 
+// Stage timing page labels, indexed by StageProfiler::Stage
+static const char* const STAGE_LABELS[StageProfiler::STAGE_COUNT] = {
+    "FET ", "FLT ", "SHT ", "RED ", "COL ", "SER ", "PUB ", "BUF "
+};
+
+// Metrics, stage timing and spectrum pages rotate on this period
+static constexpr uint32_t DISPLAY_PAGE_MS = 4000;
+static constexpr uint32_t DISPLAY_PAGE_COUNT = SpectrumConfig::DISPLAY_PAGE ? 3 : 2;
+
+// log2(value) in quarter octaves (0 for 0), for the spectrum bars
+static uint32_t log2_q2(uint32_t value) {
+    if (value == 0) return 0;
+    uint32_t msb = 31;
+    while ((value & (1u << msb)) == 0) msb--;
+    uint32_t fraction = (msb >= 2) ? ((value >> (msb - 2)) & 3) : ((value << (2 - msb)) & 3);
+    return msb * 4 + fraction;
+}
+
 // Volatile flag set by timer interrupt to trigger display update
 volatile bool g_display_update_flag = false;
 
 // Timer callback to set display update flag
 bool display_update_timer_callback(repeating_timer_t *rt) {
     g_display_update_flag = true;
+    __sev();  // A tick landing just before Core 0's WFE still wakes it
     return true; // keep repeating
 }
 void display_main() {
@@ -119,6 +151,12 @@ void display_main() {
     uint32_t core0_display_count = 0;
     float core0_display_hz = 0.0f;
     absolute_time_t last_metrics_time = core0_start_time;
+
+    // Bottom-row banner: a capture for BANNER_MS, else low battery until
+    // it clears
+    char banner[20] = "";
+    absolute_time_t banner_until = core0_start_time;
+    uint32_t low_battery_mv = 0;
     
     // Set up a repeating timer for display updates (16.67ms = 60Hz)
     repeating_timer_t display_timer;
@@ -132,101 +170,170 @@ void display_main() {
         absolute_time_t current_time = get_absolute_time();
         int64_t us_since_update = absolute_time_diff_us(last_display_update, current_time);
         
-        if (!g_display_update_flag && us_since_update < 100000) {
-            tight_loop_contents();
+        if (!g_display_update_flag && !g_events.pending() && us_since_update < 100000) {
+            // Idle time between frames goes to the spectrum, then sleep
+            // until the next tick or event
+            if (!g_spectrum.update()) {
+                g_events.wait();
+            }
             continue;
         }
         g_display_update_flag = false;
         last_display_update = current_time;
 
-        // Read shared data from Core 1 (with mutex protection)
-        bool data_available = false;
-        
-        // Always read fallback counter (no mutex needed for atomic read)
-        local_data.fallback_counter = g_shared_data.fallback_counter;
-        
-        if (mutex_try_enter(&g_data_mutex, NULL)) {
-            if (g_shared_data.data_updated) {
-                // Copy volatile data to local structure field by field
-                local_data.current_voltage_mv = g_shared_data.current_voltage_mv;
-                local_data.shot_count = g_shared_data.shot_count;
-                local_data.moving_average_mv = g_shared_data.moving_average_mv;
-                local_data.filtered_voltage_adc = g_shared_data.filtered_voltage_adc;
-                local_data.raw_avg_adc = g_shared_data.raw_avg_adc;
-                local_data.raw_adc_voltage_mv = g_shared_data.raw_adc_voltage_mv;
-                local_data.raw_min_adc = g_shared_data.raw_min_adc;
-                local_data.raw_max_adc = g_shared_data.raw_max_adc;
-                local_data.data_updated = g_shared_data.data_updated;
-                local_data.core1_uptime_ms = g_shared_data.core1_uptime_ms;
-                local_data.core1_loop_hz = g_shared_data.core1_loop_hz;
-                local_data.debug_counter = g_shared_data.debug_counter;
-                local_data.dma_buffer_count = g_shared_data.dma_buffer_count;
-                local_data.dma_overflow_count = g_shared_data.dma_overflow_count;
-                local_data.samples_processed = g_shared_data.samples_processed;
-                local_data.dma_irq_count = g_shared_data.dma_irq_count;
-                local_data.dma_timer_count = g_shared_data.dma_timer_count;
-                g_shared_data.data_updated = false;
-                data_available = true;
+        // Events since the last frame, in order. The snapshot below was
+        // published before they were posted, so it already shows them
+        CoreEvent event;
+        while (g_events.poll(&event)) {
+            switch (event.type) {
+                case CoreEvent::Type::SHOT:
+                case CoreEvent::Type::SHOTS_DOWN:
+                    break;
+                case CoreEvent::Type::CAPTURE_DONE:
+                    snprintf(banner, sizeof(banner), "CAP %lu SAVED", static_cast<unsigned long>(event.value));
+                    banner_until = make_timeout_time_ms(EventConfig::BANNER_MS);
+                    break;
+                case CoreEvent::Type::LOW_BATTERY:
+                    low_battery_mv = event.value;
+                    break;
+                case CoreEvent::Type::BATTERY_OK:
+                    low_battery_mv = 0;
+                    break;
             }
-            mutex_exit(&g_data_mutex);
         }
+
+        // Newest snapshot from Core 1 (one consistent copy)
+        bool data_available = false;
+        local_data = g_shared_data.acquire(&data_available);
         display.clearDisplay(); // Clear display buffer
         // Draw the wave animation demo (one frame per update)
         // wave_demo_frame(display);
 
-        // ==================================================
-        // Metrics Display: DMA Sampling Statistics
-        // ==================================================
-
-        uint8_t row_height = display.getFontHeight() + 4;
-        uint8_t y = 4;  // Start with 4px padding at top for consistent spacing
-        char metric_str[32];
-
-        // DMA buffer statistics
-        snprintf(metric_str, sizeof(metric_str), "BUF: %lu", local_data.dma_buffer_count);
-        display.drawString(0, y, metric_str);
-        y += row_height;
-
-        snprintf(metric_str, sizeof(metric_str), "OVF: %lu", local_data.dma_overflow_count);
-        display.drawString(0, y, metric_str);
-        y += row_height;
-
-        snprintf(metric_str, sizeof(metric_str), "SMP: %lu", local_data.samples_processed);
-        display.drawString(0, y, metric_str);
-        y += row_height;
-
-    snprintf(metric_str, sizeof(metric_str), "IRQ: %lu", local_data.dma_irq_count);
-    display.drawString(0, y, metric_str);
-    y += row_height;
-
-    snprintf(metric_str, sizeof(metric_str), "TMR: %lu", local_data.dma_timer_count);
-    display.drawString(0, y, metric_str);
-    y += row_height;
-
-    float voltage_v = local_data.current_voltage_mv * 0.001f;
-    if (voltage_v < 0.0f) voltage_v = 0.0f;
-    if (voltage_v > 99.99f) voltage_v = 99.99f;
-    snprintf(metric_str, sizeof(metric_str), "VOL: %05.2fV", voltage_v);
-        display.drawString(0, y, metric_str);
-        y += row_height;
-
-        float adc_voltage_v = local_data.raw_adc_voltage_mv * 0.001f;
-        if (adc_voltage_v < 0.0f) adc_voltage_v = 0.0f;
-        if (adc_voltage_v > ADCConfig::ADC_VREF) adc_voltage_v = ADCConfig::ADC_VREF;
-        snprintf(metric_str, sizeof(metric_str), "ADC: %05.2fV", adc_voltage_v);
-        display.drawString(0, y, metric_str);
-        y += row_height;
-
-        snprintf(metric_str, sizeof(metric_str), "RAW: %05.0f", local_data.raw_avg_adc);
-        display.drawString(0, y, metric_str);
-        y += row_height;
+        uint32_t page = (to_ms_since_boot(current_time) / DISPLAY_PAGE_MS) % DISPLAY_PAGE_COUNT;
+        if (page == 2) {
+            // ==================================================
+            // Spectrum Display: one column per bin from 0 Hz, log scale
+            // (a quarter octave per 2 px), strongest peak on top
+            // ==================================================
+
+            static SpectrumAnalyzer::Snapshot spectrum_snapshot;  // ~1 KB, off the stack
+            char metric_str[32];
+            uint8_t graph_top = display.getFontHeight() + 6;
+            uint8_t graph_bottom = display.getHeight() - 1;
+
+            if (g_spectrum.read(&spectrum_snapshot)) {
+                SpectrumAnalyzer::Peak peak;
+                if (SpectrumAnalyzer::find_peaks(spectrum_snapshot, &peak, 1) == 1) {
+                    snprintf(metric_str, sizeof(metric_str), "%4.0fHz %5.1fmV", peak.hz, peak.amplitude_mv);
+                } else {
+                    snprintf(metric_str, sizeof(metric_str), "FFT: flat");
+                }
+                display.drawString(0, 4, metric_str);
+
+                // 1/16 count (Q8 16) sits on the axis
+                uint32_t max_height = graph_bottom - graph_top;
+                uint32_t columns = display.getWidth();
+                if (columns > FftQ15::BINS) columns = FftQ15::BINS;
+                for (uint32_t x = 0; x < columns; ++x) {
+                    uint32_t level = log2_q2(spectrum_snapshot.amplitude_q8[x]);
+                    uint32_t height = (level > 16) ? (level - 16) * 2 : 0;
+                    if (height > max_height) height = max_height;
+                    if (height > 0) {
+                        display.drawLine(x, graph_bottom, x, graph_bottom - height);
+                    }
+                }
+            } else {
+                display.drawString(0, 4, "FFT: waiting");
+            }
+        } else if (page == 1) {
+            // ==================================================
+            // Stage Timing Display: Core 1 per-stage avg/p99 (us)
+            // ==================================================
+
+            uint8_t row_height = display.getFontHeight() + 4;
+            uint8_t y = 4;
+            char metric_str[32];
+
+            display.drawString(0, y, "STG   AVG   P99");
+            y += row_height;
+
+            for (uint32_t i = 0; i < StageProfiler::STAGE_COUNT; ++i) {
+                snprintf(metric_str, sizeof(metric_str), "%s%5lu %5lu",
+                         STAGE_LABELS[i],
+                         static_cast<unsigned long>(local_data.stage_avg_us[i]),
+                         static_cast<unsigned long>(local_data.stage_p99_us[i]));
+                display.drawString(0, y, metric_str);
+                y += row_height;
+            }
 
-        snprintf(metric_str, sizeof(metric_str), "MN:%4u MX:%4u", local_data.raw_min_adc, local_data.raw_max_adc);
-        display.drawString(0, y, metric_str);
-        y += row_height;
+            snprintf(metric_str, sizeof(metric_str), "LOAD: %4.1f%%", local_data.buffer_load_pct);
+            display.drawString(0, y, metric_str);
+        } else {
+            // ==================================================
+            // Metrics Display: DMA Sampling Statistics
+            // ==================================================
+
+            uint8_t row_height = display.getFontHeight() + 4;
+            uint8_t y = 4;  // Start with 4px padding at top for consistent spacing
+            char metric_str[32];
+
+            // DMA buffer statistics
+            snprintf(metric_str, sizeof(metric_str), "BUF: %lu", local_data.dma_buffer_count);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            snprintf(metric_str, sizeof(metric_str), "OVF: %lu", local_data.dma_overflow_count);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            snprintf(metric_str, sizeof(metric_str), "SMP: %lu", local_data.samples_processed);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            snprintf(metric_str, sizeof(metric_str), "IRQ: %lu", local_data.dma_irq_count);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            snprintf(metric_str, sizeof(metric_str), "TMR: %lu", local_data.dma_timer_count);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            float voltage_v = local_data.current_voltage_mv * 0.001f;
+            if (voltage_v < 0.0f) voltage_v = 0.0f;
+            if (voltage_v > 99.99f) voltage_v = 99.99f;
+            snprintf(metric_str, sizeof(metric_str), "VOL: %05.2fV", voltage_v);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            float adc_voltage_v = local_data.raw_adc_voltage_mv * 0.001f;
+            if (adc_voltage_v < 0.0f) adc_voltage_v = 0.0f;
+            if (adc_voltage_v > ADCConfig::ADC_VREF) adc_voltage_v = ADCConfig::ADC_VREF;
+            snprintf(metric_str, sizeof(metric_str), "ADC: %05.2fV", adc_voltage_v);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            snprintf(metric_str, sizeof(metric_str), "RAW: %05.0f", local_data.raw_avg_adc);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            snprintf(metric_str, sizeof(metric_str), "MN:%4u MX:%4u", local_data.raw_min_adc, local_data.raw_max_adc);
+            display.drawString(0, y, metric_str);
+            y += row_height;
+
+            snprintf(metric_str, sizeof(metric_str), "SHT: %lu", local_data.shot_count);
+            display.drawString(0, y, metric_str);
+        }
 
-        snprintf(metric_str, sizeof(metric_str), "SHT: %lu", local_data.shot_count);
-        display.drawString(0, y, metric_str);
+        bool show_banner = absolute_time_diff_us(current_time, banner_until) > 0;
+        if (!show_banner && low_battery_mv > 0) {
+            snprintf(banner, sizeof(banner), "LOW BAT %4.1fV", low_battery_mv * 0.001f);
+            show_banner = true;
+        }
+        if (show_banner) {
+            uint8_t banner_y = display.getHeight() - display.getFontHeight() - 2;
+            display.fillRect(0, banner_y - 2, display.getWidth(), display.getFontHeight() + 4, false);
+            display.drawString(0, banner_y, banner);
+        }
 
         display.display();
 
@@ -259,9 +366,6 @@ int main() {
     watchdog_enable(2000, 1);
     printf("Starting Airsoft Display System...\n");
     
-    // Initialize mutex
-    mutex_init(&g_data_mutex);
-
     // Prepare current core to participate in lockouts when necessary
     multicore_lockout_victim_init();
 
@@ -276,21 +380,35 @@ int main() {
     FlashStorage::init();
     printf("Core 1: Flash storage initialized\n");
     
+    // Initialize DMA ADC sampler with 5 kHz sampling
+    // (static: the aligned ring buffers do not belong on the stack)
+    static DMAADCSampler dma_sampler;
+    
+    // Initialize sample pipeline (median + low-pass filter, shot detection,
+    // buffer statistics); static so its filtered scratch buffer stays off
+    // the stack
+    static SamplePipeline pipeline;
+    
     // Initialize serial command handler
-    SerialCommands::init(&g_data_collector);
+    SerialCommands::init(&g_data_collector, &g_stage_profiler, &dma_sampler, &pipeline.get_shot_detector(), &g_spectrum);
     printf("Core 1: Serial commands initialized (type HELP for commands)\n");
     
-    // Initialize DMA ADC sampler with 5 kHz sampling
-    DMAADCSampler dma_sampler;
     if (!dma_sampler.init()) {
         printf("Core 1: Failed to initialize DMA sampler!\n");
         while (1) sleep_ms(1000);
     }
     dma_sampler.start();
-    printf("Core 1: DMA sampler started at 5 kHz\n");
+    printf("Core 1: DMA sampler started at %lu Hz (%s)\n",
+           static_cast<unsigned long>(dma_sampler.get_sample_rate_hz()),
+           DMAADCSampler::pacing_name(dma_sampler.get_pacing()));
     
-    // Initialize voltage filter (median + low-pass)
-    VoltageFilter voltage_filter;
+    // Start this core's SysTick for per-stage cycle timing
+    StageProfiler::init_counter();
+    pipeline.set_profiler(&g_stage_profiler);
+    pipeline.set_spectrum(&g_spectrum);
+    uint32_t stage_avg_us[StageProfiler::STAGE_COUNT] = {0};
+    uint32_t stage_p99_us[StageProfiler::STAGE_COUNT] = {0};
+    float buffer_load_pct = 0.0f;
     
     // Initialize status LED
     gpio_init(PIN_STATUS_LED);
@@ -304,96 +422,40 @@ int main() {
     uint32_t core1_loop_count = 0;
     float core1_loop_hz = 0.0f;
     uint32_t core1_last_debug_log_ms = 0;
-    
-    // Sample processing variables
-    uint32_t total_samples_processed = 0;
-    float last_filtered_value = 0.0f;
-    float accumulated_voltage_mv = 0.0f;
-    uint32_t voltage_sample_count = 0;
-    float last_avg_voltage_mv = 0.0f;
-    float last_raw_avg = 0.0f;
-    float last_raw_adc_mv = 0.0f;
-    uint16_t last_raw_min = 0;
-    uint16_t last_raw_max = 0;
+
+    // Event edges already posted to Core 0
+    uint32_t posted_shot_count = 0;
+    bool capture_busy = false;
+    bool battery_low = false;
     
     // Core 1 main loop: Data Acquisition & Processing
     while (true) {
         // Check if a DMA buffer is ready for processing
+        uint32_t fetch_start = StageProfiler::now();
         bool buffer_ready = dma_sampler.is_buffer_ready();
         if (buffer_ready) {
             uint32_t buffer_size = 0;
             const uint16_t* buffer = dma_sampler.get_ready_buffer(&buffer_size);
             
             if (buffer != nullptr && buffer_size > 0) {
-                uint32_t raw_sum = 0;
-                uint16_t raw_min = 0xFFFF;
-                uint16_t raw_max = 0;
-                
-                // Temporary buffer for filtered samples (only allocated if collecting)
-                uint16_t* filtered_buffer = nullptr;
-                if (g_data_collector.is_collecting()) {
-                    filtered_buffer = new (std::nothrow) uint16_t[buffer_size];
-                }
-
-                // Process all samples in the buffer through the filter chain
-                for (uint32_t i = 0; i < buffer_size; ++i) {
-                    uint16_t sample = buffer[i];
-                    raw_sum += sample;
-                    if (sample < raw_min) raw_min = sample;
-                    if (sample > raw_max) raw_max = sample;
-                    
-                    // Filter the raw ADC sample
-                    float filtered_adc = voltage_filter.process(sample);
-                    last_filtered_value = filtered_adc;
-                    
-                    // Store filtered sample for data collection (scaled back to uint16_t)
-                    if (filtered_buffer != nullptr) {
-                        // Clamp to 12-bit range and round
-                        float clamped = (filtered_adc < 0.0f) ? 0.0f : 
-                                       (filtered_adc > ADCConfig::ADC_MAX) ? static_cast<float>(ADCConfig::ADC_MAX) : 
-                                       filtered_adc;
-                        filtered_buffer[i] = static_cast<uint16_t>(clamped + 0.5f);
-                    }
-                    
-                    // Convert to voltage (millivolts) using pre-computed combined scale factor
-                    float voltage_mv = filtered_adc * ADC_TO_VOLTAGE_SCALE;
-                    
-                    // Accumulate for moving average
-                    accumulated_voltage_mv += voltage_mv;
-                    voltage_sample_count++;
-                    
-                    total_samples_processed++;
-                }
-
-                float buffer_avg = static_cast<float>(raw_sum) / static_cast<float>(buffer_size);
-                last_raw_avg = buffer_avg;
-                last_raw_min = raw_min;
-                last_raw_max = raw_max;
-                last_raw_adc_mv = (buffer_avg / static_cast<float>(ADCConfig::ADC_MAX)) * ADCConfig::ADC_VREF * ADCConfig::ADC_CALIBRATION * 1000.0f;
-                
-                // If collecting data, feed buffers to collector
-                if (g_data_collector.is_collecting()) {
-                    g_data_collector.process_buffer(buffer, filtered_buffer, buffer_size);
-                }
+                g_stage_profiler.record_since(StageProfiler::STAGE_FETCH, fetch_start);
                 
-                // Clean up temporary filtered buffer
-                if (filtered_buffer != nullptr) {
-                    delete[] filtered_buffer;
-                }
+                // Filter, gather statistics and feed the collector
+                pipeline.process_buffer(buffer, buffer_size, &g_data_collector);
                 
                 // Release the buffer back to DMA
                 dma_sampler.release_buffer();
+                g_stage_profiler.record_since(StageProfiler::STAGE_BUFFER, fetch_start);
             }
         }
         
-        // Debug: Print message after collection completes
-        static bool was_collecting = false;
-        bool is_collecting_now = g_data_collector.is_collecting();
-        // Removed debug message for consistency
-        was_collecting = is_collecting_now;
-        
         // Check for serial input commands
+        uint32_t serial_start = StageProfiler::now();
         SerialCommands::check_input();
+        g_stage_profiler.record_since(StageProfiler::STAGE_SERIAL, serial_start);
+
+        // A capture that just started gets its raw samples straight from DMA
+        g_data_collector.attach_dma(&dma_sampler);
         
         // Calculate uptime and loop frequency every second
         uint32_t core1_uptime_ms = absolute_time_diff_us(core1_start_time, get_absolute_time()) / 1000;
@@ -403,6 +465,15 @@ int main() {
             core1_loop_hz = core1_loop_count / ((core1_uptime_ms - core1_last_metrics_time_ms) / 1000.0f);
             core1_loop_count = 0;
             core1_last_metrics_time_ms = core1_uptime_ms;
+
+            // Refresh the stage timing summary shown on the display
+            for (uint32_t i = 0; i < StageProfiler::STAGE_COUNT; ++i) {
+                StageProfiler::Summary summary = g_stage_profiler.summarize(static_cast<StageProfiler::Stage>(i));
+                stage_avg_us[i] = summary.avg / StageProfiler::CYCLES_PER_US;
+                stage_p99_us[i] = summary.p99 / StageProfiler::CYCLES_PER_US;
+            }
+            StageProfiler::Summary buffer_summary = g_stage_profiler.summarize(StageProfiler::STAGE_BUFFER);
+            buffer_load_pct = 100.0f * buffer_summary.max / StageProfiler::CYCLES_PER_US / (ADCConfig::BUFFER_SIZE * 1000000.0f / dma_sampler.get_sample_rate_hz());
         }
 
         // Debug logging disabled to reduce serial clutter
@@ -422,9 +493,9 @@ int main() {
                    dma_sampler.get_overflow_count(),
                    dma_sampler.get_irq_count(),
                    dma_sampler.get_timer_trigger_count(),
-                   total_samples_processed,
+                   pipeline.get_total_samples_processed(),
                    core1_loop_hz,
-                   last_avg_voltage_mv);
+                   pipeline.get_voltage_mv());
             printf("      fifo=%u dma_busy=%d dma_rem=%lu adc_fcs=0x%08lx adc_cs=0x%08lx\n",
                    fifo_level,
                    dma_busy,
@@ -434,46 +505,70 @@ int main() {
         }
         */
         
-        // Update shared data (with mutex protection)
-        if (mutex_try_enter(&g_data_mutex, NULL)) {
-            // Calculate moving average voltage from accumulated samples
-            float avg_voltage_mv = last_avg_voltage_mv;
-            if (voltage_sample_count > 0) {
-                avg_voltage_mv = accumulated_voltage_mv / voltage_sample_count;
-                last_avg_voltage_mv = avg_voltage_mv;
-            }
+        // Publish a snapshot for Core 0 (never blocks, never skipped)
+        uint32_t publish_start = StageProfiler::now();
+        {
+            // 10 Hz output of the pipeline's decimation chain
+            float avg_voltage_mv = pipeline.get_voltage_mv();
+
+            // The slot holds an older snapshot: every field is written
+            shared_data_t& shared = g_shared_data.begin_write();
 
             // Add diode drop to show true battery voltage (pre-diode)
-            g_shared_data.current_voltage_mv = avg_voltage_mv + ADCConfig::DIODE_DROP_MV;
-            g_shared_data.moving_average_mv = avg_voltage_mv + ADCConfig::DIODE_DROP_MV;
-            g_shared_data.filtered_voltage_adc = last_filtered_value;
-            g_shared_data.core1_uptime_ms = core1_uptime_ms;
-            g_shared_data.core1_loop_hz = core1_loop_hz;
-            g_shared_data.debug_counter++;
-            g_shared_data.dma_buffer_count = dma_sampler.get_buffer_count();
-            g_shared_data.dma_overflow_count = dma_sampler.get_overflow_count();
-            g_shared_data.samples_processed = total_samples_processed;
-            g_shared_data.dma_irq_count = dma_sampler.get_irq_count();
-            g_shared_data.dma_timer_count = dma_sampler.get_timer_trigger_count();
-            g_shared_data.raw_avg_adc = last_raw_avg;
-            g_shared_data.raw_adc_voltage_mv = last_raw_adc_mv;
-            g_shared_data.raw_min_adc = last_raw_min;
-            g_shared_data.raw_max_adc = last_raw_max;
-            g_shared_data.data_updated = true;
-            
-            // Reset accumulators after updating shared data
-            accumulated_voltage_mv = 0.0f;
-            voltage_sample_count = 0;
-            
-            mutex_exit(&g_data_mutex);
+            shared.current_voltage_mv = avg_voltage_mv + ADCConfig::DIODE_DROP_MV;
+            shared.moving_average_mv = avg_voltage_mv + ADCConfig::DIODE_DROP_MV;
+            shared.filtered_voltage_adc = pipeline.get_last_filtered_value();
+            shared.shot_count = pipeline.get_shot_detector().get_shot_count();
+            shared.core1_uptime_ms = core1_uptime_ms;
+            shared.core1_loop_hz = core1_loop_hz;
+            shared.debug_counter = loop_counter;
+            shared.dma_buffer_count = dma_sampler.get_buffer_count();
+            shared.dma_overflow_count = dma_sampler.get_overflow_count();
+            shared.samples_processed = pipeline.get_total_samples_processed();
+            shared.dma_irq_count = dma_sampler.get_irq_count();
+            shared.dma_timer_count = dma_sampler.get_timer_trigger_count();
+            shared.raw_avg_adc = pipeline.get_last_raw_avg();
+            shared.raw_adc_voltage_mv = pipeline.get_last_raw_adc_mv();
+            shared.raw_min_adc = pipeline.get_last_raw_min();
+            shared.raw_max_adc = pipeline.get_last_raw_max();
+            for (uint32_t i = 0; i < StageProfiler::STAGE_COUNT; ++i) {
+                shared.stage_avg_us[i] = stage_avg_us[i];
+                shared.stage_p99_us[i] = stage_p99_us[i];
+            }
+            shared.buffer_load_pct = buffer_load_pct;
+
+            g_shared_data.publish();
+
+            // Events after the snapshot, so the frame they trigger shows them
+            uint32_t shot_count = pipeline.get_shot_detector().get_shot_count();
+            if (shot_count < posted_shot_count) {
+                // A load step taken back, or SHOTS RESET
+                posted_shot_count = shot_count;
+                g_events.post(CoreEvent::Type::SHOTS_DOWN, shot_count);
+            }
+            while (posted_shot_count < shot_count) {
+                g_events.post(CoreEvent::Type::SHOT, ++posted_shot_count);
+            }
+
+            bool busy = g_data_collector.is_busy();
+            if (capture_busy && !busy && g_data_collector.is_complete()) {
+                g_events.post(CoreEvent::Type::CAPTURE_DONE, g_data_collector.get_last_capture_id());
+            }
+            capture_busy = busy;
+
+            // 0 until the decimation chain's first output
+            float battery_mv = avg_voltage_mv + ADCConfig::DIODE_DROP_MV;
+            if (avg_voltage_mv > 0.0f) {
+                if (!battery_low && battery_mv < EventConfig::LOW_BATTERY_MV) {
+                    battery_low = true;
+                    g_events.post(CoreEvent::Type::LOW_BATTERY, static_cast<uint32_t>(battery_mv));
+                } else if (battery_low && battery_mv > EventConfig::LOW_BATTERY_MV + EventConfig::LOW_BATTERY_HYSTERESIS_MV) {
+                    battery_low = false;
+                    g_events.post(CoreEvent::Type::BATTERY_OK, static_cast<uint32_t>(battery_mv));
+                }
+            }
         }
-        
-        // Debug: Force increment fallback counter even if mutex fails
-        static uint32_t fallback_counter = 0;
-        fallback_counter++;
-        
-        // Update fallback counter in shared data (using atomic write)
-        g_shared_data.fallback_counter = fallback_counter;
+        g_stage_profiler.record_since(StageProfiler::STAGE_PUBLISH, publish_start);
         
         // Blink status LED to show Core 1 is running
         gpio_put(PIN_STATUS_LED, (loop_counter / 1000) & 1);
@@ -3,11 +3,12 @@
 Download captured ADC data from Pico via USB serial
 
 Usage:
-    python download_data.py <port> <slot_number> [output_file]
+    python download_data.py <port> download <capture_id> [output_file] [--range <from_s> <to_s>]
 
 Examples:
-    python download_data.py /dev/ttyACM0 0
-    python download_data.py COM3 1 capture_001.bin
+    python download_data.py /dev/ttyACM0 download 0
+    python download_data.py COM3 download 1 capture_001.bin
+    python download_data.py COM3 download 1 --range 12.5 14
 """
 
 import serial
@@ -15,6 +16,7 @@ import struct
 import sys
 import time
 from pathlib import Path
+from sample_codec import decode_capture
 
 
 def list_captures(ser):
@@ -28,13 +30,18 @@ def list_captures(ser):
         print(f"  {line}")
 
 
-def download_capture(ser, slot, output_file=None):
-    """Download a specific capture slot"""
+def download_capture(ser, capture_id, output_file=None, time_range=None):
+    """Download a specific capture, or the chunks of a version 3 capture
+    covering time_range = (from_s, to_s)"""
     if output_file is None:
-        output_file = f"capture_{slot:05d}.bin"
+        output_file = f"capture_{capture_id:05d}.bin"
     
-    print(f"Requesting download of slot {slot}...")
-    ser.write(f'DOWNLOAD {slot}\n'.encode())
+    print(f"Requesting download of capture {capture_id}...")
+    if time_range is not None:
+        from_ms, to_ms = (round(t * 1000) for t in time_range)
+        ser.write(f'DOWNLOAD {capture_id} {from_ms} {to_ms}\n'.encode())
+    else:
+        ser.write(f'DOWNLOAD {capture_id}\n'.encode())
     
     # Wait for START message
     start_found = False
@@ -109,13 +116,13 @@ def download_capture(ser, slot, output_file=None):
             magic, version, sample_rate, sample_count, timestamp, checksum = header
             has_filtered = 0
             checksum_filt = 0
-        elif version == 2:
+        elif version in (2, 3):
             header_size = 32
             if len(data) >= 32:
                 header = struct.unpack('<IIIIIIII', data[:32])
                 magic, version, sample_rate, sample_count, timestamp, checksum, has_filtered, checksum_filt = header
             else:
-                print("ERROR: Truncated version 2 header")
+                print(f"ERROR: Truncated version {version} header")
                 return True
         else:
             print(f"ERROR: Unknown version {version}")
@@ -137,8 +144,23 @@ def download_capture(ser, slot, output_file=None):
         raw_data_offset = header_size
         raw_data_size = sample_count * 2
         expected_raw_samples = sample_count
+        samples = None
         
-        if len(data) >= raw_data_offset + raw_data_size:
+        if version == 3:
+            # Coded chunks: decode to check their CRCs and the count
+            v2_size = header_size + sample_count * 2 * (2 if has_filtered else 1)
+            print(f"  Coded Size:   {len(data)} bytes ({v2_size / len(data):.2f}x smaller than v2)")
+            segments, damaged = decode_capture(data[header_size:], bool(has_filtered))
+            samples = [s for _, raw, _ in segments for s in raw]
+            if segments:
+                print(f"  Time Range:   {segments[0][0] / sample_rate:.3f}-"
+                      f"{(segments[-1][0] + len(segments[-1][1])) / sample_rate:.3f} s of the capture")
+            if len(samples) == sample_count and not damaged:
+                print(f"  Samples:      {sample_count} (matches header, {len(segments)} chunks)")
+            else:
+                print(f"  Samples:      {len(samples)} (expected {sample_count}, {len(damaged)} damaged chunks)")
+            actual_raw_samples = len(samples)
+        elif len(data) >= raw_data_offset + raw_data_size:
             actual_raw_samples = expected_raw_samples
             print(f"  Raw Samples:  {actual_raw_samples} (matches header)")
         else:
@@ -146,7 +168,7 @@ def download_capture(ser, slot, output_file=None):
             print(f"  Raw Samples:  {actual_raw_samples} (TRUNCATED: expected {expected_raw_samples})")
         
         # Parse filtered samples if present
-        if version >= 2 and has_filtered:
+        if version == 2 and has_filtered:
             filt_data_offset = raw_data_offset + raw_data_size
             filt_data_size = sample_count * 2
             
@@ -159,8 +181,9 @@ def download_capture(ser, slot, output_file=None):
         
         # Quick stats on raw samples
         if actual_raw_samples > 0:
-            raw_sample_data = data[raw_data_offset:raw_data_offset + actual_raw_samples * 2]
-            samples = struct.unpack(f'<{actual_raw_samples}H', raw_sample_data)
+            if samples is None:
+                raw_sample_data = data[raw_data_offset:raw_data_offset + actual_raw_samples * 2]
+                samples = struct.unpack(f'<{actual_raw_samples}H', raw_sample_data)
             print(f"\nRaw Sample Statistics:")
             print(f"  Min ADC:      {min(samples)}")
             print(f"  Max ADC:      {max(samples)}")
@@ -177,10 +200,10 @@ def download_capture(ser, slot, output_file=None):
     return True
 
 
-def delete_capture(ser, slot):
-    """Delete a specific capture slot"""
-    print(f"Deleting slot {slot}...")
-    ser.write(f'DELETE {slot}\n'.encode())
+def delete_capture(ser, capture_id):
+    """Delete a specific capture"""
+    print(f"Deleting capture {capture_id}...")
+    ser.write(f'DELETE {capture_id}\n'.encode())
     time.sleep(0.5)
     
     while ser.in_waiting:
@@ -193,12 +216,14 @@ def main():
         print("Usage: python download_data.py <port> [command] [args...]")
         print("\nCommands:")
         print("  list                    - List all captures")
-        print("  download <slot> [file]  - Download capture to file")
-        print("  delete <slot>           - Delete a capture")
+        print("  download <id> [file] [--range <from_s> <to_s>]")
+        print("                          - Download capture (or a time range of a v3 capture) to file")
+        print("  delete <id>             - Delete a capture")
         print("\nExamples:")
         print("  python download_data.py /dev/ttyACM0 list")
         print("  python download_data.py COM3 download 0")
         print("  python download_data.py /dev/ttyACM0 download 1 my_capture.bin")
+        print("  python download_data.py COM3 download 1 --range 12.5 14")
         print("  python download_data.py COM3 delete 0")
         sys.exit(1)
     
@@ -227,22 +252,28 @@ def main():
         
         elif command == 'download':
             if len(sys.argv) < 4:
-                print("ERROR: download requires slot number")
+                print("ERROR: download requires capture id")
                 sys.exit(1)
             
-            slot = int(sys.argv[3])
-            output_file = sys.argv[4] if len(sys.argv) > 4 else None
+            args = sys.argv[4:]
+            time_range = None
+            if '--range' in args:
+                at = args.index('--range')
+                time_range = (float(args[at + 1]), float(args[at + 2]))
+                del args[at:at + 3]
+            capture_id = int(sys.argv[3])
+            output_file = args[0] if args else None
             
-            success = download_capture(ser, slot, output_file)
+            success = download_capture(ser, capture_id, output_file, time_range)
             sys.exit(0 if success else 1)
         
         elif command == 'delete':
             if len(sys.argv) < 4:
-                print("ERROR: delete requires slot number")
+                print("ERROR: delete requires capture id")
                 sys.exit(1)
             
-            slot = int(sys.argv[3])
-            delete_capture(ser, slot)
+            capture_id = int(sys.argv[3])
+            delete_capture(ser, capture_id)
         
         else:
             print(f"ERROR: Unknown command '{command}'")
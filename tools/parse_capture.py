@@ -3,7 +3,10 @@
 Parse and visualize captured ADC data from Pico
 
 Usage:
-    python parse_capture.py <capture_file.bin>
+    python parse_capture.py <capture_file.bin> [<from_s> <to_s>]
+
+A time range (seconds from the start of the capture) limits the output to
+that part; version 3 files only decode the chunks it touches.
 
 Creates:
     - CSV file with parsed data
@@ -12,17 +15,19 @@ Creates:
 
 import struct
 import sys
+import zlib
 import numpy as np
 import matplotlib.pyplot as plt
 from pathlib import Path
+from sample_codec import decode_capture
 
 
-def parse_capture(filename):
-    """Parse binary capture file"""
+def parse_capture(filename, start_s=None, end_s=None):
+    """Parse binary capture file, optionally only [start_s, end_s)"""
     with open(filename, 'rb') as f:
         data = f.read()
     
-    # Version 1: 24 bytes header, Version 2: 32 bytes header
+    # Version 1: 24 bytes header, Version 2/3: 32 bytes header
     if len(data) < 24:
         print("ERROR: File too small (missing header)")
         return None
@@ -41,10 +46,10 @@ def parse_capture(filename):
         magic, version, sample_rate, sample_count, timestamp, checksum = header
         has_filtered = 0
         checksum_filt = 0
-    elif version == 2:
+    elif version in (2, 3):
         header_size = 32
         if len(data) < header_size:
-            print("ERROR: File too small for version 2 header")
+            print(f"ERROR: File too small for version {version} header")
             return None
         header = struct.unpack('<IIIIIIII', data[:header_size])
         magic, version, sample_rate, sample_count, timestamp, checksum, has_filtered, checksum_filt = header
@@ -66,6 +71,13 @@ def parse_capture(filename):
         if has_filtered:
             print(f"Filt Checksum: 0x{checksum_filt:08X}")
     
+    start = int(start_s * sample_rate) if start_s is not None else None
+    end = int(np.ceil(end_s * sample_rate)) if end_s is not None else None
+    
+    if version == 3:
+        return parse_coded(data[header_size:], header_size, magic, version, sample_rate,
+                           sample_count, timestamp, has_filtered, start, end)
+    
     # Parse raw samples
     raw_data_offset = header_size
     raw_data_size = sample_count * 2
@@ -78,7 +90,6 @@ def parse_capture(filename):
     raw_samples = struct.unpack(f'<{sample_count}H', data[raw_data_offset:raw_data_offset + raw_data_size])
     
     # Verify raw checksum
-    import zlib
     calculated_crc = zlib.crc32(data[raw_data_offset:raw_data_offset + raw_data_size]) & 0xFFFFFFFF
     
     if calculated_crc == checksum:
@@ -106,6 +117,14 @@ def parse_capture(filename):
         else:
             print(f"WARNING: File truncated (missing filtered data)")
     
+    positions = np.arange(len(raw_samples))
+    if start is not None or end is not None:
+        keep = slice(start, end)
+        positions = positions[keep]
+        raw_samples = raw_samples[keep]
+        if filtered_samples is not None:
+            filtered_samples = filtered_samples[keep]
+    
     return {
         'header': {
             'magic': magic,
@@ -117,11 +136,53 @@ def parse_capture(filename):
             'has_filtered': has_filtered,
             'checksum_filt': checksum_filt
         },
+        'positions': positions,
         'raw_samples': np.array(raw_samples, dtype=np.uint16),
         'filtered_samples': np.array(filtered_samples, dtype=np.uint16) if filtered_samples else None
     }
 
 
+def parse_coded(payload, header_size, magic, version, sample_rate,
+                sample_count, timestamp, has_filtered, start, end):
+    """Decode the chunks of a version 3 (coded) capture within [start, end)"""
+    segments, damaged = decode_capture(payload, bool(has_filtered), start, end)
+    
+    stored = header_size + len(payload)
+    print(f"Coded Size:   {stored} bytes ({(header_size + sample_count * 2 * (2 if has_filtered else 1)) / stored:.2f}x smaller than v2)")
+    if damaged:
+        for chunk in damaged:
+            print(f"Chunk:        ✗ Damaged, skipped {chunk.sample_count} samples at "
+                  f"{chunk.first_sample / sample_rate:.3f} s")
+    else:
+        print(f"Chunks:       ✓ {len(segments)} valid")
+    
+    if not segments:
+        print("ERROR: No samples in range")
+        return None
+    
+    positions = np.concatenate([np.arange(first, first + len(raw)) for first, raw, _ in segments])
+    raw_samples = np.concatenate([np.array(raw, dtype=np.uint16) for _, raw, _ in segments])
+    filtered_samples = None
+    if has_filtered:
+        filtered_samples = np.concatenate([np.array(filt, dtype=np.uint16) for _, _, filt in segments])
+    
+    return {
+        'header': {
+            'magic': magic,
+            'version': version,
+            'sample_rate': sample_rate,
+            'sample_count': sample_count,
+            'timestamp': timestamp,
+            'checksum': 0,
+            'has_filtered': has_filtered,
+            'checksum_filt': 0
+        },
+        'positions': positions,
+        'raw_samples': raw_samples,
+        'filtered_samples': filtered_samples
+    }
+
+
 def analyze_samples(data):
     """Analyze and print statistics"""
     raw_samples = data['raw_samples']
@@ -137,9 +198,9 @@ def analyze_samples(data):
     if filtered_samples is not None:
         filtered_voltage = (filtered_samples / 4095.0) * 3.3 * 3.8
     
-    # Time axis
+    # Time axis (from the start of the capture; gaps where chunks were skipped)
     duration_sec = len(raw_samples) / sample_rate
-    time_ms = np.arange(len(raw_samples)) * (1000.0 / sample_rate)
+    time_ms = data['positions'] * (1000.0 / sample_rate)
     
     print("="*60)
     print("Sample Statistics")
@@ -262,20 +323,23 @@ def plot_data(filename, time_ms, raw_voltage, filtered_voltage, baseline, thresh
 
 
 def main():
-    if len(sys.argv) < 2:
-        print("Usage: python parse_capture.py <capture_file.bin>")
-        print("\nExample:")
+    if len(sys.argv) not in (2, 4):
+        print("Usage: python parse_capture.py <capture_file.bin> [<from_s> <to_s>]")
+        print("\nExamples:")
         print("  python parse_capture.py capture_00001.bin")
+        print("  python parse_capture.py capture_00001.bin 12.5 14")
         sys.exit(1)
     
     filename = Path(sys.argv[1])
+    start_s = float(sys.argv[2]) if len(sys.argv) == 4 else None
+    end_s = float(sys.argv[3]) if len(sys.argv) == 4 else None
     
     if not filename.exists():
         print(f"ERROR: File not found: {filename}")
         sys.exit(1)
     
     # Parse file
-    data = parse_capture(filename)
+    data = parse_capture(filename, start_s, end_s)
     if data is None:
         sys.exit(1)
     
@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+"""
+Decoder for version 3 capture files (delta + Rice coded samples)
+
+Mirrors lib/sample_codec.h: blocks of 128 samples, each starting with a
+4-bit Rice parameter per channel (raw, then filtered if present),
+followed by the raw codes and then the filtered codes. Each code is a
+zigzag-mapped difference from the previous sample of the same channel:
+q one bits, a zero bit and k low bits, or 16 one bits and the 16-bit
+value. Bits are packed LSB first.
+
+A capture stores the samples in chunks of up to 2048, each a 20-byte
+header (magic "CK", sample count, first sample, timestamp in ms, coded
+size, CRC32) and its own coded stream padded to 4 bytes. An index of
+chunk offsets and a trailer (chunk count, CRC32, "CIDX") end the file,
+so any time range can be decoded without the chunks before it.
+
+Usage as a module:
+    from sample_codec import decode_capture
+    segments, damaged = decode_capture(payload, has_filtered, start, end)
+    for first_sample, raw, filtered in segments: ...
+"""
+
+import struct
+import zlib
+from collections import namedtuple
+
+BLOCK_SAMPLES = 128
+K_BITS = 4
+ESCAPE_Q = 16
+
+CHUNK_SAMPLES = 2048
+CHUNK_MAGIC = 0x4B43
+INDEX_MAGIC = 0x58444943
+CHUNK_HEADER = struct.Struct('<HHIIII')   # magic, samples, first, timestamp, coded size, crc
+INDEX_TRAILER = struct.Struct('<III')     # chunk count, crc, magic
+
+Chunk = namedtuple('Chunk', 'offset first_sample sample_count timestamp coded valid')
+
+
+class CodecError(Exception):
+    pass
+
+
+def decode(payload, sample_count, has_filtered):
+    """Decode one chunk's coded stream into (raw, filtered) lists of ints.
+
+    filtered is None if the capture has no filtered channel. Raises
+    CodecError if the stream ends early (the error carries the samples
+    decoded so far as .raw / .filtered).
+    """
+    data = bytes(payload) + bytes(4)  # Padding for the 4-byte reads below
+    total_bits = (len(data) - 4) * 8
+    pos = 0
+
+    raw = []
+    filtered = [] if has_filtered else None
+    prev = [0, 0]
+
+    def get(width):
+        nonlocal pos
+        if pos + width > total_bits:
+            raise EOFError
+        byte = pos >> 3
+        word = int.from_bytes(data[byte:byte + 4], 'little')
+        value = (word >> (pos & 7)) & ((1 << width) - 1)
+        pos += width
+        return value
+
+    def read_channel(out, channel, n, k):
+        value = prev[channel]
+        for _ in range(n):
+            # Unary part: count ones up to the escape length
+            q = 0
+            while q < ESCAPE_Q and get(1):
+                q += 1
+            z = (q << k) | get(k) if q < ESCAPE_Q else get(16)
+            diff = (z >> 1) ^ -(z & 1)
+            value = (value + diff) & 0xFFFF
+            out.append(value)
+        prev[channel] = value
+
+    decoded = 0
+    try:
+        while decoded < sample_count:
+            n = min(BLOCK_SAMPLES, sample_count - decoded)
+            raw_k = get(K_BITS)
+            filtered_k = get(K_BITS) if has_filtered else 0
+            block_raw = []
+            block_filtered = []
+            read_channel(block_raw, 0, n, raw_k)
+            if has_filtered:
+                read_channel(block_filtered, 1, n, filtered_k)
+            raw.extend(block_raw)
+            if has_filtered:
+                filtered.extend(block_filtered)
+            decoded += n
+    except EOFError:
+        error = CodecError(f"coded stream ends after {decoded} of {sample_count} samples")
+        error.raw = raw
+        error.filtered = filtered
+        raise error
+
+    return raw, filtered
+
+
+def _chunk_at(payload, offset, end):
+    """The chunk whose header is at offset, or None if it does not fit"""
+    if offset + CHUNK_HEADER.size > end:
+        return None
+    magic, count, first, timestamp, size, crc = CHUNK_HEADER.unpack_from(payload, offset)
+    start = offset + CHUNK_HEADER.size
+    if magic != CHUNK_MAGIC or not 0 < count <= CHUNK_SAMPLES or start + size > end:
+        return None
+    coded = bytes(payload[start:start + size])
+    check = zlib.crc32(payload[offset:offset + 16], zlib.crc32(coded)) & 0xFFFFFFFF
+    return Chunk(offset, first, count, timestamp, coded, check == crc)
+
+
+def read_chunks(payload):
+    """List the chunks of a version 3 payload (the bytes after the header).
+
+    Uses the index at the end; if that is missing or damaged (e.g. a
+    truncated download) the chunk headers are walked from the start
+    instead. Chunk.valid is False where the CRC does not match.
+    """
+    payload = bytes(payload)
+    end = len(payload)
+    if end >= INDEX_TRAILER.size:
+        count, crc, magic = INDEX_TRAILER.unpack_from(payload, end - INDEX_TRAILER.size)
+        index_start = end - INDEX_TRAILER.size - 4 * count
+        if magic == INDEX_MAGIC and index_start >= 0:
+            index = payload[index_start:end - INDEX_TRAILER.size]
+            if zlib.crc32(index) & 0xFFFFFFFF == crc:
+                offsets = struct.unpack(f'<{count}I', index)
+                chunks = [_chunk_at(payload, offset, index_start) for offset in offsets]
+                return [c for c in chunks if c is not None]
+
+    chunks = []
+    offset = 0
+    while True:
+        chunk = _chunk_at(payload, offset, end)
+        if chunk is None:
+            return chunks
+        chunks.append(chunk)
+        offset += CHUNK_HEADER.size + len(chunk.coded)
+
+
+def decode_capture(payload, has_filtered, start=None, end=None):
+    """Decode the chunks of a version 3 payload overlapping samples [start, end).
+
+    Returns (segments, damaged): segments is a list of (first_sample, raw,
+    filtered) per decoded chunk, trimmed to the range (filtered is None
+    without a filtered channel); damaged lists the Chunks skipped for a
+    CRC or coding error.
+    """
+    segments = []
+    damaged = []
+    for chunk in read_chunks(payload):
+        last = chunk.first_sample + chunk.sample_count
+        if (start is not None and last <= start) or (end is not None and chunk.first_sample >= end):
+            continue
+        if not chunk.valid:
+            damaged.append(chunk)
+            continue
+        try:
+            raw, filtered = decode(chunk.coded, chunk.sample_count, has_filtered)
+        except CodecError:
+            damaged.append(chunk)
+            continue
+        lo = max(0, start - chunk.first_sample) if start is not None else 0
+        hi = min(chunk.sample_count, end - chunk.first_sample) if end is not None else chunk.sample_count
+        segments.append((chunk.first_sample + lo, raw[lo:hi],
+                         filtered[lo:hi] if filtered is not None else None))
+    return segments, damaged